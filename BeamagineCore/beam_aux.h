@@ -90,5 +90,18 @@ typedef struct indexTdc{
     static const uint8_t both = 3;
 }indexTdc;
 
+//! @brief  Converts a device timestamp (hhmmssmmm) to milliseconds of the day
+//! @param  timestamp Timestamp as received from the L3Cam
+//! @return milliseconds elapsed since 00:00:00.000
+inline uint32_t timestampToMilliseconds(uint32_t timestamp)
+{
+    uint32_t hours = timestamp / 10000000;
+    uint32_t minutes = (timestamp / 100000) % 100;
+    uint32_t seconds = (timestamp / 1000) % 100;
+    uint32_t milliseconds = timestamp % 1000;
+
+    return (((hours * 60) + minutes) * 60 + seconds) * 1000 + milliseconds;
+}
+
 #endif // BEAM_AUX_H
 
@@ -0,0 +1,150 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "beam_parallel.h"
+
+#include <algorithm>
+
+#include <QDebug>
+
+//! Chunks per thread, more chunks balance better the loops with uneven work
+static const size_t chunks_per_thread = 4;
+
+beamThreadPool &beamThreadPool::instance()
+{
+    static beamThreadPool pool;
+    return pool;
+}
+
+beamThreadPool::beamThreadPool()
+{
+    m_body = NULL;
+    m_count = 0;
+    m_chunk = 0;
+    m_next = 0;
+    m_generation = 0;
+    m_active_workers = 0;
+    m_stop = false;
+
+    unsigned int threads = std::thread::hardware_concurrency();
+    if(threads == 0){
+        threads = 2;
+    }
+
+    //!the thread calling parallelFor works as one more thread
+    for(unsigned int i = 1; i < threads; ++i){
+        m_workers.push_back(std::thread(&beamThreadPool::workerLoop, this));
+    }
+}
+
+beamThreadPool::~beamThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_condition.notify_all();
+
+    for(size_t i = 0; i < m_workers.size(); ++i){
+        m_workers[i].join();
+    }
+}
+
+int beamThreadPool::getNumberOfThreads() const
+{
+    return (int)m_workers.size() + 1;
+}
+
+void beamThreadPool::runChunks()
+{
+    size_t begin;
+    while((begin = m_next.fetch_add(m_chunk)) < m_count){
+        size_t end = std::min(begin + m_chunk, m_count);
+        try{
+            (*m_body)(begin, end);
+        }catch(...){
+            qDebug()<<"Unhandled error at beamThreadPool::runChunks";
+        }
+    }
+}
+
+void beamThreadPool::workerLoop()
+{
+    uint64_t generation = 0;
+
+    while(1){
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_condition.wait(lock, [&]{ return m_stop || m_generation != generation; });
+            if(m_stop){
+                return;
+            }
+            generation = m_generation;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_active_workers;
+        }
+        m_done_condition.notify_one();
+    }
+}
+
+void beamThreadPool::parallelFor(size_t count, size_t min_chunk, const std::function<void(size_t, size_t)> &body)
+{
+    if(count == 0){
+        return;
+    }
+
+    size_t max_chunks = m_workers.size() > 0 ? (m_workers.size() + 1) * chunks_per_thread : 1;
+    size_t chunks = std::min(count / std::max(min_chunk, (size_t)1), max_chunks);
+    if(chunks <= 1){
+        body(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(m_call_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_body = &body;
+        m_count = count;
+        m_chunk = (count + chunks - 1) / chunks;
+        m_next = 0;
+        m_active_workers = (int)m_workers.size();
+        ++m_generation;
+    }
+    m_work_condition.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_condition.wait(lock, [&]{ return m_active_workers == 0; });
+    m_body = NULL;
+}
@@ -0,0 +1,92 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BEAM_PARALLEL_H
+#define BEAM_PARALLEL_H
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! @brief  Persistent pool of worker threads used to split the per point work of the
+//!         host processing stages. Only one parallel loop runs at a time, the calling
+//!         thread works on the loop too.
+class beamThreadPool
+{
+public:
+    //! @brief  Returns the pool shared by the application
+    static beamThreadPool &instance();
+
+    ~beamThreadPool();
+
+    //! @brief  Returns the number of threads working on a loop, including the caller
+    int getNumberOfThreads() const;
+
+    //! @brief  Runs body over [0, count) split in chunks and waits until all of them are done
+    //! @param  count Number of items
+    //! @param  min_chunk Minimum number of items per chunk, small loops run in the caller only
+    //! @param  body Function called with the [begin, end) range of each chunk
+    //! @return none
+    void parallelFor(size_t count, size_t min_chunk, const std::function<void(size_t, size_t)> &body);
+
+private:
+    beamThreadPool();
+
+    void workerLoop();
+
+    void runChunks();
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_call_mutex;
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_condition;
+    std::condition_variable m_done_condition;
+
+    const std::function<void(size_t, size_t)> *m_body;
+    size_t m_count;
+    size_t m_chunk;
+    std::atomic<size_t> m_next;
+
+    uint64_t m_generation;
+    int m_active_workers;
+    bool m_stop;
+};
+
+//! @brief  Shortcut to beamThreadPool::instance().parallelFor
+inline void beamParallelFor(size_t count, size_t min_chunk, const std::function<void(size_t, size_t)> &body)
+{
+    beamThreadPool::instance().parallelFor(count, min_chunk, body);
+}
+
+#endif // BEAM_PARALLEL_H
@@ -0,0 +1,333 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "streamCoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+const int streamCoder::max_code_bits;
+const int streamCoder::number_of_symbols;
+
+//! Size of a stream before its bits, its size and the code lengths as 4 bit values
+static const size_t stream_header_bytes = sizeof(uint32_t) + (streamCoder::number_of_symbols + 1) / 2;
+
+static const int code_table_size = 1 << streamCoder::max_code_bits;
+
+typedef struct bitWriter{
+    uint8_t *output;
+    size_t position;
+    uint64_t bits;
+    int count;
+}bitWriter;
+
+//! @brief  Returns the position of the highest bit set plus one, 0 for 0
+static inline int bitLength(uint32_t value)
+{
+    if(value == 0){
+        return 0;
+    }
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, value);
+    return index + 1;
+#else
+    return 32 - __builtin_clz(value);
+#endif
+}
+
+//! @brief  Appends up to 31 bits, the lowest bit first
+static inline void writeBits(bitWriter &writer, uint32_t value, int count)
+{
+    writer.bits |= (uint64_t)value << writer.count;
+    writer.count += count;
+    if(writer.count >= 32){
+        uint32_t word = (uint32_t)writer.bits;
+        memcpy(writer.output + writer.position, &word, sizeof(word));
+        writer.position += sizeof(word);
+        writer.bits >>= 32;
+        writer.count -= 32;
+    }
+}
+
+static inline void flushBits(bitWriter &writer)
+{
+    while(writer.count > 0){
+        writer.output[writer.position++] = (uint8_t)writer.bits;
+        writer.bits >>= 8;
+        writer.count -= 8;
+    }
+    writer.count = 0;
+}
+
+static inline uint16_t reverseBits(uint16_t code, int length)
+{
+    uint16_t reversed = 0;
+    for(int i = 0; i < length; i++){
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    return reversed;
+}
+
+//! @brief  Computes the Huffman code lengths of the symbols used, up to max_code_bits. The
+//!         frequencies are halved until the longest code fits.
+static void buildCodeLengths(const uint32_t *frequencies, uint8_t *lengths)
+{
+    const int symbols = streamCoder::number_of_symbols;
+    uint32_t scaled[symbols];
+    memcpy(scaled, frequencies, sizeof(scaled));
+
+    while(true){
+        //!leaves first, then the nodes merged, every one points to its parent
+        uint64_t weights[2 * symbols];
+        int parents[2 * symbols];
+        bool active[2 * symbols];
+        int nodes = symbols;
+        int used = 0;
+        for(int i = 0; i < symbols; i++){
+            weights[i] = scaled[i];
+            parents[i] = -1;
+            active[i] = scaled[i] > 0;
+            used += active[i];
+        }
+
+        memset(lengths, 0, symbols);
+        if(used == 0){
+            return;
+        }
+        if(used == 1){
+            for(int i = 0; i < symbols; i++){
+                lengths[i] = active[i] ? 1 : 0;
+            }
+            return;
+        }
+
+        for(int merges = 0; merges < used - 1; merges++){
+            int first = -1;
+            int second = -1;
+            for(int i = 0; i < nodes; i++){
+                if(!active[i]){
+                    continue;
+                }
+                if(first < 0 || weights[i] < weights[first]){
+                    second = first;
+                    first = i;
+                }else if(second < 0 || weights[i] < weights[second]){
+                    second = i;
+                }
+            }
+            weights[nodes] = weights[first] + weights[second];
+            parents[nodes] = -1;
+            active[nodes] = true;
+            parents[first] = nodes;
+            parents[second] = nodes;
+            active[first] = false;
+            active[second] = false;
+            nodes++;
+        }
+
+        int longest = 0;
+        for(int i = 0; i < symbols; i++){
+            if(scaled[i] == 0){
+                continue;
+            }
+            int depth = 0;
+            for(int node = i; parents[node] >= 0; node = parents[node]){
+                depth++;
+            }
+            lengths[i] = depth;
+            longest = std::max(longest, depth);
+        }
+        if(longest <= streamCoder::max_code_bits){
+            return;
+        }
+        for(int i = 0; i < symbols; i++){
+            if(scaled[i] > 0){
+                scaled[i] = (scaled[i] + 1) / 2;
+            }
+        }
+    }
+}
+
+//! @brief  Assigns the canonical codes of the lengths, reversed so they are read lowest bit first
+//! @return false if the lengths do not make a prefix code
+static bool buildCodes(const uint8_t *lengths, uint16_t *codes)
+{
+    int length_counts[streamCoder::max_code_bits + 1] = {0};
+    uint32_t kraft = 0;
+    for(int i = 0; i < streamCoder::number_of_symbols; i++){
+        if(lengths[i] > streamCoder::max_code_bits){
+            return false;
+        }
+        if(lengths[i] > 0){
+            length_counts[lengths[i]]++;
+            kraft += code_table_size >> lengths[i];
+        }
+    }
+    if(kraft > (uint32_t)code_table_size){
+        return false;
+    }
+
+    uint16_t next_code[streamCoder::max_code_bits + 1] = {0};
+    uint16_t code = 0;
+    for(int bits = 1; bits <= streamCoder::max_code_bits; bits++){
+        code = (code + length_counts[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+    for(int i = 0; i < streamCoder::number_of_symbols; i++){
+        codes[i] = (lengths[i] > 0) ? reverseBits(next_code[lengths[i]]++, lengths[i]) : 0;
+    }
+    return true;
+}
+
+streamCoder::streamCoder()
+{
+    m_decode_table.resize(code_table_size);
+}
+
+void streamCoder::encode(const uint32_t *values, size_t count, std::vector<uint8_t> &encoded)
+{
+    uint32_t frequencies[number_of_symbols] = {0};
+    for(size_t i = 0; i < count; i++){
+        frequencies[bitLength(values[i])]++;
+    }
+    uint8_t lengths[number_of_symbols];
+    uint16_t codes[number_of_symbols];
+    buildCodeLengths(frequencies, lengths);
+    buildCodes(lengths, codes);
+
+    //!room for the longest code and 31 bits per value
+    size_t start = encoded.size();
+    encoded.resize(start + stream_header_bytes + (count * (max_code_bits + 31) + 7) / 8 + sizeof(uint32_t));
+
+    uint8_t *stream = &encoded[start];
+    for(int i = 0; i < number_of_symbols; i += 2){
+        uint8_t high = (i + 1 < number_of_symbols) ? lengths[i + 1] : 0;
+        stream[sizeof(uint32_t) + i / 2] = lengths[i] | (high << 4);
+    }
+
+    bitWriter writer;
+    writer.output = stream + stream_header_bytes;
+    writer.position = 0;
+    writer.bits = 0;
+    writer.count = 0;
+    for(size_t i = 0; i < count; i++){
+        uint32_t value = values[i];
+        int length = bitLength(value);
+        writeBits(writer, codes[length], lengths[length]);
+        //!the highest bit is given by the length
+        if(length > 1){
+            writeBits(writer, value & ((1u << (length - 1)) - 1), length - 1);
+        }
+    }
+    flushBits(writer);
+
+    uint32_t stream_bytes = stream_header_bytes + writer.position;
+    memcpy(stream, &stream_bytes, sizeof(stream_bytes));
+    encoded.resize(start + stream_bytes);
+}
+
+size_t streamCoder::decode(const uint8_t *stream, size_t bytes, size_t count, uint32_t *values)
+{
+    if(bytes < stream_header_bytes){
+        return 0;
+    }
+    uint32_t stream_bytes;
+    memcpy(&stream_bytes, stream, sizeof(stream_bytes));
+    if(stream_bytes < stream_header_bytes || stream_bytes > bytes){
+        return 0;
+    }
+
+    uint8_t lengths[number_of_symbols];
+    for(int i = 0; i < number_of_symbols; i++){
+        uint8_t packed = stream[sizeof(uint32_t) + i / 2];
+        lengths[i] = (i % 2 == 0) ? (packed & 0x0F) : (packed >> 4);
+    }
+    uint16_t codes[number_of_symbols];
+    if(!buildCodes(lengths, codes)){
+        return 0;
+    }
+
+    //!every entry holds the symbol of the code in its lowest bits and the code length
+    std::fill(m_decode_table.begin(), m_decode_table.end(), 0);
+    for(int symbol = 0; symbol < number_of_symbols; symbol++){
+        int length = lengths[symbol];
+        if(length == 0){
+            continue;
+        }
+        for(int high = 0; high < (code_table_size >> length); high++){
+            m_decode_table[codes[symbol] | (high << length)] = (uint16_t)((symbol << 4) | length);
+        }
+    }
+
+    const uint8_t *data = stream + stream_header_bytes;
+    const uint8_t *end = stream + stream_bytes;
+    uint64_t bits = 0;
+    int available = 0;
+
+    for(size_t i = 0; i < count; i++){
+        //!at least the longest code and 31 bits are available, zeros past the end
+        if(end - data >= 8){
+            uint64_t word;
+            memcpy(&word, data, sizeof(word));
+            bits |= word << available;
+            data += (63 - available) >> 3;
+            available |= 56;
+        }else{
+            while(available <= 56 && data < end){
+                bits |= (uint64_t)(*data++) << available;
+                available += 8;
+            }
+        }
+
+        uint16_t entry = m_decode_table[bits & (code_table_size - 1)];
+        int length = entry & 0x0F;
+        if(length == 0){
+            return 0;
+        }
+        int symbol = entry >> 4;
+        bits >>= length;
+        available -= length;
+
+        uint32_t value = symbol;
+        if(symbol > 1){
+            int extra = symbol - 1;
+            value = (1u << extra) | (uint32_t)(bits & ((1ull << extra) - 1));
+            bits >>= extra;
+            available -= extra;
+        }
+        if(available < 0){
+            return 0;
+        }
+        values[i] = value;
+    }
+    return stream_bytes;
+}
@@ -0,0 +1,70 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef STREAMCODER_H
+#define STREAMCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+//! @brief  Entropy coder of the streams of values of the codecs of the recordings. Every value
+//!         is split in its bit length, Huffman coded, and the bits below the highest one,
+//!         written as they are, so small values take the fewest bits. A stream is its size,
+//!         the code lengths as 4 bit values and its bits.
+//!         The decoding table is kept between streams, use one coder per thread.
+class streamCoder
+{
+public:
+    streamCoder();
+
+    //! Longest Huffman code, the decoder looks the codes up in a table of this many bits
+    static const int max_code_bits = 12;
+
+    //! Bit lengths of a 32 bit value, 0 to 32
+    static const int number_of_symbols = 33;
+
+    //! @brief  Appends a stream of values
+    //! @param  values Values to code, zigzag mapped if they can be negative
+    //! @param  count Number of values
+    //! @param  encoded The stream is appended to it
+    //! @return none
+    void encode(const uint32_t *values, size_t count, std::vector<uint8_t> &encoded);
+
+    //! @brief  Decodes a stream appended by encode
+    //! @param  stream Start of the stream
+    //! @param  bytes Bytes available from the start of the stream
+    //! @param  count Number of values of the stream
+    //! @param  values Output values, it can hold count values
+    //! @return bytes of the stream, 0 if it is not valid
+    size_t decode(const uint8_t *stream, size_t bytes, size_t count, uint32_t *values);
+
+private:
+
+    std::vector<uint16_t> m_decode_table;
+};
+
+#endif // STREAMCODER_H
@@ -0,0 +1,536 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "glPointCloudWidget.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_4_Core>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QSurfaceFormat>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_PROGRAM_POINT_SIZE
+#define GL_PROGRAM_POINT_SIZE 0x8642
+#endif
+
+//! Points per slot, the largest frame the receiver can assemble (480*150*4)
+static const int32_t max_points_per_frame = 288000;
+
+//! Length of the axis in mm
+static const float axis_length = 1000.0f;
+
+static const float degrees_to_radians = 0.017453292f;
+
+//! Intensity shown as white when the points are colored by intensity
+static const float max_intensity = 255.0f;
+
+static const char *vertex_shader_source =
+        "in vec3 position;\n"
+        "in int intensity;\n"
+        "in int color;\n"
+        "uniform mat4 mvp;\n"
+        "uniform float position_scale;\n"
+        "uniform float point_size;\n"
+        "uniform int use_rgb;\n"
+        "uniform float max_intensity;\n"
+        "out vec3 vertex_color;\n"
+        "void main(){\n"
+        "    gl_Position = mvp * vec4(position * position_scale, 1.0);\n"
+        "    gl_PointSize = point_size;\n"
+        "    if(use_rgb != 0){\n"
+        "        vertex_color = vec3(float((color >> 16) & 255), float((color >> 8) & 255), float(color & 255)) / 255.0;\n"
+        "    }else{\n"
+        "        vertex_color = vec3(clamp(float(intensity) / max_intensity, 0.0, 1.0));\n"
+        "    }\n"
+        "}\n";
+
+static const char *fragment_shader_source =
+        "in vec3 vertex_color;\n"
+        "out vec4 fragment_color;\n"
+        "void main(){\n"
+        "    fragment_color = vec4(vertex_color, 1.0);\n"
+        "}\n";
+
+glPointCloudWidget::glPointCloudWidget(QWidget *parent) :
+    QOpenGLWidget(parent)
+{
+    m_gl44 = NULL;
+    m_points_buffer = 0;
+    m_axis_buffer = 0;
+    m_initialized = false;
+    m_rendering_enabled = false;
+    m_persistent = false;
+    m_mapped_points = NULL;
+    m_slot_capacity = max_points_per_frame;
+    m_ready_slot = -1;
+    m_drawn_slot = -1;
+    m_frames_dropped = 0;
+
+    for(int slot = 0; slot < number_of_slots; ++slot){
+        m_slots[slot].state = slot_free;
+        m_slots[slot].number_of_points = 0;
+        m_slots[slot].timestamp = 0;
+        m_slots[slot].fence = NULL;
+    }
+
+    m_point_size = 2.0f;
+    m_background = Qt::black;
+    m_show_axis = true;
+    m_use_rgb = true;
+
+    //!a 3.3 core context is asked, Mesa and most drivers return their highest core version
+    QSurfaceFormat surface_format = format();
+    if(QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGL){
+        surface_format.setVersion(3, 3);
+        surface_format.setProfile(QSurfaceFormat::CoreProfile);
+    }
+    setFormat(surface_format);
+
+    resetCamera();
+}
+
+glPointCloudWidget::~glPointCloudWidget()
+{
+    makeCurrent();
+    releaseBuffers();
+    doneCurrent();
+}
+
+bool glPointCloudWidget::writeFrame(const tPointPcd *points, int32_t number_of_points, uint32_t timestamp)
+{
+    //!the buffers can be released from the GUI thread, it is checked with the slot taken
+    int slot = -1;
+    tPointPcd *memory = NULL;
+    {
+        std::lock_guard<std::mutex> lock(m_slots_mutex);
+        if(!m_initialized || !m_rendering_enabled){
+            return false;
+        }
+        for(int s = 0; s < number_of_slots; ++s){
+            if(m_slots[s].state == slot_free){
+                m_slots[s].state = slot_writing;
+                slot = s;
+                memory = getSlotMemory(s);
+                break;
+            }
+        }
+        if(slot < 0){
+            ++m_frames_dropped;
+            return false;
+        }
+    }
+
+    //!the slot is only used by this thread while it is being written, releaseBuffers waits for it
+    number_of_points = std::min(std::max(number_of_points, 0), m_slot_capacity);
+    memcpy(memory, points, sizeof(tPointPcd) * number_of_points);
+
+    {
+        std::lock_guard<std::mutex> lock(m_slots_mutex);
+        m_slots[slot].number_of_points = number_of_points;
+        m_slots[slot].timestamp = timestamp;
+        m_slots[slot].state = slot_ready;
+
+        //!a frame that was not drawn yet is replaced by the newer one
+        if(m_ready_slot >= 0){
+            m_slots[m_ready_slot].state = slot_free;
+        }
+        m_ready_slot = slot;
+
+        //!the widget can be destroyed as soon as the lock is released
+        m_slot_written.notify_all();
+        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+void glPointCloudWidget::setRenderingEnabled(bool enabled)
+{
+    m_rendering_enabled = enabled;
+    update();
+}
+
+bool glPointCloudWidget::isRenderingEnabled() const
+{
+    return m_rendering_enabled;
+}
+
+void glPointCloudWidget::setPointSize(float point_size)
+{
+    m_point_size = std::max(point_size, 1.0f);
+    update();
+}
+
+void glPointCloudWidget::setBackgroundColor(const QColor &color)
+{
+    m_background = color;
+    update();
+}
+
+void glPointCloudWidget::setShowAxis(bool show)
+{
+    m_show_axis = show;
+    update();
+}
+
+void glPointCloudWidget::setUseRgbField(bool use_rgb)
+{
+    m_use_rgb = use_rgb;
+    update();
+}
+
+bool glPointCloudWidget::usesPersistentMapping() const
+{
+    return m_persistent;
+}
+
+uint64_t glPointCloudWidget::getFramesDropped() const
+{
+    return m_frames_dropped;
+}
+
+void glPointCloudWidget::resetCamera()
+{
+    m_target = QVector3D(0.0f, 0.0f, 10.0f);
+    m_distance = 12.0f;
+    m_yaw = 0.0f;
+    m_pitch = 15.0f;
+    update();
+}
+
+void glPointCloudWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, [this](){
+        m_initialized = false;
+        makeCurrent();
+        releaseBuffers();
+        doneCurrent();
+    });
+
+    bool is_es = context()->isOpenGLES();
+    QByteArray version = is_es ? "#version 300 es\nprecision highp float;\nprecision highp int;\n" : "#version 330 core\n";
+
+    if(!m_program.addShaderFromSourceCode(QOpenGLShader::Vertex, version + vertex_shader_source) ||
+            !m_program.addShaderFromSourceCode(QOpenGLShader::Fragment, version + fragment_shader_source) ||
+            !m_program.link()){
+        qDebug()<<"Error building the point cloud shaders"<<m_program.log();
+        return;
+    }
+
+    if(!is_es && (format().majorVersion() > 4 || (format().majorVersion() == 4 && format().minorVersion() >= 4))){
+        m_gl44 = context()->versionFunctions<QOpenGLFunctions_4_4_Core>();
+        if(m_gl44 != NULL && !m_gl44->initializeOpenGLFunctions()){
+            m_gl44 = NULL;
+        }
+    }
+
+    if(!createBuffers()){
+        qDebug()<<"Error creating the point cloud buffers";
+        return;
+    }
+
+    if(!is_es){
+        glEnable(GL_PROGRAM_POINT_SIZE);
+    }
+    glEnable(GL_DEPTH_TEST);
+
+    m_initialized = true;
+}
+
+bool glPointCloudWidget::createBuffers()
+{
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    m_points_buffer = buffers[0];
+    m_axis_buffer = buffers[1];
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_points_buffer);
+
+    //!all the slots share one buffer that stays mapped, the writes need no flush with coherent mapping
+    m_persistent = false;
+    if(m_gl44 != NULL){
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLsizeiptr size = (GLsizeiptr)sizeof(tPointPcd) * m_slot_capacity * number_of_slots;
+        m_gl44->glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+        m_mapped_points = (tPointPcd*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        m_persistent = m_mapped_points != NULL;
+    }
+
+    if(!m_persistent){
+        if(m_gl44 != NULL){
+            //!immutable storage can not be reallocated, a new buffer is used
+            glDeleteBuffers(1, &buffers[0]);
+            glGenBuffers(1, &buffers[0]);
+            m_points_buffer = buffers[0];
+            glBindBuffer(GL_ARRAY_BUFFER, m_points_buffer);
+        }
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)sizeof(tPointPcd) * m_slot_capacity, NULL, GL_STREAM_DRAW);
+        m_host_points.resize((size_t)m_slot_capacity * number_of_slots);
+    }
+
+    int position_location = m_program.attributeLocation("position");
+    int intensity_location = m_program.attributeLocation("intensity");
+    int color_location = m_program.attributeLocation("color");
+
+    //!the vertices are the points as received, int32 coordinates in mm, intensity and RGB
+    auto setAttributes = [&](){
+        glEnableVertexAttribArray(position_location);
+        glVertexAttribPointer(position_location, 3, GL_INT, GL_FALSE, sizeof(tPointPcd), (void*)offsetof(tPointPcd, x));
+        if(intensity_location >= 0){
+            glEnableVertexAttribArray(intensity_location);
+            glVertexAttribIPointer(intensity_location, 1, GL_INT, sizeof(tPointPcd), (void*)offsetof(tPointPcd, intensity));
+        }
+        glEnableVertexAttribArray(color_location);
+        glVertexAttribIPointer(color_location, 1, GL_INT, sizeof(tPointPcd), (void*)offsetof(tPointPcd, RGB));
+    };
+
+    m_points_vao.create();
+    m_points_vao.bind();
+    glBindBuffer(GL_ARRAY_BUFFER, m_points_buffer);
+    setAttributes();
+    m_points_vao.release();
+
+    //!unit axis colored red, green and blue, scaled by the shader
+    tPointPcd axis[6];
+    memset(axis, 0, sizeof(axis));
+    axis[1].x = 1; axis[0].RGB = axis[1].RGB = 0xFF0000;
+    axis[3].y = 1; axis[2].RGB = axis[3].RGB = 0x00FF00;
+    axis[5].z = 1; axis[4].RGB = axis[5].RGB = 0x0000FF;
+
+    m_axis_vao.create();
+    m_axis_vao.bind();
+    glBindBuffer(GL_ARRAY_BUFFER, m_axis_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(axis), axis, GL_STATIC_DRAW);
+    setAttributes();
+    m_axis_vao.release();
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+void glPointCloudWidget::releaseBuffers()
+{
+    std::unique_lock<std::mutex> lock(m_slots_mutex);
+
+    //!no frame is written after this, the one being copied from the receiver thread is let finish
+    m_initialized = false;
+    m_slot_written.wait(lock, [this](){
+        for(int slot = 0; slot < number_of_slots; ++slot){
+            if(m_slots[slot].state == slot_writing){
+                return false;
+            }
+        }
+        return true;
+    });
+
+    for(int slot = 0; slot < number_of_slots; ++slot){
+        if(m_slots[slot].fence != NULL){
+            glDeleteSync(m_slots[slot].fence);
+            m_slots[slot].fence = NULL;
+        }
+        m_slots[slot].state = slot_free;
+    }
+    m_ready_slot = -1;
+    m_drawn_slot = -1;
+
+    if(m_persistent && m_points_buffer != 0){
+        glBindBuffer(GL_ARRAY_BUFFER, m_points_buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    m_mapped_points = NULL;
+    m_persistent = false;
+
+    if(m_points_buffer != 0){
+        GLuint buffers[2] = {m_points_buffer, m_axis_buffer};
+        glDeleteBuffers(2, buffers);
+        m_points_buffer = 0;
+        m_axis_buffer = 0;
+    }
+    m_points_vao.destroy();
+    m_axis_vao.destroy();
+}
+
+tPointPcd *glPointCloudWidget::getSlotMemory(int slot)
+{
+    tPointPcd *memory = m_persistent ? m_mapped_points : m_host_points.data();
+    return &memory[(size_t)slot * m_slot_capacity];
+}
+
+int glPointCloudWidget::takeSlotToDraw()
+{
+    std::lock_guard<std::mutex> lock(m_slots_mutex);
+
+    //!slots left behind are reused once the GPU has read them
+    for(int slot = 0; slot < number_of_slots; ++slot){
+        if(m_slots[slot].state != slot_retired){
+            continue;
+        }
+        if(m_slots[slot].fence != NULL){
+            GLenum status = glClientWaitSync(m_slots[slot].fence, 0, 0);
+            if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED){
+                continue;
+            }
+            glDeleteSync(m_slots[slot].fence);
+            m_slots[slot].fence = NULL;
+        }
+        m_slots[slot].state = slot_free;
+    }
+
+    if(m_ready_slot >= 0){
+        if(m_drawn_slot >= 0){
+            m_slots[m_drawn_slot].state = slot_retired;
+        }
+        m_drawn_slot = m_ready_slot;
+        m_slots[m_drawn_slot].state = slot_drawn;
+        m_ready_slot = -1;
+
+        //!without persistent mapping the new frame is uploaded, the slot is not written while drawn
+        if(!m_persistent){
+            glBindBuffer(GL_ARRAY_BUFFER, m_points_buffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(tPointPcd) * m_slots[m_drawn_slot].number_of_points, getSlotMemory(m_drawn_slot));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            if(m_slots[m_drawn_slot].fence != NULL){
+                glDeleteSync(m_slots[m_drawn_slot].fence);
+                m_slots[m_drawn_slot].fence = NULL;
+            }
+        }
+    }
+
+    return m_drawn_slot;
+}
+
+QMatrix4x4 glPointCloudWidget::getViewMatrix() const
+{
+    //!z forward, x right and y down, the camera orbits around the target
+    float yaw = m_yaw * degrees_to_radians;
+    float pitch = m_pitch * degrees_to_radians;
+    QVector3D direction(std::sin(yaw) * std::cos(pitch), std::sin(pitch), std::cos(yaw) * std::cos(pitch));
+
+    QMatrix4x4 view;
+    view.lookAt(m_target - direction * m_distance, m_target, QVector3D(0.0f, -1.0f, 0.0f));
+    return view;
+}
+
+void glPointCloudWidget::resizeGL(int width, int height)
+{
+    m_projection.setToIdentity();
+    m_projection.perspective(45.0f, (float)width / std::max(height, 1), 0.05f, 500.0f);
+}
+
+void glPointCloudWidget::paintGL()
+{
+    glClearColor(m_background.redF(), m_background.greenF(), m_background.blueF(), 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if(!m_initialized){
+        return;
+    }
+
+    int slot = takeSlotToDraw();
+
+    //!the points are in mm and the view in m
+    QMatrix4x4 model;
+    model.scale(0.001f);
+    QMatrix4x4 mvp = m_projection * getViewMatrix() * model;
+
+    m_program.bind();
+    m_program.setUniformValue("mvp", mvp);
+    m_program.setUniformValue("point_size", m_point_size);
+    m_program.setUniformValue("max_intensity", max_intensity);
+
+    if(slot >= 0 && m_rendering_enabled){
+        m_program.setUniformValue("position_scale", 1.0f);
+        m_program.setUniformValue("use_rgb", m_use_rgb ? 1 : 0);
+
+        m_points_vao.bind();
+        GLint first = m_persistent ? slot * m_slot_capacity : 0;
+        glDrawArrays(GL_POINTS, first, m_slots[slot].number_of_points);
+        m_points_vao.release();
+
+        if(m_persistent){
+            if(m_slots[slot].fence != NULL){
+                glDeleteSync(m_slots[slot].fence);
+            }
+            m_slots[slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    if(m_show_axis){
+        m_program.setUniformValue("position_scale", axis_length);
+        m_program.setUniformValue("use_rgb", 1);
+        m_axis_vao.bind();
+        glDrawArrays(GL_LINES, 0, 6);
+        m_axis_vao.release();
+    }
+
+    m_program.release();
+}
+
+void glPointCloudWidget::mousePressEvent(QMouseEvent *event)
+{
+    m_last_mouse_position = event->pos();
+}
+
+void glPointCloudWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    QPoint delta = event->pos() - m_last_mouse_position;
+    m_last_mouse_position = event->pos();
+
+    if(event->buttons() & Qt::LeftButton){
+        m_yaw += delta.x() * 0.3f;
+        m_pitch = std::min(std::max(m_pitch + delta.y() * 0.3f, -89.0f), 89.0f);
+    }else if(event->buttons() & (Qt::RightButton | Qt::MiddleButton)){
+        //!the target moves in the view plane, faster when the camera is farther
+        QMatrix4x4 view = getViewMatrix();
+        QVector3D right(view(0, 0), view(0, 1), view(0, 2));
+        QVector3D up(view(1, 0), view(1, 1), view(1, 2));
+        float step = m_distance * 0.002f;
+        m_target += (-right * delta.x() + up * delta.y()) * step;
+    }
+    update();
+}
+
+void glPointCloudWidget::wheelEvent(QWheelEvent *event)
+{
+    m_distance = std::min(std::max(m_distance * std::pow(0.999f, (float)event->angleDelta().y()), 0.5f), 300.0f);
+    update();
+}
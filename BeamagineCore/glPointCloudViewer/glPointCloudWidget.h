@@ -0,0 +1,179 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef GLPOINTCLOUDWIDGET_H
+#define GLPOINTCLOUDWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QColor>
+#include <QPoint>
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+class QOpenGLFunctions_4_4_Core;
+
+//! @brief  Point cloud view embedded in the main window, an alternative to the VTK window.
+//!         The vertices are the points as received (tPointPcd), so a frame is copied once
+//!         from the receiver thread into a slot of a vertex buffer that stays mapped, and the
+//!         shaders do the conversion, the coloring and the point size. Three slots let the
+//!         receiver write a frame while the last one is drawn, fences tell when the GPU is
+//!         done with a slot. Without persistent mapping (GL < 4.4) the slots are kept in host
+//!         memory and uploaded when drawn. Runs on software GL (Mesa llvmpipe).
+class glPointCloudWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
+{
+    Q_OBJECT
+public:
+    explicit glPointCloudWidget(QWidget *parent = 0);
+    ~glPointCloudWidget();
+
+    //! @brief  Copies a frame to a free slot and schedules a repaint, can be called from any thread
+    //! @param  points Points of the frame
+    //! @param  number_of_points Number of points
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return false if the frame was dropped because all the slots were in use
+    bool writeFrame(const tPointPcd *points, int32_t number_of_points, uint32_t timestamp);
+
+    //! @brief  Enables the rendering, frames written while disabled are dropped
+    void setRenderingEnabled(bool enabled);
+
+    bool isRenderingEnabled() const;
+
+    void setPointSize(float point_size);
+
+    void setBackgroundColor(const QColor &color);
+
+    void setShowAxis(bool show);
+
+    //! @brief  Colors the points with the RGB field if true, with the intensity otherwise
+    void setUseRgbField(bool use_rgb);
+
+    //! @brief  Returns true if the vertex buffer is persistently mapped
+    bool usesPersistentMapping() const;
+
+    //! @brief  Returns the number of frames dropped because the slots were busy
+    uint64_t getFramesDropped() const;
+
+public slots:
+
+    //! @brief  Goes back to the default view
+    void resetCamera();
+
+protected:
+
+    void initializeGL() override;
+
+    void resizeGL(int width, int height) override;
+
+    void paintGL() override;
+
+    void mousePressEvent(QMouseEvent *event) override;
+
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    void wheelEvent(QWheelEvent *event) override;
+
+private:
+
+    enum slotState{
+        slot_free = 0,
+        slot_writing,
+        slot_ready,
+        slot_drawn,
+        slot_retired
+    };
+
+    typedef struct frameSlot{
+        slotState state;
+        int32_t number_of_points;
+        uint32_t timestamp;
+        GLsync fence;
+    }frameSlot;
+
+    bool createBuffers();
+
+    //! @brief  Stops the writes of new frames, waits for the frame being copied and releases the buffers
+    void releaseBuffers();
+
+    //! @brief  Takes the newest frame to draw and frees the slots the GPU is done with
+    //! @return slot to draw, -1 if there is none
+    int takeSlotToDraw();
+
+    tPointPcd *getSlotMemory(int slot);
+
+    QMatrix4x4 getViewMatrix() const;
+
+private:
+
+    static const int number_of_slots = 3;
+
+    QOpenGLFunctions_4_4_Core *m_gl44;
+
+    QOpenGLShaderProgram m_program;
+    QOpenGLVertexArrayObject m_points_vao;
+    QOpenGLVertexArrayObject m_axis_vao;
+    uint32_t m_points_buffer;
+    uint32_t m_axis_buffer;
+
+    std::atomic<bool> m_initialized;
+    std::atomic<bool> m_rendering_enabled;
+    bool m_persistent;
+    tPointPcd *m_mapped_points;
+    std::vector<tPointPcd> m_host_points;
+    int32_t m_slot_capacity;
+
+    std::mutex m_slots_mutex;
+    std::condition_variable m_slot_written;
+    frameSlot m_slots[number_of_slots];
+    int m_ready_slot;
+    int m_drawn_slot;
+    std::atomic<uint64_t> m_frames_dropped;
+
+    float m_point_size;
+    QColor m_background;
+    bool m_show_axis;
+    bool m_use_rgb;
+
+    QMatrix4x4 m_projection;
+    float m_yaw;
+    float m_pitch;
+    float m_distance;
+    QVector3D m_target;
+    QPoint m_last_mouse_position;
+};
+
+#endif // GLPOINTCLOUDWIDGET_H
@@ -0,0 +1,145 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "displayedPointCloud.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+
+displayedPointCloud::displayedPointCloud()
+{
+    m_positions = vtkSmartPointer<vtkFloatArray>::New();
+    m_positions->SetNumberOfComponents(3);
+
+    m_colors = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    m_colors->SetNumberOfComponents(3);
+    m_colors->SetName("RGB");
+
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    points->SetData(m_positions);
+
+    m_vertices = vtkSmartPointer<vtkCellArray>::New();
+
+    m_polydata = vtkSmartPointer<vtkPolyData>::New();
+    m_polydata->SetPoints(points);
+    m_polydata->SetVerts(m_vertices);
+    m_polydata->GetPointData()->SetScalars(m_colors);
+
+    m_number_of_slots = 0;
+}
+
+void displayedPointCloud::reserveSlots(size_t number_of_slots, size_t max_slots)
+{
+    if(number_of_slots <= m_number_of_slots){
+        return;
+    }
+
+    //!the ring grows a little with every frame until it is full, the buffers double instead
+    size_t slots = std::max(number_of_slots, std::min(m_number_of_slots * 2, max_slots));
+
+    m_positions->SetNumberOfTuples(slots);
+    m_colors->SetNumberOfTuples(slots);
+    m_intensities.resize(slots, 0);
+    m_timestamps.resize(slots, 0);
+
+    std::fill(m_positions->GetPointer(m_number_of_slots * 3), m_positions->GetPointer(0) + (slots * 3), std::numeric_limits<float>::quiet_NaN());
+    std::fill(m_colors->GetPointer(m_number_of_slots * 3), m_colors->GetPointer(0) + (slots * 3), 0);
+
+    //!a single poly vertex draws every slot, only rebuilt when the buffers grow
+    m_vertices->Reset();
+    m_vertices->InsertNextCell((vtkIdType)slots);
+    for(size_t i = 0; i < slots; ++i){
+        m_vertices->InsertCellPoint((vtkIdType)i);
+    }
+    m_vertices->Modified();
+
+    m_number_of_slots = slots;
+}
+
+size_t displayedPointCloud::getNumberOfSlots() const
+{
+    return m_number_of_slots;
+}
+
+void displayedPointCloud::setFrame(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int32_t> &intensities, uint32_t timestamp)
+{
+    size_t number_of_points = cloud.points.size();
+    reserveSlots(number_of_points, std::numeric_limits<size_t>::max());
+
+    float *positions = m_positions->GetPointer(0);
+    uint8_t *colors = m_colors->GetPointer(0);
+
+    for(size_t i = 0; i < number_of_points; ++i){
+        const pcl::PointXYZRGB &point = cloud.points[i];
+        positions[(i * 3)] = point.x;
+        positions[(i * 3) + 1] = point.y;
+        positions[(i * 3) + 2] = point.z;
+        colors[(i * 3)] = point.r;
+        colors[(i * 3) + 1] = point.g;
+        colors[(i * 3) + 2] = point.b;
+        m_intensities[i] = i < intensities.size() ? intensities[i] : 0;
+    }
+    std::fill(m_timestamps.begin(), m_timestamps.begin() + number_of_points, timestamp);
+
+    std::fill(positions + (number_of_points * 3), positions + (m_number_of_slots * 3), std::numeric_limits<float>::quiet_NaN());
+}
+
+float *displayedPointCloud::getPositions()
+{
+    return m_positions->GetPointer(0);
+}
+
+uint8_t *displayedPointCloud::getColors()
+{
+    return m_colors->GetPointer(0);
+}
+
+int32_t *displayedPointCloud::getIntensities()
+{
+    return m_intensities.data();
+}
+
+uint32_t *displayedPointCloud::getTimestamps()
+{
+    return m_timestamps.data();
+}
+
+void displayedPointCloud::setModified()
+{
+    m_positions->Modified();
+    m_colors->Modified();
+    m_polydata->GetPoints()->Modified();
+    m_polydata->Modified();
+}
+
+vtkSmartPointer<vtkPolyData> displayedPointCloud::getPolyData() const
+{
+    return m_polydata;
+}
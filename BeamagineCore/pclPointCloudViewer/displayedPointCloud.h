@@ -0,0 +1,99 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef DISPLAYEDPOINTCLOUD_H
+#define DISPLAYEDPOINTCLOUD_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkFloatArray.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkCellArray.h>
+
+//! @brief  Buffers drawn by the point cloud viewer. The positions and colors are the VTK
+//!         arrays of the model added to the viewer, so a frame is written in place and
+//!         only the slots that changed have to be copied. Slots not in use are NaN and
+//!         are not drawn. It is only used from the visualization thread.
+class displayedPointCloud
+{
+public:
+    displayedPointCloud();
+
+    //! @brief  Makes room for at least the given number of slots, the new slots are NaN
+    //! @param  number_of_slots Slots needed
+    //! @param  max_slots Slots that will be needed at most, the buffers grow in steps up to it
+    //! @return none
+    void reserveSlots(size_t number_of_slots, size_t max_slots);
+
+    //! @brief  Returns the number of slots of the buffers
+    size_t getNumberOfSlots() const;
+
+    //! @brief  Copies a whole frame to the first slots, the slots after it are set to NaN
+    //! @param  cloud Points of the frame
+    //! @param  intensities Intensity of each point
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return none
+    void setFrame(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const std::vector<int32_t> &intensities, uint32_t timestamp);
+
+    //! @brief  Returns x, y, z of each slot
+    float *getPositions();
+
+    //! @brief  Returns red, green and blue of each slot
+    uint8_t *getColors();
+
+    //! @brief  Returns the intensity of each slot
+    int32_t *getIntensities();
+
+    //! @brief  Returns the device timestamp of each slot
+    uint32_t *getTimestamps();
+
+    //! @brief  Flags the buffers as changed so they are uploaded on the next render
+    void setModified();
+
+    //! @brief  Returns the model to add to the viewer, it references the buffers
+    vtkSmartPointer<vtkPolyData> getPolyData() const;
+
+private:
+
+    vtkSmartPointer<vtkPolyData> m_polydata;
+    vtkSmartPointer<vtkFloatArray> m_positions;
+    vtkSmartPointer<vtkUnsignedCharArray> m_colors;
+    vtkSmartPointer<vtkCellArray> m_vertices;
+
+    std::vector<int32_t> m_intensities;
+    std::vector<uint32_t> m_timestamps;
+
+    size_t m_number_of_slots;
+};
+
+#endif // DISPLAYEDPOINTCLOUD_H
@@ -0,0 +1,349 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "offscreenRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <beam_aux.h>
+
+//! Empty pixel of the depth buffer, farther than any point
+static const uint64_t empty_pixel = UINT64_MAX;
+
+//! Points closer than this to the camera plane are not drawn, in mm
+static const float near_plane = 10.0;
+
+//! Milliseconds in a day, device timestamps wrap at midnight
+static const uint32_t milliseconds_per_day = 86400000;
+
+static void normalize(float v[3])
+{
+    float norm = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+    if(norm > 0){
+        v[0] /= norm;
+        v[1] /= norm;
+        v[2] /= norm;
+    }
+}
+
+static void cross(const float a[3], const float b[3], float result[3])
+{
+    result[0] = a[1]*b[2] - a[2]*b[1];
+    result[1] = a[2]*b[0] - a[0]*b[2];
+    result[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+offscreenRenderer::offscreenRenderer()
+{
+    m_settings = getDefaultSettings();
+    m_frames_written = 0;
+    m_first_timestamp_ms = 0;
+    m_is_open = false;
+}
+
+offscreenRenderer::~offscreenRenderer()
+{
+    close();
+}
+
+offscreenRenderSettings offscreenRenderer::getDefaultSettings()
+{
+    offscreenRenderSettings settings;
+
+    settings.enabled = false;
+    settings.width = 1280;
+    settings.height = 720;
+    settings.point_size = 2;
+
+    //!same start position as the viewer, z forward and y down
+    renderCamera camera = {{0, 0, -1500}, {0, 0, 20000}, {0, -1, 0}, 45};
+    settings.camera = camera;
+
+    settings.video_fps = 10;
+
+    return settings;
+}
+
+bool offscreenRenderer::loadCameraPath(const QString &file_name, std::vector<cameraKeyframe> &path)
+{
+    path.clear();
+
+    QFile file(file_name);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text)){
+        qDebug()<<"offscreenRenderer could not open camera path"<<file_name;
+        return false;
+    }
+
+    QTextStream stream(&file);
+    while(!stream.atEnd()){
+        QString line = stream.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith("#")){
+            continue;
+        }
+
+        QStringList values = line.split(",");
+        if(values.size() < 7){
+            qDebug()<<"offscreenRenderer skipping camera keyframe"<<line;
+            continue;
+        }
+
+        cameraKeyframe keyframe;
+        keyframe.camera = getDefaultSettings().camera;
+        keyframe.time_s = values[0].toDouble();
+        for(int i = 0; i < 3; ++i){
+            keyframe.camera.eye[i] = values[1 + i].toFloat();
+            keyframe.camera.target[i] = values[4 + i].toFloat();
+        }
+        if(values.size() > 7){
+            keyframe.camera.fov = values[7].toFloat();
+        }
+        path.push_back(keyframe);
+    }
+
+    std::sort(path.begin(), path.end(), [](const cameraKeyframe &a, const cameraKeyframe &b){
+        return a.time_s < b.time_s;
+    });
+
+    return !path.empty();
+}
+
+bool offscreenRenderer::open(const offscreenRenderSettings &settings)
+{
+    close();
+
+    m_settings = settings;
+    m_settings.width = std::max(settings.width, 16);
+    m_settings.height = std::max(settings.height, 16);
+    m_settings.point_size = std::min(std::max(settings.point_size, 1), 5);
+
+    m_camera_path.clear();
+    if(!m_settings.camera_path_file.isEmpty()){
+        loadCameraPath(m_settings.camera_path_file, m_camera_path);
+    }
+
+    m_depth_color.assign((size_t)m_settings.width * m_settings.height, empty_pixel);
+    m_frames_written = 0;
+
+    if(!m_settings.image_directory.isEmpty() && !QDir().mkpath(m_settings.image_directory)){
+        qDebug()<<"offscreenRenderer could not create"<<m_settings.image_directory;
+        return false;
+    }
+
+    if(!m_settings.video_file.isEmpty()){
+        //!MJPG is available in every OpenCV build and cheap to encode on one core
+        m_video.open(m_settings.video_file.toStdString(), cv::VideoWriter::fourcc('M','J','P','G'),
+                     m_settings.video_fps, cv::Size(m_settings.width, m_settings.height));
+        if(!m_video.isOpened()){
+            qDebug()<<"offscreenRenderer could not open"<<m_settings.video_file;
+            return false;
+        }
+    }
+
+    m_is_open = true;
+    return true;
+}
+
+void offscreenRenderer::close()
+{
+    if(m_video.isOpened()){
+        m_video.release();
+    }
+    m_is_open = false;
+}
+
+renderCamera offscreenRenderer::getCameraAt(double time_s) const
+{
+    if(m_camera_path.empty()){
+        return m_settings.camera;
+    }
+    if(m_camera_path.size() == 1){
+        return m_camera_path[0].camera;
+    }
+
+    //!the path is repeated once its last keyframe is reached
+    double start = m_camera_path.front().time_s;
+    double duration = m_camera_path.back().time_s - start;
+    double time = start;
+    if(duration > 0){
+        time = start + std::fmod(std::max(time_s - start, 0.0), duration);
+    }
+
+    size_t next = 1;
+    while(next < m_camera_path.size() - 1 && m_camera_path[next].time_s < time){
+        ++next;
+    }
+    const cameraKeyframe &from = m_camera_path[next - 1];
+    const cameraKeyframe &to = m_camera_path[next];
+
+    double span = to.time_s - from.time_s;
+    float t = span > 0 ? (float)std::min(std::max((time - from.time_s) / span, 0.0), 1.0) : 0;
+
+    renderCamera camera = from.camera;
+    for(int i = 0; i < 3; ++i){
+        camera.eye[i] = from.camera.eye[i] + t * (to.camera.eye[i] - from.camera.eye[i]);
+        camera.target[i] = from.camera.target[i] + t * (to.camera.target[i] - from.camera.target[i]);
+    }
+    camera.fov = from.camera.fov + t * (to.camera.fov - from.camera.fov);
+
+    return camera;
+}
+
+size_t offscreenRenderer::render(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const renderCamera &camera, cv::Mat &image)
+{
+    int width = m_settings.width;
+    int height = m_settings.height;
+
+    m_depth_color.assign((size_t)width * height, empty_pixel);
+
+    //!camera axes: forward, right and down in the image
+    float forward[3] = {camera.target[0] - camera.eye[0], camera.target[1] - camera.eye[1], camera.target[2] - camera.eye[2]};
+    normalize(forward);
+    float right[3];
+    cross(forward, camera.up, right);
+    normalize(right);
+    float down[3];
+    cross(forward, right, down);
+
+    float focal = (height / 2.0f) / std::tan(camera.fov * 0.5f * 0.01745329252f);
+    float center_u = width / 2.0f;
+    float center_v = height / 2.0f;
+
+    //!the splat is centered on the projected pixel
+    int splat_first = -(m_settings.point_size - 1) / 2;
+    int splat_last = splat_first + m_settings.point_size - 1;
+
+    size_t points_drawn = 0;
+    uint64_t *buffer = m_depth_color.data();
+
+    for(size_t i = 0; i < cloud.points.size(); ++i){
+        const pcl::PointXYZRGB &point = cloud.points[i];
+
+        float px = point.x - camera.eye[0];
+        float py = point.y - camera.eye[1];
+        float pz = point.z - camera.eye[2];
+
+        float depth = px*forward[0] + py*forward[1] + pz*forward[2];
+        //!NaN points fail this comparison too
+        if(!(depth > near_plane)){
+            continue;
+        }
+
+        float inverse_depth = focal / depth;
+        int u = (int)std::floor(center_u + (px*right[0] + py*right[1] + pz*right[2]) * inverse_depth);
+        int v = (int)std::floor(center_v + (px*down[0] + py*down[1] + pz*down[2]) * inverse_depth);
+        if(u + splat_last < 0 || u + splat_first >= width || v + splat_last < 0 || v + splat_first >= height){
+            continue;
+        }
+
+        //!positive floats keep their order when compared as integers
+        uint32_t depth_bits;
+        memcpy(&depth_bits, &depth, sizeof(depth_bits));
+        uint32_t color;
+        memcpy(&color, &point.rgb, sizeof(color));
+        uint64_t value = ((uint64_t)depth_bits << 32) | (color & 0x00FFFFFF);
+
+        if(splat_first == 0 && splat_last == 0){
+            uint64_t &pixel = buffer[(size_t)v * width + u];
+            pixel = std::min(pixel, value);
+        }else{
+            int first_row = std::max(v + splat_first, 0);
+            int last_row = std::min(v + splat_last, height - 1);
+            int first_column = std::max(u + splat_first, 0);
+            int last_column = std::min(u + splat_last, width - 1);
+            for(int row = first_row; row <= last_row; ++row){
+                uint64_t *line = &buffer[(size_t)row * width];
+                for(int column = first_column; column <= last_column; ++column){
+                    line[column] = std::min(line[column], value);
+                }
+            }
+        }
+        ++points_drawn;
+    }
+
+    image.create(height, width, CV_8UC3);
+    for(int row = 0; row < height; ++row){
+        const uint64_t *line = &buffer[(size_t)row * width];
+        uint8_t *pixels = image.ptr<uint8_t>(row);
+        for(int column = 0; column < width; ++column){
+            uint32_t color = line[column] == empty_pixel ? 0 : (uint32_t)line[column];
+            pixels[column*3] = color & 0xFF;
+            pixels[column*3+1] = (color >> 8) & 0xFF;
+            pixels[column*3+2] = (color >> 16) & 0xFF;
+        }
+    }
+
+    return points_drawn;
+}
+
+void offscreenRenderer::renderFrame(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, uint32_t timestamp)
+{
+    if(!m_is_open){
+        return;
+    }
+
+    try{
+        uint32_t timestamp_ms = timestampToMilliseconds(timestamp);
+        if(m_frames_written == 0){
+            m_first_timestamp_ms = timestamp_ms;
+        }
+        double time_s = ((timestamp_ms + milliseconds_per_day - m_first_timestamp_ms) % milliseconds_per_day) / 1000.0;
+
+        render(cloud, getCameraAt(time_s), m_image);
+
+        if(!m_settings.image_directory.isEmpty()){
+            //!fastest PNG compression, the images are written at the frame rate
+            std::vector<int> parameters = {cv::IMWRITE_PNG_COMPRESSION, 1};
+            QString file_name = QString("%1/%2_%3.png").arg(m_settings.image_directory).arg(m_frames_written, 6, 10, QChar('0')).arg(timestamp);
+            cv::imwrite(file_name.toStdString(), m_image, parameters);
+        }
+
+        if(m_video.isOpened()){
+            m_video.write(m_image);
+        }
+
+        ++m_frames_written;
+
+    }catch(cv::Exception &ex){
+        qDebug()<<"Error at offscreenRenderer::renderFrame"<<ex.what();
+    }catch(...){
+        qDebug()<<"Unhandled error at offscreenRenderer::renderFrame";
+    }
+}
+
+uint64_t offscreenRenderer::getFramesWritten() const
+{
+    return m_frames_written;
+}
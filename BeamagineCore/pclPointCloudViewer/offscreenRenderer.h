@@ -0,0 +1,133 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef OFFSCREENRENDERER_H
+#define OFFSCREENRENDERER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <QString>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+typedef struct renderCamera{
+    float eye[3];
+    float target[3];
+    float up[3];
+    float fov;
+}renderCamera;
+
+typedef struct cameraKeyframe{
+    double time_s;
+    renderCamera camera;
+}cameraKeyframe;
+
+typedef struct offscreenRenderSettings{
+    bool enabled;
+    int width;
+    int height;
+    int point_size;
+    renderCamera camera;
+    QString camera_path_file;
+    QString image_directory;
+    QString video_file;
+    double video_fps;
+}offscreenRenderSettings;
+
+//! @brief  Renders point clouds to images without a window or a GPU. Points are projected
+//!         with a pinhole camera and splatted in a depth buffer, depth and color are packed
+//!         in one value so the nearest point of a pixel is kept with a single comparison.
+//!         Frames are written as a PNG sequence and/or a video.
+class offscreenRenderer
+{
+public:
+    offscreenRenderer();
+
+    ~offscreenRenderer();
+
+    //! @brief  Returns the default settings, a 1280x720 view from the viewer start position
+    static offscreenRenderSettings getDefaultSettings();
+
+    //! @brief  Reads a camera path, one keyframe per line:
+    //!         time_s,eye_x,eye_y,eye_z,target_x,target_y,target_z[,fov], in mm and degrees
+    //! @param  file_name Path of the file
+    //! @param  path Returns the keyframes sorted by time
+    //! @return true if at least one keyframe was read
+    static bool loadCameraPath(const QString &file_name, std::vector<cameraKeyframe> &path);
+
+    //! @brief  Prepares the renderer and opens the outputs
+    //! @param  settings Image size, camera and outputs
+    //! @return true if the outputs could be opened
+    bool open(const offscreenRenderSettings &settings);
+
+    //! @brief  Closes the outputs, the video is finished
+    void close();
+
+    //! @brief  Returns the camera at a time of the camera path, the fixed camera if there is no path
+    renderCamera getCameraAt(double time_s) const;
+
+    //! @brief  Renders a cloud, points with NaN coordinates are skipped
+    //! @param  cloud Cloud to render, in mm
+    //! @param  camera Camera to render from
+    //! @param  image Returns the rendered image (BGR)
+    //! @return number of points drawn
+    size_t render(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, const renderCamera &camera, cv::Mat &image);
+
+    //! @brief  Renders a frame with the camera of its time and writes it to the outputs
+    //! @param  cloud Cloud to render, in mm
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return none
+    void renderFrame(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, uint32_t timestamp);
+
+    //! @brief  Returns the number of frames written
+    uint64_t getFramesWritten() const;
+
+private:
+
+    offscreenRenderSettings m_settings;
+
+    std::vector<cameraKeyframe> m_camera_path;
+
+    std::vector<uint64_t> m_depth_color;
+
+    cv::Mat m_image;
+
+    cv::VideoWriter m_video;
+
+    uint64_t m_frames_written;
+
+    uint32_t m_first_timestamp_ms;
+
+    bool m_is_open;
+};
+
+#endif // OFFSCREENRENDERER_H
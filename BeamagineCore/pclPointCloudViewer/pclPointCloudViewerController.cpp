@@ -35,17 +35,42 @@
 #include <vtkTransform.h>
 
 
-pcl::visualization::CloudViewer viewer ("Lidar Viewer");
+//! Viewer window, it is not created when rendering offscreen so no display is needed
+pcl::visualization::CloudViewer *viewer = NULL;
 
+offscreenRenderSettings offscreen_settings = offscreenRenderer::getDefaultSettings();
 
-bool point_cloud_ready = false;
+
+//! Set by the controller thread when a new frame is waiting, cleared by the visualization thread
+std::atomic<bool> point_cloud_ready(false);
 bool first_frame_received = false;
 int parameter = 0;
 int initial_detection = 0;
 
+//! Frame waiting to be drawn, or the ring to copy the changed slots from when accumulating
 pcl::PointCloud<pcl::PointXYZRGB>::Ptr data_to_show = pcl::PointCloud<pcl::PointXYZRGB>::Ptr(new pcl::PointCloud<pcl::PointXYZRGB> );
+std::vector<int32_t> data_to_show_intensities;
+pointCloudAccumulator *data_to_show_accumulator = NULL;
+std::mutex data_to_show_mutex;
+uint32_t data_to_show_timestamp = 0;
+size_t data_to_show_points = 0;
+
+//! Buffers of the model drawn, created in the visualization thread
+displayedPointCloud *displayed_cloud = NULL;
+int displayed_point_size = 0;
+
+renderScheduler render_scheduler;
+bool show_statistics = true;
+bool statistics_shown = false;
+
+pointPickingService picking_service;
 
-QVector<int> m_intensities;
+//! Boxes drawn at most, the largest objects are drawn first
+static const size_t max_cluster_boxes = 64;
+
+std::vector<pointCloudCluster> clusters_to_show;
+bool clusters_ready = false;
+size_t clusters_shown = 0;
 
 double red_global = 0;
 double green_global = 0;
@@ -73,11 +98,18 @@ void pointPickingEventOccurred (const pcl::visualization::PointPickingEvent& eve
         event.getPoint(x, y, z);
 
         QString selected = "";
-        float distance = sqrt((x*x)+(y*y)+(z*z))/1000.0;
-        selected = QString("Point coordinate (%1,%2,%3) - Distance %4 m").arg(x).arg(y).arg(z).arg(distance);
-
-        if(index < m_intensities.size()){
-            selected += QString(" - Intensity %1").arg(m_intensities.at(index));
+        pickedPoint picked;
+        if(!picking_service.pickPoint(index, x, y, z, picked)){
+            float distance = sqrt((x*x)+(y*y)+(z*z))/1000.0;
+            selected = QString("Point coordinate (%1,%2,%3) - Distance %4 m").arg(x).arg(y).arg(z).arg(distance);
+        }else{
+            selected = QString("Point coordinate (%1,%2,%3) - Distance %4 m").arg(picked.x).arg(picked.y).arg(picked.z).arg(picked.range/1000.0);
+            selected += QString(" - Intensity %1").arg(picked.intensity);
+            selected += QString(" - RGB (%1,%2,%3)").arg(picked.red).arg(picked.green).arg(picked.blue);
+            selected += QString(" - Timestamp %1").arg(picked.timestamp);
+            if(picked.has_previous){
+                selected += QString(" - Distance to previous point %1 m").arg(picked.distance_to_previous/1000.0);
+            }
         }
 
         qDebug()<<selected;
@@ -104,6 +136,8 @@ void keyboardEventOccurred(const pcl::visualization::KeyboardEvent &event, void
 
 void viewerOneOff(pcl::visualization::PCLVisualizer& viewer){
 
+    displayed_cloud = new displayedPointCloud();
+
     viewer.createViewPort(0.0, 0.0, 1.0, 1.0, parameter);
     viewer.setBackgroundColor(0, 0, 0, 1);
     viewer.initCameraParameters();
@@ -118,29 +152,118 @@ void centerCameraCallBack(pcl::visualization::PCLVisualizer& viewer){
     viewer.setCameraPosition(0,0,-1500,0,-1,0);
 }
 
+void updateStatisticsOverlay(pcl::visualization::PCLVisualizer& viewer){
+
+    if(!show_statistics){
+        if(statistics_shown){
+            viewer.removeShape("Statistics");
+            statistics_shown = false;
+        }
+        return;
+    }
+
+    if(!render_scheduler.isOverlayDue()){
+        return;
+    }
+
+    renderStatistics statistics = render_scheduler.getStatistics();
+    QString text = QString("Render %1 fps - Ingest %2 fps - Skipped %3 - Points %4 - Frame age %5 ms")
+            .arg(statistics.render_fps, 0, 'f', 1)
+            .arg(statistics.ingest_fps, 0, 'f', 1)
+            .arg(statistics.skipped_frames)
+            .arg(statistics.points_drawn)
+            .arg(statistics.frame_age_ms);
+
+    if(statistics_shown){
+        viewer.updateText(text.toStdString(), 10, 10, "Statistics");
+    }else{
+        viewer.addText(text.toStdString(), 10, 10, 12, 1.0, 1.0, 1.0, "Statistics");
+        statistics_shown = true;
+    }
+}
+
+void updateClusterBoxes(pcl::visualization::PCLVisualizer& viewer){
+
+    std::vector<pointCloudCluster> clusters;
+    {
+        std::lock_guard<std::mutex> lock(data_to_show_mutex);
+        if(!clusters_ready){
+            return;
+        }
+        clusters.swap(clusters_to_show);
+        clusters_ready = false;
+    }
+
+    for(size_t i = 0; i < clusters_shown; ++i){
+        viewer.removeShape(QString("Cluster %1").arg(i).toStdString());
+    }
+
+    clusters_shown = std::min(clusters.size(), max_cluster_boxes);
+    for(size_t i = 0; i < clusters_shown; ++i){
+        const pointCloudCluster &cluster = clusters[i];
+
+        //!the principal axes of the object are the columns of the box rotation
+        Eigen::Matrix3f rotation;
+        for(int axis = 0; axis < 3; ++axis){
+            rotation.col(axis) = Eigen::Vector3f(cluster.axes[axis][0], cluster.axes[axis][1], cluster.axes[axis][2]);
+        }
+
+        std::string id = QString("Cluster %1").arg(i).toStdString();
+        viewer.addCube(Eigen::Vector3f(cluster.center[0], cluster.center[1], cluster.center[2]), Eigen::Quaternionf(rotation),
+                       cluster.size[0], cluster.size[1], cluster.size[2], id);
+        viewer.setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_REPRESENTATION, pcl::visualization::PCL_VISUALIZER_REPRESENTATION_WIREFRAME, id);
+        viewer.setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_COLOR, 1.0, 1.0, 0.0, id);
+    }
+}
+
 void updatePointCloud(pcl::visualization::PCLVisualizer& viewer){
     try{
-        if(point_cloud_ready){
+        //!frames arriving faster than the target rate wait in data_to_show and only the newest is drawn
+        if(point_cloud_ready && render_scheduler.isRenderDue()){
 
             point_cloud_ready = false;
 
-            if(!first_frame_received){
+            uint32_t frame_timestamp;
+            size_t frame_points;
+            {
+                std::lock_guard<std::mutex> lock(data_to_show_mutex);
+                if(data_to_show_accumulator != NULL){
+                    //!only the slots changed since the last update are written
+                    displayed_cloud->reserveSlots(data_to_show_accumulator->getNumberOfSlots(), data_to_show_accumulator->getCapacity());
+                    data_to_show_accumulator->copyChangedSlots(displayed_cloud->getPositions(), displayed_cloud->getColors(), displayed_cloud->getIntensities(),
+                                                               displayed_cloud->getTimestamps(), displayed_cloud->getNumberOfSlots());
+                }else{
+                    displayed_cloud->setFrame(*data_to_show, data_to_show_intensities, data_to_show_timestamp);
+                }
+                frame_timestamp = data_to_show_timestamp;
+                frame_points = data_to_show_points;
+            }
+            displayed_cloud->setModified();
 
-                if(data_to_show->points.size() > 0){
+            if(!first_frame_received){
 
-                    viewer.addPointCloud<pcl::PointXYZRGB>(data_to_show, "Lidar Viewer");
+                if(displayed_cloud->getNumberOfSlots() > 0){
+                    //!the model references the buffers, the next frames are written in place
+                    viewer.addModelFromPolyData(displayed_cloud->getPolyData(), "Lidar Viewer");
                     first_frame_received = true;
                 }
+            }
 
-            }else{
-
-                if(data_to_show->points.size() > 0){
-                    viewer.removePointCloud("Lidar Viewer");
-                    viewer.addPointCloud<pcl::PointXYZRGB>(data_to_show, "Lidar Viewer");
-                    viewer.setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, global_point_size, "Lidar Viewer");
-                }
+            if(first_frame_received && displayed_point_size != global_point_size){
+                viewer.setShapeRenderingProperties(pcl::visualization::PCL_VISUALIZER_POINT_SIZE, global_point_size, "Lidar Viewer");
+                displayed_point_size = global_point_size;
             }
+
+            //!picks are resolved against the frame on screen, the picking callback runs in this thread too
+            picking_service.setDisplayedFrame(displayed_cloud->getPositions(), displayed_cloud->getColors(), displayed_cloud->getIntensities(),
+                                              displayed_cloud->getTimestamps(), displayed_cloud->getNumberOfSlots(), frame_timestamp);
+
+            updateClusterBoxes(viewer);
+
+            render_scheduler.frameRendered(frame_points, frame_timestamp);
         }
+
+        updateStatisticsOverlay(viewer);
     }
     catch(pcl::IOException& ex ){
         qDebug()<<"Error atupdatePointCloud "<<ex.what();
@@ -226,20 +349,75 @@ pclPointCloudViewerController::pclPointCloudViewerController(QObject *parent) :
 
     m_color_type_to_show = visualizationTypes::RAINBOW;
 
+    m_mailbox_timestamp = 0;
+    m_mailbox_pending = false;
+
+    m_foreground_only = false;
+
+    if(!offscreen_settings.enabled){
+        viewer = new pcl::visualization::CloudViewer("Lidar Viewer");
+    }
+}
+
+void pclPointCloudViewerController::setOffscreenRendering(const offscreenRenderSettings &settings)
+{
+    offscreen_settings = settings;
 }
 
 void pclPointCloudViewerController::customEvent(QEvent *event)
 {
 
-    if(pclPointCloudViewerControllerShowUdpPointCloud *p_event = dynamic_cast<pclPointCloudViewerControllerShowUdpPointCloud*>(event)){
-        onShowUpdPointCloudRequest(p_event);
+    if(dynamic_cast<pclPointCloudViewerControllerShowUdpPointCloud*>(event)){
+        onShowUpdPointCloudRequest();
+    }
+    else if(pclPointCloudViewerControllerSetPersistenceRequest *p_event = dynamic_cast<pclPointCloudViewerControllerSetPersistenceRequest*>(event)){
+        onSetPersistenceRequest(p_event);
     }
 
 }
 
-void pclPointCloudViewerController::doShowPointCloud(int32_t *pointcloud)
+void pclPointCloudViewerController::doShowPointCloud(int32_t *pointcloud, uint32_t timestamp, int32_t foreground_points)
 {
-    pclPointCloudViewerControllerShowUdpPointCloud *request = new pclPointCloudViewerControllerShowUdpPointCloud(pointcloud, pointcloud[0]);
+    int32_t number_of_points = m_foreground_only ? foreground_points : pointcloud[0];
+
+    bool wake_up = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mailbox_mutex);
+
+        //!latest wins, a frame still waiting is replaced and only one event is queued at a time
+        wake_up = !m_mailbox_pending;
+        m_mailbox_frame.assign(pointcloud, pointcloud + (number_of_points * 5) + 1);
+        m_mailbox_frame[0] = number_of_points;
+        m_mailbox_timestamp = timestamp;
+        m_mailbox_pending = true;
+    }
+
+    render_scheduler.frameIngested();
+    if(!wake_up){
+        render_scheduler.frameSkipped();
+    }
+
+    if(wake_up){
+        pclPointCloudViewerControllerShowUdpPointCloud *request = new pclPointCloudViewerControllerShowUdpPointCloud();
+        QCoreApplication::postEvent(this, request);
+    }
+}
+
+void pclPointCloudViewerController::doShowClusters(const std::vector<pointCloudCluster> &clusters)
+{
+    std::lock_guard<std::mutex> lock(data_to_show_mutex);
+    clusters_to_show = clusters;
+    clusters_ready = true;
+}
+
+uint64_t pclPointCloudViewerController::getSkippedFrames()
+{
+    return render_scheduler.getStatistics().skipped_frames;
+}
+
+void pclPointCloudViewerController::doSetPersistence(int frames, int time_ms, bool fade, float voxel_size, int memory_mb)
+{
+    pclPointCloudViewerControllerSetPersistenceRequest *request = new pclPointCloudViewerControllerSetPersistenceRequest(frames, time_ms, fade, voxel_size, memory_mb);
     QCoreApplication::postEvent(this, request);
 }
 
@@ -251,7 +429,9 @@ void pclPointCloudViewerController::doChangeBackgroundColor(const double &red, c
         green_global = green;
         blue_global = blue;
 
-        viewer.runOnVisualizationThreadOnce(changeBackgroundColorCallback);
+        if(viewer != NULL){
+            viewer->runOnVisualizationThreadOnce(changeBackgroundColorCallback);
+        }
     }
     catch(pcl::IOException& ex ){
         qDebug()<<"Error at simplePointCloudViewer::changeBackgroundColor"<<ex.what();
@@ -274,7 +454,20 @@ void pclPointCloudViewerController::doChangeBackgroundColor(const double &red, c
 }
 
 void pclPointCloudViewerController::doCenterCamera(){
-    viewer.runOnVisualizationThreadOnce(centerCameraCallBack);
+    if(viewer != NULL){
+        viewer->runOnVisualizationThreadOnce(centerCameraCallBack);
+    }
+}
+
+void pclPointCloudViewerController::setRenderSettings(int target_fps, bool show_overlay)
+{
+    render_scheduler.setTargetFps(target_fps);
+    show_statistics = show_overlay;
+}
+
+void pclPointCloudViewerController::setForegroundOnly(bool enable)
+{
+    m_foreground_only = enable;
 }
 
 void pclPointCloudViewerController::setColorType(int pcd_type)
@@ -302,6 +495,11 @@ void pclPointCloudViewerController::stopController()
     try{
         if(m_controller_thread->isRunning()){
             m_controller_thread->exit(0);
+            if(offscreen_settings.enabled){
+                //!the video is only valid once it is closed
+                m_controller_thread->wait();
+                m_offscreen_renderer.close();
+            }
         }
         m_event_handlers.clear();
 
@@ -319,7 +517,9 @@ void pclPointCloudViewerController::setEventHandler(const QEvent::Type type, con
 
 void pclPointCloudViewerController::setAxisEnabled(const bool &enable){
     enableAxis = enable;
-    viewer.runOnVisualizationThreadOnce(enableAxisCallback);
+    if(viewer != NULL){
+        viewer->runOnVisualizationThreadOnce(enableAxisCallback);
+    }
 }
 
 void pclPointCloudViewerController::sendEvent(QEvent::Type event_type, QEvent *event)
@@ -335,35 +535,111 @@ QList<const QObject *> pclPointCloudViewerController::getEventHandlers(const QEv
     return m_event_handlers.values(event_type);
 }
 
-void pclPointCloudViewerController::onShowUpdPointCloudRequest(pclPointCloudViewerControllerShowUdpPointCloud *request)
+void pclPointCloudViewerController::onShowUpdPointCloudRequest()
 {
     try{
-        int32_t *point_cloud = (int32_t*)malloc((request->getBufferSize()*sizeof(int32_t)*5)+1);
-        memcpy(point_cloud, request->getPointCloud(), (5*sizeof(int32_t)*request->getBufferSize())+1);
+        uint32_t timestamp;
+        {
+            std::lock_guard<std::mutex> lock(m_mailbox_mutex);
+            if(!m_mailbox_pending){
+                return;
+            }
+            //!the buffers are swapped so the next frame can be written while this one is processed
+            m_mailbox_working_frame.swap(m_mailbox_frame);
+            timestamp = m_mailbox_timestamp;
+            m_mailbox_pending = false;
+        }
 
-        if(request->getBufferSize() > 0){
+        int32_t *point_cloud = m_mailbox_working_frame.data();
+        int32_t number_of_points = point_cloud[0];
 
-            showUdpPointCloud(point_cloud, request->getBufferSize());
+        //!empty frames are shown too, with only the foreground points a static scene is empty
+        if(number_of_points >= 0){
 
-            pcl::copyPointCloud(*m_color_point_cloud, *data_to_show);
+            showUdpPointCloud(point_cloud, number_of_points, timestamp);
 
-            point_cloud_ready = true;
-        }
+            if(offscreen_settings.enabled){
+                renderOffscreen(timestamp);
+                return;
+            }
 
-        free(point_cloud);
+            bool accumulating;
+            {
+                std::lock_guard<std::mutex> lock(data_to_show_mutex);
+                accumulating = m_accumulator.isEnabled();
+                if(accumulating){
+                    //!the visualization thread copies the slots changed from the ring itself
+                    data_to_show_accumulator = &m_accumulator;
+                    data_to_show_points = m_accumulator.getPointsAlive();
+                }else{
+                    //!the buffers are swapped, the one given back is refilled by the next frame
+                    data_to_show_accumulator = NULL;
+                    data_to_show.swap(m_color_point_cloud);
+                    data_to_show_intensities.swap(m_intensities);
+                    data_to_show_points = number_of_points;
+                }
+                data_to_show_timestamp = timestamp;
+            }
+
+            //!the previous frame was not drawn yet because of the render pacing, with persistence
+            //!its points stay in the ring and are drawn with this one, so it is not skipped
+            bool previous_not_drawn = point_cloud_ready.exchange(true);
+            if(previous_not_drawn && !accumulating){
+                render_scheduler.frameSkipped();
+            }
+        }
 
     }catch(...){
         qDebug()<<"pclPointcloudViewerController::onShowUdpPointCloudRequest Unhandled error";
     }
-    request->releaseMemory();
 }
 
-void pclPointCloudViewerController::showUdpPointCloud(int32_t *point_cloud, uint32_t buff_size)
+void pclPointCloudViewerController::renderOffscreen(uint32_t timestamp)
+{
+    //!frames over the target rate are not rendered, the video keeps its frame rate
+    if(!render_scheduler.isRenderDue()){
+        render_scheduler.frameSkipped();
+        return;
+    }
+
+    if(m_accumulator.isEnabled()){
+        m_accumulator.applyFade();
+    }
+
+    const pcl::PointCloud<pcl::PointXYZRGB> &cloud = m_accumulator.isEnabled() ? *m_accumulator.getCloud() : *m_color_point_cloud;
+    m_offscreen_renderer.renderFrame(cloud, timestamp);
+
+    render_scheduler.frameRendered(m_accumulator.isEnabled() ? m_accumulator.getPointsAlive() : cloud.points.size(), timestamp);
+}
+
+void pclPointCloudViewerController::onSetPersistenceRequest(pclPointCloudViewerControllerSetPersistenceRequest *request)
 {
     try{
+        //!the visualization thread reads the ring under the same lock
+        std::lock_guard<std::mutex> lock(data_to_show_mutex);
+        m_accumulator.setMemoryLimit((size_t)request->getMemoryMb() * 1024 * 1024);
+        m_accumulator.setVoxelSize(request->getVoxelSize());
+        m_accumulator.setFadeEnabled(request->getFade());
+        m_accumulator.setPersistence(request->getFrames(), request->getTimeMs());
+    }catch(...){
+        qDebug()<<"pclPointcloudViewerController::onSetPersistenceRequest Unhandled error";
+    }
+}
+
+void pclPointCloudViewerController::showUdpPointCloud(int32_t *point_cloud, uint32_t buff_size, uint32_t timestamp)
+{
+    try{
+
+        if(m_accumulator.isEnabled()){
+            //!the accumulated ring is shown, intensities are kept per slot of the ring
+            std::lock_guard<std::mutex> lock(data_to_show_mutex);
+            m_accumulator.addFrame((tPointPcd*)&point_cloud[1], buff_size, timestamp);
+            return;
+        }
 
         m_color_point_cloud->clear();
         m_intensities.clear();
+        m_intensities.reserve(buff_size);
 
         int j = 1;
 
@@ -414,8 +690,16 @@ void pclPointCloudViewerController::run()
 {
     m_color_point_cloud = pcl::PointCloud<pcl::PointXYZRGB>::Ptr(new pcl::PointCloud<pcl::PointXYZRGB>);
 
-    viewer.runOnVisualizationThreadOnce(viewerOneOff);
-    viewer.runOnVisualizationThread(updatePointCloud);
+    if(offscreen_settings.enabled){
+        //!no window, the frames are rendered in this thread
+        render_scheduler.setTargetFps((int)offscreen_settings.video_fps);
+        if(!offscreen_settings.image_directory.isEmpty() || !offscreen_settings.video_file.isEmpty()){
+            m_offscreen_renderer.open(offscreen_settings);
+        }
+    }else{
+        viewer->runOnVisualizationThreadOnce(viewerOneOff);
+        viewer->runOnVisualizationThread(updatePointCloud);
+    }
 
     //!loop where data selection gets detected
     m_message_timer = new QTimer();
@@ -36,6 +36,9 @@
 #include <QTimer>
 #include <QQueue>
 
+#include <mutex>
+#include <atomic>
+
 //segmentation
 //#include <pcl/io/pcd_io.h>
 #include <pcl/point_types.h>
@@ -50,6 +53,12 @@
 #include <vtkRenderWindow.h>
 
 #include "pclPointCloudViewerControllerMessages.h"
+#include "displayedPointCloud.h"
+#include "pointCloudAccumulator.h"
+#include "pointPickingService.h"
+#include "renderScheduler.h"
+#include "euclideanClustering.h"
+#include "offscreenRenderer.h"
 
 //#include "boost/math/special_functions/round.hpp"
 #include "math.h"
@@ -69,7 +78,40 @@ public:
     //! @return
     void customEvent(QEvent *event);
 
-    void doShowPointCloud(int32_t *pointcloud);
+    //! @brief  Renders the frames offscreen instead of opening the viewer window, it has to be
+    //!         called before the controller is created
+    //! @param  settings Image size, camera and outputs, rendering is offscreen if enabled
+    //! @return none
+    static void setOffscreenRendering(const offscreenRenderSettings &settings);
+
+    //! @brief  Leaves a frame in the mailbox of the viewer, a frame not shown yet is replaced
+    //! @param  pointcloud Point cloud in L3Cam layout, the first value is the number of points
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @param  foreground_points Number of foreground points, placed before the background ones
+    //! @return none
+    void doShowPointCloud(int32_t *pointcloud, uint32_t timestamp, int32_t foreground_points);
+
+    //! @brief  Replaces the boxes of the objects shown, they are drawn with the next frame
+    //! @param  clusters Objects found in the last frame
+    //! @return none
+    void doShowClusters(const std::vector<pointCloudCluster> &clusters);
+
+    //! @brief  Shows only the foreground points of the frames
+    //! @param  enable If true the background points are not shown
+    //! @return none
+    void setForegroundOnly(bool enable);
+
+    //! @brief  Returns the number of frames replaced in the mailbox before being shown
+    uint64_t getSkippedFrames();
+
+    //! @brief  Configures the persistence of the frames shown
+    //! @param  frames Number of frames to keep, 0 or 1 shows only the last frame
+    //! @param  time_ms Maximum age of the frames kept in ms, 0 for no time limit
+    //! @param  fade If true older frames are shown darker
+    //! @param  voxel_size Voxel edge in mm to keep only the newest point per voxel, 0 to disable
+    //! @param  memory_mb Maximum memory used by the accumulated points in MB
+    //! @return none
+    void doSetPersistence(int frames, int time_ms, bool fade, float voxel_size, int memory_mb);
 
     //! @brief  Changes visualization window background color
     //! @param  red Red value of backgroud color in range 0-1
@@ -99,6 +141,12 @@ public:
 
     void setColorType(int pcd_type);
 
+    //! @brief  Configures the rate the viewer is updated at and the statistics overlay
+    //! @param  target_fps Maximum updates per second, 0 to update on every new frame
+    //! @param  show_overlay If true render and ingest rates, points drawn and frame age are shown
+    //! @return none
+    void setRenderSettings(int target_fps, bool show_overlay);
+
 signals:
 
     void sendPointSelectedData(QString data);
@@ -111,9 +159,13 @@ public slots:
 
 private:
 
-    void onShowUpdPointCloudRequest(pclPointCloudViewerControllerShowUdpPointCloud *request);
+    void onShowUpdPointCloudRequest();
+
+    void onSetPersistenceRequest(pclPointCloudViewerControllerSetPersistenceRequest *request);
+
+    void renderOffscreen(uint32_t timestamp);
 
-    void showUdpPointCloud(int32_t *point_cloud, uint32_t buff_size);
+    void showUdpPointCloud(int32_t *point_cloud, uint32_t buff_size, uint32_t timestamp);
 
 
 protected:
@@ -131,6 +183,20 @@ protected:
 
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr m_color_point_cloud;
 
+    pointCloudAccumulator m_accumulator;
+
+    offscreenRenderer m_offscreen_renderer;
+
+    std::vector<int32_t> m_intensities;
+
+    std::mutex m_mailbox_mutex;
+    std::vector<int32_t> m_mailbox_frame;
+    std::vector<int32_t> m_mailbox_working_frame;
+    uint32_t m_mailbox_timestamp;
+    bool m_mailbox_pending;
+
+    std::atomic<bool> m_foreground_only;
+
 
 public:
 
@@ -29,3 +29,4 @@
 
 const QEvent::Type pclPointCloudViewerControllerShowUdpPointCloud::TYPE                       = static_cast<QEvent::Type>(QEvent::registerEventType());
 const QEvent::Type pclPointCloudViewerControllerPointSelectedNotification::TYPE               = static_cast<QEvent::Type>(QEvent::registerEventType());
+const QEvent::Type pclPointCloudViewerControllerSetPersistenceRequest::TYPE                   = static_cast<QEvent::Type>(QEvent::registerEventType());
@@ -38,20 +38,35 @@
 #include <pcl/io/file_io.h>
 
 
+//! @brief  Wakes the controller up to show the frame waiting in its mailbox
 class pclPointCloudViewerControllerShowUdpPointCloud : public QEvent{
   public:
-    pclPointCloudViewerControllerShowUdpPointCloud(int32_t *pointcloud, int32_t buff_size) : QEvent((QEvent::Type)(QEvent::registerEventType())){
-        m_point_cloud = (int32_t*)malloc((buff_size*sizeof(int32_t)*5)+1);
-        memcpy(m_point_cloud, pointcloud, (sizeof(int32_t)*buff_size*5)+1);
-        m_buff_size = buff_size;
+    pclPointCloudViewerControllerShowUdpPointCloud() : QEvent((QEvent::Type)(QEvent::registerEventType())){
     }
     static const QEvent::Type TYPE;
-    int32_t *getPointCloud(){return m_point_cloud;}
-    int32_t getBufferSize(){return m_buff_size;}
-    void releaseMemory(){free(m_point_cloud);}
+};
+
+class pclPointCloudViewerControllerSetPersistenceRequest : public QEvent{
+public:
+    pclPointCloudViewerControllerSetPersistenceRequest(int frames, int time_ms, bool fade, float voxel_size, int memory_mb) : QEvent((QEvent::Type)(QEvent::registerEventType())){
+        m_frames = frames;
+        m_time_ms = time_ms;
+        m_fade = fade;
+        m_voxel_size = voxel_size;
+        m_memory_mb = memory_mb;
+    }
+    static const QEvent::Type TYPE;
+    int getFrames(){return m_frames;}
+    int getTimeMs(){return m_time_ms;}
+    bool getFade(){return m_fade;}
+    float getVoxelSize(){return m_voxel_size;}
+    int getMemoryMb(){return m_memory_mb;}
 private:
-    int32_t m_buff_size;
-    int32_t *m_point_cloud;
+    int m_frames;
+    int m_time_ms;
+    bool m_fade;
+    float m_voxel_size;
+    int m_memory_mb;
 };
 
 class pclPointCloudViewerControllerPointSelectedNotification : public QEvent{
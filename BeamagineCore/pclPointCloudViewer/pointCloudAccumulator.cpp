@@ -0,0 +1,433 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pointCloudAccumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//! Bytes used by every slot: the ring point and its bookkeeping and the buffers of the
+//! viewer (position, color, intensity, timestamp and vertex id)
+static const size_t bytes_per_slot = sizeof(pcl::PointXYZRGB) + (2 * sizeof(uint64_t)) + (3 * sizeof(uint32_t)) +
+                                     (3 * sizeof(float)) + (3 * sizeof(uint8_t)) + sizeof(int32_t) + sizeof(uint32_t) + sizeof(int64_t);
+
+//! Ranges tracked before the whole ring is copied instead
+static const size_t max_changed_ranges = 4096;
+
+//! Milliseconds in a day, device timestamps wrap at midnight
+static const uint32_t milliseconds_per_day = 86400000;
+
+//! Brightness of the oldest frame when fading is enabled
+static const float minimum_fade = 0.15;
+
+pointCloudAccumulator::pointCloudAccumulator()
+{
+    m_cloud = pcl::PointCloud<pcl::PointXYZRGB>::Ptr(new pcl::PointCloud<pcl::PointXYZRGB>);
+
+    m_max_frames = 0;
+    m_max_time_ms = 0;
+    m_fade_enabled = false;
+    m_voxel_size = 0;
+    m_sequence = 0;
+
+    setMemoryLimit(256 * 1024 * 1024);
+}
+
+void pointCloudAccumulator::setPersistence(int frames, int time_ms)
+{
+    m_max_frames = frames < 0 ? 0 : frames;
+    m_max_time_ms = time_ms < 0 ? 0 : time_ms;
+    clear();
+}
+
+void pointCloudAccumulator::setFadeEnabled(bool enabled)
+{
+    if(enabled != m_fade_enabled){
+        //!the colors go back to the ones of the points
+        m_all_slots_changed = true;
+    }
+    m_fade_enabled = enabled;
+}
+
+void pointCloudAccumulator::setVoxelSize(float voxel_size)
+{
+    m_voxel_size = voxel_size < 0 ? 0 : voxel_size;
+    clear();
+}
+
+void pointCloudAccumulator::setMemoryLimit(size_t bytes)
+{
+    m_capacity = bytes / bytes_per_slot;
+    if(m_capacity == 0){
+        m_capacity = 1;
+    }
+    clear();
+}
+
+bool pointCloudAccumulator::isEnabled() const
+{
+    return m_max_frames > 1 || m_max_time_ms > 0;
+}
+
+void pointCloudAccumulator::clear()
+{
+    m_cloud->clear();
+    m_cloud->is_dense = false;
+
+    m_slot_frame.clear();
+    m_slot_voxel.clear();
+    m_slot_color.clear();
+    m_slot_intensity.clear();
+    m_slot_timestamp.clear();
+
+    m_frames.clear();
+    m_voxels.clear();
+
+    m_changed_slots.clear();
+    m_all_slots_changed = true;
+    m_fade_changed = false;
+
+    m_head = 0;
+    m_slots_used = 0;
+    m_points_alive = 0;
+}
+
+void pointCloudAccumulator::addFrame(const tPointPcd *points, int32_t number_of_points, uint32_t timestamp)
+{
+    if(number_of_points <= 0){
+        return;
+    }
+
+    size_t points_to_add = (size_t)number_of_points;
+    if(points_to_add > m_capacity){
+        //!keep the last points of the frame, the ring can not hold more
+        points += points_to_add - m_capacity;
+        points_to_add = m_capacity;
+    }
+
+    uint32_t timestamp_ms = timestampToMilliseconds(timestamp);
+
+    evictFrames(timestamp_ms);
+
+    //!make room for the whole frame evicting the oldest ones
+    while(m_slots_used + points_to_add > m_capacity && !m_frames.empty()){
+        evictOldestFrame();
+    }
+
+    accumulatedFrame frame;
+    frame.sequence = ++m_sequence;
+    frame.timestamp_ms = timestamp_ms;
+    frame.first_slot = m_head;
+    frame.number_of_slots = points_to_add;
+
+    pcl::PointXYZRGB curr_point;
+
+    for(size_t i = 0; i < points_to_add; ++i){
+
+        size_t slot = m_head;
+
+        if(slot == m_cloud->points.size()){
+            //!ring still growing up to its capacity
+            m_cloud->points.push_back(curr_point);
+            m_slot_frame.push_back(0);
+            m_slot_voxel.push_back(0);
+            m_slot_color.push_back(0);
+            m_slot_intensity.push_back(0);
+            m_slot_timestamp.push_back(0);
+        }
+
+        curr_point.x = points[i].x;
+        curr_point.y = points[i].y;
+        curr_point.z = points[i].z;
+        curr_point.rgb = *reinterpret_cast<const float*>(&points[i].RGB);
+
+        m_cloud->points[slot] = curr_point;
+        m_slot_frame[slot] = frame.sequence;
+        m_slot_color[slot] = (uint32_t)points[i].RGB;
+        m_slot_intensity[slot] = points[i].intensity;
+        m_slot_timestamp[slot] = timestamp;
+        ++m_points_alive;
+
+        if(m_voxel_size > 0){
+            uint64_t key = getVoxelKey(points[i]);
+            m_slot_voxel[slot] = key;
+
+            std::unordered_map<uint64_t, size_t>::iterator it = m_voxels.find(key);
+            if(it != m_voxels.end()){
+                //!the newest sample replaces the one already in the voxel
+                size_t old_slot = it->second;
+                it->second = slot;
+                releaseSlot(old_slot);
+            }else{
+                m_voxels[key] = slot;
+            }
+        }
+
+        m_head = (m_head + 1) % m_capacity;
+    }
+
+    m_slots_used += points_to_add;
+    m_frames.push_back(frame);
+    markChanged(frame.first_slot, points_to_add);
+    m_fade_changed = true;
+
+    m_cloud->width = m_cloud->points.size();
+    m_cloud->height = 1;
+    m_cloud->is_dense = false;
+}
+
+pcl::PointCloud<pcl::PointXYZRGB>::Ptr pointCloudAccumulator::getCloud() const
+{
+    return m_cloud;
+}
+
+size_t pointCloudAccumulator::getCapacity() const
+{
+    return m_capacity;
+}
+
+size_t pointCloudAccumulator::getNumberOfSlots() const
+{
+    return m_cloud->points.size();
+}
+
+void pointCloudAccumulator::copyChangedSlots(float *positions, uint8_t *colors, int32_t *intensities, uint32_t *timestamps, size_t number_of_slots)
+{
+    if(m_all_slots_changed){
+        copySlots(0, m_cloud->points.size(), positions, colors, intensities, timestamps);
+        std::fill(positions + (m_cloud->points.size() * 3), positions + (number_of_slots * 3), std::numeric_limits<float>::quiet_NaN());
+    }else{
+        for(size_t i = 0; i < m_changed_slots.size(); ++i){
+            copySlots(m_changed_slots[i].first, m_changed_slots[i].second, positions, colors, intensities, timestamps);
+        }
+    }
+
+    //!every frame gets older with a new one, only the colors of the slots in use are written
+    if(m_fade_enabled && (m_fade_changed || m_all_slots_changed)){
+        for(size_t f = 0; f < m_frames.size(); ++f){
+
+            const accumulatedFrame &frame = m_frames[f];
+            float factor = getFadeFactor(f);
+
+            for(size_t i = 0; i < frame.number_of_slots; ++i){
+                size_t slot = (frame.first_slot + i) % m_capacity;
+                if(m_slot_frame[slot] != frame.sequence){
+                    continue;
+                }
+
+                uint32_t color = m_slot_color[slot];
+                uint8_t *rgb = colors + (slot * 3);
+                rgb[0] = (uint8_t)(((color >> 16) & 0xFF) * factor);
+                rgb[1] = (uint8_t)(((color >> 8) & 0xFF) * factor);
+                rgb[2] = (uint8_t)((color & 0xFF) * factor);
+            }
+        }
+    }
+
+    m_changed_slots.clear();
+    m_all_slots_changed = false;
+    m_fade_changed = false;
+}
+
+const std::vector<int32_t> &pointCloudAccumulator::getIntensities() const
+{
+    return m_slot_intensity;
+}
+
+const std::vector<uint32_t> &pointCloudAccumulator::getTimestamps() const
+{
+    return m_slot_timestamp;
+}
+
+size_t pointCloudAccumulator::getPointsAlive() const
+{
+    return m_points_alive;
+}
+
+size_t pointCloudAccumulator::getFramesAlive() const
+{
+    return m_frames.size();
+}
+
+void pointCloudAccumulator::evictFrames(uint32_t timestamp_ms)
+{
+    //!the incoming frame takes one of the places of the window
+    while(m_max_frames > 0 && (int)m_frames.size() >= m_max_frames){
+        evictOldestFrame();
+    }
+
+    while(m_max_time_ms > 0 && !m_frames.empty() &&
+          getFrameAge(timestamp_ms, m_frames.front().timestamp_ms) > (uint32_t)m_max_time_ms){
+        evictOldestFrame();
+    }
+}
+
+void pointCloudAccumulator::evictOldestFrame()
+{
+    const accumulatedFrame &frame = m_frames.front();
+
+    for(size_t i = 0; i < frame.number_of_slots; ++i){
+        size_t slot = (frame.first_slot + i) % m_capacity;
+        if(m_slot_frame[slot] == frame.sequence){
+            releaseSlot(slot);
+        }
+    }
+
+    m_slots_used -= frame.number_of_slots;
+    m_frames.pop_front();
+    m_fade_changed = true;
+}
+
+void pointCloudAccumulator::releaseSlot(size_t slot)
+{
+    if(m_slot_frame[slot] == 0){
+        return;
+    }
+
+    if(m_voxel_size > 0){
+        std::unordered_map<uint64_t, size_t>::iterator it = m_voxels.find(m_slot_voxel[slot]);
+        if(it != m_voxels.end() && it->second == slot){
+            m_voxels.erase(it);
+        }
+    }
+
+    pcl::PointXYZRGB &point = m_cloud->points[slot];
+    point.x = point.y = point.z = std::numeric_limits<float>::quiet_NaN();
+
+    m_slot_frame[slot] = 0;
+    --m_points_alive;
+
+    markChanged(slot, 1);
+}
+
+void pointCloudAccumulator::markChanged(size_t first_slot, size_t number_of_slots)
+{
+    if(m_all_slots_changed || number_of_slots == 0){
+        return;
+    }
+
+    size_t count = std::min(number_of_slots, m_capacity - first_slot);
+
+    if(!m_changed_slots.empty() && m_changed_slots.back().first + m_changed_slots.back().second == first_slot){
+        //!slots released one by one while evicting a frame extend the same range
+        m_changed_slots.back().second += count;
+    }else if(m_changed_slots.size() >= max_changed_ranges){
+        m_changed_slots.clear();
+        m_all_slots_changed = true;
+        return;
+    }else{
+        m_changed_slots.push_back(std::make_pair(first_slot, count));
+    }
+
+    //!a range that wraps around the end of the ring goes on from the first slot
+    if(count < number_of_slots){
+        markChanged(0, number_of_slots - count);
+    }
+}
+
+void pointCloudAccumulator::copySlots(size_t first_slot, size_t number_of_slots, float *positions, uint8_t *colors, int32_t *intensities, uint32_t *timestamps) const
+{
+    for(size_t slot = first_slot; slot < first_slot + number_of_slots; ++slot){
+
+        const pcl::PointXYZRGB &point = m_cloud->points[slot];
+        float *xyz = positions + (slot * 3);
+        xyz[0] = point.x;
+        xyz[1] = point.y;
+        xyz[2] = point.z;
+
+        uint32_t color = m_slot_color[slot];
+        uint8_t *rgb = colors + (slot * 3);
+        rgb[0] = (uint8_t)((color >> 16) & 0xFF);
+        rgb[1] = (uint8_t)((color >> 8) & 0xFF);
+        rgb[2] = (uint8_t)(color & 0xFF);
+
+        intensities[slot] = m_slot_intensity[slot];
+        timestamps[slot] = m_slot_timestamp[slot];
+    }
+}
+
+void pointCloudAccumulator::applyFade()
+{
+    if(!m_fade_enabled){
+        return;
+    }
+
+    for(size_t f = 0; f < m_frames.size(); ++f){
+
+        const accumulatedFrame &frame = m_frames[f];
+        float factor = getFadeFactor(f);
+
+        for(size_t i = 0; i < frame.number_of_slots; ++i){
+            size_t slot = (frame.first_slot + i) % m_capacity;
+            if(m_slot_frame[slot] != frame.sequence){
+                continue;
+            }
+
+            uint32_t color = m_slot_color[slot];
+            uint32_t red = (uint32_t)(((color >> 16) & 0xFF) * factor);
+            uint32_t green = (uint32_t)(((color >> 8) & 0xFF) * factor);
+            uint32_t blue = (uint32_t)((color & 0xFF) * factor);
+
+            pcl::PointXYZRGB &point = m_cloud->points[slot];
+            point.r = red;
+            point.g = green;
+            point.b = blue;
+        }
+    }
+}
+
+float pointCloudAccumulator::getFadeFactor(size_t frame) const
+{
+    if(m_frames.size() < 2){
+        return 1.0;
+    }
+
+    //!fade by age when there is a time window, by position in the ring otherwise
+    float window = m_max_time_ms > 0 ? (float)m_max_time_ms : (float)(m_frames.size() - 1);
+    float age = m_max_time_ms > 0 ? (float)getFrameAge(m_frames.back().timestamp_ms, m_frames[frame].timestamp_ms) : (float)(m_frames.size() - 1 - frame);
+
+    return 1.0 - ((1.0 - minimum_fade) * std::min(age / window, (float)1.0));
+}
+
+uint64_t pointCloudAccumulator::getVoxelKey(const tPointPcd &point) const
+{
+    //!21 bits per axis, enough for +-1000 m with 1 mm voxels
+    const int64_t offset = 1 << 20;
+    const uint64_t mask = (1 << 21) - 1;
+
+    uint64_t vx = (uint64_t)((int64_t)std::floor(point.x / m_voxel_size) + offset) & mask;
+    uint64_t vy = (uint64_t)((int64_t)std::floor(point.y / m_voxel_size) + offset) & mask;
+    uint64_t vz = (uint64_t)((int64_t)std::floor(point.z / m_voxel_size) + offset) & mask;
+
+    return (vx << 42) | (vy << 21) | vz;
+}
+
+uint32_t pointCloudAccumulator::getFrameAge(uint32_t newest_ms, uint32_t frame_ms) const
+{
+    return (newest_ms + milliseconds_per_day - frame_ms) % milliseconds_per_day;
+}
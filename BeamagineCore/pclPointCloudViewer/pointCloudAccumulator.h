@@ -0,0 +1,182 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef POINTCLOUDACCUMULATOR_H
+#define POINTCLOUDACCUMULATOR_H
+
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include <beam_aux.h>
+
+//! @brief  Keeps the points of the last frames in a fixed capacity ring so sparse
+//!         frames can be shown together. New frames overwrite the slots of the oldest
+//!         ones and expired slots are set to NaN so they are not drawn. The slots
+//!         changed since the last copy are tracked, so the buffers of the viewer are
+//!         updated in place with the new frame and the fade of the older ones only.
+class pointCloudAccumulator
+{
+public:
+    pointCloudAccumulator();
+
+    //! @brief  Sets the persistence window
+    //! @param  frames Maximum number of frames to keep, 0 for no frame limit
+    //! @param  time_ms Maximum age of the frames to keep in ms, 0 for no time limit
+    //! @return none
+    void setPersistence(int frames, int time_ms);
+
+    //! @brief  Enables or disables fading older frames towards black
+    //! @param  enabled If true older frames are darkened according to their age
+    //! @return none
+    void setFadeEnabled(bool enabled);
+
+    //! @brief  Sets the voxel size used to keep a single point per voxel
+    //! @param  voxel_size Voxel edge in mm, 0 disables the deduplication
+    //! @return none
+    void setVoxelSize(float voxel_size);
+
+    //! @brief  Sets the memory budget of the ring, it fixes the maximum number of points kept
+    //! @param  bytes Maximum memory to use in bytes
+    //! @return none
+    void setMemoryLimit(size_t bytes);
+
+    //! @brief  Returns true when a persistence window is configured
+    bool isEnabled() const;
+
+    //! @brief  Removes all the accumulated frames
+    void clear();
+
+    //! @brief  Adds a new frame to the ring evicting the frames out of the window
+    //! @param  points Points of the frame in L3Cam layout
+    //! @param  number_of_points Number of points of the frame
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return none
+    void addFrame(const tPointPcd *points, int32_t number_of_points, uint32_t timestamp);
+
+    //! @brief  Returns the ring cloud, slots not in use are NaN
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr getCloud() const;
+
+    //! @brief  Returns the maximum number of slots of the ring
+    size_t getCapacity() const;
+
+    //! @brief  Returns the number of slots of the ring, it grows up to the capacity
+    size_t getNumberOfSlots() const;
+
+    //! @brief  Copies the slots changed since the last call to the buffers of the viewer.
+    //!         With fading enabled the colors of every slot in use are refreshed too.
+    //! @param  positions x, y, z of each slot
+    //! @param  colors Red, green and blue of each slot
+    //! @param  intensities Intensity of each slot
+    //! @param  timestamps Device timestamp of each slot
+    //! @param  number_of_slots Slots of the buffers, at least getNumberOfSlots(). The ones
+    //!         after the ring are set to NaN when the whole ring is copied
+    //! @return none
+    void copyChangedSlots(float *positions, uint8_t *colors, int32_t *intensities, uint32_t *timestamps, size_t number_of_slots);
+
+    //! @brief  Darkens the colors of the ring cloud by the age of their frames when fading
+    //!         is enabled, for the renderers that draw the ring cloud itself
+    void applyFade();
+
+    //! @brief  Returns the intensity of each slot of the ring
+    const std::vector<int32_t> &getIntensities() const;
+
+    //! @brief  Returns the device timestamp of the frame owning each slot
+    const std::vector<uint32_t> &getTimestamps() const;
+
+    //! @brief  Returns the number of points currently drawn
+    size_t getPointsAlive() const;
+
+    //! @brief  Returns the number of frames currently kept
+    size_t getFramesAlive() const;
+
+private:
+
+    typedef struct accumulatedFrame{
+        uint64_t sequence;
+        uint32_t timestamp_ms;
+        size_t first_slot;
+        size_t number_of_slots;
+    }accumulatedFrame;
+
+    void evictFrames(uint32_t timestamp_ms);
+
+    void evictOldestFrame();
+
+    void releaseSlot(size_t slot);
+
+    void markChanged(size_t first_slot, size_t number_of_slots);
+
+    void copySlots(size_t first_slot, size_t number_of_slots, float *positions, uint8_t *colors, int32_t *intensities, uint32_t *timestamps) const;
+
+    //! @brief  Returns the brightness of a frame, 1 for the newest
+    //! @param  frame Position of the frame in the list of frames kept
+    float getFadeFactor(size_t frame) const;
+
+    uint64_t getVoxelKey(const tPointPcd &point) const;
+
+    uint32_t getFrameAge(uint32_t newest_ms, uint32_t frame_ms) const;
+
+private:
+
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr m_cloud;
+
+    std::vector<uint64_t> m_slot_frame;
+    std::vector<uint64_t> m_slot_voxel;
+    std::vector<uint32_t> m_slot_color;
+    std::vector<int32_t> m_slot_intensity;
+    std::vector<uint32_t> m_slot_timestamp;
+
+    std::deque<accumulatedFrame> m_frames;
+
+    std::unordered_map<uint64_t, size_t> m_voxels;
+
+    //! Ranges of slots (first, count) changed since the last copy
+    std::vector<std::pair<size_t, size_t> > m_changed_slots;
+    bool m_all_slots_changed;
+    bool m_fade_changed;
+
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_slots_used;
+    size_t m_points_alive;
+
+    uint64_t m_sequence;
+
+    float m_voxel_size;
+
+    int m_max_frames;
+    int m_max_time_ms;
+
+    bool m_fade_enabled;
+};
+
+#endif // POINTCLOUDACCUMULATOR_H
@@ -0,0 +1,108 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pointPickingService.h"
+
+#include <cmath>
+
+//! Maximum distance between the picked coordinates and the point of the slot, in mm. The
+//! picker gives the coordinates of the slot, a larger distance is a point of another actor
+static const float max_slot_distance = 1.0;
+
+pointPickingService::pointPickingService()
+{
+    m_positions = NULL;
+    m_colors = NULL;
+    m_intensities = NULL;
+    m_timestamps = NULL;
+    m_number_of_points = 0;
+    m_timestamp = 0;
+    m_has_previous = false;
+    m_previous_x = 0;
+    m_previous_y = 0;
+    m_previous_z = 0;
+}
+
+void pointPickingService::setDisplayedFrame(const float *positions, const uint8_t *colors, const int32_t *intensities, const uint32_t *timestamps, size_t number_of_points, uint32_t timestamp)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_positions = positions;
+    m_colors = colors;
+    m_intensities = intensities;
+    m_timestamps = timestamps;
+    m_number_of_points = number_of_points;
+    m_timestamp = timestamp;
+}
+
+bool pointPickingService::pickPoint(int32_t index, float x, float y, float z, pickedPoint &picked)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_positions == NULL || index < 0 || (size_t)index >= m_number_of_points){
+        return false;
+    }
+
+    //!the slots not in use are NaN and are never within the distance
+    const float *point = m_positions + ((size_t)index * 3);
+    float dx = point[0] - x;
+    float dy = point[1] - y;
+    float dz = point[2] - z;
+    if(!(dx*dx + dy*dy + dz*dz <= max_slot_distance * max_slot_distance)){
+        return false;
+    }
+
+    const uint8_t *color = m_colors + ((size_t)index * 3);
+
+    picked.x = point[0];
+    picked.y = point[1];
+    picked.z = point[2];
+    picked.range = std::sqrt(point[0]*point[0] + point[1]*point[1] + point[2]*point[2]);
+    picked.intensity = m_intensities != NULL ? m_intensities[index] : 0;
+    picked.red = color[0];
+    picked.green = color[1];
+    picked.blue = color[2];
+    picked.timestamp = m_timestamps != NULL ? m_timestamps[index] : m_timestamp;
+
+    //!consecutive picks measure the distance between points
+    picked.has_previous = m_has_previous;
+    if(m_has_previous){
+        float previous_dx = point[0] - m_previous_x;
+        float previous_dy = point[1] - m_previous_y;
+        float previous_dz = point[2] - m_previous_z;
+        picked.distance_to_previous = std::sqrt(previous_dx*previous_dx + previous_dy*previous_dy + previous_dz*previous_dz);
+    }else{
+        picked.distance_to_previous = 0;
+    }
+
+    m_has_previous = true;
+    m_previous_x = point[0];
+    m_previous_y = point[1];
+    m_previous_z = point[2];
+
+    return true;
+}
@@ -0,0 +1,94 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef POINTPICKINGSERVICE_H
+#define POINTPICKINGSERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+
+typedef struct pickedPoint{
+    float x;
+    float y;
+    float z;
+    float range;
+    int32_t intensity;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint32_t timestamp;
+    bool has_previous;
+    float distance_to_previous;
+}pickedPoint;
+
+//! @brief  Answers point picking queries on the frame being displayed. The buffers of
+//!         the viewer are only referenced when they are published. The point picked in the
+//!         model of the viewer has the index of its slot in the buffers, so a pick is
+//!         resolved without searching and nothing is built when a new frame is shown.
+class pointPickingService
+{
+public:
+    pointPickingService();
+
+    //! @brief  Publishes the frame being displayed. The buffers must not change until they
+    //!         are published again, from the thread that picks.
+    //! @param  positions x, y, z of each point, NaN for the points not drawn
+    //! @param  colors Red, green and blue of each point
+    //! @param  intensities Intensity of each point
+    //! @param  timestamps Device timestamp of each point
+    //! @param  number_of_points Number of points of the buffers
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return none
+    void setDisplayedFrame(const float *positions, const uint8_t *colors, const int32_t *intensities, const uint32_t *timestamps, size_t number_of_points, uint32_t timestamp);
+
+    //! @brief  Returns the attributes of the point picked in the model of the viewer
+    //! @param  index Index of the point picked in the model, the slot of the buffers
+    //! @param  x, y, z Coordinates of the point picked in mm
+    //! @param  picked Returns the attributes of the point
+    //! @return false if the slot does not hold a point drawn at the picked coordinates,
+    //!         the pick was on another actor
+    bool pickPoint(int32_t index, float x, float y, float z, pickedPoint &picked);
+
+private:
+
+    std::mutex m_mutex;
+
+    const float *m_positions;
+    const uint8_t *m_colors;
+    const int32_t *m_intensities;
+    const uint32_t *m_timestamps;
+    size_t m_number_of_points;
+    uint32_t m_timestamp;
+
+    bool m_has_previous;
+    float m_previous_x;
+    float m_previous_y;
+    float m_previous_z;
+};
+
+#endif // POINTPICKINGSERVICE_H
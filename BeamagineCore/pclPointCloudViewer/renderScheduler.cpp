@@ -0,0 +1,132 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "renderScheduler.h"
+
+#include <QTime>
+
+#include <beam_aux.h>
+
+//! Window used to compute the rates, in ms
+static const int64_t rate_window = 1000;
+
+//! Refresh period of the statistics overlay, in ms
+static const int64_t overlay_period = 250;
+
+static const int64_t milliseconds_per_day = 86400000;
+
+static const int64_t default_target_fps = 30;
+
+renderScheduler::renderScheduler()
+{
+    m_clock.start();
+
+    m_last_render = -rate_window;
+    m_last_overlay = -rate_window;
+    m_render_period = 1000 / default_target_fps;
+
+    m_points_drawn = 0;
+    m_frame_age_ms = 0;
+    m_skipped_frames = 0;
+}
+
+void renderScheduler::setTargetFps(int fps)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_render_period = fps > 0 ? 1000 / fps : 0;
+}
+
+bool renderScheduler::isRenderDue()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_clock.elapsed() - m_last_render >= m_render_period;
+}
+
+bool renderScheduler::isOverlayDue()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = m_clock.elapsed();
+    if(now - m_last_overlay < overlay_period){
+        return false;
+    }
+    m_last_overlay = now;
+    return true;
+}
+
+void renderScheduler::dropOldEvents(std::deque<int64_t> &events, int64_t now)
+{
+    while(!events.empty() && now - events.front() > rate_window){
+        events.pop_front();
+    }
+}
+
+void renderScheduler::frameIngested()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = m_clock.elapsed();
+    m_ingest_events.push_back(now);
+    dropOldEvents(m_ingest_events, now);
+}
+
+void renderScheduler::frameSkipped()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_skipped_frames;
+}
+
+void renderScheduler::frameRendered(size_t points_drawn, uint32_t timestamp)
+{
+    //!the age relies on the device clock being in sync with the host clock
+    int64_t age = (int64_t)QTime::currentTime().msecsSinceStartOfDay() - (int64_t)timestampToMilliseconds(timestamp);
+    if(age < -milliseconds_per_day / 2){
+        age += milliseconds_per_day;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = m_clock.elapsed();
+    m_last_render = now;
+    m_render_events.push_back(now);
+    dropOldEvents(m_render_events, now);
+    m_points_drawn = points_drawn;
+    m_frame_age_ms = age;
+}
+
+renderStatistics renderScheduler::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int64_t now = m_clock.elapsed();
+    dropOldEvents(m_ingest_events, now);
+    dropOldEvents(m_render_events, now);
+
+    renderStatistics statistics;
+    statistics.render_fps = m_render_events.size() * 1000.0 / rate_window;
+    statistics.ingest_fps = m_ingest_events.size() * 1000.0 / rate_window;
+    statistics.points_drawn = m_points_drawn;
+    statistics.frame_age_ms = m_frame_age_ms;
+    statistics.skipped_frames = m_skipped_frames;
+    return statistics;
+}
@@ -0,0 +1,102 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+
+#include <QElapsedTimer>
+
+typedef struct renderStatistics{
+    double render_fps;
+    double ingest_fps;
+    size_t points_drawn;
+    int64_t frame_age_ms;
+    uint64_t skipped_frames;
+}renderStatistics;
+
+//! @brief  Paces the updates of the point cloud viewer to a target rate independent of
+//!         the rate frames are received at, and measures both rates and the age of the
+//!         frame on screen. Frames are ingested from the controller thread and rendered
+//!         from the visualization thread.
+class renderScheduler
+{
+public:
+    renderScheduler();
+
+    //! @brief  Sets the maximum rate the viewer is updated at
+    //! @param  fps Target frames per second, 0 to update on every new frame
+    //! @return none
+    void setTargetFps(int fps);
+
+    //! @brief  Returns true when the time since the last render reached the target period
+    bool isRenderDue();
+
+    //! @brief  Returns true when the statistics overlay has to be refreshed
+    bool isOverlayDue();
+
+    //! @brief  Counts a frame received by the viewer
+    void frameIngested();
+
+    //! @brief  Counts a frame replaced by a newer one before being shown
+    void frameSkipped();
+
+    //! @brief  Counts a frame pushed to the viewer
+    //! @param  points_drawn Number of points of the frame
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return none
+    void frameRendered(size_t points_drawn, uint32_t timestamp);
+
+    //! @brief  Returns the rates over the last second and the data of the last frame rendered
+    renderStatistics getStatistics();
+
+private:
+
+    void dropOldEvents(std::deque<int64_t> &events, int64_t now);
+
+private:
+
+    std::mutex m_mutex;
+
+    QElapsedTimer m_clock;
+
+    std::deque<int64_t> m_ingest_events;
+    std::deque<int64_t> m_render_events;
+
+    int64_t m_last_render;
+    int64_t m_last_overlay;
+    int64_t m_render_period;
+
+    size_t m_points_drawn;
+    int64_t m_frame_age_ms;
+    uint64_t m_skipped_frames;
+};
+
+#endif // RENDERSCHEDULER_H
@@ -0,0 +1,257 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "backgroundModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <beam_parallel.h>
+
+#include "pointPartition.h"
+
+//! Minimum points per chunk of the parallel loops
+static const size_t background_chunk = 8192;
+
+//! Voxels are packed in 21 bits per axis, 0 is kept as the empty slot of the hash set
+static const int64_t voxel_offset = 1 << 20;
+static const uint64_t voxel_mask = (1 << 21) - 1;
+
+static uint64_t packVoxelKey(int64_t vx, int64_t vy, int64_t vz)
+{
+    return ((((uint64_t)(vx + voxel_offset) & voxel_mask) << 42) |
+            (((uint64_t)(vy + voxel_offset) & voxel_mask) << 21) |
+            ((uint64_t)(vz + voxel_offset) & voxel_mask)) + 1;
+}
+
+static uint64_t hashVoxelKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+backgroundModel::backgroundModel()
+{
+    m_settings.enabled = false;
+    m_settings.voxel_size = 200;
+    m_settings.learning_frames = 50;
+    m_settings.min_occupancy = 0.2;
+
+    m_relearn_requested = true;
+
+    m_voxel_size = m_settings.voxel_size;
+    m_learning_frames = m_settings.learning_frames;
+    m_learning_frames_left = m_learning_frames;
+    m_learning_frame = 0;
+
+    m_background_mask = 0;
+    m_background_voxels = 0;
+}
+
+void backgroundModel::setSettings(const backgroundModelSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(settings.voxel_size != m_settings.voxel_size || settings.learning_frames != m_settings.learning_frames ||
+       settings.min_occupancy != m_settings.min_occupancy || (settings.enabled && !m_settings.enabled)){
+        m_relearn_requested = true;
+    }
+    m_settings = settings;
+}
+
+backgroundModelSettings backgroundModel::getSettings()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+void backgroundModel::relearn()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_relearn_requested = true;
+}
+
+bool backgroundModel::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled;
+}
+
+int backgroundModel::getLearningFramesLeft()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_relearn_requested ? m_settings.learning_frames : m_learning_frames_left;
+}
+
+size_t backgroundModel::getBackgroundVoxels()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_background_voxels;
+}
+
+uint64_t backgroundModel::getVoxelKey(const tPointPcd &point, float inverse_voxel_size) const
+{
+    return packVoxelKey((int64_t)std::floor(point.x * inverse_voxel_size),
+                        (int64_t)std::floor(point.y * inverse_voxel_size),
+                        (int64_t)std::floor(point.z * inverse_voxel_size));
+}
+
+void backgroundModel::learnFrame(const tPointPcd *input, int32_t number_of_points)
+{
+    float inverse_voxel_size = 1.0 / m_voxel_size;
+    ++m_learning_frame;
+
+    for(int32_t i = 0; i < number_of_points; ++i){
+        std::pair<uint32_t, uint32_t> &hits = m_hits[getVoxelKey(input[i], inverse_voxel_size)];
+        //!a voxel counts once per frame
+        if(hits.second != m_learning_frame){
+            hits.second = m_learning_frame;
+            ++hits.first;
+        }
+    }
+}
+
+void backgroundModel::insertBackgroundVoxel(uint64_t key)
+{
+    uint64_t slot = hashVoxelKey(key) & m_background_mask;
+    while(m_background[slot] != 0){
+        if(m_background[slot] == key){
+            return;
+        }
+        slot = (slot + 1) & m_background_mask;
+    }
+    m_background[slot] = key;
+    ++m_background_voxels;
+}
+
+bool backgroundModel::isBackgroundVoxel(uint64_t key) const
+{
+    if(m_background.empty()){
+        return false;
+    }
+    uint64_t slot = hashVoxelKey(key) & m_background_mask;
+    while(m_background[slot] != 0){
+        if(m_background[slot] == key){
+            return true;
+        }
+        slot = (slot + 1) & m_background_mask;
+    }
+    return false;
+}
+
+void backgroundModel::finishLearning()
+{
+    uint32_t min_hits = (uint32_t)std::ceil(m_settings.min_occupancy * m_learning_frames);
+    if(min_hits < 1){
+        min_hits = 1;
+    }
+
+    std::vector<uint64_t> occupied;
+    occupied.reserve(m_hits.size());
+    for(std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t> >::const_iterator it = m_hits.begin(); it != m_hits.end(); ++it){
+        if(it->second.first >= min_hits){
+            occupied.push_back(it->first);
+        }
+    }
+
+    //!neighbours are added so points close to the edge of a background voxel are not foreground
+    std::vector<uint64_t> dilated;
+    dilated.reserve(occupied.size() * 27);
+    for(size_t i = 0; i < occupied.size(); ++i){
+        uint64_t key = occupied[i] - 1;
+        int64_t vx = (int64_t)((key >> 42) & voxel_mask) - voxel_offset;
+        int64_t vy = (int64_t)((key >> 21) & voxel_mask) - voxel_offset;
+        int64_t vz = (int64_t)(key & voxel_mask) - voxel_offset;
+
+        for(int64_t dx = -1; dx <= 1; ++dx){
+            for(int64_t dy = -1; dy <= 1; ++dy){
+                for(int64_t dz = -1; dz <= 1; ++dz){
+                    dilated.push_back(packVoxelKey(vx + dx, vy + dy, vz + dz));
+                }
+            }
+        }
+    }
+    std::sort(dilated.begin(), dilated.end());
+    dilated.erase(std::unique(dilated.begin(), dilated.end()), dilated.end());
+
+    //!the set is kept under half full for short probe sequences
+    size_t capacity = 1024;
+    while(capacity < dilated.size() * 2){
+        capacity *= 2;
+    }
+    m_background.assign(capacity, 0);
+    m_background_mask = capacity - 1;
+    m_background_voxels = 0;
+
+    for(size_t i = 0; i < dilated.size(); ++i){
+        insertBackgroundVoxel(dilated[i]);
+    }
+
+    m_hits.clear();
+}
+
+int32_t backgroundModel::apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_relearn_requested){
+            m_relearn_requested = false;
+            m_voxel_size = std::max(m_settings.voxel_size, 1.0f);
+            m_learning_frames = std::max(m_settings.learning_frames, 1);
+            m_learning_frames_left = m_learning_frames;
+            m_learning_frame = 0;
+            m_hits.clear();
+            m_background.clear();
+            m_background_voxels = 0;
+        }
+
+        if(m_learning_frames_left > 0){
+            learnFrame(input, number_of_points);
+            if(--m_learning_frames_left == 0){
+                finishLearning();
+            }
+            memcpy(output, input, sizeof(tPointPcd) * number_of_points);
+            return number_of_points;
+        }
+    }
+
+    float inverse_voxel_size = 1.0 / m_voxel_size;
+
+    m_foreground.resize(number_of_points);
+
+    beamParallelFor(number_of_points, background_chunk, [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            m_foreground[i] = !isBackgroundVoxel(getVoxelKey(input[i], inverse_voxel_size));
+        }
+    });
+
+    //!foreground points first and the background ones after them
+    return partitionPoints(input, number_of_points, m_foreground, output, true);
+}
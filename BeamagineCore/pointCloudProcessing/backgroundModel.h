@@ -0,0 +1,114 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BACKGROUNDMODEL_H
+#define BACKGROUNDMODEL_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+#include <beam_aux.h>
+
+typedef struct backgroundModelSettings{
+    bool enabled;
+    float voxel_size;
+    int learning_frames;
+    float min_occupancy;
+}backgroundModelSettings;
+
+//! @brief  Learns which voxels are occupied by the static scene in front of a fixed
+//!         sensor and splits the following frames in foreground and background points.
+//!         While learning, the frames in which every voxel is hit are counted; voxels hit
+//!         in enough of them, and their neighbours, become background. Once learnt, each
+//!         point is classified with a single lookup in an open addressing hash set.
+class backgroundModel
+{
+public:
+    backgroundModel();
+
+    //! @brief  Sets the model settings, a change of voxel size or learning frames restarts the learning
+    void setSettings(const backgroundModelSettings &settings);
+
+    //! @brief  Returns the model settings
+    backgroundModelSettings getSettings();
+
+    //! @brief  Discards the model and learns it again from the next frames
+    void relearn();
+
+    //! @brief  Returns true if the stage is enabled
+    bool isEnabled();
+
+    //! @brief  Returns the number of frames still needed to finish the learning
+    int getLearningFramesLeft();
+
+    //! @brief  Returns the number of background voxels
+    size_t getBackgroundVoxels();
+
+    //! @brief  Copies the points with the foreground ones first, keeping their order
+    //! @param  input Input points
+    //! @param  number_of_points Number of input points
+    //! @param  output Output points, it can hold number_of_points points
+    //! @return number of foreground points, all points are foreground while learning
+    int32_t apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output);
+
+private:
+
+    uint64_t getVoxelKey(const tPointPcd &point, float inverse_voxel_size) const;
+
+    void learnFrame(const tPointPcd *input, int32_t number_of_points);
+
+    void finishLearning();
+
+    void insertBackgroundVoxel(uint64_t key);
+
+    bool isBackgroundVoxel(uint64_t key) const;
+
+private:
+
+    std::mutex m_mutex;
+
+    backgroundModelSettings m_settings;
+    bool m_relearn_requested;
+
+    float m_voxel_size;
+    int m_learning_frames;
+    int m_learning_frames_left;
+    uint32_t m_learning_frame;
+
+    //!voxel key, (frames hit, last frame hit)
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t> > m_hits;
+
+    std::vector<uint64_t> m_background;
+    uint64_t m_background_mask;
+    size_t m_background_voxels;
+
+    std::vector<uint8_t> m_foreground;
+};
+
+#endif // BACKGROUNDMODEL_H
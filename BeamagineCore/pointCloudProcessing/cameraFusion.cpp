@@ -0,0 +1,325 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "cameraFusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <beam_parallel.h>
+
+//! Frames kept per camera to pair with the point clouds
+static const size_t frame_history = 4;
+
+//! Points projected together, their coordinates fit in the cache as separate arrays
+static const int32_t projection_block = 256;
+
+//! Minimum points per chunk of the parallel loop
+static const size_t fusion_chunk = 8192;
+
+//! Points closer to the camera plane are not projected (mm)
+static const float min_depth = 100.0f;
+
+//! Milliseconds in a day, device timestamps wrap at midnight
+static const uint32_t day_ms = 86400000;
+
+//! Color of the points out of the camera view
+static const int32_t out_of_view_color = 0x404040;
+
+cameraFusion::cameraFusion()
+{
+    m_settings = getDefaultSettings();
+    for(int source = 0; source < fusion_source_count; ++source){
+        m_next_frame[source] = 0;
+    }
+}
+
+cameraFusionSettings cameraFusion::getDefaultSettings()
+{
+    cameraFusionSettings settings;
+    memset(&settings, 0, sizeof(settings));
+
+    settings.enabled = false;
+    settings.source = fusion_source_rgb;
+    settings.calibration_width = 1920;
+    settings.calibration_height = 1080;
+    settings.fx = 1400;
+    settings.fy = 1400;
+    settings.cx = 960;
+    settings.cy = 540;
+    for(int i = 0; i < 3; ++i){
+        settings.rotation[i][i] = 1;
+    }
+    settings.max_time_difference = 100;
+    settings.min_temperature = 0;
+    settings.max_temperature = 40;
+    settings.keep_color_out_of_view = false;
+
+    return settings;
+}
+
+void cameraFusion::setSettings(const cameraFusionSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+}
+
+cameraFusionSettings cameraFusion::getSettings()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+bool cameraFusion::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled;
+}
+
+bool cameraFusion::usesSource(int source)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled && m_settings.source == source && m_static_frame == NULL;
+}
+
+cameraFusion::cameraFramePtr cameraFusion::takeFrameSlot(int source)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<cameraFramePtr> &frames = m_frames[source];
+    if(frames.size() < frame_history){
+        return cameraFramePtr(new cameraFrame());
+    }
+
+    //!the oldest frame is reused unless a point cloud is being colored with it
+    cameraFramePtr frame = frames[m_next_frame[source]];
+    frames[m_next_frame[source]].reset();
+    if(frame.use_count() > 1){
+        return cameraFramePtr(new cameraFrame());
+    }
+    return frame;
+}
+
+void cameraFusion::storeFrame(int source, const cameraFramePtr &frame)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<cameraFramePtr> &frames = m_frames[source];
+    if(frames.size() < frame_history){
+        frames.push_back(frame);
+        return;
+    }
+    frames[m_next_frame[source]] = frame;
+    m_next_frame[source] = (m_next_frame[source] + 1) % frame_history;
+}
+
+void cameraFusion::addImage(int source, const uint8_t *image_data, uint16_t height, uint16_t width, uint8_t channels, uint32_t timestamp)
+{
+    if(source < 0 || source >= fusion_source_count || (channels != 1 && channels != 3)){
+        return;
+    }
+
+    //!the copy is done out of the lock so the point clouds are not delayed
+    cameraFramePtr frame = takeFrameSlot(source);
+    frame->time_ms = timestampToMilliseconds(timestamp);
+    frame->height = height;
+    frame->width = width;
+    frame->channels = channels;
+    frame->pixels.assign(image_data, image_data + (size_t)height * width * channels);
+    frame->temperatures.clear();
+
+    storeFrame(source, frame);
+}
+
+void cameraFusion::addTemperatures(const float *temperature_data, uint16_t height, uint16_t width, uint32_t timestamp)
+{
+    cameraFramePtr frame = takeFrameSlot(fusion_source_temperatures);
+    frame->time_ms = timestampToMilliseconds(timestamp);
+    frame->height = height;
+    frame->width = width;
+    frame->channels = 1;
+    frame->pixels.clear();
+    frame->temperatures.assign(temperature_data, temperature_data + (size_t)height * width);
+
+    storeFrame(fusion_source_temperatures, frame);
+}
+
+void cameraFusion::setStaticImage(const uint8_t *image_data, uint16_t height, uint16_t width)
+{
+    cameraFramePtr frame;
+    if(image_data != NULL){
+        frame = cameraFramePtr(new cameraFrame());
+        frame->time_ms = 0;
+        frame->height = height;
+        frame->width = width;
+        frame->channels = 3;
+        frame->pixels.assign(image_data, image_data + (size_t)height * width * 3);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_static_frame = frame;
+}
+
+bool cameraFusion::hasStaticImage()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_static_frame != NULL;
+}
+
+cameraFusion::cameraFramePtr cameraFusion::findFrame(int source, uint32_t time_ms, uint32_t max_time_difference)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_static_frame != NULL){
+        return m_static_frame;
+    }
+
+    cameraFramePtr best;
+    uint32_t best_difference = max_time_difference + 1;
+    for(const cameraFramePtr &frame : m_frames[source]){
+        if(frame == NULL){
+            continue;
+        }
+        uint32_t difference = frame->time_ms > time_ms ? frame->time_ms - time_ms : time_ms - frame->time_ms;
+        difference = std::min(difference, day_ms - difference);
+        if(difference < best_difference){
+            best_difference = difference;
+            best = frame;
+        }
+    }
+    return best;
+}
+
+int32_t cameraFusion::colorOfTemperature(float temperature, float min_temperature, float max_temperature)
+{
+    //!jet color map, blue for the coldest and red for the warmest temperatures
+    float value = (temperature - min_temperature) / std::max(max_temperature - min_temperature, 0.001f);
+    value = std::min(std::max(value, 0.0f), 1.0f);
+
+    float red = std::min(std::max(1.5f - std::fabs(4.0f * value - 3.0f), 0.0f), 1.0f);
+    float green = std::min(std::max(1.5f - std::fabs(4.0f * value - 2.0f), 0.0f), 1.0f);
+    float blue = std::min(std::max(1.5f - std::fabs(4.0f * value - 1.0f), 0.0f), 1.0f);
+
+    return ((int32_t)(red * 255) << 16) | ((int32_t)(green * 255) << 8) | (int32_t)(blue * 255);
+}
+
+void cameraFusion::projectBlock(tPointPcd *points, int32_t number_of_points, const cameraFusionSettings &settings,
+                                const cameraFrame &frame, std::atomic<int32_t> &points_seen) const
+{
+    //!the intrinsics are scaled when the stream does not have the calibration resolution
+    float scale_x = settings.calibration_width > 0 ? (float)frame.width / settings.calibration_width : 1.0f;
+    float scale_y = settings.calibration_height > 0 ? (float)frame.height / settings.calibration_height : 1.0f;
+    const float fx = settings.fx * scale_x, fy = settings.fy * scale_y;
+    const float cx = settings.cx * scale_x, cy = settings.cy * scale_y;
+    const float k1 = settings.distortion[0], k2 = settings.distortion[1];
+    const float p1 = settings.distortion[2], p2 = settings.distortion[3];
+    const float k3 = settings.distortion[4];
+    const float (*r)[3] = settings.rotation;
+    const float *t = settings.translation;
+    const float max_u = frame.width, max_v = frame.height;
+
+    float xs[projection_block], ys[projection_block], zs[projection_block];
+    float us[projection_block], vs[projection_block];
+    uint8_t visible[projection_block];
+    int32_t seen = 0;
+
+    for(int32_t first = 0; first < number_of_points; first += projection_block){
+        int32_t count = std::min(projection_block, number_of_points - first);
+        const tPointPcd *block = &points[first];
+
+        for(int32_t i = 0; i < count; ++i){
+            xs[i] = (float)block[i].x;
+            ys[i] = (float)block[i].y;
+            zs[i] = (float)block[i].z;
+        }
+
+        //!rigid transform, projection and distortion of the whole block without branches
+        for(int32_t i = 0; i < count; ++i){
+            float x = r[0][0]*xs[i] + r[0][1]*ys[i] + r[0][2]*zs[i] + t[0];
+            float y = r[1][0]*xs[i] + r[1][1]*ys[i] + r[1][2]*zs[i] + t[1];
+            float z = r[2][0]*xs[i] + r[2][1]*ys[i] + r[2][2]*zs[i] + t[2];
+
+            float inverse_z = 1.0f / std::max(z, min_depth);
+            float xn = x * inverse_z;
+            float yn = y * inverse_z;
+            float r2 = xn*xn + yn*yn;
+            float radial = 1.0f + r2 * (k1 + r2 * (k2 + r2 * k3));
+            float xd = xn * radial + 2.0f*p1*xn*yn + p2*(r2 + 2.0f*xn*xn);
+            float yd = yn * radial + p1*(r2 + 2.0f*yn*yn) + 2.0f*p2*xn*yn;
+
+            us[i] = fx * xd + cx;
+            vs[i] = fy * yd + cy;
+            visible[i] = (z > min_depth) & (us[i] >= 0.0f) & (us[i] < max_u) & (vs[i] >= 0.0f) & (vs[i] < max_v);
+        }
+
+        tPointPcd *output = &points[first];
+        for(int32_t i = 0; i < count; ++i){
+            if(!visible[i]){
+                if(!settings.keep_color_out_of_view){
+                    output[i].RGB = out_of_view_color;
+                }
+                continue;
+            }
+
+            size_t pixel = (size_t)vs[i] * frame.width + (size_t)us[i];
+            if(!frame.temperatures.empty()){
+                output[i].RGB = colorOfTemperature(frame.temperatures[pixel], settings.min_temperature, settings.max_temperature);
+            }else if(frame.channels == 3){
+                const uint8_t *rgb = &frame.pixels[pixel * 3];
+                output[i].RGB = ((int32_t)rgb[0] << 16) | ((int32_t)rgb[1] << 8) | (int32_t)rgb[2];
+            }else{
+                int32_t gray = frame.pixels[pixel];
+                output[i].RGB = (gray << 16) | (gray << 8) | gray;
+            }
+            ++seen;
+        }
+    }
+
+    points_seen += seen;
+}
+
+int32_t cameraFusion::apply(tPointPcd *points, int32_t number_of_points, uint32_t timestamp)
+{
+    cameraFusionSettings settings = getSettings();
+    if(!settings.enabled || settings.source < 0 || settings.source >= fusion_source_count){
+        return -1;
+    }
+
+    //!the frame is held while it is sampled, the cameras keep storing new ones
+    cameraFramePtr frame = findFrame(settings.source, timestampToMilliseconds(timestamp), settings.max_time_difference);
+    if(frame == NULL || frame->width == 0 || frame->height == 0){
+        return -1;
+    }
+
+    std::atomic<int32_t> points_seen(0);
+    beamParallelFor(number_of_points, fusion_chunk, [&](size_t begin, size_t end){
+        projectBlock(&points[begin], (int32_t)(end - begin), settings, *frame, points_seen);
+    });
+
+    return points_seen;
+}
@@ -0,0 +1,171 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAMERAFUSION_H
+#define CAMERAFUSION_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+//! Camera streams that can color the points
+enum cameraFusionSource{
+    fusion_source_rgb = 0,          //! RGB or Allied narrow camera
+    fusion_source_thermal,          //! Thermal image as sent by the device
+    fusion_source_temperatures,     //! Thermal data, colored with the temperature range
+    fusion_source_polarimetric,     //! Polarimetric or Allied wide camera
+    fusion_source_count
+};
+
+//! Pinhole camera with the Brown-Conrady distortion used by OpenCV. The rotation and
+//! the translation (mm) take the lidar coordinates to the camera coordinates, where
+//! z points forward, x to the right and y down.
+typedef struct cameraFusionSettings{
+    bool enabled;
+    int source;
+
+    int calibration_width;
+    int calibration_height;
+    float fx;
+    float fy;
+    float cx;
+    float cy;
+    float distortion[5];            //! k1, k2, p1, p2, k3
+
+    float rotation[3][3];
+    float translation[3];
+
+    uint32_t max_time_difference;   //! ms between the point cloud and the camera frame
+    float min_temperature;
+    float max_temperature;
+    bool keep_color_out_of_view;
+}cameraFusionSettings;
+
+//! @brief  Colors the points on the host with a camera frame, so the fused views do
+//!         not need the device to change its color mode and recorded images can be
+//!         used too. The frames of every camera are kept in a short history and the one
+//!         closest in time to the point cloud is used. Points are projected in blocks
+//!         with branch free loops that the compiler vectorizes, and the blocks are
+//!         split between the host processing threads.
+class cameraFusion
+{
+public:
+    cameraFusion();
+
+    //! @brief  Returns the default settings, an uncalibrated camera aligned with the lidar
+    static cameraFusionSettings getDefaultSettings();
+
+    //! @brief  Sets the fusion settings, they apply from the next frame
+    void setSettings(const cameraFusionSettings &settings);
+
+    //! @brief  Returns the fusion settings
+    cameraFusionSettings getSettings();
+
+    //! @brief  Returns true if the stage is enabled
+    bool isEnabled();
+
+    //! @brief  Returns true if the stage is enabled and colors the points with the given source
+    bool usesSource(int source);
+
+    //! @brief  Stores a camera frame, the data is copied
+    //! @param  source Camera of the frame
+    //! @param  image_data RGB or gray pixels
+    //! @param  height Image height
+    //! @param  width Image width
+    //! @param  channels 3 for RGB, 1 for gray
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return none
+    void addImage(int source, const uint8_t *image_data, uint16_t height, uint16_t width, uint8_t channels, uint32_t timestamp);
+
+    //! @brief  Stores a frame of thermal data, the data is copied
+    //! @param  temperature_data Temperatures in degrees
+    //! @param  height Image height
+    //! @param  width Image width
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return none
+    void addTemperatures(const float *temperature_data, uint16_t height, uint16_t width, uint32_t timestamp);
+
+    //! @brief  Sets a recorded RGB image used for every point cloud instead of the streams
+    //! @param  image_data RGB pixels, NULL to go back to the streams
+    //! @param  height Image height
+    //! @param  width Image width
+    //! @return none
+    void setStaticImage(const uint8_t *image_data, uint16_t height, uint16_t width);
+
+    //! @brief  Returns true if a recorded image is used instead of the streams
+    bool hasStaticImage();
+
+    //! @brief  Colors the points with the frame paired with the point cloud
+    //! @param  points Points to color, the RGB field is replaced
+    //! @param  number_of_points Number of points
+    //! @param  timestamp Device timestamp of the point cloud (hhmmssmmm)
+    //! @return number of points seen by the camera, -1 if there was no frame to pair
+    int32_t apply(tPointPcd *points, int32_t number_of_points, uint32_t timestamp);
+
+private:
+
+    typedef struct cameraFrame{
+        uint32_t time_ms;
+        uint16_t height;
+        uint16_t width;
+        uint8_t channels;
+        std::vector<uint8_t> pixels;
+        std::vector<float> temperatures;
+    }cameraFrame;
+
+    typedef std::shared_ptr<cameraFrame> cameraFramePtr;
+
+    //! @brief  Takes a history slot to overwrite, a new frame if the oldest one is still in use
+    cameraFramePtr takeFrameSlot(int source);
+
+    void storeFrame(int source, const cameraFramePtr &frame);
+
+    //! @brief  Returns the frame closest in time to the timestamp, NULL if none is close enough
+    cameraFramePtr findFrame(int source, uint32_t time_ms, uint32_t max_time_difference);
+
+    static int32_t colorOfTemperature(float temperature, float min_temperature, float max_temperature);
+
+    void projectBlock(tPointPcd *points, int32_t number_of_points, const cameraFusionSettings &settings,
+                      const cameraFrame &frame, std::atomic<int32_t> &points_seen) const;
+
+private:
+
+    std::mutex m_mutex;
+
+    cameraFusionSettings m_settings;
+
+    std::vector<cameraFramePtr> m_frames[fusion_source_count];
+    size_t m_next_frame[fusion_source_count];
+
+    cameraFramePtr m_static_frame;
+};
+
+#endif // CAMERAFUSION_H
@@ -0,0 +1,252 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "depthImageRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//! Depth buffer value of the pixels without return
+static const uint64_t empty_pixel = ~(uint64_t)0;
+
+//! Empty pixels are only filled when this many neighbours have a return, so the
+//! borders of the objects do not grow
+static const int min_fill_neighbours = 2;
+
+static const float degrees_to_radians = 0.017453292f;
+
+depthImageRasterizer::depthImageRasterizer()
+{
+    m_settings = getDefaultSettings();
+    applySettings();
+}
+
+depthImageSettings depthImageRasterizer::getDefaultSettings()
+{
+    depthImageSettings settings;
+
+    settings.view = visualizationTypes::DEPTH_TOT;
+    settings.columns = 480;
+    settings.rows = 150;
+    settings.min_azimuth = -30;
+    settings.max_azimuth = 30;
+    settings.min_elevation = -11.5;
+    settings.max_elevation = 11.5;
+    settings.min_value = 0;
+    settings.max_value = 30000;
+    settings.fill_holes = 1;
+
+    return settings;
+}
+
+void depthImageRasterizer::setSettings(const depthImageSettings &settings)
+{
+    m_settings = settings;
+    applySettings();
+}
+
+depthImageSettings depthImageRasterizer::getSettings() const
+{
+    return m_settings;
+}
+
+int depthImageRasterizer::getColumns() const
+{
+    return m_settings.columns;
+}
+
+int depthImageRasterizer::getRows() const
+{
+    return m_settings.rows;
+}
+
+const std::vector<uint16_t> &depthImageRasterizer::getValueImage() const
+{
+    return m_filled;
+}
+
+const std::vector<uint8_t> &depthImageRasterizer::getColorImage() const
+{
+    return m_color_image;
+}
+
+void depthImageRasterizer::applySettings()
+{
+    m_settings.columns = std::max(m_settings.columns, 1);
+    m_settings.rows = std::max(m_settings.rows, 1);
+    m_settings.fill_holes = std::min(std::max(m_settings.fill_holes, 0), 3);
+
+    m_azimuth_origin = m_settings.min_azimuth * degrees_to_radians;
+    m_elevation_origin = m_settings.min_elevation * degrees_to_radians;
+    m_columns_per_radian = m_settings.columns / (std::max(m_settings.max_azimuth - m_settings.min_azimuth, 0.1f) * degrees_to_radians);
+    m_rows_per_radian = m_settings.rows / (std::max(m_settings.max_elevation - m_settings.min_elevation, 0.1f) * degrees_to_radians);
+
+    size_t pixels = (size_t)m_settings.columns * m_settings.rows;
+    m_depth_buffer.assign(pixels, empty_pixel);
+    m_values.assign(pixels, 0);
+    m_filled.assign(pixels, 0);
+    m_ranges.assign(pixels, 0);
+    m_color_image.assign(pixels * 3, 0);
+
+    //!jet from near (red) to far (blue) for the depth views, gray levels for the intensity
+    for(int i = 0; i < 256; ++i){
+        float value = i / 255.0f;
+        if(m_settings.view == visualizationTypes::INTENSITY){
+            m_lut[i][0] = m_lut[i][1] = m_lut[i][2] = (uint8_t)i;
+            continue;
+        }
+        value = 1.0f - value;
+        m_lut[i][0] = (uint8_t)(255 * std::min(std::max(1.5f - std::fabs(4.0f * value - 3.0f), 0.0f), 1.0f));
+        m_lut[i][1] = (uint8_t)(255 * std::min(std::max(1.5f - std::fabs(4.0f * value - 2.0f), 0.0f), 1.0f));
+        m_lut[i][2] = (uint8_t)(255 * std::min(std::max(1.5f - std::fabs(4.0f * value - 1.0f), 0.0f), 1.0f));
+    }
+}
+
+int32_t depthImageRasterizer::render(const tPointPcd *points, int32_t number_of_points)
+{
+    std::fill(m_depth_buffer.begin(), m_depth_buffer.end(), empty_pixel);
+
+    const int columns = m_settings.columns;
+    const int rows = m_settings.rows;
+    const int view = m_settings.view;
+
+    for(int32_t i = 0; i < number_of_points; ++i){
+        float x = points[i].x;
+        float y = points[i].y;
+        float z = points[i].z;
+
+        //!z forward, x right and y down
+        float horizontal = std::sqrt(x * x + z * z);
+        int column = (int)std::floor((std::atan2(x, z) - m_azimuth_origin) * m_columns_per_radian);
+        int row = (int)std::floor((std::atan2(y, horizontal) - m_elevation_origin) * m_rows_per_radian);
+        if(column < 0 || column >= columns || row < 0 || row >= rows){
+            continue;
+        }
+
+        float range = std::sqrt(horizontal * horizontal + y * y);
+        int32_t value;
+        if(view == visualizationTypes::DEPTH_Z){
+            value = points[i].z;
+        }else if(view == visualizationTypes::INTENSITY){
+            value = points[i].intensity;
+        }else{
+            value = (int32_t)(range + 0.5f);
+        }
+        value = std::min(std::max(value, 1), 65535);
+
+        //!positive floats keep their order as integers
+        uint32_t range_bits;
+        memcpy(&range_bits, &range, sizeof(range_bits));
+        uint64_t packed = ((uint64_t)range_bits << 32) | (uint32_t)value;
+
+        uint64_t &pixel = m_depth_buffer[row * columns + column];
+        pixel = std::min(pixel, packed);
+    }
+
+    for(size_t p = 0; p < m_depth_buffer.size(); ++p){
+        uint64_t packed = m_depth_buffer[p];
+        if(packed == empty_pixel){
+            m_values[p] = 0;
+            m_ranges[p] = 0;
+            continue;
+        }
+        uint32_t range_bits = (uint32_t)(packed >> 32);
+        memcpy(&m_ranges[p], &range_bits, sizeof(float));
+        m_values[p] = (uint16_t)(packed & 0xFFFF);
+    }
+
+    fillHoles();
+
+    return colorize();
+}
+
+void depthImageRasterizer::fillHoles()
+{
+    m_filled = m_values;
+
+    const int radius = m_settings.fill_holes;
+    if(radius == 0){
+        return;
+    }
+
+    const int columns = m_settings.columns;
+    const int rows = m_settings.rows;
+
+    //!an empty pixel takes the nearest return around it, read from the image before filling
+    for(int row = 0; row < rows; ++row){
+        for(int column = 0; column < columns; ++column){
+            size_t p = (size_t)row * columns + column;
+            if(m_values[p] != 0){
+                continue;
+            }
+
+            int neighbours = 0;
+            float best_range = INFINITY;
+            uint16_t best_value = 0;
+            for(int r = std::max(row - radius, 0); r <= std::min(row + radius, rows - 1); ++r){
+                for(int c = std::max(column - radius, 0); c <= std::min(column + radius, columns - 1); ++c){
+                    size_t q = (size_t)r * columns + c;
+                    if(m_values[q] == 0){
+                        continue;
+                    }
+                    ++neighbours;
+                    if(m_ranges[q] < best_range){
+                        best_range = m_ranges[q];
+                        best_value = m_values[q];
+                    }
+                }
+            }
+            if(neighbours >= min_fill_neighbours){
+                m_filled[p] = best_value;
+            }
+        }
+    }
+}
+
+int32_t depthImageRasterizer::colorize()
+{
+    int32_t pixels_with_return = 0;
+    float scale = 255.0f / std::max(m_settings.max_value - m_settings.min_value, 1);
+    float offset = (float)m_settings.min_value;
+
+    for(size_t p = 0; p < m_filled.size(); ++p){
+        uint8_t *color = &m_color_image[p * 3];
+        if(m_filled[p] == 0){
+            color[0] = color[1] = color[2] = 0;
+            continue;
+        }
+        int index = (int)((m_filled[p] - offset) * scale);
+        index = std::min(std::max(index, 0), 255);
+        color[0] = m_lut[index][0];
+        color[1] = m_lut[index][1];
+        color[2] = m_lut[index][2];
+        ++pixels_with_return;
+    }
+
+    return pixels_with_return;
+}
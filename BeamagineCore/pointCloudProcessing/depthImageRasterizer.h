@@ -0,0 +1,115 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef DEPTHIMAGERASTERIZER_H
+#define DEPTHIMAGERASTERIZER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <beam_aux.h>
+
+//! Angles in degrees, azimuth positive to the right and elevation positive downwards,
+//! the first row of the image is the top one. The colormap range is in mm for the depth
+//! views and in intensity units for the intensity view.
+typedef struct depthImageSettings{
+    int view;
+    int columns;
+    int rows;
+    float min_azimuth;
+    float max_azimuth;
+    float min_elevation;
+    float max_elevation;
+    int32_t min_value;
+    int32_t max_value;
+    int fill_holes;
+}depthImageSettings;
+
+//! @brief  Renders a frame as a 2D image aligned with the scan, far cheaper to show than
+//!         the 3D viewer. Every point goes to the pixel of its azimuth and elevation and
+//!         the nearest return of each pixel is kept with a z-buffer. The views are the
+//!         range (visualizationTypes::DEPTH_TOT), the forward distance
+//!         (visualizationTypes::DEPTH_Z) and the intensity (visualizationTypes::INTENSITY).
+//!         Used from one thread only.
+class depthImageRasterizer
+{
+public:
+    depthImageRasterizer();
+
+    //! @brief  Returns the default settings, the 480x150 layout of the L3Cam scan
+    static depthImageSettings getDefaultSettings();
+
+    void setSettings(const depthImageSettings &settings);
+
+    depthImageSettings getSettings() const;
+
+    //! @brief  Renders a frame
+    //! @param  points Points of the frame
+    //! @param  number_of_points Number of points
+    //! @return number of pixels with a return, holes filled included
+    int32_t render(const tPointPcd *points, int32_t number_of_points);
+
+    int getColumns() const;
+
+    int getRows() const;
+
+    //! @brief  Returns the values of the last frame rendered, 0 for pixels without return
+    const std::vector<uint16_t> &getValueImage() const;
+
+    //! @brief  Returns the last frame rendered with the colormap, RGB interleaved
+    const std::vector<uint8_t> &getColorImage() const;
+
+private:
+
+    void applySettings();
+
+    void fillHoles();
+
+    //! @brief  Applies the colormap, returns the number of pixels with a return
+    int32_t colorize();
+
+private:
+
+    depthImageSettings m_settings;
+
+    float m_azimuth_origin;
+    float m_elevation_origin;
+    float m_columns_per_radian;
+    float m_rows_per_radian;
+
+    //!range bits in the high half and value in the low half, the minimum is the nearest return
+    std::vector<uint64_t> m_depth_buffer;
+
+    std::vector<uint16_t> m_values;
+    std::vector<uint16_t> m_filled;
+    std::vector<float> m_ranges;
+    std::vector<uint8_t> m_color_image;
+
+    uint8_t m_lut[256][3];
+};
+
+#endif // DEPTHIMAGERASTERIZER_H
@@ -0,0 +1,430 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "euclideanClustering.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <beam_parallel.h>
+
+//! Cell edge relative to the tolerance, the diagonal of a cell is the tolerance so
+//! the points sharing a cell are always connected
+static const float cell_per_tolerance = 0.57735027f;
+
+//! Cells away from a cell that can hold points closer than the tolerance
+static const int neighbour_reach = 2;
+
+//! Minimum cells per chunk of the parallel loops
+static const size_t clustering_chunk = 256;
+
+//! Minimum clusters per chunk when measuring them
+static const size_t measure_chunk = 4;
+
+//! @brief  Eigen decomposition of a symmetric 3x3 matrix with cyclic Jacobi rotations
+//! @param  matrix Symmetric matrix
+//! @param  values Returns the eigenvalues
+//! @param  vectors Returns the eigenvectors in the columns
+//! @return none
+static void computeSymmetricEigen(const double matrix[3][3], double values[3], double vectors[3][3])
+{
+    double a[3][3];
+    for(int r = 0; r < 3; ++r){
+        for(int c = 0; c < 3; ++c){
+            a[r][c] = matrix[r][c];
+            vectors[r][c] = r == c ? 1.0 : 0.0;
+        }
+    }
+
+    for(int sweep = 0; sweep < 16; ++sweep){
+        double diagonal = a[0][0]*a[0][0] + a[1][1]*a[1][1] + a[2][2]*a[2][2];
+        double off_diagonal = a[0][1]*a[0][1] + a[0][2]*a[0][2] + a[1][2]*a[1][2];
+        if(off_diagonal <= 1e-24 * diagonal){
+            break;
+        }
+
+        for(int p = 0; p < 2; ++p){
+            for(int q = p + 1; q < 3; ++q){
+                if(a[p][q] == 0){
+                    continue;
+                }
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for(int k = 0; k < 3; ++k){
+                    double akp = a[k][p];
+                    double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for(int k = 0; k < 3; ++k){
+                    double apk = a[p][k];
+                    double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for(int k = 0; k < 3; ++k){
+                    double vkp = vectors[k][p];
+                    double vkq = vectors[k][q];
+                    vectors[k][p] = c * vkp - s * vkq;
+                    vectors[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    for(int i = 0; i < 3; ++i){
+        values[i] = a[i][i];
+    }
+}
+
+euclideanClustering::euclideanClustering()
+{
+    m_settings.enabled = false;
+    m_settings.tolerance = 300;
+    m_settings.min_points = 10;
+    m_settings.max_points = 50000;
+
+    m_parents_capacity = 0;
+}
+
+void euclideanClustering::setSettings(const euclideanClusteringSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+}
+
+euclideanClusteringSettings euclideanClustering::getSettings()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+bool euclideanClustering::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled;
+}
+
+void euclideanClustering::apply(const tPointPcd *points, int32_t number_of_points, std::vector<pointCloudCluster> &clusters)
+{
+    clusters.clear();
+
+    euclideanClusteringSettings settings = getSettings();
+    if(!settings.enabled || number_of_points <= 0 || settings.tolerance <= 0){
+        return;
+    }
+
+    m_index.build(points, number_of_points, settings.tolerance * cell_per_tolerance);
+
+    size_t number_of_cells = m_index.getNumberOfCells();
+    size_t number_of_sorted = m_index.getSortedIndices().size();
+    if(number_of_cells == 0){
+        return;
+    }
+
+    if(m_parents_capacity < number_of_sorted){
+        m_parents.reset(new std::atomic<int32_t>[number_of_sorted]);
+        m_parents_capacity = number_of_sorted;
+    }
+
+    //!every cell starts as its own set, represented by its first point
+    beamParallelFor(number_of_cells, clustering_chunk, [&](size_t first_cell, size_t last_cell){
+        for(size_t cell = first_cell; cell < last_cell; ++cell){
+            uint64_t key;
+            uint32_t first, count;
+            m_index.getCellByPosition(cell, key, first, count);
+            m_parents[first].store((int32_t)first, std::memory_order_relaxed);
+        }
+    });
+
+    //!only half of the neighbourhood is visited, the other half visits this cell, and the
+    //!cells whose boxes are farther than the tolerance are skipped
+    float cell_size = m_index.getCellSize();
+    float tolerance_sqr = settings.tolerance * settings.tolerance;
+    std::vector<int> offsets;
+    for(int dx = -neighbour_reach; dx <= neighbour_reach; ++dx){
+        for(int dy = -neighbour_reach; dy <= neighbour_reach; ++dy){
+            for(int dz = -neighbour_reach; dz <= neighbour_reach; ++dz){
+                bool forward = dx > 0 || (dx == 0 && dy > 0) || (dx == 0 && dy == 0 && dz > 0);
+                float gx = std::max(std::abs(dx) - 1, 0) * cell_size;
+                float gy = std::max(std::abs(dy) - 1, 0) * cell_size;
+                float gz = std::max(std::abs(dz) - 1, 0) * cell_size;
+                if(forward && gx*gx + gy*gy + gz*gz <= tolerance_sqr){
+                    offsets.push_back(dx);
+                    offsets.push_back(dy);
+                    offsets.push_back(dz);
+                }
+            }
+        }
+    }
+
+    beamParallelFor(number_of_cells, clustering_chunk, [&](size_t first_cell, size_t last_cell){
+        for(size_t cell = first_cell; cell < last_cell; ++cell){
+            uint64_t key;
+            uint32_t first, count;
+            m_index.getCellByPosition(cell, key, first, count);
+
+            int64_t cx, cy, cz;
+            voxelGridIndex::unpackCellKey(key, cx, cy, cz);
+
+            for(size_t o = 0; o < offsets.size(); o += 3){
+                uint32_t neighbour_first, neighbour_count;
+                if(!m_index.getCell(voxelGridIndex::packCellKey(cx + offsets[o], cy + offsets[o+1], cz + offsets[o+2]), neighbour_first, neighbour_count)){
+                    continue;
+                }
+                if(findRoot(first) == findRoot(neighbour_first)){
+                    continue;
+                }
+                if(cellsTouch(first, count, neighbour_first, neighbour_count, tolerance_sqr)){
+                    unite(first, neighbour_first);
+                }
+            }
+        }
+    });
+
+    //!number the sets and count their points
+    m_group_of_root.resize(number_of_sorted);
+    m_group_of_cell.resize(number_of_cells);
+    m_group_points.clear();
+    for(size_t cell = 0; cell < number_of_cells; ++cell){
+        uint64_t key;
+        uint32_t first, count;
+        m_index.getCellByPosition(cell, key, first, count);
+        int32_t root = findRoot(first);
+        if(root == (int32_t)first){
+            m_group_of_root[root] = m_group_points.size();
+            m_group_points.push_back(0);
+        }
+    }
+    for(size_t cell = 0; cell < number_of_cells; ++cell){
+        uint64_t key;
+        uint32_t first, count;
+        m_index.getCellByPosition(cell, key, first, count);
+        int32_t group = m_group_of_root[findRoot(first)];
+        m_group_of_cell[cell] = group;
+        m_group_points[group] += count;
+    }
+
+    //!the groups out of the size range are dropped, the rest get the cells that form them
+    m_cluster_of_group.assign(m_group_points.size(), -1);
+    m_cluster_cells_offset.assign(1, 0);
+    for(size_t group = 0; group < m_group_points.size(); ++group){
+        if(m_group_points[group] >= settings.min_points && m_group_points[group] <= settings.max_points){
+            m_cluster_of_group[group] = m_cluster_cells_offset.size() - 1;
+            m_cluster_cells_offset.push_back(0);
+        }
+    }
+    size_t number_of_clusters = m_cluster_cells_offset.size() - 1;
+    if(number_of_clusters == 0){
+        return;
+    }
+
+    for(size_t cell = 0; cell < number_of_cells; ++cell){
+        int32_t cluster = m_cluster_of_group[m_group_of_cell[cell]];
+        if(cluster >= 0){
+            ++m_cluster_cells_offset[cluster + 1];
+        }
+    }
+    for(size_t cluster = 0; cluster < number_of_clusters; ++cluster){
+        m_cluster_cells_offset[cluster + 1] += m_cluster_cells_offset[cluster];
+    }
+    m_cluster_cells.resize(m_cluster_cells_offset[number_of_clusters]);
+    std::vector<uint32_t> fill(m_cluster_cells_offset.begin(), m_cluster_cells_offset.end() - 1);
+    for(size_t cell = 0; cell < number_of_cells; ++cell){
+        int32_t cluster = m_cluster_of_group[m_group_of_cell[cell]];
+        if(cluster >= 0){
+            m_cluster_cells[fill[cluster]++] = cell;
+        }
+    }
+
+    clusters.resize(number_of_clusters);
+    beamParallelFor(number_of_clusters, measure_chunk, [&](size_t first_cluster, size_t last_cluster){
+        for(size_t cluster = first_cluster; cluster < last_cluster; ++cluster){
+            measureCluster(&m_cluster_cells[m_cluster_cells_offset[cluster]],
+                           m_cluster_cells_offset[cluster + 1] - m_cluster_cells_offset[cluster], clusters[cluster]);
+        }
+    });
+
+    std::sort(clusters.begin(), clusters.end(), [](const pointCloudCluster &a, const pointCloudCluster &b){
+        return a.number_of_points > b.number_of_points;
+    });
+    for(size_t cluster = 0; cluster < number_of_clusters; ++cluster){
+        clusters[cluster].id = cluster;
+    }
+}
+
+int32_t euclideanClustering::findRoot(int32_t node)
+{
+    //!parents always have a lower index, halving the path keeps it that way even if
+    //!other threads are linking the same sets
+    while(true){
+        int32_t parent = m_parents[node].load(std::memory_order_relaxed);
+        if(parent == node){
+            return node;
+        }
+        int32_t grandparent = m_parents[parent].load(std::memory_order_relaxed);
+        if(grandparent != parent){
+            m_parents[node].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+        }
+        node = grandparent;
+    }
+}
+
+void euclideanClustering::unite(int32_t first, int32_t second)
+{
+    while(true){
+        first = findRoot(first);
+        second = findRoot(second);
+        if(first == second){
+            return;
+        }
+        if(first < second){
+            std::swap(first, second);
+        }
+        //!fails if another thread linked the root meanwhile, then the new roots are tried
+        int32_t expected = first;
+        if(m_parents[first].compare_exchange_strong(expected, second, std::memory_order_relaxed)){
+            return;
+        }
+    }
+}
+
+bool euclideanClustering::cellsTouch(uint32_t first_a, uint32_t count_a, uint32_t first_b, uint32_t count_b, float tolerance_sqr) const
+{
+    const float *positions = m_index.getSortedPositions().data();
+
+    for(uint32_t a = first_a; a < first_a + count_a; ++a){
+        float x = positions[a*3];
+        float y = positions[a*3+1];
+        float z = positions[a*3+2];
+        for(uint32_t b = first_b; b < first_b + count_b; ++b){
+            float dx = positions[b*3] - x;
+            float dy = positions[b*3+1] - y;
+            float dz = positions[b*3+2] - z;
+            if(dx*dx + dy*dy + dz*dz <= tolerance_sqr){
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void euclideanClustering::measureCluster(const uint32_t *cells, size_t number_of_cells, pointCloudCluster &cluster) const
+{
+    const float *positions = m_index.getSortedPositions().data();
+
+    double sum[3] = {0, 0, 0};
+    int32_t number_of_points = 0;
+    for(size_t c = 0; c < number_of_cells; ++c){
+        uint64_t key;
+        uint32_t first, count;
+        m_index.getCellByPosition(cells[c], key, first, count);
+        for(uint32_t p = first; p < first + count; ++p){
+            sum[0] += positions[p*3];
+            sum[1] += positions[p*3+1];
+            sum[2] += positions[p*3+2];
+        }
+        number_of_points += count;
+    }
+
+    double centroid[3];
+    for(int i = 0; i < 3; ++i){
+        centroid[i] = sum[i] / number_of_points;
+        cluster.centroid[i] = centroid[i];
+    }
+
+    double covariance[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    for(size_t c = 0; c < number_of_cells; ++c){
+        uint64_t key;
+        uint32_t first, count;
+        m_index.getCellByPosition(cells[c], key, first, count);
+        for(uint32_t p = first; p < first + count; ++p){
+            double d[3] = {positions[p*3] - centroid[0], positions[p*3+1] - centroid[1], positions[p*3+2] - centroid[2]};
+            for(int r = 0; r < 3; ++r){
+                for(int k = r; k < 3; ++k){
+                    covariance[r][k] += d[r] * d[k];
+                }
+            }
+        }
+    }
+    for(int r = 0; r < 3; ++r){
+        for(int k = 0; k < r; ++k){
+            covariance[r][k] = covariance[k][r];
+        }
+    }
+
+    double values[3];
+    double vectors[3][3];
+    computeSymmetricEigen(covariance, values, vectors);
+
+    //!axes sorted by decreasing spread, the third one completes a right handed frame
+    int order[3] = {0, 1, 2};
+    std::sort(order, order + 3, [&](int a, int b){ return values[a] > values[b]; });
+    double axes[3][3];
+    for(int i = 0; i < 2; ++i){
+        for(int k = 0; k < 3; ++k){
+            axes[i][k] = vectors[k][order[i]];
+        }
+    }
+    axes[2][0] = axes[0][1] * axes[1][2] - axes[0][2] * axes[1][1];
+    axes[2][1] = axes[0][2] * axes[1][0] - axes[0][0] * axes[1][2];
+    axes[2][2] = axes[0][0] * axes[1][1] - axes[0][1] * axes[1][0];
+
+    double minimum[3] = {1e30, 1e30, 1e30};
+    double maximum[3] = {-1e30, -1e30, -1e30};
+    for(size_t c = 0; c < number_of_cells; ++c){
+        uint64_t key;
+        uint32_t first, count;
+        m_index.getCellByPosition(cells[c], key, first, count);
+        for(uint32_t p = first; p < first + count; ++p){
+            double d[3] = {positions[p*3] - centroid[0], positions[p*3+1] - centroid[1], positions[p*3+2] - centroid[2]};
+            for(int i = 0; i < 3; ++i){
+                double projection = d[0] * axes[i][0] + d[1] * axes[i][1] + d[2] * axes[i][2];
+                minimum[i] = std::min(minimum[i], projection);
+                maximum[i] = std::max(maximum[i], projection);
+            }
+        }
+    }
+
+    for(int k = 0; k < 3; ++k){
+        double center = centroid[k];
+        for(int i = 0; i < 3; ++i){
+            center += axes[i][k] * (minimum[i] + maximum[i]) / 2.0;
+        }
+        cluster.center[k] = center;
+    }
+    for(int i = 0; i < 3; ++i){
+        cluster.size[i] = maximum[i] - minimum[i];
+        for(int k = 0; k < 3; ++k){
+            cluster.axes[i][k] = axes[i][k];
+        }
+    }
+    cluster.number_of_points = number_of_points;
+}
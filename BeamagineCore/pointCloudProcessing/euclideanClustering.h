@@ -0,0 +1,114 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef EUCLIDEANCLUSTERING_H
+#define EUCLIDEANCLUSTERING_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+#include "voxelGridIndex.h"
+
+typedef struct euclideanClusteringSettings{
+    bool enabled;
+    float tolerance;
+    int min_points;
+    int max_points;
+}euclideanClusteringSettings;
+
+//! @brief  Object found in a frame. The box is oriented along the principal axes of
+//!         its points, axes[0] is the direction of largest spread.
+typedef struct pointCloudCluster{
+    int32_t id;
+    int32_t number_of_points;
+    float centroid[3];
+    float center[3];
+    float size[3];
+    float axes[3][3];
+}pointCloudCluster;
+
+//! @brief  Euclidean clustering. Points closer than the tolerance belong to the same
+//!         object. The points are bucketed in cells small enough for all the points of
+//!         a cell to be connected, so only the cells are joined with a concurrent
+//!         union-find, and every thread works on its own range of cells.
+class euclideanClustering
+{
+public:
+    euclideanClustering();
+
+    //! @brief  Sets the clustering settings, they apply from the next frame
+    void setSettings(const euclideanClusteringSettings &settings);
+
+    //! @brief  Returns the clustering settings
+    euclideanClusteringSettings getSettings();
+
+    //! @brief  Returns true if the stage is enabled
+    bool isEnabled();
+
+    //! @brief  Groups the points and measures every group with a size in the configured range
+    //! @param  points Points to group
+    //! @param  number_of_points Number of points
+    //! @param  clusters Returns the groups found, largest first
+    //! @return none
+    void apply(const tPointPcd *points, int32_t number_of_points, std::vector<pointCloudCluster> &clusters);
+
+private:
+
+    int32_t findRoot(int32_t node);
+
+    void unite(int32_t first, int32_t second);
+
+    bool cellsTouch(uint32_t first_a, uint32_t count_a, uint32_t first_b, uint32_t count_b, float tolerance_sqr) const;
+
+    void measureCluster(const uint32_t *cells, size_t number_of_cells, pointCloudCluster &cluster) const;
+
+private:
+
+    std::mutex m_mutex;
+
+    euclideanClusteringSettings m_settings;
+
+    voxelGridIndex m_index;
+
+    //!parent of every set, indexed by the sorted position of the first point of each cell
+    std::unique_ptr<std::atomic<int32_t>[]> m_parents;
+    size_t m_parents_capacity;
+
+    std::vector<int32_t> m_group_of_root;
+    std::vector<int32_t> m_group_of_cell;
+    std::vector<int32_t> m_group_points;
+    std::vector<int32_t> m_cluster_of_group;
+    std::vector<uint32_t> m_cluster_cells_offset;
+    std::vector<uint32_t> m_cluster_cells;
+};
+
+#endif // EUCLIDEANCLUSTERING_H
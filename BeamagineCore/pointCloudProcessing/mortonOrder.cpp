@@ -0,0 +1,220 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "mortonOrder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <beam_parallel.h>
+
+//! Points per chunk, every chunk keeps its own histogram so the sort is stable
+static const int32_t morton_chunk = 16384;
+
+//! Bits of the code sorted in every pass
+static const int radix_bits = 10;
+static const uint32_t radix_size = 1 << radix_bits;
+static const uint32_t radix_mask = radix_size - 1;
+
+//! Passes to sort the 30 bit codes
+static const int radix_passes = 3;
+
+//! Quantization levels per axis
+static const float quantization_levels = 1023.0f;
+
+mortonOrder::mortonOrder()
+{
+    m_enabled = false;
+    m_sorted_buffer = 0;
+}
+
+void mortonOrder::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+}
+
+bool mortonOrder::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+}
+
+std::vector<int32_t> mortonOrder::getLastPermutation()
+{
+    std::lock_guard<std::mutex> lock(m_permutation_mutex);
+    return m_permutation;
+}
+
+//! @brief  Spreads the 10 lowest bits of a value to every third bit
+static inline uint32_t spreadBits(uint32_t value)
+{
+    value &= 0x3FF;
+    value = (value | (value << 16)) & 0x030000FF;
+    value = (value | (value << 8)) & 0x0300F00F;
+    value = (value | (value << 4)) & 0x030C30C3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+uint32_t mortonOrder::encode(uint32_t x, uint32_t y, uint32_t z)
+{
+    return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+}
+
+void mortonOrder::computeCodes(const tPointPcd *input, int32_t number_of_points)
+{
+    size_t number_of_chunks = (number_of_points + morton_chunk - 1) / morton_chunk;
+
+    //!bounding box of every chunk, then of the frame
+    std::vector<int32_t> bounds(number_of_chunks * 6);
+    beamParallelFor(number_of_chunks, 1, [&](size_t first_chunk, size_t last_chunk){
+        for(size_t chunk = first_chunk; chunk < last_chunk; ++chunk){
+            int32_t begin = chunk * morton_chunk;
+            int32_t end = std::min(begin + morton_chunk, number_of_points);
+            int32_t *box = &bounds[chunk * 6];
+            box[0] = box[1] = box[2] = INT32_MAX;
+            box[3] = box[4] = box[5] = INT32_MIN;
+            for(int32_t i = begin; i < end; ++i){
+                box[0] = std::min(box[0], input[i].x); box[3] = std::max(box[3], input[i].x);
+                box[1] = std::min(box[1], input[i].y); box[4] = std::max(box[4], input[i].y);
+                box[2] = std::min(box[2], input[i].z); box[5] = std::max(box[5], input[i].z);
+            }
+        }
+    });
+
+    int32_t box[6] = {INT32_MAX, INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN, INT32_MIN};
+    for(size_t chunk = 0; chunk < number_of_chunks; ++chunk){
+        for(int axis = 0; axis < 3; ++axis){
+            box[axis] = std::min(box[axis], bounds[chunk * 6 + axis]);
+            box[axis + 3] = std::max(box[axis + 3], bounds[chunk * 6 + axis + 3]);
+        }
+    }
+
+    //!a cube keeps the cells isotropic, so the curve follows the same distance in every axis
+    double extent = std::max((double)box[3] - box[0], std::max((double)box[4] - box[1], (double)box[5] - box[2]));
+    float scale = quantization_levels / (float)std::max(extent, 1.0);
+
+    beamParallelFor(number_of_points, morton_chunk, [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            uint32_t x = (uint32_t)(((double)input[i].x - box[0]) * scale);
+            uint32_t y = (uint32_t)(((double)input[i].y - box[1]) * scale);
+            uint32_t z = (uint32_t)(((double)input[i].z - box[2]) * scale);
+            m_codes[0][i] = encode(x, y, z);
+            m_order[0][i] = (int32_t)i;
+        }
+    });
+}
+
+void mortonOrder::sortCodes(int32_t number_of_points)
+{
+    size_t number_of_chunks = (number_of_points + morton_chunk - 1) / morton_chunk;
+    m_histograms.resize(number_of_chunks * radix_size);
+    int source = 0;
+
+    for(int pass = 0; pass < radix_passes; ++pass){
+        int shift = pass * radix_bits;
+        const uint32_t *codes = m_codes[source].data();
+        const int32_t *order = m_order[source].data();
+
+        beamParallelFor(number_of_chunks, 1, [&](size_t first_chunk, size_t last_chunk){
+            for(size_t chunk = first_chunk; chunk < last_chunk; ++chunk){
+                int32_t begin = chunk * morton_chunk;
+                int32_t end = std::min(begin + morton_chunk, number_of_points);
+                uint32_t *histogram = &m_histograms[chunk * radix_size];
+                std::fill(histogram, histogram + radix_size, 0);
+                for(int32_t i = begin; i < end; ++i){
+                    ++histogram[(codes[i] >> shift) & radix_mask];
+                }
+            }
+        });
+
+        //!offsets of every digit and chunk, the chunks of a digit follow their input order;
+        //!a pass where all the codes share the digit would not move anything
+        uint32_t position = 0;
+        bool single_digit = false;
+        for(uint32_t digit = 0; digit < radix_size; ++digit){
+            uint32_t digit_start = position;
+            for(size_t chunk = 0; chunk < number_of_chunks; ++chunk){
+                uint32_t count = m_histograms[chunk * radix_size + digit];
+                m_histograms[chunk * radix_size + digit] = position;
+                position += count;
+            }
+            single_digit |= position - digit_start == (uint32_t)number_of_points;
+        }
+        if(single_digit){
+            continue;
+        }
+
+        uint32_t *sorted_codes = m_codes[1 - source].data();
+        int32_t *sorted_order = m_order[1 - source].data();
+        beamParallelFor(number_of_chunks, 1, [&](size_t first_chunk, size_t last_chunk){
+            for(size_t chunk = first_chunk; chunk < last_chunk; ++chunk){
+                int32_t begin = chunk * morton_chunk;
+                int32_t end = std::min(begin + morton_chunk, number_of_points);
+                uint32_t *offsets = &m_histograms[chunk * radix_size];
+                for(int32_t i = begin; i < end; ++i){
+                    uint32_t destination = offsets[(codes[i] >> shift) & radix_mask]++;
+                    sorted_codes[destination] = codes[i];
+                    sorted_order[destination] = order[i];
+                }
+            }
+        });
+        source = 1 - source;
+    }
+
+    m_sorted_buffer = source;
+}
+
+int32_t mortonOrder::apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output)
+{
+    if(number_of_points <= 0){
+        return 0;
+    }
+
+    for(int buffer = 0; buffer < 2; ++buffer){
+        m_codes[buffer].resize(number_of_points);
+        m_order[buffer].resize(number_of_points);
+    }
+
+    computeCodes(input, number_of_points);
+    sortCodes(number_of_points);
+
+    const int32_t *order = m_order[m_sorted_buffer].data();
+    beamParallelFor(number_of_points, morton_chunk, [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            output[i] = input[order[i]];
+        }
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(m_permutation_mutex);
+        m_permutation.assign(order, order + number_of_points);
+    }
+
+    return number_of_points;
+}
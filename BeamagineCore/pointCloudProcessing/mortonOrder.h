@@ -0,0 +1,86 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MORTONORDER_H
+#define MORTONORDER_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+//! @brief  Reorders a frame along a Z-order curve, so points close in space are close in
+//!         memory for the voxel grids, the neighbour searches and the compression of the
+//!         recordings. The coordinates are quantized to 10 bits per axis in the bounding
+//!         cube of the frame and the interleaved codes are sorted with a stable parallel
+//!         radix sort, every chunk of points counts and scatters its own range.
+class mortonOrder
+{
+public:
+    mortonOrder();
+
+    //! @brief  Enables the stage, it applies from the next frame
+    void setEnabled(bool enabled);
+
+    //! @brief  Returns true if the stage is enabled
+    bool isEnabled();
+
+    //! @brief  Copies the points sorted by their Morton code
+    //! @param  input Input points
+    //! @param  number_of_points Number of input points
+    //! @param  output Output points, it can hold number_of_points points
+    //! @return number of points copied to output
+    int32_t apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output);
+
+    //! @brief  Returns the permutation of the last frame, the input position of every output point
+    std::vector<int32_t> getLastPermutation();
+
+    //! @brief  Interleaves the bits of three 10 bit coordinates, x in the lowest bit
+    static uint32_t encode(uint32_t x, uint32_t y, uint32_t z);
+
+private:
+
+    void computeCodes(const tPointPcd *input, int32_t number_of_points);
+
+    void sortCodes(int32_t number_of_points);
+
+private:
+
+    std::mutex m_mutex;
+    bool m_enabled;
+
+    std::vector<uint32_t> m_codes[2];
+    std::vector<int32_t> m_order[2];
+    std::vector<uint32_t> m_histograms;
+    int m_sorted_buffer;
+
+    std::mutex m_permutation_mutex;
+    std::vector<int32_t> m_permutation;
+};
+
+#endif // MORTONORDER_H
@@ -0,0 +1,228 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "normalEstimation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <beam_parallel.h>
+
+//! Cells searched at each side for a neighbour, the scan can leave gaps of one cell
+static const int max_neighbour_distance = 2;
+
+//! Minimum depth jump in mm, for the points close to the sensor
+static const float min_depth_jump = 50.0f;
+
+//! Minimum rows per chunk of the parallel loop
+static const size_t normal_rows_chunk = 8;
+
+//! Minimum points per chunk of the shading loop
+static const size_t shade_points_chunk = 4096;
+
+//! Color shaded for the points without color
+static const int32_t default_color = 0xC0C0C0;
+
+static const float degrees_to_radians = 0.01745329252f;
+
+normalEstimation::normalEstimation()
+{
+    m_settings.enabled = false;
+    m_settings.ambient = 0.25f;
+    m_settings.light_azimuth = 20.0f;
+    m_settings.light_elevation = 30.0f;
+    m_settings.max_depth_jump = 0.05f;
+
+    m_columns = 0;
+    m_rows = 0;
+}
+
+void normalEstimation::setSettings(const normalEstimationSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+    m_settings.ambient = std::min(std::max(settings.ambient, 0.0f), 1.0f);
+}
+
+normalEstimationSettings normalEstimation::getSettings()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+bool normalEstimation::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled;
+}
+
+const std::vector<float> &normalEstimation::getNormals() const
+{
+    return m_normals;
+}
+
+void normalEstimation::clear()
+{
+    m_normals.clear();
+}
+
+bool normalEstimation::getDifference(const float position[3], float range, int row, int column,
+                                     int row_step, int column_step, float max_jump, float difference[3]) const
+{
+    //!the nearest neighbour at each side on the same surface, the point itself if there is none
+    const float *neighbours[2] = {position, position};
+    for(int side = 0; side < 2; ++side){
+        int sign = side == 0 ? -1 : 1;
+        for(int distance = 1; distance <= max_neighbour_distance; ++distance){
+            int r = row + sign * distance * row_step;
+            int c = column + sign * distance * column_step;
+            if(r < 0 || r >= m_rows || c < 0 || c >= m_columns){
+                break;
+            }
+            const float *cell = &m_cells[((size_t)r * m_columns + c) * 4];
+            if(cell[3] <= 0){
+                continue;
+            }
+            if(std::fabs(cell[3] - range) <= max_jump){
+                neighbours[side] = cell;
+            }
+            break;
+        }
+    }
+
+    if(neighbours[0] == neighbours[1]){
+        return false;
+    }
+
+    for(int i = 0; i < 3; ++i){
+        difference[i] = neighbours[1][i] - neighbours[0][i];
+    }
+    return true;
+}
+
+bool normalEstimation::apply(const tPointPcd *points, int32_t number_of_points, const organizedFrame &organized)
+{
+    normalEstimationSettings settings = getSettings();
+    m_normals.clear();
+    if(!settings.enabled || number_of_points <= 0 || organized.getNumberOfPoints() != number_of_points){
+        return false;
+    }
+
+    m_normals.resize((size_t)number_of_points * 3);
+
+    m_columns = organized.getColumns();
+    m_rows = organized.getRows();
+    m_cells.resize((size_t)m_columns * m_rows * 4);
+    const int columns = m_columns;
+
+    const std::vector<int32_t> &heads = organized.getIndexImage();
+    const std::vector<float> &ranges = organized.getRangeImage();
+    beamParallelFor(m_rows, normal_rows_chunk, [&](size_t first_row, size_t last_row){
+        for(size_t cell = first_row * columns; cell < last_row * columns; ++cell){
+            float *output = &m_cells[cell * 4];
+            int32_t head = heads[cell];
+            if(head < 0){
+                output[3] = 0;
+                continue;
+            }
+            output[0] = (float)points[head].x;
+            output[1] = (float)points[head].y;
+            output[2] = (float)points[head].z;
+            output[3] = ranges[cell];
+        }
+    });
+
+    beamParallelFor(m_rows, normal_rows_chunk, [&](size_t first_row, size_t last_row){
+        for(int row = (int)first_row; row < (int)last_row; ++row){
+            for(int column = 0; column < columns; ++column){
+                for(int32_t index = organized.getPointIndex(row, column); index >= 0; index = organized.getNextPointIndex(index)){
+                    const tPointPcd &point = points[index];
+                    float position[3] = {(float)point.x, (float)point.y, (float)point.z};
+                    float range = std::sqrt(position[0]*position[0] + position[1]*position[1] + position[2]*position[2]);
+                    float max_jump = std::max(range * settings.max_depth_jump, min_depth_jump);
+
+                    float horizontal[3], vertical[3], normal[3] = {0, 0, 0};
+                    bool valid = getDifference(position, range, row, column, 0, 1, max_jump, horizontal) &&
+                            getDifference(position, range, row, column, 1, 0, max_jump, vertical);
+                    if(valid){
+                        normal[0] = horizontal[1] * vertical[2] - horizontal[2] * vertical[1];
+                        normal[1] = horizontal[2] * vertical[0] - horizontal[0] * vertical[2];
+                        normal[2] = horizontal[0] * vertical[1] - horizontal[1] * vertical[0];
+                    }
+                    float length = std::sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+
+                    //!isolated points face the sensor
+                    if(!valid || length <= 0){
+                        for(int i = 0; i < 3; ++i){
+                            normal[i] = -position[i];
+                        }
+                        length = std::max(range, 1.0f);
+                    }
+
+                    //!the normals point to the sensor
+                    float sign = (normal[0]*position[0] + normal[1]*position[1] + normal[2]*position[2]) > 0 ? -1.0f : 1.0f;
+                    float scale = sign / length;
+                    float *output = &m_normals[(size_t)index * 3];
+                    for(int i = 0; i < 3; ++i){
+                        output[i] = normal[i] * scale;
+                    }
+                }
+            }
+        }
+    });
+    return true;
+}
+
+bool normalEstimation::shade(const tPointPcd *points, int32_t number_of_points, tPointPcd *shaded)
+{
+    if(number_of_points <= 0 || m_normals.size() != (size_t)number_of_points * 3){
+        return false;
+    }
+    normalEstimationSettings settings = getSettings();
+
+    //!z forward, x right and y down, the light is on the side of the sensor
+    float azimuth = settings.light_azimuth * degrees_to_radians;
+    float elevation = settings.light_elevation * degrees_to_radians;
+    const float light[3] = {std::sin(azimuth) * std::cos(elevation), -std::sin(elevation), -std::cos(azimuth) * std::cos(elevation)};
+    const float diffuse = 1.0f - settings.ambient;
+
+    beamParallelFor(number_of_points, shade_points_chunk, [&](size_t first, size_t last){
+        for(size_t index = first; index < last; ++index){
+            const float *normal = &m_normals[index * 3];
+            float lambert = std::max(normal[0]*light[0] + normal[1]*light[1] + normal[2]*light[2], 0.0f);
+            float factor = settings.ambient + diffuse * lambert;
+
+            int32_t color = points[index].RGB != 0 ? points[index].RGB : default_color;
+            int32_t red = (int32_t)(((color >> 16) & 0xFF) * factor);
+            int32_t green = (int32_t)(((color >> 8) & 0xFF) * factor);
+            int32_t blue = (int32_t)((color & 0xFF) * factor);
+            shaded[index] = points[index];
+            shaded[index].RGB = (red << 16) | (green << 8) | blue;
+        }
+    });
+    return true;
+}
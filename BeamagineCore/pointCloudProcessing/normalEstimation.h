@@ -0,0 +1,112 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef NORMALESTIMATION_H
+#define NORMALESTIMATION_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+#include "organizedFrame.h"
+
+//! The light comes from the given azimuth and elevation seen from the sensor, in
+//! degrees. The depth jump is relative to the range of the point.
+typedef struct normalEstimationSettings{
+    bool enabled;
+    float ambient;
+    float light_azimuth;
+    float light_elevation;
+    float max_depth_jump;
+}normalEstimationSettings;
+
+//! @brief  Estimates the surface normal of every point from its neighbours in the organized
+//!         view of the frame, the cross product of the horizontal and vertical differences,
+//!         instead of searching them in 3D. Neighbours across a depth jump are not used, so
+//!         the edges of the objects are not blended with the background. A copy of the points
+//!         can then be shaded with a Lambert model, so every viewer shows the shape of the
+//!         surfaces while the frame keeps the colors of the device.
+class normalEstimation
+{
+public:
+    normalEstimation();
+
+    //! @brief  Sets the stage settings, they apply from the next frame
+    void setSettings(const normalEstimationSettings &settings);
+
+    //! @brief  Returns the stage settings
+    normalEstimationSettings getSettings();
+
+    //! @brief  Returns true if the stage is enabled
+    bool isEnabled();
+
+    //! @brief  Estimates the normals of the points
+    //! @param  points Points of the frame
+    //! @param  number_of_points Number of points
+    //! @param  organized Organized view of the same points
+    //! @return false if the stage is disabled, the frame has no normals then
+    bool apply(const tPointPcd *points, int32_t number_of_points, const organizedFrame &organized);
+
+    //! @brief  Copies the points of the last frame with their color shaded by their normals
+    //! @param  points Points of the frame given to apply
+    //! @param  number_of_points Number of points
+    //! @param  shaded Output points, it can hold number_of_points
+    //! @return false if the last frame has no normals for these points
+    bool shade(const tPointPcd *points, int32_t number_of_points, tPointPcd *shaded);
+
+    //! @brief  Returns the normals of the last frame, x, y and z of every point interleaved
+    const std::vector<float> &getNormals() const;
+
+    //! @brief  Drops the normals of the last frame
+    void clear();
+
+private:
+
+    //! @brief  Returns the difference between the neighbours of a point along a direction of
+    //!         the grid, one sided if only one of them is on the same surface
+    //! @return false if no neighbour is on the same surface
+    bool getDifference(const float position[3], float range, int row, int column,
+                       int row_step, int column_step, float max_jump, float difference[3]) const;
+
+private:
+
+    std::mutex m_mutex;
+
+    normalEstimationSettings m_settings;
+
+    std::vector<float> m_normals;
+
+    //!x, y, z and range of the nearest point of every cell, so the neighbours are read
+    //!from a compact grid instead of the whole frame
+    std::vector<float> m_cells;
+    int m_columns;
+    int m_rows;
+};
+
+#endif // NORMALESTIMATION_H
@@ -0,0 +1,198 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "organizedFrame.h"
+
+#include <cmath>
+
+//! Degrees to radians
+static const float degrees_to_radians = 0.01745329252f;
+
+organizedFrame::organizedFrame()
+{
+    //!L3Cam scan layout and field of view, with some margin in elevation
+    m_pending_settings.columns = 480;
+    m_pending_settings.rows = 150;
+    m_pending_settings.min_azimuth = -30.0;
+    m_pending_settings.max_azimuth = 30.0;
+    m_pending_settings.min_elevation = -11.5;
+    m_pending_settings.max_elevation = 11.5;
+
+    m_number_of_points = 0;
+
+    applySettings();
+}
+
+void organizedFrame::setSettings(const organizedFrameSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(m_settings_mutex);
+    m_pending_settings = settings;
+    m_pending_settings.columns = std::max(settings.columns, 1);
+    m_pending_settings.rows = std::max(settings.rows, 1);
+}
+
+organizedFrameSettings organizedFrame::getSettings()
+{
+    std::lock_guard<std::mutex> lock(m_settings_mutex);
+    return m_pending_settings;
+}
+
+void organizedFrame::applySettings()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_settings_mutex);
+        m_settings = m_pending_settings;
+    }
+
+    m_azimuth_origin = m_settings.min_azimuth * degrees_to_radians;
+    m_elevation_origin = m_settings.min_elevation * degrees_to_radians;
+    m_columns_per_radian = m_settings.columns / std::max((m_settings.max_azimuth - m_settings.min_azimuth) * degrees_to_radians, 1e-6f);
+    m_rows_per_radian = m_settings.rows / std::max((m_settings.max_elevation - m_settings.min_elevation) * degrees_to_radians, 1e-6f);
+
+    size_t number_of_cells = (size_t)m_settings.columns * m_settings.rows;
+    m_range_image.assign(number_of_cells, 0);
+    m_intensity_image.assign(number_of_cells, 0);
+    m_index_image.assign(number_of_cells, -1);
+}
+
+void organizedFrame::reset()
+{
+    applySettings();
+
+    m_point_cell.clear();
+    m_point_next.clear();
+    m_point_range.clear();
+
+    m_number_of_points = 0;
+}
+
+void organizedFrame::addPoints(const tPointPcd *points, int32_t first_index, int32_t number_of_points)
+{
+    if(number_of_points <= 0){
+        return;
+    }
+
+    size_t needed = (size_t)first_index + number_of_points;
+    if(m_point_cell.size() < needed){
+        m_point_cell.resize(needed, -1);
+        m_point_next.resize(needed, -1);
+        m_point_range.resize(needed, 0);
+    }
+
+    for(int32_t i = 0; i < number_of_points; ++i){
+        const tPointPcd &point = points[i];
+        int32_t index = first_index + i;
+
+        int row, column;
+        project(point.x, point.y, point.z, row, column);
+        int32_t cell = row * m_settings.columns + column;
+
+        float range = std::sqrt((float)point.x * point.x + (float)point.y * point.y + (float)point.z * point.z);
+        m_point_cell[index] = cell;
+        m_point_range[index] = range;
+
+        //!the nearest point of the cell heads its chain and fills the images, the others go after it unsorted
+        int32_t head = m_index_image[cell];
+        if(head < 0 || range < m_point_range[head]){
+            m_point_next[index] = head;
+            m_index_image[cell] = index;
+            m_range_image[cell] = range;
+            m_intensity_image[cell] = point.intensity;
+        }else{
+            m_point_next[index] = m_point_next[head];
+            m_point_next[head] = index;
+        }
+    }
+
+    m_number_of_points += number_of_points;
+}
+
+void organizedFrame::build(const tPointPcd *points, int32_t number_of_points)
+{
+    reset();
+    addPoints(points, 0, number_of_points);
+}
+
+int32_t organizedFrame::getNumberOfPoints() const
+{
+    return m_number_of_points;
+}
+
+int organizedFrame::getColumns() const
+{
+    return m_settings.columns;
+}
+
+int organizedFrame::getRows() const
+{
+    return m_settings.rows;
+}
+
+bool organizedFrame::project(float x, float y, float z, int &row, int &column) const
+{
+    //!z forward, x right and y down
+    float azimuth = std::atan2(x, z);
+    float elevation = std::atan2(y, std::sqrt(x * x + z * z));
+
+    int c = (int)std::floor((azimuth - m_azimuth_origin) * m_columns_per_radian);
+    int r = (int)std::floor((elevation - m_elevation_origin) * m_rows_per_radian);
+
+    column = std::min(std::max(c, 0), m_settings.columns - 1);
+    row = std::min(std::max(r, 0), m_settings.rows - 1);
+
+    return c == column && r == row;
+}
+
+int32_t organizedFrame::getPointIndex(int row, int column) const
+{
+    return m_index_image[row * m_settings.columns + column];
+}
+
+int32_t organizedFrame::getNextPointIndex(int32_t index) const
+{
+    return m_point_next[index];
+}
+
+int32_t organizedFrame::getCellOf(int32_t index) const
+{
+    return m_point_cell[index];
+}
+
+const std::vector<float> &organizedFrame::getRangeImage() const
+{
+    return m_range_image;
+}
+
+const std::vector<int32_t> &organizedFrame::getIntensityImage() const
+{
+    return m_intensity_image;
+}
+
+const std::vector<int32_t> &organizedFrame::getIndexImage() const
+{
+    return m_index_image;
+}
@@ -0,0 +1,189 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ORGANIZEDFRAME_H
+#define ORGANIZEDFRAME_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+typedef struct organizedFrameSettings{
+    int columns;
+    int rows;
+    float min_azimuth;
+    float max_azimuth;
+    float min_elevation;
+    float max_elevation;
+}organizedFrameSettings;
+
+//! @brief  Organized view of a frame. The L3Cam sends only the points with a return, in
+//!         no fixed order, so every point is binned by azimuth and elevation in a grid
+//!         with the layout of a scan (480x150 by default). Each cell keeps its points
+//!         chained, the nearest one first and the others in no order of range, and the
+//!         range, intensity and index of the nearest one form the range image. Points out of the field of view go to the border cells.
+//!         The view can be filled while the frame is being received.
+class organizedFrame
+{
+public:
+    organizedFrame();
+
+    //! @brief  Sets the grid layout, it applies from the next reset
+    void setSettings(const organizedFrameSettings &settings);
+
+    //! @brief  Returns the grid layout
+    organizedFrameSettings getSettings();
+
+    //! @brief  Empties the grid for a new frame
+    void reset();
+
+    //! @brief  Bins a block of points of the frame, blocks can be added as they arrive
+    //! @param  points Points of the block
+    //! @param  first_index Index of the first point of the block in the frame
+    //! @param  number_of_points Number of points of the block
+    //! @return none
+    void addPoints(const tPointPcd *points, int32_t first_index, int32_t number_of_points);
+
+    //! @brief  Resets the grid and bins a whole frame
+    void build(const tPointPcd *points, int32_t number_of_points);
+
+    //! @brief  Returns the number of points binned since the last reset
+    int32_t getNumberOfPoints() const;
+
+    int getColumns() const;
+
+    int getRows() const;
+
+    //! @brief  Returns the cell of some coordinates
+    //! @param  x, y, z Coordinates in mm
+    //! @param  row Returns the row of the cell
+    //! @param  column Returns the column of the cell
+    //! @return false if the coordinates are out of the field of view, the border cell is returned
+    bool project(float x, float y, float z, int &row, int &column) const;
+
+    //! @brief  Returns the index of the nearest point of a cell, -1 if the cell is empty
+    int32_t getPointIndex(int row, int column) const;
+
+    //! @brief  Returns the next point chained in the same cell, -1 if there is none. Only the first
+    //!         point of a cell is the nearest, the ones after it are not sorted by range
+    int32_t getNextPointIndex(int32_t index) const;
+
+    //! @brief  Returns the cell of a point as row * columns + column
+    int32_t getCellOf(int32_t index) const;
+
+    //! @brief  Returns the range in mm of the nearest point of every cell, 0 for empty cells
+    const std::vector<float> &getRangeImage() const;
+
+    //! @brief  Returns the intensity of the nearest point of every cell, 0 for empty cells
+    const std::vector<int32_t> &getIntensityImage() const;
+
+    //! @brief  Returns the index of the nearest point of every cell, -1 for empty cells
+    const std::vector<int32_t> &getIndexImage() const;
+
+    //! @brief  Calls visit with the index of every point in the cells around the cell of a point,
+    //!         the point itself included
+    //! @param  index Point whose neighbourhood is visited
+    //! @param  row_radius Rows visited above and below
+    //! @param  column_radius Columns visited at each side
+    //! @param  visit Function called with the index of every point
+    //! @return none
+    template <typename F>
+    void forEachNeighbour(int32_t index, int row_radius, int column_radius, F visit) const;
+
+    //! @brief  Calls visit with the index of every point in the cells covered by a radius around
+    //!         a point, the window is sized from the range of the point
+    //! @param  index Point whose neighbourhood is visited
+    //! @param  radius Radius in mm
+    //! @param  max_cells Maximum cells visited at each side
+    //! @param  visit Function called with the index of every point
+    //! @return none
+    template <typename F>
+    void forEachNearbyPoint(int32_t index, float radius, int max_cells, F visit) const;
+
+private:
+
+    void applySettings();
+
+private:
+
+    std::mutex m_settings_mutex;
+    organizedFrameSettings m_pending_settings;
+    organizedFrameSettings m_settings;
+
+    float m_azimuth_origin;
+    float m_elevation_origin;
+    float m_columns_per_radian;
+    float m_rows_per_radian;
+
+    std::vector<float> m_range_image;
+    std::vector<int32_t> m_intensity_image;
+    std::vector<int32_t> m_index_image;
+
+    std::vector<int32_t> m_point_cell;
+    std::vector<int32_t> m_point_next;
+    std::vector<float> m_point_range;
+
+    int32_t m_number_of_points;
+};
+
+template <typename F>
+void organizedFrame::forEachNeighbour(int32_t index, int row_radius, int column_radius, F visit) const
+{
+    int32_t cell = m_point_cell[index];
+    int row = cell / m_settings.columns;
+    int column = cell % m_settings.columns;
+
+    int first_row = std::max(row - row_radius, 0);
+    int last_row = std::min(row + row_radius, m_settings.rows - 1);
+    int first_column = std::max(column - column_radius, 0);
+    int last_column = std::min(column + column_radius, m_settings.columns - 1);
+
+    for(int r = first_row; r <= last_row; ++r){
+        const int32_t *cells = &m_index_image[r * m_settings.columns];
+        for(int c = first_column; c <= last_column; ++c){
+            for(int32_t point = cells[c]; point >= 0; point = m_point_next[point]){
+                visit(point);
+            }
+        }
+    }
+}
+
+template <typename F>
+void organizedFrame::forEachNearbyPoint(int32_t index, float radius, int max_cells, F visit) const
+{
+    float angle = std::atan2(radius, std::max(m_point_range[index], radius));
+    int row_radius = std::min(std::max((int)std::ceil(angle * m_rows_per_radian), 1), max_cells);
+    int column_radius = std::min(std::max((int)std::ceil(angle * m_columns_per_radian), 1), max_cells);
+
+    forEachNeighbour(index, row_radius, column_radius, visit);
+}
+
+#endif // ORGANIZEDFRAME_H
@@ -0,0 +1,179 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "outlierFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <beam_parallel.h>
+
+#include "pointPartition.h"
+
+//! Minimum cells per chunk of the parallel loops
+static const size_t outlier_chunk = 256;
+
+//! Minimum points per chunk of the parallel loops on the organized view
+static const size_t organized_chunk = 4096;
+
+//! Cells visited at each side of a point in the organized view, the window starts
+//! with the minimum and grows while there are not enough neighbours
+static const int organized_min_cells = 2;
+static const int organized_max_cells = 3;
+
+outlierFilter::outlierFilter()
+{
+    m_settings.enabled = false;
+    m_settings.neighbours = 8;
+    m_settings.std_multiplier = 1.0;
+    m_settings.search_radius = 1000;
+    m_settings.use_range_image = false;
+}
+
+void outlierFilter::setSettings(const outlierFilterSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+}
+
+outlierFilterSettings outlierFilter::getSettings()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+bool outlierFilter::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled;
+}
+
+bool outlierFilter::usesOrganizedFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings.enabled && m_settings.use_range_image;
+}
+
+int32_t outlierFilter::apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output, const organizedFrame *organized)
+{
+    outlierFilterSettings settings = getSettings();
+
+    if(!settings.enabled || number_of_points <= settings.neighbours){
+        memcpy(output, input, sizeof(tPointPcd) * number_of_points);
+        return number_of_points;
+    }
+
+    m_mean_distances.resize(number_of_points);
+
+    if(settings.use_range_image){
+        if(organized == NULL || organized->getNumberOfPoints() != number_of_points){
+            m_organized.build(input, number_of_points);
+            organized = &m_organized;
+        }
+        computeOrganizedDistances(settings, input, number_of_points, organized);
+    }else{
+        m_index.build(input, number_of_points);
+        computeGridDistances(settings);
+    }
+
+    double sum = 0;
+    double sum_sqr = 0;
+    for(int32_t i = 0; i < number_of_points; ++i){
+        sum += m_mean_distances[i];
+        sum_sqr += (double)m_mean_distances[i] * m_mean_distances[i];
+    }
+    double mean = sum / number_of_points;
+    double deviation = std::sqrt(std::max(sum_sqr / number_of_points - mean * mean, 0.0));
+    float threshold = mean + settings.std_multiplier * deviation;
+
+    m_keep.resize(number_of_points);
+    for(int32_t i = 0; i < number_of_points; ++i){
+        m_keep[i] = m_mean_distances[i] <= threshold;
+    }
+
+    return partitionPoints(input, number_of_points, m_keep, output, false);
+}
+
+void outlierFilter::computeGridDistances(const outlierFilterSettings &settings)
+{
+    //!every thread works on its own range of cells, the points of a cell share their candidates
+    beamParallelFor(m_index.getNumberOfCells(), outlier_chunk, [&](size_t first_cell, size_t last_cell){
+        m_index.forEachNearestK(first_cell, last_cell, settings.neighbours, settings.search_radius,
+                                [&](int index, const std::vector<float> &distances, int found){
+            float sum = 0;
+            for(int n = 0; n < found; ++n){
+                sum += std::sqrt(distances[n]);
+            }
+            sum += (settings.neighbours - found) * settings.search_radius;
+
+            m_mean_distances[index] = sum / settings.neighbours;
+        });
+    });
+}
+
+void outlierFilter::computeOrganizedDistances(const outlierFilterSettings &settings, const tPointPcd *input, int32_t number_of_points, const organizedFrame *organized)
+{
+    float search_radius_sqr = settings.search_radius * settings.search_radius;
+
+    //!the neighbours are the points of the cells around the point, no tree search is needed
+    beamParallelFor(number_of_points, organized_chunk, [&](size_t first_point, size_t last_point){
+        std::vector<float> distances;
+        for(size_t i = first_point; i < last_point; ++i){
+            const tPointPcd &point = input[i];
+
+            for(int cells = organized_min_cells; cells <= organized_max_cells; ++cells){
+                distances.clear();
+                organized->forEachNearbyPoint(i, settings.search_radius, cells, [&](int32_t neighbour){
+                    float dx = (float)(input[neighbour].x - point.x);
+                    float dy = (float)(input[neighbour].y - point.y);
+                    float dz = (float)(input[neighbour].z - point.z);
+                    float distance = dx*dx + dy*dy + dz*dz;
+                    if(neighbour != (int32_t)i && distance <= search_radius_sqr){
+                        distances.push_back(distance);
+                    }
+                });
+                if((int)distances.size() >= settings.neighbours){
+                    break;
+                }
+            }
+
+            int found = std::min((int)distances.size(), settings.neighbours);
+            if(found > 0 && found < (int)distances.size()){
+                std::nth_element(distances.begin(), distances.begin() + found - 1, distances.end());
+            }
+
+            float sum = 0;
+            for(int n = 0; n < found; ++n){
+                sum += std::sqrt(distances[n]);
+            }
+            sum += (settings.neighbours - found) * settings.search_radius;
+
+            m_mean_distances[i] = sum / settings.neighbours;
+        }
+    });
+}
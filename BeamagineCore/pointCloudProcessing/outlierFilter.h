@@ -0,0 +1,98 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef OUTLIERFILTER_H
+#define OUTLIERFILTER_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+#include "voxelGridIndex.h"
+#include "organizedFrame.h"
+
+typedef struct outlierFilterSettings{
+    bool enabled;
+    int neighbours;
+    float std_multiplier;
+    float search_radius;
+    bool use_range_image;
+}outlierFilterSettings;
+
+//! @brief  Statistical outlier removal. The mean distance of every point to its k nearest
+//!         neighbours is compared with the mean and standard deviation of the frame, points
+//!         farther than mean + std_multiplier * deviation are dropped. Isolated points with
+//!         fewer than k neighbours in the search radius count as being at that radius.
+//!         Neighbours are searched in a voxel grid, or in the cells around the point in the
+//!         organized view of the frame, which is faster but only finds the neighbours in the
+//!         line of sight.
+class outlierFilter
+{
+public:
+    outlierFilter();
+
+    //! @brief  Sets the filter settings, they apply from the next frame
+    void setSettings(const outlierFilterSettings &settings);
+
+    //! @brief  Returns the filter settings
+    outlierFilterSettings getSettings();
+
+    //! @brief  Returns true if the stage is enabled
+    bool isEnabled();
+
+    //! @brief  Returns true if the neighbours are searched in the organized view of the frame
+    bool usesOrganizedFrame();
+
+    //! @brief  Copies the points that are not outliers keeping their order
+    //! @param  input Input points
+    //! @param  number_of_points Number of input points
+    //! @param  output Output points, it can hold number_of_points points
+    //! @param  organized Organized view of the input points, NULL to build it when it is used
+    //! @return number of points copied to output
+    int32_t apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output, const organizedFrame *organized = NULL);
+
+private:
+
+    void computeGridDistances(const outlierFilterSettings &settings);
+
+    void computeOrganizedDistances(const outlierFilterSettings &settings, const tPointPcd *input, int32_t number_of_points, const organizedFrame *organized);
+
+    std::mutex m_mutex;
+
+    outlierFilterSettings m_settings;
+
+    voxelGridIndex m_index;
+
+    organizedFrame m_organized;
+
+    std::vector<float> m_mean_distances;
+    std::vector<uint8_t> m_keep;
+};
+
+#endif // OUTLIERFILTER_H
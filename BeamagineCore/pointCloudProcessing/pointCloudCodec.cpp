@@ -0,0 +1,210 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pointCloudCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+//! The colors are coded with a palette if the frame has at most one for every this many points
+static const int32_t points_per_palette_color = 4;
+
+static inline uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+pointCloudCodec::pointCloudCodec()
+{
+}
+
+void pointCloudCodec::encode(const tPointPcd *points, int32_t number_of_points, std::vector<uint8_t> &encoded)
+{
+    number_of_points = std::max(number_of_points, 0);
+    m_values.resize(number_of_points);
+
+    //!the palette is given up as soon as the frame has too many colors
+    m_palette_positions.clear();
+    size_t max_palette_size = number_of_points / points_per_palette_color;
+    bool use_palette = max_palette_size > 0;
+    for(int32_t i = 0; i < number_of_points && use_palette; i++){
+        m_palette_positions[points[i].RGB]++;
+        use_palette = m_palette_positions.size() <= max_palette_size;
+    }
+
+    //!the colors used the most get the shortest positions
+    m_palette.clear();
+    if(use_palette){
+        m_palette_uses.clear();
+        for(const auto &color : m_palette_positions){
+            m_palette_uses.push_back(std::make_pair(color.second, color.first));
+        }
+        std::sort(m_palette_uses.begin(), m_palette_uses.end(), [](const std::pair<uint32_t, int32_t> &a, const std::pair<uint32_t, int32_t> &b){
+            return (a.first != b.first) ? (a.first > b.first) : (a.second < b.second);
+        });
+        for(size_t i = 0; i < m_palette_uses.size(); i++){
+            m_palette.push_back(m_palette_uses[i].second);
+            m_palette_positions[m_palette_uses[i].second] = i;
+        }
+    }
+
+    pointCloudCodecHeader header;
+    memcpy(header.magic, POINTCLOUD_CODEC_MAGIC, sizeof(header.magic));
+    header.number_of_points = number_of_points;
+    header.palette_size = m_palette.size();
+    header.streams = use_palette ? 5 : 8;
+
+    encoded.resize(sizeof(header) + m_palette.size() * sizeof(int32_t));
+    memcpy(encoded.data(), &header, sizeof(header));
+    if(!m_palette.empty()){
+        memcpy(&encoded[sizeof(header)], m_palette.data(), m_palette.size() * sizeof(int32_t));
+    }
+
+    //!x, y, z and intensity as the difference with the previous point
+    for(int field = 0; field < 4; field++){
+        const int32_t *values = (const int32_t*)points + field;
+        int32_t previous = 0;
+        for(int32_t i = 0; i < number_of_points; i++){
+            int32_t value = values[i * 5];
+            m_values[i] = zigzag((int32_t)((uint32_t)value - (uint32_t)previous));
+            previous = value;
+        }
+        encodeStream(number_of_points, encoded);
+    }
+
+    if(use_palette){
+        for(int32_t i = 0; i < number_of_points; i++){
+            m_values[i] = m_palette_positions[points[i].RGB];
+        }
+        encodeStream(number_of_points, encoded);
+        return;
+    }
+
+    //!every byte of the color as the difference with the previous point
+    for(int lane = 0; lane < 4; lane++){
+        uint8_t previous = 0;
+        for(int32_t i = 0; i < number_of_points; i++){
+            uint8_t value = (uint8_t)((uint32_t)points[i].RGB >> (8 * lane));
+            m_values[i] = zigzag((int8_t)(uint8_t)(value - previous));
+            previous = value;
+        }
+        encodeStream(number_of_points, encoded);
+    }
+}
+
+void pointCloudCodec::encodeStream(size_t count, std::vector<uint8_t> &encoded)
+{
+    m_stream_coder.encode(m_values.data(), count, encoded);
+}
+
+int32_t pointCloudCodec::getNumberOfPoints(const uint8_t *encoded, size_t bytes)
+{
+    if(encoded == NULL || bytes < sizeof(pointCloudCodecHeader)){
+        return -1;
+    }
+    pointCloudCodecHeader header;
+    memcpy(&header, encoded, sizeof(header));
+    if(memcmp(header.magic, POINTCLOUD_CODEC_MAGIC, sizeof(header.magic)) != 0 || header.number_of_points < 0){
+        return -1;
+    }
+    return header.number_of_points;
+}
+
+bool pointCloudCodec::decode(const uint8_t *encoded, size_t bytes, tPointPcd *points)
+{
+    int32_t number_of_points = getNumberOfPoints(encoded, bytes);
+    if(number_of_points < 0){
+        return false;
+    }
+    pointCloudCodecHeader header;
+    memcpy(&header, encoded, sizeof(header));
+    size_t position = sizeof(header) + (size_t)header.palette_size * sizeof(int32_t);
+    if(position > bytes || header.streams != (header.palette_size > 0 ? 5u : 8u)){
+        return false;
+    }
+    m_palette.resize(header.palette_size);
+    if(header.palette_size > 0){
+        memcpy(m_palette.data(), encoded + sizeof(header), header.palette_size * sizeof(int32_t));
+    }
+    m_values.resize(number_of_points);
+
+    for(int field = 0; field < 4; field++){
+        size_t stream_bytes = decodeStream(encoded + position, bytes - position, number_of_points);
+        if(stream_bytes == 0){
+            return false;
+        }
+        position += stream_bytes;
+
+        int32_t *values = (int32_t*)points + field;
+        int32_t previous = 0;
+        for(int32_t i = 0; i < number_of_points; i++){
+            previous = (int32_t)((uint32_t)previous + (uint32_t)unzigzag(m_values[i]));
+            values[i * 5] = previous;
+        }
+    }
+
+    if(header.palette_size > 0){
+        if(decodeStream(encoded + position, bytes - position, number_of_points) == 0){
+            return false;
+        }
+        for(int32_t i = 0; i < number_of_points; i++){
+            if(m_values[i] >= header.palette_size){
+                return false;
+            }
+            points[i].RGB = m_palette[m_values[i]];
+        }
+        return true;
+    }
+
+    for(int32_t i = 0; i < number_of_points; i++){
+        points[i].RGB = 0;
+    }
+    for(int lane = 0; lane < 4; lane++){
+        size_t stream_bytes = decodeStream(encoded + position, bytes - position, number_of_points);
+        if(stream_bytes == 0){
+            return false;
+        }
+        position += stream_bytes;
+
+        uint8_t previous = 0;
+        for(int32_t i = 0; i < number_of_points; i++){
+            previous = (uint8_t)(previous + unzigzag(m_values[i]));
+            points[i].RGB = (int32_t)((uint32_t)points[i].RGB | ((uint32_t)previous << (8 * lane)));
+        }
+    }
+    return true;
+}
+
+size_t pointCloudCodec::decodeStream(const uint8_t *stream, size_t bytes, size_t count)
+{
+    return m_stream_coder.decode(stream, bytes, count, m_values.data());
+}
@@ -0,0 +1,95 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef POINTCLOUDCODEC_H
+#define POINTCLOUDCODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+#include <beam_aux.h>
+
+#include "streamCoder.h"
+
+#define POINTCLOUD_CODEC_MAGIC "BPC1"
+
+typedef struct pointCloudCodecHeader{
+    char magic[4];
+    int32_t number_of_points;
+    uint32_t palette_size;          //!< 0 if the colors are coded as byte deltas
+    uint32_t streams;
+}pointCloudCodecHeader;
+
+//! @brief  Lossless compression of the point cloud frames for the recordings. Every field is
+//!         coded on its own: the difference with the previous point, zigzag mapped, is coded
+//!         as a stream of streamCoder. The colors are replaced by their position in a palette of the frame
+//!         sorted by use, or coded as byte deltas when the frame has too many of them.
+//!         An encoded frame is a pointCloudCodecHeader, the palette and the streams.
+//!         The work buffers are kept between frames, use one codec per thread.
+class pointCloudCodec
+{
+public:
+    pointCloudCodec();
+
+    //! @brief  Encodes a frame
+    //! @param  points Points of the frame
+    //! @param  number_of_points Number of points
+    //! @param  encoded Encoded frame, it is resized to its size
+    //! @return none
+    void encode(const tPointPcd *points, int32_t number_of_points, std::vector<uint8_t> &encoded);
+
+    //! @brief  Decodes a frame
+    //! @param  encoded Encoded frame
+    //! @param  bytes Size of the encoded frame
+    //! @param  points Output points, it can hold getNumberOfPoints points
+    //! @return false if the frame is not valid
+    bool decode(const uint8_t *encoded, size_t bytes, tPointPcd *points);
+
+    //! @brief  Returns the number of points of an encoded frame, -1 if it is not valid
+    static int32_t getNumberOfPoints(const uint8_t *encoded, size_t bytes);
+
+private:
+
+    //! @brief  Appends a stream with the values in m_values
+    void encodeStream(size_t count, std::vector<uint8_t> &encoded);
+
+    //! @brief  Decodes a stream to m_values
+    //! @return bytes of the stream, 0 if it is not valid
+    size_t decodeStream(const uint8_t *stream, size_t bytes, size_t count);
+
+private:
+
+    std::vector<uint32_t> m_values;
+    std::unordered_map<int32_t, uint32_t> m_palette_positions;
+    std::vector<std::pair<uint32_t, int32_t> > m_palette_uses;
+    std::vector<int32_t> m_palette;
+    streamCoder m_stream_coder;
+};
+
+#endif // POINTCLOUDCODEC_H
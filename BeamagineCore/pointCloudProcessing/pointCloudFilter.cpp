@@ -0,0 +1,119 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pointCloudFilter.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <beam_parallel.h>
+
+#include "pointPartition.h"
+
+//! Minimum points per chunk of the parallel loops
+static const size_t filter_chunk = 8192;
+
+pointCloudFilter::pointCloudFilter()
+{
+    memset(&m_settings, 0, sizeof(m_settings));
+}
+
+void pointCloudFilter::setSettings(const pointCloudFilterSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_settings = settings;
+}
+
+pointCloudFilterSettings pointCloudFilter::getSettings()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_settings;
+}
+
+bool pointCloudFilter::isEnabled(const pointCloudFilterSettings &settings)
+{
+    return settings.box_enabled || settings.range_enabled || settings.intensity_enabled || settings.sector_enabled;
+}
+
+bool pointCloudFilter::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return isEnabled(m_settings);
+}
+
+int32_t pointCloudFilter::apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output)
+{
+    pointCloudFilterSettings settings = getSettings();
+
+    if(!isEnabled(settings)){
+        memcpy(output, input, sizeof(tPointPcd) * number_of_points);
+        return number_of_points;
+    }
+
+    //!squared ranges and angle tangents avoid square roots and trigonometry per point
+    float min_range_sqr = settings.min_range * settings.min_range;
+    float max_range_sqr = settings.max_range * settings.max_range;
+    float tan_min_azimuth = std::tan(settings.min_azimuth * M_PI / 180.0);
+    float tan_max_azimuth = std::tan(settings.max_azimuth * M_PI / 180.0);
+    float tan_min_elevation = std::tan(settings.min_elevation * M_PI / 180.0);
+    float tan_max_elevation = std::tan(settings.max_elevation * M_PI / 180.0);
+
+    m_keep.resize(number_of_points);
+
+    beamParallelFor(number_of_points, filter_chunk, [&](size_t begin, size_t end){
+        for(size_t i = begin; i < end; ++i){
+            const tPointPcd &point = input[i];
+            bool keep = true;
+
+            if(settings.box_enabled){
+                keep = point.x >= settings.min_x && point.x <= settings.max_x &&
+                       point.y >= settings.min_y && point.y <= settings.max_y &&
+                       point.z >= settings.min_z && point.z <= settings.max_z;
+            }
+            if(keep && settings.intensity_enabled){
+                keep = point.intensity >= settings.min_intensity;
+            }
+            if(keep && settings.range_enabled){
+                float x = point.x, y = point.y, z = point.z;
+                float range_sqr = x*x + y*y + z*z;
+                keep = range_sqr >= min_range_sqr && range_sqr <= max_range_sqr;
+            }
+            if(keep && settings.sector_enabled){
+                //!sectors are limited to the half space in front of the sensor
+                float x = point.x, y = point.y, z = point.z;
+                float horizontal = std::sqrt(x*x + z*z);
+                keep = z > 0 &&
+                       x >= tan_min_azimuth * z && x <= tan_max_azimuth * z &&
+                       -y >= tan_min_elevation * horizontal && -y <= tan_max_elevation * horizontal;
+            }
+
+            m_keep[i] = keep;
+        }
+    });
+
+    return partitionPoints(input, number_of_points, m_keep, output, false);
+}
@@ -0,0 +1,98 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef POINTCLOUDFILTER_H
+#define POINTCLOUDFILTER_H
+
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include <beam_aux.h>
+
+//! Coordinates are in mm, z points forward, x to the right and y down. Azimuth is
+//! positive to the right and elevation positive upwards, both in degrees.
+typedef struct pointCloudFilterSettings{
+    bool box_enabled;
+    int32_t min_x;
+    int32_t max_x;
+    int32_t min_y;
+    int32_t max_y;
+    int32_t min_z;
+    int32_t max_z;
+
+    bool range_enabled;
+    float min_range;
+    float max_range;
+
+    bool intensity_enabled;
+    int32_t min_intensity;
+
+    bool sector_enabled;
+    float min_azimuth;
+    float max_azimuth;
+    float min_elevation;
+    float max_elevation;
+}pointCloudFilterSettings;
+
+//! @brief  Drops the points out of the region of interest of the host. Settings can be
+//!         changed from any thread and are taken at the beginning of every frame.
+class pointCloudFilter
+{
+public:
+    pointCloudFilter();
+
+    //! @brief  Sets the filter settings, they apply from the next frame
+    void setSettings(const pointCloudFilterSettings &settings);
+
+    //! @brief  Returns the filter settings
+    pointCloudFilterSettings getSettings();
+
+    //! @brief  Returns true if any of the criteria is enabled
+    bool isEnabled();
+
+    //! @brief  Copies the points that pass the filter keeping their order
+    //! @param  input Input points
+    //! @param  number_of_points Number of input points
+    //! @param  output Output points, it can hold number_of_points points
+    //! @return number of points copied to output
+    int32_t apply(const tPointPcd *input, int32_t number_of_points, tPointPcd *output);
+
+private:
+
+    static bool isEnabled(const pointCloudFilterSettings &settings);
+
+private:
+
+    std::mutex m_mutex;
+
+    pointCloudFilterSettings m_settings;
+
+    std::vector<uint8_t> m_keep;
+};
+
+#endif // POINTCLOUDFILTER_H
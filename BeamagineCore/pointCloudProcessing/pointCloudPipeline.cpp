@@ -0,0 +1,233 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pointCloudPipeline.h"
+
+#include <cstring>
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+pointCloudPipeline::pointCloudPipeline()
+{
+    memset(&m_timing, 0, sizeof(m_timing));
+}
+
+pointCloudFilter *pointCloudPipeline::getFilter()
+{
+    return &m_filter;
+}
+
+backgroundModel *pointCloudPipeline::getBackgroundModel()
+{
+    return &m_background;
+}
+
+mortonOrder *pointCloudPipeline::getMortonOrder()
+{
+    return &m_morton;
+}
+
+outlierFilter *pointCloudPipeline::getOutlierFilter()
+{
+    return &m_outliers;
+}
+
+organizedFrame *pointCloudPipeline::getOrganizedInput()
+{
+    return &m_organized_input;
+}
+
+bool pointCloudPipeline::usesOrganizedFrame()
+{
+    return m_outliers.usesOrganizedFrame() || m_normals.isEnabled();
+}
+
+euclideanClustering *pointCloudPipeline::getClustering()
+{
+    return &m_clustering;
+}
+
+cameraFusion *pointCloudPipeline::getCameraFusion()
+{
+    return &m_fusion;
+}
+
+normalEstimation *pointCloudPipeline::getNormalEstimation()
+{
+    return &m_normals;
+}
+
+bool pointCloudPipeline::shadeLastFrame(const int32_t *frame, int32_t *shaded)
+{
+    if(!m_normals.shade((const tPointPcd*)&frame[1], frame[0], (tPointPcd*)&shaded[1])){
+        return false;
+    }
+    shaded[0] = frame[0];
+    return true;
+}
+
+std::vector<pointCloudCluster> pointCloudPipeline::getLastClusters()
+{
+    std::lock_guard<std::mutex> lock(m_clusters_mutex);
+    return m_clusters;
+}
+
+pointCloudPipelineTiming pointCloudPipeline::getLastTiming()
+{
+    std::lock_guard<std::mutex> lock(m_timing_mutex);
+    return m_timing;
+}
+
+int32_t pointCloudPipeline::process(const int32_t *input, int32_t *output, uint32_t timestamp)
+{
+    //!the normals of the previous frame are not used to shade this one
+    m_normals.clear();
+
+    try{
+        QElapsedTimer timer;
+        timer.start();
+
+        pointCloudPipelineTiming timing;
+        memset(&timing, 0, sizeof(timing));
+
+        int32_t number_of_points = input[0];
+        timing.input_points = number_of_points;
+
+        bool run_filter = m_filter.isEnabled();
+        bool run_outliers = m_outliers.isEnabled();
+        bool run_morton = m_morton.isEnabled();
+        bool run_background = m_background.isEnabled();
+        int stages_left = run_filter + run_outliers + run_morton + run_background;
+        bool output_is_input = stages_left == 0;
+
+        //!stages alternate between the work buffers and the last one writes to the output
+        m_work_points[0].resize(number_of_points);
+        m_work_points[1].resize(number_of_points);
+        const tPointPcd *current = (const tPointPcd*)&input[1];
+        int work_buffer = 0;
+        auto nextDestination = [&]() -> tPointPcd* {
+            if(--stages_left == 0){
+                return (tPointPcd*)&output[1];
+            }
+            work_buffer = 1 - work_buffer;
+            return m_work_points[work_buffer].data();
+        };
+
+        if(stages_left == 0){
+            memcpy(&output[1], current, sizeof(tPointPcd) * number_of_points);
+        }
+
+        qint64 stage_start = timer.nsecsElapsed();
+
+        if(run_filter){
+            tPointPcd *destination = nextDestination();
+            number_of_points = m_filter.apply(current, number_of_points, destination);
+            current = destination;
+            timing.filter_ms = (timer.nsecsElapsed() - stage_start) / 1000000.0;
+            stage_start = timer.nsecsElapsed();
+        }
+
+        if(run_outliers){
+            tPointPcd *destination = nextDestination();
+            //!the view filled by the receiver is only valid while the points are the ones received
+            const organizedFrame *organized = NULL;
+            if(current == (const tPointPcd*)&input[1] && m_organized_input.getNumberOfPoints() == number_of_points){
+                organized = &m_organized_input;
+            }
+            int32_t points_kept = m_outliers.apply(current, number_of_points, destination, organized);
+            timing.outliers_removed = number_of_points - points_kept;
+            number_of_points = points_kept;
+            current = destination;
+            timing.outliers_ms = (timer.nsecsElapsed() - stage_start) / 1000000.0;
+            stage_start = timer.nsecsElapsed();
+        }
+
+        //!after the outliers, so they still get the organized view of the received frame
+        if(run_morton){
+            tPointPcd *destination = nextDestination();
+            number_of_points = m_morton.apply(current, number_of_points, destination);
+            current = destination;
+            timing.morton_ms = (timer.nsecsElapsed() - stage_start) / 1000000.0;
+            stage_start = timer.nsecsElapsed();
+        }
+
+        int32_t foreground_points = number_of_points;
+
+        if(run_background){
+            tPointPcd *destination = nextDestination();
+            foreground_points = m_background.apply(current, number_of_points, destination);
+            current = destination;
+            timing.background_ms = (timer.nsecsElapsed() - stage_start) / 1000000.0;
+            stage_start = timer.nsecsElapsed();
+        }
+
+        //!the objects are searched in the foreground only, the static scene would merge them
+        m_clustering.apply(current, foreground_points, m_work_clusters);
+        timing.clustering_ms = (timer.nsecsElapsed() - stage_start) / 1000000.0;
+        timing.clusters = m_work_clusters.size();
+        {
+            std::lock_guard<std::mutex> lock(m_clusters_mutex);
+            m_clusters.swap(m_work_clusters);
+        }
+
+        stage_start = timer.nsecsElapsed();
+
+        //!the points are colored in place once they are all in the output
+        timing.fused_points = m_fusion.apply((tPointPcd*)&output[1], number_of_points, timestamp);
+        timing.fusion_ms = (timer.nsecsElapsed() - stage_start) / 1000000.0;
+        stage_start = timer.nsecsElapsed();
+
+        if(m_normals.isEnabled()){
+            //!the view filled by the receiver is reused when the points are still the ones received
+            const organizedFrame *organized = &m_organized_input;
+            if(!output_is_input || m_organized_input.getNumberOfPoints() != number_of_points){
+                m_organized_output.build((tPointPcd*)&output[1], number_of_points);
+                organized = &m_organized_output;
+            }
+            m_normals.apply((const tPointPcd*)&output[1], number_of_points, *organized);
+            timing.normals_ms = (timer.nsecsElapsed() - stage_start) / 1000000.0;
+        }
+
+        output[0] = number_of_points;
+
+        timing.output_points = number_of_points;
+        timing.foreground_points = foreground_points;
+        timing.total_ms = timer.nsecsElapsed() / 1000000.0;
+        {
+            std::lock_guard<std::mutex> lock(m_timing_mutex);
+            m_timing = timing;
+        }
+
+        return foreground_points;
+
+    }catch(...){
+        qDebug()<<"Unhandled error at pointCloudPipeline::process";
+        memcpy(output, input, sizeof(int32_t) * ((input[0] * 5) + 1));
+    }
+    return output[0];
+}
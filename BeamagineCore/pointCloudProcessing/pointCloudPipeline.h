@@ -0,0 +1,154 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef POINTCLOUDPIPELINE_H
+#define POINTCLOUDPIPELINE_H
+
+#include <stdint.h>
+
+#include <beam_aux.h>
+
+#include <mutex>
+#include <vector>
+
+#include "pointCloudFilter.h"
+#include "outlierFilter.h"
+#include "backgroundModel.h"
+#include "euclideanClustering.h"
+#include "organizedFrame.h"
+#include "cameraFusion.h"
+#include "normalEstimation.h"
+#include "mortonOrder.h"
+
+typedef struct pointCloudPipelineTiming{
+    double filter_ms;
+    double outliers_ms;
+    double morton_ms;
+    double background_ms;
+    double clustering_ms;
+    double fusion_ms;
+    double normals_ms;
+    double total_ms;
+    int32_t input_points;
+    int32_t outliers_removed;
+    int32_t output_points;
+    int32_t foreground_points;
+    int32_t clusters;
+    int32_t fused_points;
+}pointCloudPipelineTiming;
+
+//! @brief  Host processing applied to every point cloud right after it is assembled,
+//!         so the viewer, the save path and any analysis only get the points kept.
+//!         Stages run in order: region of interest filter, outlier removal, Morton
+//!         reordering and background subtraction. The points kept, or only the foreground ones when
+//!         the background is subtracted, are then grouped in objects. Last, the
+//!         points kept can be colored with a camera frame and their normals estimated, the
+//!         viewers show a copy shaded with them.
+class pointCloudPipeline
+{
+public:
+    pointCloudPipeline();
+
+    //! @brief  Returns the region of interest filter
+    pointCloudFilter *getFilter();
+
+    //! @brief  Returns the statistical outlier removal stage
+    outlierFilter *getOutlierFilter();
+
+    //! @brief  Returns the background subtraction stage
+    backgroundModel *getBackgroundModel();
+
+    //! @brief  Returns the Morton reordering stage
+    mortonOrder *getMortonOrder();
+
+    //! @brief  Returns the organized view of the next frame to process. The receiver fills it
+    //!         while the frame arrives, stages that use it then run on the input as received.
+    organizedFrame *getOrganizedInput();
+
+    //! @brief  Returns true if an enabled stage uses the organized view of the frame
+    bool usesOrganizedFrame();
+
+    //! @brief  Returns the object clustering stage
+    euclideanClustering *getClustering();
+
+    //! @brief  Returns the camera fusion stage
+    cameraFusion *getCameraFusion();
+
+    //! @brief  Returns the normal estimation and shading stage
+    normalEstimation *getNormalEstimation();
+
+    //! @brief  Copies the last frame processed with its points shaded by their normals, for
+    //!         the viewers. The frame itself keeps the colors of the device, so the recordings
+    //!         do not depend on the shading. Call it from the thread that runs process.
+    //! @param  frame Last frame returned by process
+    //! @param  shaded Output frame in the same layout, it can hold the frame
+    //! @return false if the normals of the frame were not estimated
+    bool shadeLastFrame(const int32_t *frame, int32_t *shaded);
+
+    //! @brief  Returns the objects found in the last frame processed
+    std::vector<pointCloudCluster> getLastClusters();
+
+    //! @brief  Returns the time spent in every stage and the points left by the last frame processed
+    pointCloudPipelineTiming getLastTiming();
+
+    //! @brief  Runs the enabled stages on a frame
+    //! @param  input Frame as assembled, the first value is the number of points
+    //! @param  output Processed frame in the same layout, it can hold the input frame
+    //! @param  timestamp Device timestamp of the frame (hhmmssmmm)
+    //! @return number of foreground points, they are placed before the background ones
+    int32_t process(const int32_t *input, int32_t *output, uint32_t timestamp);
+
+private:
+
+    pointCloudFilter m_filter;
+
+    outlierFilter m_outliers;
+
+    backgroundModel m_background;
+
+    mortonOrder m_morton;
+
+    euclideanClustering m_clustering;
+
+    cameraFusion m_fusion;
+
+    normalEstimation m_normals;
+
+    std::vector<tPointPcd> m_work_points[2];
+
+    organizedFrame m_organized_input;
+    organizedFrame m_organized_output;
+
+    std::mutex m_timing_mutex;
+    pointCloudPipelineTiming m_timing;
+
+    std::mutex m_clusters_mutex;
+    std::vector<pointCloudCluster> m_clusters;
+    std::vector<pointCloudCluster> m_work_clusters;
+};
+
+#endif // POINTCLOUDPIPELINE_H
@@ -0,0 +1,79 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pointPartition.h"
+
+#include <algorithm>
+
+#include <beam_parallel.h>
+
+//! Points per chunk of the parallel loops
+static const int32_t partition_chunk = 8192;
+
+int32_t partitionPoints(const tPointPcd *input, int32_t number_of_points, const std::vector<uint8_t> &flags, tPointPcd *output, bool copy_rest)
+{
+    size_t number_of_chunks = (number_of_points + partition_chunk - 1) / partition_chunk;
+    std::vector<int32_t> chunk_offsets(number_of_chunks + 1, 0);
+
+    //!first pass counts the flagged points per chunk
+    beamParallelFor(number_of_chunks, 1, [&](size_t first_chunk, size_t last_chunk){
+        for(size_t chunk = first_chunk; chunk < last_chunk; ++chunk){
+            int32_t begin = chunk * partition_chunk;
+            int32_t end = std::min(begin + partition_chunk, number_of_points);
+            int32_t flagged = 0;
+            for(int32_t i = begin; i < end; ++i){
+                flagged += flags[i] != 0;
+            }
+            chunk_offsets[chunk + 1] = flagged;
+        }
+    });
+
+    for(size_t chunk = 0; chunk < number_of_chunks; ++chunk){
+        chunk_offsets[chunk + 1] += chunk_offsets[chunk];
+    }
+    int32_t number_of_flagged = chunk_offsets[number_of_chunks];
+
+    //!second pass copies every chunk to its offset
+    beamParallelFor(number_of_chunks, 1, [&](size_t first_chunk, size_t last_chunk){
+        for(size_t chunk = first_chunk; chunk < last_chunk; ++chunk){
+            int32_t begin = chunk * partition_chunk;
+            int32_t end = std::min(begin + partition_chunk, number_of_points);
+            int32_t flagged_position = chunk_offsets[chunk];
+            int32_t rest_position = number_of_flagged + (begin - chunk_offsets[chunk]);
+
+            for(int32_t i = begin; i < end; ++i){
+                if(flags[i]){
+                    output[flagged_position++] = input[i];
+                }else if(copy_rest){
+                    output[rest_position++] = input[i];
+                }
+            }
+        }
+    });
+
+    return number_of_flagged;
+}
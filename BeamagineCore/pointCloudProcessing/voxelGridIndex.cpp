@@ -0,0 +1,407 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "voxelGridIndex.h"
+
+#include <algorithm>
+
+//! Cells are packed in 21 bits per axis
+static const int64_t cell_offset = 1 << 20;
+static const uint64_t cell_mask = (1 << 21) - 1;
+
+//! Points per occupied cell aimed at when the cell size is computed
+static const float target_points_per_cell = 8;
+
+voxelGridIndex::voxelGridIndex()
+{
+    m_cell_size = 1.0;
+}
+
+void voxelGridIndex::clear()
+{
+    m_positions.clear();
+    m_indices.clear();
+    m_sorted_position.clear();
+    m_cells.clear();
+    m_cell_keys.clear();
+    m_cell_ranges.clear();
+    m_cell_mask = 0;
+}
+
+bool voxelGridIndex::empty() const
+{
+    return m_indices.empty();
+}
+
+float voxelGridIndex::getCellSize() const
+{
+    return m_cell_size;
+}
+
+size_t voxelGridIndex::getNumberOfCells() const
+{
+    return m_cells.size();
+}
+
+void voxelGridIndex::getCellByPosition(size_t cell, uint64_t &key, uint32_t &first, uint32_t &count) const
+{
+    key = m_cells[cell].key;
+    first = m_cells[cell].first;
+    count = m_cells[cell].count;
+}
+
+uint64_t voxelGridIndex::packCellKey(int64_t cx, int64_t cy, int64_t cz)
+{
+    return (((uint64_t)(cx + cell_offset) & cell_mask) << 42) |
+           (((uint64_t)(cy + cell_offset) & cell_mask) << 21) |
+           ((uint64_t)(cz + cell_offset) & cell_mask);
+}
+
+uint64_t voxelGridIndex::hashCellKey(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+void voxelGridIndex::selectNearest(float *values, size_t number_of_values, int k, std::vector<float> &distances)
+{
+    if(number_of_values > (size_t)k){
+        std::nth_element(values, values + k - 1, values + number_of_values);
+        number_of_values = k;
+    }
+    std::sort(values, values + number_of_values);
+    distances.assign(values, values + number_of_values);
+}
+
+void voxelGridIndex::unpackCellKey(uint64_t key, int64_t &cx, int64_t &cy, int64_t &cz)
+{
+    cx = (int64_t)((key >> 42) & cell_mask) - cell_offset;
+    cy = (int64_t)((key >> 21) & cell_mask) - cell_offset;
+    cz = (int64_t)(key & cell_mask) - cell_offset;
+}
+
+uint64_t voxelGridIndex::getCellKey(float x, float y, float z) const
+{
+    return packCellKey((int64_t)std::floor(x / m_cell_size), (int64_t)std::floor(y / m_cell_size), (int64_t)std::floor(z / m_cell_size));
+}
+
+bool voxelGridIndex::getCell(uint64_t key, uint32_t &first, uint32_t &count) const
+{
+    if(m_cell_keys.empty()){
+        return false;
+    }
+    //!keys are stored plus one so 0 marks the empty slots
+    uint64_t stored_key = key + 1;
+    uint64_t slot = hashCellKey(stored_key) & m_cell_mask;
+    while(m_cell_keys[slot] != 0){
+        if(m_cell_keys[slot] == stored_key){
+            first = (uint32_t)(m_cell_ranges[slot] >> 32);
+            count = (uint32_t)(m_cell_ranges[slot] & 0xFFFFFFFF);
+            return true;
+        }
+        slot = (slot + 1) & m_cell_mask;
+    }
+    return false;
+}
+
+const std::vector<int> &voxelGridIndex::getSortedIndices() const
+{
+    return m_indices;
+}
+
+const std::vector<float> &voxelGridIndex::getSortedPositions() const
+{
+    return m_positions;
+}
+
+int voxelGridIndex::getSortedPosition(int index) const
+{
+    if(index < 0 || index >= (int)m_sorted_position.size()){
+        return -1;
+    }
+    return m_sorted_position[index];
+}
+
+size_t voxelGridIndex::countOccupiedCells(float cell_size) const
+{
+    size_t number_of_points = m_indices.size();
+
+    size_t capacity = 1024;
+    while(capacity < number_of_points * 2){
+        capacity *= 2;
+    }
+    std::vector<uint64_t> keys(capacity, 0);
+    uint64_t mask = capacity - 1;
+    size_t occupied = 0;
+
+    for(size_t i = 0; i < number_of_points; ++i){
+        uint64_t key = packCellKey((int64_t)std::floor(m_positions[i*3] / cell_size),
+                                   (int64_t)std::floor(m_positions[i*3+1] / cell_size),
+                                   (int64_t)std::floor(m_positions[i*3+2] / cell_size)) + 1;
+        uint64_t slot = hashCellKey(key) & mask;
+        while(keys[slot] != 0 && keys[slot] != key){
+            slot = (slot + 1) & mask;
+        }
+        if(keys[slot] == 0){
+            keys[slot] = key;
+            ++occupied;
+        }
+    }
+    return occupied;
+}
+
+float voxelGridIndex::computeCellSize(float extent) const
+{
+    size_t number_of_points = m_indices.size();
+
+    //!first guess spreads the points on a surface as large as the extent, then the size is
+    //!corrected with the cells actually occupied assuming the points lie on surfaces
+    float cell_size = std::max(extent * std::sqrt(target_points_per_cell / (float)number_of_points), 1.0f);
+
+    for(int iteration = 0; iteration < 2; ++iteration){
+        size_t occupied = countOccupiedCells(cell_size);
+        float points_per_cell = (float)number_of_points / (float)std::max(occupied, (size_t)1);
+        if(points_per_cell < target_points_per_cell * 2){
+            break;
+        }
+        cell_size = std::max(cell_size * std::sqrt(target_points_per_cell / points_per_cell), 1.0f);
+    }
+    return cell_size;
+}
+
+void voxelGridIndex::buildFromPositions()
+{
+    size_t number_of_points = m_indices.size();
+
+    std::vector<std::pair<uint64_t, uint32_t> > keys(number_of_points);
+    for(size_t i = 0; i < number_of_points; ++i){
+        keys[i].first = getCellKey(m_positions[i*3], m_positions[i*3+1], m_positions[i*3+2]);
+        keys[i].second = (uint32_t)i;
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<float> positions(number_of_points * 3);
+    std::vector<int> indices(number_of_points);
+
+    m_cells.clear();
+
+    uint32_t first = 0;
+    for(size_t i = 0; i < number_of_points; ++i){
+        uint32_t source = keys[i].second;
+        positions[i*3] = m_positions[source*3];
+        positions[i*3+1] = m_positions[source*3+1];
+        positions[i*3+2] = m_positions[source*3+2];
+        indices[i] = m_indices[source];
+        m_sorted_position[indices[i]] = (int)i;
+
+        if(i + 1 == number_of_points || keys[i+1].first != keys[i].first){
+            uint32_t count = (uint32_t)i + 1 - first;
+            gridCell cell;
+            cell.key = keys[i].first;
+            cell.first = first;
+            cell.count = count;
+            m_cells.push_back(cell);
+            first = (uint32_t)i + 1;
+        }
+    }
+
+    m_positions.swap(positions);
+    m_indices.swap(indices);
+
+    //!open addressing table kept under half full, lookups are the hot path of the searches
+    size_t capacity = 1024;
+    while(capacity < m_cells.size() * 2){
+        capacity *= 2;
+    }
+    m_cell_keys.assign(capacity, 0);
+    m_cell_ranges.assign(capacity, 0);
+    m_cell_mask = capacity - 1;
+
+    for(size_t i = 0; i < m_cells.size(); ++i){
+        uint64_t stored_key = m_cells[i].key + 1;
+        uint64_t slot = hashCellKey(stored_key) & m_cell_mask;
+        while(m_cell_keys[slot] != 0){
+            slot = (slot + 1) & m_cell_mask;
+        }
+        m_cell_keys[slot] = stored_key;
+        m_cell_ranges[slot] = ((uint64_t)m_cells[i].first << 32) | m_cells[i].count;
+    }
+}
+
+void voxelGridIndex::searchCell(int64_t cx, int64_t cy, int64_t cz, float x, float y, float z, int skip, float &best_distance, int &best_index) const
+{
+    uint32_t first, count;
+    if(!getCell(packCellKey(cx, cy, cz), first, count)){
+        return;
+    }
+
+    for(uint32_t i = first; i < first + count; ++i){
+        if((int)i == skip){
+            continue;
+        }
+        float dx = m_positions[i*3] - x;
+        float dy = m_positions[i*3+1] - y;
+        float dz = m_positions[i*3+2] - z;
+        float distance = dx*dx + dy*dy + dz*dz;
+        if(distance < best_distance){
+            best_distance = distance;
+            best_index = (int)i;
+        }
+    }
+}
+
+void voxelGridIndex::searchCellK(int64_t cx, int64_t cy, int64_t cz, float x, float y, float z, int skip, int k, float max_distance, std::vector<float> &distances) const
+{
+    uint32_t first, count;
+    if(!getCell(packCellKey(cx, cy, cz), first, count)){
+        return;
+    }
+
+    //!distances is a max heap with the k best squared distances
+    for(uint32_t i = first; i < first + count; ++i){
+        if((int)i == skip){
+            continue;
+        }
+        float dx = m_positions[i*3] - x;
+        float dy = m_positions[i*3+1] - y;
+        float dz = m_positions[i*3+2] - z;
+        float distance = dx*dx + dy*dy + dz*dz;
+        if(distance > max_distance){
+            continue;
+        }
+        if((int)distances.size() < k){
+            distances.push_back(distance);
+            std::push_heap(distances.begin(), distances.end());
+        }else if(distance < distances.front()){
+            std::pop_heap(distances.begin(), distances.end());
+            distances.back() = distance;
+            std::push_heap(distances.begin(), distances.end());
+        }
+    }
+}
+
+template <typename F>
+void voxelGridIndex::forEachShellCell(int64_t cx, int64_t cy, int64_t cz, int64_t shell, F visit) const
+{
+    for(int64_t dx = -shell; dx <= shell; ++dx){
+        for(int64_t dy = -shell; dy <= shell; ++dy){
+            bool on_face = (dx == -shell || dx == shell || dy == -shell || dy == shell);
+            if(on_face){
+                for(int64_t dz = -shell; dz <= shell; ++dz){
+                    visit(cx+dx, cy+dy, cz+dz);
+                }
+            }else{
+                visit(cx+dx, cy+dy, cz-shell);
+                if(shell > 0){
+                    visit(cx+dx, cy+dy, cz+shell);
+                }
+            }
+        }
+    }
+}
+
+int voxelGridIndex::nearest(float x, float y, float z, float max_distance, float *distance) const
+{
+    if(m_indices.empty()){
+        return -1;
+    }
+
+    int64_t cx = (int64_t)std::floor(x / m_cell_size);
+    int64_t cy = (int64_t)std::floor(y / m_cell_size);
+    int64_t cz = (int64_t)std::floor(z / m_cell_size);
+
+    int64_t max_shell = (int64_t)std::ceil(max_distance / m_cell_size);
+
+    float best_distance = max_distance * max_distance;
+    int best_index = -1;
+
+    //!visit the cells in shells of growing radius until no closer point can exist
+    for(int64_t shell = 0; shell <= max_shell; ++shell){
+
+        if(best_index >= 0){
+            float shell_distance = (shell - 1) * m_cell_size;
+            if(shell_distance > 0 && shell_distance * shell_distance >= best_distance){
+                break;
+            }
+        }
+
+        forEachShellCell(cx, cy, cz, shell, [&](int64_t vx, int64_t vy, int64_t vz){
+            searchCell(vx, vy, vz, x, y, z, -1, best_distance, best_index);
+        });
+    }
+
+    if(best_index < 0){
+        return -1;
+    }
+
+    if(distance != NULL){
+        *distance = std::sqrt(best_distance);
+    }
+    return m_indices[best_index];
+}
+
+int voxelGridIndex::nearestK(int query, int k, float max_distance, std::vector<float> &distances) const
+{
+    distances.clear();
+
+    int position = getSortedPosition(query);
+    if(position < 0 || k <= 0){
+        return 0;
+    }
+
+    float x = m_positions[position*3];
+    float y = m_positions[position*3+1];
+    float z = m_positions[position*3+2];
+
+    int64_t cx = (int64_t)std::floor(x / m_cell_size);
+    int64_t cy = (int64_t)std::floor(y / m_cell_size);
+    int64_t cz = (int64_t)std::floor(z / m_cell_size);
+
+    int64_t max_shell = (int64_t)std::ceil(max_distance / m_cell_size);
+    float max_distance_sqr = max_distance * max_distance;
+
+    //!dense regions are solved in the first shells, only sparse ones go up to the radius
+    for(int64_t shell = 0; shell <= max_shell; ++shell){
+
+        if((int)distances.size() == k){
+            float shell_distance = (shell - 1) * m_cell_size;
+            if(shell_distance > 0 && shell_distance * shell_distance >= distances.front()){
+                break;
+            }
+        }
+
+        forEachShellCell(cx, cy, cz, shell, [&](int64_t vx, int64_t vy, int64_t vz){
+            searchCellK(vx, vy, vz, x, y, z, position, k, max_distance_sqr, distances);
+        });
+    }
+
+    std::sort_heap(distances.begin(), distances.end());
+    return (int)distances.size();
+}
@@ -0,0 +1,297 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef VOXELGRIDINDEX_H
+#define VOXELGRIDINDEX_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//! @brief  Uniform grid spatial index. Points are bucketed by cell and stored
+//!         sorted by cell so neighbourhood queries only touch a few contiguous
+//!         ranges. Any point type with x, y and z members can be indexed.
+class voxelGridIndex
+{
+public:
+    voxelGridIndex();
+
+    //! @brief  Builds the index, invalid (NaN) points are skipped
+    //! @param  points Points to index
+    //! @param  number_of_points Number of points
+    //! @param  cell_size Edge of the cells, 0 to compute it from the point density
+    //! @return none
+    template <typename PointT>
+    void build(const PointT *points, size_t number_of_points, float cell_size = 0);
+
+    //! @brief  Removes the indexed points
+    void clear();
+
+    //! @brief  Returns true if there are no points indexed
+    bool empty() const;
+
+    //! @brief  Returns the edge of the cells
+    float getCellSize() const;
+
+    //! @brief  Finds the nearest indexed point
+    //! @param  x, y, z Query coordinates
+    //! @param  max_distance Search radius
+    //! @param  distance Returns the distance to the point found
+    //! @return index of the point in the input array, -1 if there is none in the radius
+    int nearest(float x, float y, float z, float max_distance, float *distance = NULL) const;
+
+    //! @brief  Finds the k nearest indexed points in a radius, the query point itself is skipped
+    //! @param  query Index of the query point in the input array
+    //! @param  k Number of neighbours
+    //! @param  max_distance Search radius
+    //! @param  distances Returns the squared distances of the neighbours found, sorted
+    //! @return number of neighbours found
+    int nearestK(int query, int k, float max_distance, std::vector<float> &distances) const;
+
+    //! @brief  Returns the number of cells with points
+    size_t getNumberOfCells() const;
+
+    //! @brief  Returns a cell by its position in the list of cells with points
+    //! @param  cell Position of the cell, from 0 to getNumberOfCells() - 1
+    //! @param  key Returns the cell key
+    //! @param  first Returns the first position of its points in the sorted arrays
+    //! @param  count Returns the number of points of the cell
+    //! @return none
+    void getCellByPosition(size_t cell, uint64_t &key, uint32_t &first, uint32_t &count) const;
+
+    //! @brief  Finds the k nearest neighbours of every point of a range of cells. The
+    //!         candidates of the 27 cells around a cell are gathered once for all its points.
+    //! @param  first_cell First cell of the range
+    //! @param  last_cell Cell after the last one of the range
+    //! @param  k Number of neighbours
+    //! @param  max_distance Search radius
+    //! @param  callback Called with the input index of every point, its sorted squared
+    //!         neighbour distances and the number of neighbours found
+    //! @return none
+    template <typename F>
+    void forEachNearestK(size_t first_cell, size_t last_cell, int k, float max_distance, F callback) const;
+
+    //! @brief  Returns the key of the cell that contains the given coordinates
+    uint64_t getCellKey(float x, float y, float z) const;
+
+    //! @brief  Returns the range of sorted points that belong to a cell
+    //! @param  key Cell key
+    //! @param  first Returns the first position in the sorted arrays
+    //! @param  count Returns the number of points of the cell
+    //! @return true if the cell has points
+    bool getCell(uint64_t key, uint32_t &first, uint32_t &count) const;
+
+    //! @brief  Returns the input indices sorted by cell
+    const std::vector<int> &getSortedIndices() const;
+
+    //! @brief  Returns the coordinates sorted by cell (x, y, z interleaved)
+    const std::vector<float> &getSortedPositions() const;
+
+    //! @brief  Returns the position of an input point in the sorted arrays
+    int getSortedPosition(int index) const;
+
+    static uint64_t packCellKey(int64_t cx, int64_t cy, int64_t cz);
+
+    static void unpackCellKey(uint64_t key, int64_t &cx, int64_t &cy, int64_t &cz);
+
+private:
+
+    typedef struct gridCell{
+        uint64_t key;
+        uint32_t first;
+        uint32_t count;
+    }gridCell;
+
+    static uint64_t hashCellKey(uint64_t key);
+
+    //! @brief  Returns in distances the k smallest values sorted, values is reordered
+    static void selectNearest(float *values, size_t number_of_values, int k, std::vector<float> &distances);
+
+    void buildFromPositions();
+
+    float computeCellSize(float extent) const;
+
+    size_t countOccupiedCells(float cell_size) const;
+
+    void searchCell(int64_t cx, int64_t cy, int64_t cz, float x, float y, float z, int skip, float &best_distance, int &best_index) const;
+
+    void searchCellK(int64_t cx, int64_t cy, int64_t cz, float x, float y, float z, int skip, int k, float max_distance, std::vector<float> &distances) const;
+
+    //! @brief  Calls visit with the cells at Chebyshev distance shell of the given cell
+    template <typename F>
+    void forEachShellCell(int64_t cx, int64_t cy, int64_t cz, int64_t shell, F visit) const;
+
+private:
+
+    std::vector<float> m_positions;
+    std::vector<int> m_indices;
+    std::vector<int> m_sorted_position;
+
+    std::vector<gridCell> m_cells;
+
+    std::vector<uint64_t> m_cell_keys;
+    std::vector<uint64_t> m_cell_ranges;
+    uint64_t m_cell_mask;
+
+    float m_cell_size;
+};
+
+template <typename PointT>
+void voxelGridIndex::build(const PointT *points, size_t number_of_points, float cell_size)
+{
+    clear();
+
+    m_positions.reserve(number_of_points * 3);
+    m_indices.reserve(number_of_points);
+
+    float min_x = INFINITY, min_y = INFINITY, min_z = INFINITY;
+    float max_x = -INFINITY, max_y = -INFINITY, max_z = -INFINITY;
+
+    for(size_t i = 0; i < number_of_points; ++i){
+        float x = points[i].x;
+        float y = points[i].y;
+        float z = points[i].z;
+        if(!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)){
+            continue;
+        }
+        m_positions.push_back(x);
+        m_positions.push_back(y);
+        m_positions.push_back(z);
+        m_indices.push_back((int)i);
+
+        min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+        min_z = std::min(min_z, z); max_z = std::max(max_z, z);
+    }
+
+    if(m_indices.empty()){
+        return;
+    }
+
+    if(cell_size <= 0){
+        float extent = std::max(max_x - min_x, std::max(max_y - min_y, max_z - min_z));
+        cell_size = computeCellSize(extent);
+    }
+    m_cell_size = std::max(cell_size, 1.0f);
+
+    m_sorted_position.assign(number_of_points, -1);
+
+    buildFromPositions();
+}
+
+template <typename F>
+void voxelGridIndex::forEachNearestK(size_t first_cell, size_t last_cell, int k, float max_distance, F callback) const
+{
+    //!candidates are gathered in separate coordinate arrays so the distances vectorize
+    std::vector<float> candidates_x, candidates_y, candidates_z, survivors;
+    std::vector<float> distances;
+    float max_distance_sqr = max_distance * max_distance;
+
+    //!neighbours closer than this are always inside the 27 cells around the point
+    float safe_distance = std::min(m_cell_size, max_distance);
+    float safe_distance_sqr = safe_distance * safe_distance;
+
+    for(size_t cell = first_cell; cell < last_cell; ++cell){
+        int64_t cx, cy, cz;
+        unpackCellKey(m_cells[cell].key, cx, cy, cz);
+
+        candidates_x.clear();
+        candidates_y.clear();
+        candidates_z.clear();
+        size_t own_offset = 0;
+        for(int64_t dx = -1; dx <= 1; ++dx){
+            for(int64_t dy = -1; dy <= 1; ++dy){
+                for(int64_t dz = -1; dz <= 1; ++dz){
+                    uint32_t first, count;
+                    if(dx == 0 && dy == 0 && dz == 0){
+                        own_offset = candidates_x.size();
+                    }
+                    if(getCell(packCellKey(cx+dx, cy+dy, cz+dz), first, count)){
+                        for(uint32_t c = first; c < first + count; ++c){
+                            candidates_x.push_back(m_positions[c*3]);
+                            candidates_y.push_back(m_positions[c*3+1]);
+                            candidates_z.push_back(m_positions[c*3+2]);
+                        }
+                    }
+                }
+            }
+        }
+        size_t number_of_candidates = candidates_x.size();
+        survivors.resize(number_of_candidates + 1);
+        float previous_kth = 0;
+        const float *xs = candidates_x.data();
+        const float *ys = candidates_y.data();
+        const float *zs = candidates_z.data();
+
+        for(uint32_t i = m_cells[cell].first; i < m_cells[cell].first + m_cells[cell].count; ++i){
+            float x = m_positions[i*3];
+            float y = m_positions[i*3+1];
+            float z = m_positions[i*3+2];
+
+            //!the query point itself is skipped by its position among the candidates
+            size_t self = own_offset + (i - m_cells[cell].first);
+
+            //!points of a cell have similar density, the bound from the previous point leaves few
+            //!candidates that are compacted without branches, it is widened if it was too tight
+            float bound = previous_kth > 0 ? std::min(previous_kth * 2.25f, max_distance_sqr) : max_distance_sqr;
+            size_t number_of_survivors = 0;
+            for(size_t c = 0; c < number_of_candidates; ++c){
+                float ex = xs[c] - x;
+                float ey = ys[c] - y;
+                float ez = zs[c] - z;
+                float distance = ex*ex + ey*ey + ez*ez;
+                survivors[number_of_survivors] = distance;
+                number_of_survivors += (distance <= bound) & (c != self);
+            }
+
+            if((int)number_of_survivors < k && bound < max_distance_sqr){
+                number_of_survivors = 0;
+                for(size_t c = 0; c < number_of_candidates; ++c){
+                    float ex = xs[c] - x;
+                    float ey = ys[c] - y;
+                    float ez = zs[c] - z;
+                    float distance = ex*ex + ey*ey + ez*ez;
+                    survivors[number_of_survivors] = distance;
+                    number_of_survivors += (distance <= max_distance_sqr) & (c != self);
+                }
+            }
+
+            selectNearest(survivors.data(), number_of_survivors, k, distances);
+            previous_kth = (int)distances.size() == k ? distances.back() : 0;
+
+            //!sparse points may have closer neighbours out of the 27 cells, they use the shell search
+            if((int)distances.size() < k || distances.back() > safe_distance_sqr){
+                nearestK(m_indices[i], k, max_distance, distances);
+            }
+
+            callback(m_indices[i], distances, (int)distances.size());
+        }
+    }
+}
+
+#endif // VOXELGRIDINDEX_H
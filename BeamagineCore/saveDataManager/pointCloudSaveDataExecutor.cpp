@@ -1,13 +1,14 @@
 #include "pointCloudSaveDataExecutor.h"
 
 #include "fstream"
+#include <algorithm>
 
 pointCloudSaveDataExecutor::pointCloudSaveDataExecutor(QObject *parent) : QObject(parent)
 {
     m_path_to_save_pcd = QDir::homePath() + "/LiDAR/";
-    m_is_available = true;
-
-    m_event_handlers.clear();
+    m_save_data_manager = NULL;
+    m_number_of_workers = 1;
+    m_compressed = false;
 
     m_controller_thread = new QThread();
     m_controller_thread->setObjectName("PointCloudSaveDataExecutor");
@@ -32,183 +33,126 @@ void pointCloudSaveDataExecutor::stopController()
 {
     try{
         if(m_controller_thread->isRunning()){
-            m_controller_thread->exit(0);
+            //!run() returns once the queue is closed and empty, the thread does not start its event loop afterwards
+            m_controller_thread->quit();
+            m_controller_thread->wait();
         }
-        m_event_handlers.clear();
 
     }catch(...){
         qDebug()<<"Unhandled error at pointCloudSaveDataExecutor::stopController";
     }
 }
 
-void pointCloudSaveDataExecutor::setEventHandler(const QEvent::Type type, const QObject *event_handler)
-{
-    m_event_handlers.insert(type, event_handler);
-
-}
-
 void pointCloudSaveDataExecutor::setPathToSavePcd(const QString &path)
 {
+    std::lock_guard<std::mutex> lock(m_path_mutex);
     m_path_to_save_pcd = path;
 }
 
-void pointCloudSaveDataExecutor::doSaveBinaryData(int32_t *pointcloud_buffer, QString file_name){
-    m_is_available = false;
-
-    int buff_size = ((pointcloud_buffer[0] * 5) + 1) * sizeof(int32_t);
-    int32_t *tmp_buff = (int32_t*)malloc(buff_size);
-
-    memcpy(tmp_buff, pointcloud_buffer, buff_size);
-
-    pointCloudSaveDataExecutorSaveBinaryBufferDataRequest *request = new pointCloudSaveDataExecutorSaveBinaryBufferDataRequest(tmp_buff, file_name);
-
-    QCoreApplication::postEvent(this, request);
-    free(tmp_buff);
-}
-
-void pointCloudSaveDataExecutor::doSaveBinaryData(tPointCloudUdp *pointcloud, QString file_name){
-
-    m_is_available = false;
-
-    int size_to_copy = sizeof(int32_t)*pointcloud->size;
-
-    tPointCloudUdp *point_cloud_to_save = (tPointCloudUdp*)malloc(sizeof(tPointCloudUdp));
-    point_cloud_to_save->size = pointcloud->size;
-    point_cloud_to_save->data_buffer = (int32_t*)malloc(size_to_copy);
-
-    memcpy(point_cloud_to_save->data_buffer, pointcloud->data_buffer, size_to_copy);
-
-    pointCloudSaveDataExecutorSaveBinaryDataRequest *request = new pointCloudSaveDataExecutorSaveBinaryDataRequest(point_cloud_to_save, file_name);
-
-    QCoreApplication::postEvent(this, request);
-
-    free(point_cloud_to_save->data_buffer);
-    free(point_cloud_to_save);
-}
-
-
-void pointCloudSaveDataExecutor::customEvent(QEvent *event)
+QString pointCloudSaveDataExecutor::getPathToSavePcd()
 {
-
-    //----Pointcloud data
-    if(pointCloudSaveDataExecutorSaveBinaryDataRequest *p_event = dynamic_cast<pointCloudSaveDataExecutorSaveBinaryDataRequest*>(event)){
-        onSaveBinaryDataRequest(p_event);
-    }
-    else if(pointCloudSaveDataExecutorSaveBinaryBufferDataRequest *p_event = dynamic_cast<pointCloudSaveDataExecutorSaveBinaryBufferDataRequest*>(event)){
-        onSaveBinaryDataRequest(p_event);
-    }
-
+    std::lock_guard<std::mutex> lock(m_path_mutex);
+    return m_path_to_save_pcd;
 }
 
-
-void pointCloudSaveDataExecutor::doCheckTimeout()
+void pointCloudSaveDataExecutor::setSaveDataManager(saveDataManager *manager)
 {
-    //!do nothing
+    m_save_data_manager = manager;
 }
 
-void pointCloudSaveDataExecutor::sendEvent(QEvent::Type event_type, QEvent *event)
+void pointCloudSaveDataExecutor::setNumberOfWorkers(int workers)
 {
-    QList<const QObject *> list = getEventHandlers(event_type);
-    for (int i = 0; i < list.size(); ++i){
-        QCoreApplication::postEvent((QObject*)list.at(i), event);
-    }
+    m_number_of_workers = std::max(workers, 1);
 }
 
-QList<const QObject *> pointCloudSaveDataExecutor::getEventHandlers(const QEvent::Type &event_type)
+void pointCloudSaveDataExecutor::setCompression(bool compressed)
 {
-    return m_event_handlers.values(event_type);
+    m_compressed = compressed;
 }
 
-void pointCloudSaveDataExecutor::onSaveBinaryDataRequest(pointCloudSaveDataExecutorSaveBinaryDataRequest *request)
+QString pointCloudSaveDataExecutor::saveBinaryData(const int32_t *points, int32_t number_of_points, QString file_name)
 {
-    int size_to_copy = sizeof(int32_t)*request->getDataToSave()->size;
-
-    tPointCloudUdp *point_cloud_to_save = (tPointCloudUdp*)malloc(sizeof(tPointCloudUdp));
-
-    point_cloud_to_save->size = request->getDataToSave()->size;
-    point_cloud_to_save->data_buffer = (int32_t*)malloc(size_to_copy);
+    QString full_file_name = getPathToSavePcd() + file_name + ".bin";
 
-    memcpy(point_cloud_to_save->data_buffer, request->getDataToSave()->data_buffer, size_to_copy);
+    FILE *file_handler = std::fopen(full_file_name.toStdString().c_str(), "wb");
 
-    saveBinaryData(point_cloud_to_save, request->getFileName());
-
-    free(point_cloud_to_save->data_buffer);
-    free(point_cloud_to_save);
-    request->releaseMemory();
-
-    sendSaveBinaryDataResponse();
-}
-
-void pointCloudSaveDataExecutor::onSaveBinaryDataRequest(pointCloudSaveDataExecutorSaveBinaryBufferDataRequest *request)
-{
-    int size_to_copy = (( request->getPointcloud()[0] * 5) +1 )*sizeof(int32_t);
-    int32_t *pointcloud_buffer = (int32_t*)malloc(size_to_copy);
-
-    memcpy(pointcloud_buffer, request->getPointcloud(), size_to_copy);
-
-    saveBinaryData(pointcloud_buffer, request->getFileName());
-
-    free(pointcloud_buffer);
-    request->releaseMemory();
-}
-
-void pointCloudSaveDataExecutor::saveBinaryData(tPointCloudUdp *pointcloud, QString file_name)
-{
-    int32_t data_size = pointcloud->size/5;
-
-    m_full_file_name = m_path_to_save_pcd + file_name  + ".bin";
-
-    FILE *file_handler = std::fopen(m_full_file_name.toStdString().c_str(), "wb");
-
-    //!write datasize
-    std::fwrite(&data_size, sizeof(int32_t), 1, file_handler);
-    //!write points
-    std::fwrite(pointcloud->data_buffer, (sizeof(int32_t)*pointcloud->size), 1, file_handler);
+    //!same layout as the frame, the number of points written goes first
+    std::fwrite(&number_of_points, sizeof(int32_t), 1, file_handler);
+    std::fwrite(points, number_of_points * 5 * sizeof(int32_t), 1, file_handler);
 
     std::fclose(file_handler);
 
-    m_is_available = true;
+    return full_file_name;
 }
 
-void pointCloudSaveDataExecutor::saveBinaryData(int32_t *pointcloud_buffer, QString file_name)
+QString pointCloudSaveDataExecutor::saveCompressedData(const std::vector<uint8_t> &encoded, QString file_name)
 {
-    int32_t data_size = (( pointcloud_buffer[0] * 5) +1 )*sizeof(int32_t);
+    QString full_file_name = getPathToSavePcd() + file_name + ".bpc";
 
-    m_full_file_name = m_path_to_save_pcd + file_name + ".bin";
-
-    FILE *file_handler = std::fopen(m_full_file_name.toStdString().c_str(), "wb");
+    FILE *file_handler = std::fopen(full_file_name.toStdString().c_str(), "wb");
+    if(file_handler == NULL){
+        qDebug()<<"The point cloud"<<full_file_name<<"could not be created";
+        return QString();
+    }
 
-    //!write all data
-    std::fwrite(pointcloud_buffer, data_size, 1, file_handler);
+    std::fwrite(encoded.data(), encoded.size(), 1, file_handler);
 
     std::fclose(file_handler);
 
-    m_is_available = true;
-
-}
-
-void pointCloudSaveDataExecutor::sendSaveBinaryDataResponse()
-{
-    pointCloudSaveDataExecutorSaveBinaryDataResponse *response = new pointCloudSaveDataExecutorSaveBinaryDataResponse(m_full_file_name);
-    sendEvent(response->TYPE, response);
+    return full_file_name;
 }
 
 void pointCloudSaveDataExecutor::run()
 {
-    m_available_timer = new QTimer();
-    m_available_time_ms = 10;
-    m_is_available = true;
-    connect(m_available_timer, SIGNAL(timeout()), this, SLOT(availableTimeOut()));
-    m_available_timer->start(m_available_time_ms);
-}
-
-void pointCloudSaveDataExecutor::availableTimeOut()
-{
-    m_available_timer->stop();
+    if(m_save_data_manager == NULL){
+        return;
+    }
 
-    if(m_is_available){
-        emit executorIsAvailable(m_is_available);
+    //!the workers share the queue with this thread, frames finish out of order but every
+    //!file is named after the timestamp of its frame
+    for(int i = 1; i < m_number_of_workers; ++i){
+        m_workers.push_back(std::thread(&pointCloudSaveDataExecutor::saveQueuedFrames, this));
     }
 
-    m_available_timer->start(m_available_time_ms);
+    saveQueuedFrames();
+
+    for(size_t i = 0; i < m_workers.size(); ++i){
+        m_workers[i].join();
+    }
+    m_workers.clear();
+}
+
+void pointCloudSaveDataExecutor::saveQueuedFrames()
+{
+    //!every worker codes with its own buffers
+    pointCloudCodec codec;
+    std::vector<uint8_t> encoded;
+
+    //!the next point cloud is taken as soon as the previous one is written
+    pointcloudData data;
+    while(m_save_data_manager->takePointCloud(data)){
+        try{
+            if(m_compressed){
+                codec.encode((const tPointPcd*)&data.pointcloud_buffer.get()[1], data.number_of_points, encoded);
+                if(data.session){
+                    data.session->writeRecord(data.stream_id, session_format_pointcloud_bpc, data.timestamp,
+                                              encoded.data(), encoded.size());
+                }else{
+                    saveCompressedData(encoded, QString("%1").arg(data.timestamp));
+                }
+            }else if(data.session){
+                //!the record holds the same bytes as the file of the frame
+                data.session->writeRecord(data.stream_id, session_format_pointcloud, data.timestamp,
+                                          &data.number_of_points, sizeof(int32_t),
+                                          &data.pointcloud_buffer.get()[1], data.number_of_points * 5 * sizeof(int32_t));
+            }else{
+                saveBinaryData(&data.pointcloud_buffer.get()[1], data.number_of_points, QString("%1").arg(data.timestamp));
+            }
+        }catch(...){
+            qDebug()<<"Unhandled error at pointCloudSaveDataExecutor::saveQueuedFrames";
+        }
+        //!the frame and the session are not kept while waiting for the next one
+        data.pointcloud_buffer.reset();
+        data.session.reset();
+    }
 }
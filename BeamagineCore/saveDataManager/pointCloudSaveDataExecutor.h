@@ -7,9 +7,11 @@
 
 #include <QObject>
 #include <QThread>
-#include <QMap>
-#include <QCoreApplication>
-#include <QTimer>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 
@@ -17,7 +19,9 @@
 #include <unistd.h>
 #endif
 
-#include "pointCloudSaveDataExecutorMessages.h"
+#include "pointCloudCodec.h"
+#include "saveDataManager.h"
+#include "sessionContainerWriter.h"
 
 
 class pointCloudSaveDataExecutor : public QObject
@@ -31,68 +35,69 @@ public:
     //! @return none
     void startController();
 
-    //! @brief  Stops the thread
+    //! @brief  Stops the thread once the point clouds of its queue are written. Close the queue
+    //!         first (saveDataManager::stopController), the workers are joined when it is empty.
     //! @param  none
     //! @return none
     void stopController();
 
-    void setEventHandler(const QEvent::Type type, const QObject* event_handler);
-
     //! @brief  Sets path to save pcl data
     //! @param  path Path to save pcl data
     //! @return none
     void setPathToSavePcd(const QString &path);
 
-    void doSaveBinaryData(int32_t *pointcloud_buffer, QString file_name);
-
-    void doSaveBinaryData(tPointCloudUdp *pointcloud, QString file_name);
-
-private:
-    //! @brief  Receives events to process requests
-    //! @param  event even to process
+    //! @brief  Sets the queue the thread takes the point clouds from, it waits on it from
+    //!         the start of the thread until the queue is closed. Start the queue first.
+    //! @param  manager Queue of point clouds to save
     //! @return none
-    void customEvent(QEvent *event);
-
-    void doCheckTimeout();
-
-    void sendEvent(QEvent::Type event_type, QEvent *event );
-
-    QList<const QObject *> getEventHandlers(const QEvent::Type& event_type);
+    void setSaveDataManager(saveDataManager *manager);
 
-    void onSaveBinaryDataRequest(pointCloudSaveDataExecutorSaveBinaryDataRequest *request);
-
-    void onSaveBinaryDataRequest(pointCloudSaveDataExecutorSaveBinaryBufferDataRequest *request);
-
-    void saveBinaryData(tPointCloudUdp *pointcloud, QString file_name);
+    //! @brief  Sets the number of threads that write the point clouds of the queue in parallel,
+    //!         every frame is written by the first one free. It applies when the thread starts.
+    //! @param  workers Number of threads, the executor thread included
+    //! @return none
+    void setNumberOfWorkers(int workers);
 
-    void saveBinaryData(int32_t *pointcloud_buffer, QString file_name);
+    //! @brief  Saves the point clouds coded by pointCloudCodec (.bpc files and session records)
+    //!         instead of raw. It applies from the next frame written.
+    //! @param  compressed true to compress the point clouds
+    //! @return none
+    void setCompression(bool compressed);
 
-    void sendSaveBinaryDataResponse();
+private:
+    //! @brief  Saves the first points of a frame, the frame is only read, it can run in
+    //!         several workers at once
+    //! @param  points Points of the frame, after its number of points
+    //! @param  number_of_points Points to write
+    //! @return path of the file written
+    QString saveBinaryData(const int32_t *points, int32_t number_of_points, QString file_name);
 
-signals:
+    //! @brief  Saves a frame coded by pointCloudCodec
+    //! @param  encoded Coded frame
+    //! @param  file_name Name of the file, without extension
+    //! @return path of the file written, empty if it could not be created
+    QString saveCompressedData(const std::vector<uint8_t> &encoded, QString file_name);
 
-    void executorIsAvailable(bool available);
+    //! @brief  Writes the point clouds of the queue until it is closed
+    void saveQueuedFrames();
 
+    QString getPathToSavePcd();
 
 public slots:
 
     void run();
 
-    void availableTimeOut();
-
 private:
 
     QThread *m_controller_thread;
 
-    QMultiMap <QEvent::Type, const QObject * > m_event_handlers;
-
+    std::mutex m_path_mutex;
     QString m_path_to_save_pcd;
-    QString m_full_file_name;
-
-    QTimer *m_available_timer;
-    int m_available_time_ms;
 
-    bool m_is_available;
+    saveDataManager *m_save_data_manager;
+    int m_number_of_workers;
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_compressed;
 };
 
 #endif // POINTCLOUDSAVEDATAEXECUTOR_H
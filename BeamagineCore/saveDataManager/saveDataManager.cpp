@@ -1,266 +1,327 @@
 #include "saveDataManager.h"
+#include "videoStreamWriter.h"
+
+#include <algorithm>
+
+std::mutex saveDataManager::s_queue_mutex;
+uint64_t saveDataManager::s_total_budget_bytes = 1024ull * 1024 * 1024;
+uint64_t saveDataManager::s_total_queued_bytes = 0;
+int saveDataManager::s_open_queues = 0;
+
+//! Bytes a stream can keep queued by default
+static const uint64_t default_queue_budget = 256ull * 1024 * 1024;
+
+static uint64_t frameBytes(const imageData &data)
+{
+    return (uint64_t)data.image_width * data.image_height * data.image_channels;
+}
+
+static uint64_t frameBytes(const pointcloudData &data)
+{
+    return data.pointcloud_size;
+}
+
+static uint64_t frameBytes(const binaryFloatData &data)
+{
+    return data.data_size;
+}
+
+static void releaseFrame(imageData &data)
+{
+    data.image_buffer.reset();
+    data.session.reset();
+    data.video.reset();
+}
+
+static void releaseFrame(pointcloudData &data)
+{
+    data.pointcloud_buffer.reset();
+    data.session.reset();
+}
+
+static void releaseFrame(binaryFloatData &data)
+{
+    data.data_buffer.reset();
+    data.session.reset();
+}
+
+//! @brief  Attaches the video being recorded to the images, the other frames are not encoded
+static void attachVideo(imageData &data, const std::shared_ptr<videoStreamWriter> &video)
+{
+    data.video = video;
+}
+
+template <typename T>
+static void attachVideo(T &, const std::shared_ptr<videoStreamWriter> &)
+{
+}
+
+//! @brief  Reserves the position of an image in its video, called in the order of the queue
+static void reserveVideoFrame(imageData &data)
+{
+    if(data.video){
+        data.video_frame = data.video->reserveFrame();
+    }
+}
+
+template <typename T>
+static void reserveVideoFrame(T &)
+{
+}
+
+//! @brief  Copies a buffer in a new shared one, for the producers that reuse theirs
+template <typename T>
+static std::shared_ptr<const T> copyBuffer(const T *source, size_t bytes)
+{
+    T *buffer = (T*)malloc(bytes);
+    memcpy(buffer, source, bytes);
+    return std::shared_ptr<const T>(buffer, free);
+}
 
 
 saveDataManager::saveDataManager(QObject *parent): QObject(parent)
 {
     m_path_to_save_data = QDir::homePath() + "/data/";
-    m_max_frames_to_save = 1000;
-    m_current_frame_number = 0;
-    m_is_executor_available = false;
-    m_sender_timer_time_ms = 3;
+    m_budget_bytes = default_queue_budget;
+    m_policy = drop_newest;
+    m_data_type = images;
+    m_is_closed = true;
+    m_session_stream_id = 0;
 
-    m_event_handlers.clear();
+    memset(&m_statistics, 0, sizeof(m_statistics));
 
     m_images_queue.clear();
     m_pointcloud_queue.clear();
     m_float_binary_queue.clear();
-
-    m_controller_thread = new QThread();
-    m_controller_thread->setObjectName("saveDataManager");
-
-    connect(m_controller_thread, SIGNAL(started()),this, SLOT(run()));
 }
 
 void saveDataManager::startController()
 {
-    try{
-        if(!m_controller_thread->isRunning()){
-            moveToThread(m_controller_thread);
-            m_controller_thread->start();
-        }
-    }
-    catch(...){
-        qDebug()<<"Unhandled error at saveDataManager::startController";
+    std::lock_guard<std::mutex> lock(s_queue_mutex);
+    if(m_is_closed){
+        s_open_queues++;
     }
+    m_is_closed = false;
+
+    m_statistics.high_water_frames = m_statistics.queued_frames;
+    m_statistics.high_water_bytes = m_statistics.queued_bytes;
+    m_statistics.dropped_frames = 0;
+    m_statistics.dropped_bytes = 0;
 }
 
 void saveDataManager::stopController()
 {
     try{
-        if(m_controller_thread->isRunning()){
-            m_controller_thread->exit(0);
+        {
+            std::lock_guard<std::mutex> lock(s_queue_mutex);
+            if(!m_is_closed){
+                s_open_queues--;
+            }
+            m_is_closed = true;
         }
-        m_event_handlers.clear();
+        m_queue_condition.notify_all();
 
     }catch(...){
         qDebug()<<"Unhandled error at saveDataManager::stopController";
     }
 }
 
-void saveDataManager::setEventHandler(const QEvent::Type type, const QObject *event_handler)
-{
-    m_event_handlers.insert(type, event_handler);
-
-}
-
 void saveDataManager::setPathToSaveData(const QString &path)
 {
     m_path_to_save_data = path;
 }
 
-void saveDataManager::setMaxFramesToSave(uint8_t frames)
+void saveDataManager::setQueueBudget(uint64_t bytes)
 {
-    m_max_frames_to_save = frames;
+    std::lock_guard<std::mutex> lock(s_queue_mutex);
+    m_budget_bytes = bytes;
 }
 
-void saveDataManager::doSavePointerToPng(uint8_t *image_pointer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp)
+void saveDataManager::setTotalQueueBudget(uint64_t bytes)
 {
-    int buff_size = width*height*channels;
-    uint8_t *image_buffer = (uint8_t*)malloc(buff_size);
-    memcpy(image_buffer, image_pointer, buff_size);
-
-    saveDataManagerSavePointerToPngRequest *request = new saveDataManagerSavePointerToPngRequest(image_buffer, width, height, channels, time_stamp);
-
-    QCoreApplication::postEvent(this, request);
-    free(image_buffer);
+    std::lock_guard<std::mutex> lock(s_queue_mutex);
+    s_total_budget_bytes = bytes;
 }
 
-void saveDataManager::doSavePointCloudToBin(int32_t *data_buffer, int32_t number_of_points, uint32_t time_stamp)
+void saveDataManager::setQueuePolicy(uint8_t policy)
 {
-    int buff_size = ((data_buffer[0] * 5) + 1) * sizeof(int32_t);
-    int32_t *pointcloud_buffer = (int32_t*)malloc(buff_size);
-    memcpy(pointcloud_buffer, data_buffer, buff_size);
-
-    saveDataManagerSavePointCloudToBinRequest *request = new saveDataManagerSavePointCloudToBinRequest(pointcloud_buffer, number_of_points, time_stamp);
-
-    QCoreApplication::postEvent(this, request);
-    free(pointcloud_buffer);
+    std::lock_guard<std::mutex> lock(s_queue_mutex);
+    m_policy = policy;
 }
 
-void saveDataManager::doSaveFloatDataToBin(float *data_buffer, int buffer_size, uint32_t time_stamp)
+saveQueueStatistics saveDataManager::getQueueStatistics()
 {
-    float *buffer = (float*)malloc(buffer_size);
-    memcpy(buffer, data_buffer, buffer_size);
-
-    saveDataManagerSaveFloatBufferRequest *request = new saveDataManagerSaveFloatBufferRequest(data_buffer, buffer_size, time_stamp);
+    std::lock_guard<std::mutex> lock(s_queue_mutex);
+    return m_statistics;
+}
 
-    QCoreApplication::postEvent(this, request);
-    free(buffer);
+void saveDataManager::setSessionContainer(std::shared_ptr<sessionContainerWriter> session, uint16_t stream_id)
+{
+    std::lock_guard<std::mutex> lock(s_queue_mutex);
+    m_session = session;
+    m_session_stream_id = stream_id;
 }
 
-void saveDataManager::setDataTypeToSave(uint8_t data_type)
+void saveDataManager::setVideoWriter(std::shared_ptr<videoStreamWriter> video)
 {
-    m_data_type = data_type;
+    std::lock_guard<std::mutex> lock(s_queue_mutex);
+    m_video = video;
 }
 
-void saveDataManager::setExecutorAvailable(bool available)
+void saveDataManager::doSavePointerToPng(std::shared_ptr<const uint8_t> image_buffer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp)
 {
-    m_is_executor_available = available;
+    imageData data;
+    data.image_buffer = image_buffer;
+
+    data.timestamp = time_stamp;
+    data.image_channels = channels;
+    data.image_height = height;
+    data.image_width = width;
+
+    enqueueFrame(m_images_queue, data);
 }
 
-void saveDataManager::run()
+void saveDataManager::doSavePointerToPng(const uint8_t *image_pointer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp)
 {
-    m_check_sender_timer = new QTimer();
-    connect(m_check_sender_timer, SIGNAL(timeout()), this, SLOT(checkSenderTimeout()));
-    m_check_sender_timer->start(m_sender_timer_time_ms);
+    int buff_size = width*height*channels;
+    doSavePointerToPng(copyBuffer(image_pointer, buff_size), width, height, channels, time_stamp);
 }
 
-void saveDataManager::checkSenderTimeout()
+void saveDataManager::doSavePointCloudToBin(std::shared_ptr<const int32_t> pointcloud_buffer, int32_t number_of_points, uint32_t time_stamp)
 {
-    m_check_sender_timer->stop();
+    pointcloudData data;
+    data.pointcloud_buffer = pointcloud_buffer;
 
-    if(m_current_frame_number > 0 && m_is_executor_available){
+    //!the budgets count the whole buffer, it stays in memory even if only some points are written
+    data.pointcloud_size = ((pointcloud_buffer.get()[0] * 5) + 1) * sizeof(int32_t);
+    data.number_of_points = std::min(number_of_points, pointcloud_buffer.get()[0]);
+    data.timestamp = time_stamp;
 
-        switch(m_data_type){
-        case images:
-            emit sendImageToSave(m_images_queue.dequeue());
-            --m_current_frame_number;
-            m_is_executor_available = false;
-            break;
-        case pointcloud:
-            emit sendPointCloudToSave(m_pointcloud_queue.dequeue());
-            --m_current_frame_number;
-            m_is_executor_available = false;
-            break;
-        case binaryFloat:
-            emit sendBufferToSave(m_float_binary_queue.dequeue());
-            --m_current_frame_number;
-            m_is_executor_available = false;
-            break;
-        }
-    }
+    enqueueFrame(m_pointcloud_queue, data);
+}
 
-    m_check_sender_timer->start(m_sender_timer_time_ms);
+void saveDataManager::doSavePointCloudToBin(const int32_t *data_buffer, int32_t number_of_points, uint32_t time_stamp)
+{
+    int buff_size = ((data_buffer[0] * 5) + 1) * sizeof(int32_t);
+    doSavePointCloudToBin(copyBuffer(data_buffer, buff_size), number_of_points, time_stamp);
 }
 
-void saveDataManager::customEvent(QEvent *event)
+void saveDataManager::doSaveFloatDataToBin(std::shared_ptr<const float> data_buffer, int buffer_size, uint16_t width, uint32_t time_stamp)
 {
+    binaryFloatData data;
+    data.data_buffer = data_buffer;
 
-    if(saveDataManagerSavePointerToPngRequest *p_event = dynamic_cast<saveDataManagerSavePointerToPngRequest*>(event)){
-        onSavePointerToPng(p_event);
-    }
-    else if(saveDataManagerSavePointCloudToBinRequest* p_event = dynamic_cast<saveDataManagerSavePointCloudToBinRequest*>(event)){
-        onSavePointCloudToBin(p_event);
-    }
-    else if(saveDataManagerSaveFloatBufferRequest *p_event = dynamic_cast<saveDataManagerSaveFloatBufferRequest*>(event)){
-        onSaveFloatBuffer(p_event);
-    }
+    data.data_size = buffer_size;
+    data.data_width = width;
+    data.timestamp = time_stamp;
 
+    enqueueFrame(m_float_binary_queue, data);
 }
 
-
-void saveDataManager::doCheckTimeout()
+void saveDataManager::doSaveFloatDataToBin(const float *data_buffer, int buffer_size, uint16_t width, uint32_t time_stamp)
 {
-    //!do nothing
+    doSaveFloatDataToBin(copyBuffer(data_buffer, buffer_size), buffer_size, width, time_stamp);
 }
 
-void saveDataManager::sendEvent(QEvent::Type event_type, QEvent *event)
+void saveDataManager::setDataTypeToSave(uint8_t data_type)
 {
-    QList<const QObject *> list = getEventHandlers(event_type);
-    for (int i = 0; i < list.size(); ++i){
-        QCoreApplication::postEvent((QObject*)list.at(i), event);
-    }
+    m_data_type = data_type;
 }
 
-QList<const QObject *> saveDataManager::getEventHandlers(const QEvent::Type &event_type)
+uint8_t saveDataManager::getDataTypeToSave()
 {
-    return m_event_handlers.values(event_type);
+    return m_data_type;
 }
 
-void saveDataManager::onSavePointerToPng(saveDataManagerSavePointerToPngRequest *request)
+bool saveDataManager::takeImage(imageData &data)
 {
-    savePointerToPng(request->getImagePointer(), request->getImageWidth(), request->getImageHeight(), request->getImageChannels(), request->getTimeStamp());
-
-    request->releaseMemory();
+    return takeFrame(m_images_queue, data);
 }
 
-void saveDataManager::onSavePointCloudToBin(saveDataManagerSavePointCloudToBinRequest *request)
+bool saveDataManager::takePointCloud(pointcloudData &data)
 {
-    savePointCloudToBin(request->getPointCloudBuffer(), request->getNumberPoints(), request->getTimeStamp());
-
-    request->releaseMemory();
+    return takeFrame(m_pointcloud_queue, data);
 }
 
-void saveDataManager::onSaveFloatBuffer(saveDataManagerSaveFloatBufferRequest *request)
+bool saveDataManager::takeFloatBuffer(binaryFloatData &data)
 {
-    saveFloatBuffer(request->getFloatBuffer(), request->getBufferSize(), request->getTimeStamp());
-
-    request->releaseMemory();
+    return takeFrame(m_float_binary_queue, data);
 }
 
-
-void saveDataManager::savePointCloudToBin(int32_t *data_buffer, int32_t number_of_points, uint32_t time_stamp)
+template <typename T>
+void saveDataManager::enqueueFrame(QQueue<T> &queue, T &data)
 {
-    Q_UNUSED(number_of_points)
-    if(m_current_frame_number < m_max_frames_to_save){
+    uint64_t bytes = frameBytes(data);
 
-        int size = ((data_buffer[0] * 5) + 1) * sizeof(int32_t);
-        pointcloudData data;
+    std::unique_lock<std::mutex> lock(s_queue_mutex);
 
-        data.pointcloud_buffer = (int32_t*)malloc(size);
-        memcpy(data.pointcloud_buffer, data_buffer, size);
+    //!the producer never waits here, it is the thread of a receiver or the GUI
+    while(m_policy == drop_oldest && !m_is_closed && !fitsInBudget(bytes) && !queue.isEmpty()){
+        T oldest = queue.dequeue();
+        addQueuedFrame(-1, -(int64_t)frameBytes(oldest));
+        addDroppedFrame(frameBytes(oldest));
+        releaseFrame(oldest);
+    }
 
-        data.timestamp = time_stamp;
+    if(m_is_closed || !fitsInBudget(bytes)){
+        addDroppedFrame(bytes);
+        lock.unlock();
+        qDebug()<<"Save queue full, frame dropped"<<data.timestamp;
+        releaseFrame(data);
+        return;
+    }
 
-        m_pointcloud_queue.enqueue(data);
-        m_current_frame_number++;
+    data.session = m_session;
+    data.stream_id = m_session_stream_id;
+    attachVideo(data, m_video);
+    queue.enqueue(data);
+    addQueuedFrame(1, bytes);
+    lock.unlock();
 
-    }else{
-        qDebug()<<"Point Cloud Buffer full";
+    m_queue_condition.notify_one();
+}
 
+template <typename T>
+bool saveDataManager::takeFrame(QQueue<T> &queue, T &data)
+{
+    std::unique_lock<std::mutex> lock(s_queue_mutex);
+    m_queue_condition.wait(lock, [&]{ return !queue.isEmpty() || m_is_closed; });
+    if(queue.isEmpty()){
+        return false;
     }
+    data = queue.dequeue();
+    addQueuedFrame(-1, -(int64_t)frameBytes(data));
+    //!the workers encode the images of a video in the order they take them
+    reserveVideoFrame(data);
+    return true;
 }
 
-void saveDataManager::savePointerToPng(uint8_t *image_pointer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp){
-
-    if(m_current_frame_number < m_max_frames_to_save){
-
-        int buff_size = width*height*channels;
-        imageData data;
-
-        data.image_buffer = (uint8_t*)malloc(buff_size);
-        memcpy(data.image_buffer, image_pointer, buff_size);
-
-        data.timestamp = time_stamp;
-        data.image_channels = channels;
-        data.image_height = height;
-        data.image_width = width;
-
-
-        m_images_queue.enqueue(data);
-        m_current_frame_number++;
-
-    }else{
-        qDebug()<<"Image Buffer full"<<width;
+bool saveDataManager::fitsInBudget(uint64_t bytes)
+{
+    //!one frame always fits, a frame larger than the budgets could not be saved otherwise
+    if(m_statistics.queued_frames == 0){
+        return true;
+    }
+    if(m_statistics.queued_bytes + bytes > m_budget_bytes){
+        return false;
     }
+    uint64_t share = s_total_budget_bytes / std::max(s_open_queues, 1);
+    return m_statistics.queued_bytes + bytes <= share ||
+           s_total_queued_bytes + bytes <= s_total_budget_bytes;
 }
 
-void saveDataManager::saveFloatBuffer(float *buffer, int buffer_size, uint32_t time_stamp)
+void saveDataManager::addQueuedFrame(int frames, int64_t bytes)
 {
-    if(m_current_frame_number < m_max_frames_to_save){
+    m_statistics.queued_frames += frames;
+    m_statistics.queued_bytes += bytes;
+    s_total_queued_bytes += bytes;
 
-        binaryFloatData data;
-
-        data.data_buffer = (float*)malloc(buffer_size);
-        memcpy(data.data_buffer, buffer, buffer_size);
-
-        data.data_size = buffer_size;
-        data.timestamp = time_stamp;
-
-        m_float_binary_queue.enqueue(data);
-        m_current_frame_number++;
-    }else{
-        qDebug()<<"Binary float buffer is full";
-    }
+    m_statistics.high_water_frames = std::max(m_statistics.high_water_frames, m_statistics.queued_frames);
+    m_statistics.high_water_bytes = std::max(m_statistics.high_water_bytes, m_statistics.queued_bytes);
 }
 
+void saveDataManager::addDroppedFrame(uint64_t bytes)
+{
+    m_statistics.dropped_frames++;
+    m_statistics.dropped_bytes += bytes;
+}
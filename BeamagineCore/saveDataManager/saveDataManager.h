@@ -7,12 +7,10 @@
 #include <QQueue>
 
 #include <QObject>
-#include <QThread>
-#include <QMap>
-#include <QCoreApplication>
-#include <QTimer>
 
-#include "saveDataManagerMessages.h"
+#include <mutex>
+#include <condition_variable>
+
 #include "saveDataStructs.h"
 
 #ifdef _WIN32
@@ -21,104 +19,162 @@
 #include <unistd.h>
 #endif
 
-
+//! @brief  Queue of the frames to save. The receivers add frames from their own threads and
+//!         the executors take them from theirs, an executor waits on the queue while it is
+//!         empty and takes the next frame as soon as it has written the previous one.
+//!         The frames queued are bounded in bytes by the budget of the stream and by a
+//!         budget shared by all the streams, the policy sets which frame is dropped when
+//!         one does not fit, the producers never wait. Every open stream can always use its share of the total budget,
+//!         so a stream of large frames can not starve the others, past its share a stream
+//!         only uses what the others leave free. The total can then exceed its budget by
+//!         the shares of the other streams, it stays below twice the budget.
 class saveDataManager : public QObject
 {
     Q_OBJECT
 public:
     explicit saveDataManager(QObject *parent = 0);
 
-    //! @brief  Starts the thread
+    //! @brief  Opens the queue and resets its statistics
     //! @param  none
     //! @return none
     void startController();
 
-    //! @brief  Stops the thread
+    //! @brief  Closes the queue, the executors write the frames left and stop waiting
     //! @param  none
     //! @return none
     void stopController();
 
-    void setEventHandler(const QEvent::Type type, const QObject* event_handler);
-
     //! @brief  Sets path to save png images
     //! @param  path Path to save images
     //! @return none
     void setPathToSaveData(const QString &path);
 
-    void setMaxFramesToSave(uint8_t frames);
-
-    void doSavePointerToPng(uint8_t* image_pointer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp);
-
-    void doSavePointCloudToBin(int32_t *data_buffer, int32_t number_of_points, uint32_t time_stamp);
-
-    void doSaveFloatDataToBin(float *data_buffer, int buffer_size, uint32_t time_stamp);
+    //! @brief  Sets the bytes this stream can keep queued
+    //! @param  bytes Budget of the stream
+    //! @return none
+    void setQueueBudget(uint64_t bytes);
 
-    void setDataTypeToSave(uint8_t data_type);
+    //! @brief  Sets the bytes all the streams together can keep queued
+    //! @param  bytes Budget shared by the streams
+    //! @return none
+    static void setTotalQueueBudget(uint64_t bytes);
 
-    void setExecutorAvailable(bool available);
+    //! @brief  Sets which frame is dropped when a frame does not fit in the budgets
+    //! @param  policy One of saveQueuePolicies
+    //! @return none
+    void setQueuePolicy(uint8_t policy);
 
-signals:
+    //! @brief  Returns the frames and bytes queued, the highest ones and the frames dropped
+    saveQueueStatistics getQueueStatistics();
 
-    void sendPointCloudToSave(pointcloudData data);
+    //! @brief  Sets the session the frames queued from now on are appended to
+    //! @param  session Session being recorded, NULL to write a file per frame
+    //! @param  stream_id Id of the stream of this queue in the session
+    //! @return none
+    void setSessionContainer(std::shared_ptr<sessionContainerWriter> session, uint16_t stream_id);
 
-    void sendImageToSave(imageData data);
+    //! @brief  Sets the video the images queued from now on are encoded in
+    //! @param  video Video being recorded, NULL to save the images as the session or the files
+    //! @return none
+    void setVideoWriter(std::shared_ptr<videoStreamWriter> video);
 
-    void sendBufferToSave(binaryFloatData data);
+    //! @brief  Queues an image, a reference to its buffer is kept until it is written
+    //! @param  image_buffer Pixels of the image, they must not be modified after this call
+    //! @param  width, height, channels Size of the image
+    //! @param  time_stamp Device timestamp, it names the file
+    //! @return none
+    void doSavePointerToPng(std::shared_ptr<const uint8_t> image_buffer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp);
 
-public slots:
+    //! @brief  Copies an image the caller keeps using and queues the copy
+    void doSavePointerToPng(const uint8_t *image_pointer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp);
 
-    void run();
+    //! @brief  Queues a point cloud, a reference to its buffer is kept until it is written
+    //! @param  pointcloud_buffer Frame as assembled, the first value is the number of points
+    //! @param  number_of_points Points to write, the first ones of the frame
+    //! @param  time_stamp Device timestamp, it names the file
+    //! @return none
+    void doSavePointCloudToBin(std::shared_ptr<const int32_t> pointcloud_buffer, int32_t number_of_points, uint32_t time_stamp);
 
-    void checkSenderTimeout();
+    //! @brief  Copies a point cloud the caller keeps using and queues the copy
+    void doSavePointCloudToBin(const int32_t *data_buffer, int32_t number_of_points, uint32_t time_stamp);
 
-private:
-    //! @brief  Receives events to process requests
-    //! @param  event even to process
+    //! @brief  Queues a float buffer, a reference to it is kept until it is written
+    //! @param  data_buffer Values to write, they must not be modified after this call
+    //! @param  buffer_size Bytes to write
+    //! @param  width Values per row of the image, 0 if the buffer is not an image
+    //! @param  time_stamp Device timestamp, it names the file
     //! @return none
-    void customEvent(QEvent *event);
+    void doSaveFloatDataToBin(std::shared_ptr<const float> data_buffer, int buffer_size, uint16_t width, uint32_t time_stamp);
 
-    void doCheckTimeout();
+    //! @brief  Copies a float buffer the caller keeps using and queues the copy
+    void doSaveFloatDataToBin(const float *data_buffer, int buffer_size, uint16_t width, uint32_t time_stamp);
 
-    void sendEvent(QEvent::Type event_type, QEvent *event );
+    void setDataTypeToSave(uint8_t data_type);
 
-    QList<const QObject *> getEventHandlers(const QEvent::Type& event_type);
+    uint8_t getDataTypeToSave();
 
-    void onSavePointerToPng( saveDataManagerSavePointerToPngRequest *request);
+    //! @brief  Waits for the next image to save
+    //! @param  data Returns the image, reset its buffer once written
+    //! @return false if the queue was closed and there are no images left
+    bool takeImage(imageData &data);
 
-    void onSavePointCloudToBin( saveDataManagerSavePointCloudToBinRequest *request);
+    //! @brief  Waits for the next point cloud to save
+    //! @param  data Returns the point cloud, reset its buffer once written
+    //! @return false if the queue was closed and there are no point clouds left
+    bool takePointCloud(pointcloudData &data);
 
-    void onSaveFloatBuffer(saveDataManagerSaveFloatBufferRequest *request);
+    //! @brief  Waits for the next float buffer to save
+    //! @param  data Returns the buffer, reset it once written
+    //! @return false if the queue was closed and there are no buffers left
+    bool takeFloatBuffer(binaryFloatData &data);
 
-    void savePointCloudToBin(int32_t *data_buffer, int32_t number_of_points, uint32_t time_stamp);
+private:
 
-    void savePointerToPng(uint8_t *image_pointer, uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp);
+    //! @brief  Queues a frame applying the budgets and the policy, its reference is released if it is dropped
+    template <typename T>
+    void enqueueFrame(QQueue<T> &queue, T &data);
 
-    void saveFloatBuffer(float *buffer, int buffer_size, uint32_t time_stamp);
+    //! @brief  Waits for the next frame of a queue and releases its bytes
+    //! @return false if the queue was closed and it is empty
+    template <typename T>
+    bool takeFrame(QQueue<T> &queue, T &data);
 
+    //! @brief  Returns true if a frame of the given size fits in the budgets, call it locked
+    bool fitsInBudget(uint64_t bytes);
 
+    //! @brief  Counts the frames queued (positive) or taken (negative), call it locked
+    void addQueuedFrame(int frames, int64_t bytes);
 
-private:
+    void addDroppedFrame(uint64_t bytes);
 
-    QThread *m_controller_thread;
+private:
 
-    QMultiMap <QEvent::Type, const QObject * > m_event_handlers;
+    //! all the queues are guarded by the same mutex, the total budget is shared by them
+    static std::mutex s_queue_mutex;
+    static uint64_t s_total_budget_bytes;
+    static uint64_t s_total_queued_bytes;
+    static int s_open_queues;
 
+    std::condition_variable m_queue_condition;
 
     QQueue<imageData> m_images_queue;
     QQueue<pointcloudData> m_pointcloud_queue;
     QQueue<binaryFloatData> m_float_binary_queue;
 
-    QTimer *m_check_sender_timer;
-    int m_sender_timer_time_ms;
+    QString m_path_to_save_data;
 
+    uint64_t m_budget_bytes;
+    uint8_t m_policy;
+    saveQueueStatistics m_statistics;
 
-    QString m_path_to_save_data;
+    std::shared_ptr<sessionContainerWriter> m_session;
+    uint16_t m_session_stream_id;
+
+    std::shared_ptr<videoStreamWriter> m_video;
 
-    uint16_t m_max_frames_to_save;
-    uint8_t m_current_frame_number;
     uint8_t m_data_type;
 
-    bool m_is_executor_available;
+    bool m_is_closed;
 
 };
 
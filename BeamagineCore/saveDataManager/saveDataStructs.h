@@ -2,30 +2,70 @@
 #include <inttypes.h>
 #include <time.h>
 
+#include <memory>
+
+class sessionContainerWriter;
+class videoStreamWriter;
+
 typedef enum saveDataTypes{
      images = 0,
      pointcloud,
      binaryFloat
 }saveDataTypes;
 
+//! The producers are the receiver and the GUI threads, a full queue drops frames and
+//! never makes them wait for the executors
+typedef enum saveQueuePolicies{
+     drop_newest = 0,
+     drop_oldest
+}saveQueuePolicies;
+
+typedef struct saveQueueStatistics{
+    uint32_t queued_frames;
+    uint64_t queued_bytes;
+    uint32_t high_water_frames;
+    uint64_t high_water_bytes;
+    uint32_t dropped_frames;
+    uint64_t dropped_bytes;
+}saveQueueStatistics;
+
+//! The buffers of the frames to save are shared and never modified once queued, the
+//! producer, the queue and the executor only keep a reference and the last one frees it.
+//! A frame queued while a session is recorded keeps the session, it is appended to it
+//! instead of being written to its own file, and the session is closed after its last frame.
+//! An image queued while its stream is recorded as video keeps the video writer the same way.
+
 typedef struct imageData{
     uint32_t timestamp;
     uint16_t image_height;
     uint16_t image_width;
     uint8_t image_channels;
-    uint8_t *image_buffer;
+    std::shared_ptr<const uint8_t> image_buffer;
+    std::shared_ptr<sessionContainerWriter> session;
+    uint16_t stream_id;
+    std::shared_ptr<videoStreamWriter> video;
+    //! position of the image in the video, reserved when it is taken from the queue
+    uint32_t video_frame;
 }imageData;
 
 
 typedef struct pointcloudData{
     uint32_t timestamp;
+    //! bytes of the buffer referenced
     uint32_t pointcloud_size;
-    int32_t *pointcloud_buffer;
+    //! points written, the first ones of the buffer
+    int32_t number_of_points;
+    std::shared_ptr<const int32_t> pointcloud_buffer;
+    std::shared_ptr<sessionContainerWriter> session;
+    uint16_t stream_id;
 }pointcloudData;
 
 typedef struct binaryFloatData{
     uint32_t timestamp;
     uint32_t data_size;
-    float *data_buffer;
+    //! values per row, the encoded temperatures predict a row from the one above
+    uint16_t data_width;
+    std::shared_ptr<const float> data_buffer;
+    std::shared_ptr<sessionContainerWriter> session;
+    uint16_t stream_id;
 }binaryFloatData;
-
@@ -0,0 +1,262 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "temperatureCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//! Step of the fixed point values, the useful resolution of the camera
+static const double fixed16_resolution = 0.01;
+
+static const uint32_t fixed16_max_step = 0xFFFF;
+
+static inline uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline float bitsToFloat(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//! @brief  Maps the bits of a float of the given width to an integer that sorts as the float,
+//!         neighbouring temperatures get close integers even across 0 °C
+static inline uint32_t orderedKey(uint32_t bits, uint32_t sign_bit)
+{
+    return (bits & sign_bit) ? (~bits & (sign_bit | (sign_bit - 1))) : (bits | sign_bit);
+}
+
+static inline uint32_t orderedBits(uint32_t key, uint32_t sign_bit)
+{
+    return (key & sign_bit) ? (key & (sign_bit - 1)) : (~key & (sign_bit | (sign_bit - 1)));
+}
+
+//! @brief  Rounds a float to the nearest half float, ties to even
+static uint16_t floatToHalf(float value)
+{
+    uint32_t bits = floatBits(value);
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    bits &= 0x7FFFFFFF;
+
+    uint16_t half;
+    if(bits >= 0x47800000){
+        //!65536 and above, infinity and NaN
+        half = (bits > 0x7F800000) ? 0x7E00 : 0x7C00;
+    }else if(bits < 0x38800000){
+        //!below the smallest normal half, the addition rounds the mantissa in place
+        const uint32_t magic = 126u << 23;
+        half = (uint16_t)(floatBits(bitsToFloat(bits) + bitsToFloat(magic)) - magic);
+    }else{
+        uint32_t odd = (bits >> 13) & 1;
+        bits += ((uint32_t)(15 - 127) << 23) + 0xFFF + odd;
+        half = (uint16_t)(bits >> 13);
+    }
+    return half | sign;
+}
+
+static float halfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    if(exponent == 0){
+        //!subnormal, exact as a float
+        return bitsToFloat(floatBits(mantissa * 5.9604644775390625e-8f) | sign);
+    }
+    if(exponent == 31){
+        return bitsToFloat(sign | 0x7F800000 | (mantissa << 13));
+    }
+    return bitsToFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+//! @brief  Median predictor of LOCO-I, the left or upper value at the edges
+static inline uint32_t predict(const uint32_t *samples, uint32_t row, uint32_t column, uint32_t width)
+{
+    if(row == 0){
+        return (column == 0) ? 0 : samples[column - 1];
+    }
+    const uint32_t *current = samples + (size_t)row * width;
+    const uint32_t *above = current - width;
+    if(column == 0){
+        return above[0];
+    }
+    uint32_t left = current[column - 1];
+    uint32_t up = above[column];
+    uint32_t up_left = above[column - 1];
+    if(up_left >= std::max(left, up)){
+        return std::min(left, up);
+    }
+    if(up_left <= std::min(left, up)){
+        return std::max(left, up);
+    }
+    //!between both, it does not wrap
+    return left + up - up_left;
+}
+
+temperatureCodec::temperatureCodec()
+{
+}
+
+void temperatureCodec::encode(const float *values, uint32_t number_of_values, uint32_t width, uint8_t encoding, std::vector<uint8_t> &encoded)
+{
+    if(encoding != temperature_encoding_fixed16 && encoding != temperature_encoding_half){
+        encoding = temperature_encoding_lossless;
+    }
+    //!a buffer that is not an image is coded as one row
+    if(width == 0 || number_of_values % width != 0){
+        width = number_of_values;
+    }
+
+    temperatureCodecHeader header;
+    memcpy(header.magic, TEMPERATURE_CODEC_MAGIC, sizeof(header.magic));
+    header.number_of_values = number_of_values;
+    header.width = width;
+    header.encoding = encoding;
+    header.offset = 0.0f;
+    header.scale = 0.0f;
+
+    m_samples.resize(number_of_values);
+    m_residuals.resize(number_of_values);
+
+    if(encoding == temperature_encoding_fixed16){
+        //!the steps start at the coldest value, the values that are not finite take the step 0
+        double minimum = INFINITY;
+        double maximum = -INFINITY;
+        for(uint32_t i = 0; i < number_of_values; ++i){
+            if(std::isfinite(values[i])){
+                minimum = std::min(minimum, (double)values[i]);
+                maximum = std::max(maximum, (double)values[i]);
+            }
+        }
+        if(minimum > maximum){
+            minimum = maximum = 0.0;
+        }
+        header.offset = (float)minimum;
+        header.scale = (float)std::max(fixed16_resolution, (maximum - header.offset) / fixed16_max_step);
+
+        double offset = header.offset;
+        double scale = header.scale;
+        for(uint32_t i = 0; i < number_of_values; ++i){
+            double step = std::isfinite(values[i]) ? std::floor((values[i] - offset) / scale + 0.5) : 0.0;
+            m_samples[i] = (uint32_t)std::min(std::max(step, 0.0), (double)fixed16_max_step);
+        }
+    }else if(encoding == temperature_encoding_half){
+        for(uint32_t i = 0; i < number_of_values; ++i){
+            m_samples[i] = orderedKey(floatToHalf(values[i]), 0x8000);
+        }
+    }else{
+        for(uint32_t i = 0; i < number_of_values; ++i){
+            m_samples[i] = orderedKey(floatBits(values[i]), 0x80000000);
+        }
+    }
+
+    //!the difference wraps around as a 32 bit value, the decoder adds it back the same way
+    for(uint32_t row = 0, i = 0; i < number_of_values; ++row){
+        for(uint32_t column = 0; column < width; ++column, ++i){
+            m_residuals[i] = zigzag((int32_t)(m_samples[i] - predict(m_samples.data(), row, column, width)));
+        }
+    }
+
+    encoded.resize(sizeof(header));
+    memcpy(encoded.data(), &header, sizeof(header));
+    m_stream_coder.encode(m_residuals.data(), number_of_values, encoded);
+}
+
+int64_t temperatureCodec::getNumberOfValues(const uint8_t *encoded, size_t bytes)
+{
+    if(encoded == NULL || bytes < sizeof(temperatureCodecHeader)){
+        return -1;
+    }
+    temperatureCodecHeader header;
+    memcpy(&header, encoded, sizeof(header));
+    if(memcmp(header.magic, TEMPERATURE_CODEC_MAGIC, sizeof(header.magic)) != 0){
+        return -1;
+    }
+    return header.number_of_values;
+}
+
+bool temperatureCodec::decode(const uint8_t *encoded, size_t bytes, float *values)
+{
+    int64_t number_of_values = getNumberOfValues(encoded, bytes);
+    if(number_of_values < 0){
+        return false;
+    }
+    temperatureCodecHeader header;
+    memcpy(&header, encoded, sizeof(header));
+    if((header.width == 0 && number_of_values > 0) || (header.width > 0 && number_of_values % header.width != 0) ||
+            header.encoding < temperature_encoding_fixed16 || header.encoding > temperature_encoding_lossless){
+        return false;
+    }
+
+    m_samples.resize(number_of_values);
+    m_residuals.resize(number_of_values);
+    if(m_stream_coder.decode(encoded + sizeof(header), bytes - sizeof(header), number_of_values, m_residuals.data()) == 0){
+        return false;
+    }
+
+    uint32_t width = header.width;
+    for(uint32_t row = 0, i = 0; i < number_of_values; ++row){
+        for(uint32_t column = 0; column < width; ++column, ++i){
+            m_samples[i] = predict(m_samples.data(), row, column, width) + (uint32_t)unzigzag(m_residuals[i]);
+        }
+    }
+
+    if(header.encoding == temperature_encoding_fixed16){
+        double offset = header.offset;
+        double scale = header.scale;
+        for(uint32_t i = 0; i < number_of_values; ++i){
+            values[i] = (float)(offset + (double)(m_samples[i] & fixed16_max_step) * scale);
+        }
+    }else if(header.encoding == temperature_encoding_half){
+        for(uint32_t i = 0; i < number_of_values; ++i){
+            values[i] = halfToFloat((uint16_t)orderedBits(m_samples[i] & 0xFFFF, 0x8000));
+        }
+    }else{
+        for(uint32_t i = 0; i < number_of_values; ++i){
+            values[i] = bitsToFloat(orderedBits(m_samples[i], 0x80000000));
+        }
+    }
+    return true;
+}
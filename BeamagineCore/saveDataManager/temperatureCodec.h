@@ -0,0 +1,93 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef TEMPERATURECODEC_H
+#define TEMPERATURECODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "streamCoder.h"
+
+#define TEMPERATURE_CODEC_MAGIC "BTC1"
+
+typedef enum temperatureEncodings{
+    temperature_encoding_raw = 0,   //!< 32 bit floats as they come, not coded (.bin)
+    temperature_encoding_fixed16,   //!< 16 bit steps of 0.01 °C from the coldest value of the frame, wider if the range does not fit
+    temperature_encoding_half,      //!< IEEE half floats, steps of 0.03 °C below 64 °C, coarser above
+    temperature_encoding_lossless   //!< the 32 bit floats, every bit is kept
+}temperatureEncodings;
+
+typedef struct temperatureCodecHeader{
+    char magic[4];
+    uint32_t number_of_values;
+    uint32_t width;                 //!< values per row, a row is predicted from the one above
+    uint32_t encoding;              //!< one of temperatureEncodings
+    float offset;                   //!< fixed16: temperature of the step 0
+    float scale;                    //!< fixed16: temperature of a step
+}temperatureCodecHeader;
+
+//! @brief  Compression of the temperatures of the thermal camera for the recordings. The
+//!         values are taken to 16 bit fixed point or half floats, or kept as 32 bit floats,
+//!         every one is predicted from its left, upper and upper left neighbours (LOCO-I
+//!         median predictor) and the difference with the prediction is coded by
+//!         streamCoder. The coding of the 16 or 32 bit values is lossless,
+//!         the fixed point and the half floats only round the temperatures.
+//!         An encoded frame is a temperatureCodecHeader and one stream.
+//!         The work buffers are kept between frames, use one codec per thread.
+class temperatureCodec
+{
+public:
+    temperatureCodec();
+
+    //! @brief  Encodes a frame
+    //! @param  values Temperatures of the frame
+    //! @param  number_of_values Number of values
+    //! @param  width Values per row, 0 if the buffer is not an image
+    //! @param  encoding One of temperatureEncodings but raw
+    //! @param  encoded Encoded frame, it is resized to its size
+    //! @return none
+    void encode(const float *values, uint32_t number_of_values, uint32_t width, uint8_t encoding, std::vector<uint8_t> &encoded);
+
+    //! @brief  Decodes a frame
+    //! @param  encoded Encoded frame
+    //! @param  bytes Size of the encoded frame
+    //! @param  values Output temperatures, it can hold getNumberOfValues values
+    //! @return false if the frame is not valid
+    bool decode(const uint8_t *encoded, size_t bytes, float *values);
+
+    //! @brief  Returns the number of values of an encoded frame, -1 if it is not valid
+    static int64_t getNumberOfValues(const uint8_t *encoded, size_t bytes);
+
+private:
+
+    std::vector<uint32_t> m_samples;
+    std::vector<uint32_t> m_residuals;
+    streamCoder m_stream_coder;
+};
+
+#endif // TEMPERATURECODEC_H
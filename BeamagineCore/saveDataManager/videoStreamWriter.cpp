@@ -0,0 +1,360 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "videoStreamWriter.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+
+#include <algorithm>
+#include <string.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+static const char *encoderName(uint8_t codec)
+{
+    switch(codec){
+    case video_codec_hevc:
+        return "libx265";
+    case video_codec_ffv1:
+        return "ffv1";
+    }
+    return "libx264";
+}
+
+//! @brief  Returns the layout of the frames by their number of channels, MainWindow converts
+//!         every camera frame to RGB before it is queued
+static AVPixelFormat sourcePixelFormat(uint8_t channels)
+{
+    return (channels == 3) ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_NONE;
+}
+
+//! @brief  Returns the format encoded, ffv1 keeps the RGB values and the others take 4:2:0
+static AVPixelFormat encoderPixelFormat(uint8_t codec)
+{
+    return (codec == video_codec_ffv1) ? AV_PIX_FMT_BGR0 : AV_PIX_FMT_YUV420P;
+}
+
+videoStreamWriter::videoStreamWriter(const QString &folder, const QString &stream_name, const videoRecordingSettings &settings)
+{
+    m_folder = folder;
+    m_stream_name = stream_name;
+    m_settings = settings;
+
+    m_reserved_frames = 0;
+    m_next_frame = 0;
+
+    m_format_context = NULL;
+    m_codec_context = NULL;
+    m_stream = NULL;
+    m_frame = NULL;
+    m_packet = NULL;
+    m_scaler = NULL;
+    m_index_file = NULL;
+
+    m_width = 0;
+    m_height = 0;
+    m_channels = 0;
+    m_failed = false;
+    m_finished = false;
+
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+videoStreamWriter::~videoStreamWriter()
+{
+    try{
+        std::lock_guard<std::mutex> lock(m_mutex);
+        close();
+    }catch(...){
+        qDebug()<<"Unhandled error at videoStreamWriter::~videoStreamWriter";
+    }
+}
+
+videoRecordingSettings videoStreamWriter::defaultSettings()
+{
+    videoRecordingSettings settings;
+    settings.codec = video_codec_h264;
+    settings.quality = 60;
+    settings.keyframe_interval = 30;
+    settings.frames_per_second = 10;
+    return settings;
+}
+
+QString videoStreamWriter::getFileExtension(uint8_t codec)
+{
+    return (codec == video_codec_ffv1) ? ".mkv" : ".mp4";
+}
+
+uint32_t videoStreamWriter::reserveFrame()
+{
+    return m_reserved_frames++;
+}
+
+bool videoStreamWriter::writeFrame(uint32_t position, uint32_t time_stamp, const uint8_t *image_pointer, uint16_t width, uint16_t height, uint8_t channels)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    //!the encoder takes the frames in the order of the queue
+    m_turn_condition.wait(lock, [&]{ return position == m_next_frame; });
+
+    bool written = false;
+    try{
+        if(m_format_context == NULL && !m_failed && !m_finished){
+            m_failed = !open(width, height, channels, time_stamp);
+        }
+
+        if(m_failed || m_finished){
+            //!the video could not be created or it is already finished, the frames are only counted
+        }else if(width != m_width || height != m_height || channels != m_channels){
+            if(m_statistics.frames_skipped == 0){
+                qDebug()<<"The size of the frames changed, the new frames are not added to"<<m_file_name;
+            }
+        }else if(av_frame_make_writable(m_frame) >= 0){
+            const uint8_t *source_planes[4] = {image_pointer, NULL, NULL, NULL};
+            int source_strides[4] = {width * channels, 0, 0, 0};
+            sws_scale(m_scaler, source_planes, source_strides, 0, height, m_frame->data, m_frame->linesize);
+
+            uint32_t frame_number = m_statistics.frames_written;
+            m_frame->pts = frame_number;
+            written = encodeFrame(m_frame);
+
+            if(written){
+                fprintf(m_index_file, "%u,%u,%lld\n", frame_number, time_stamp, (long long)QDateTime::currentMSecsSinceEpoch());
+            }
+        }
+    }catch(...){
+        qDebug()<<"Unhandled error at videoStreamWriter::writeFrame";
+    }
+
+    if(written){
+        m_statistics.frames_written++;
+    }else{
+        m_statistics.frames_skipped++;
+    }
+
+    //!the position is released even if the frame was skipped, the next ones would wait for it otherwise
+    m_next_frame++;
+    lock.unlock();
+    m_turn_condition.notify_all();
+
+    return written;
+}
+
+void videoStreamWriter::finish()
+{
+    try{
+        std::unique_lock<std::mutex> lock(m_mutex);
+        //!a worker may still hold a frame reserved, the trailer goes after it
+        m_turn_condition.wait(lock, [&]{ return m_next_frame == m_reserved_frames; });
+        m_finished = true;
+        close();
+    }catch(...){
+        qDebug()<<"Unhandled error at videoStreamWriter::finish";
+    }
+}
+
+QString videoStreamWriter::getFileName()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file_name;
+}
+
+bool videoStreamWriter::open(uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp)
+{
+    m_width = width;
+    m_height = height;
+    m_channels = channels;
+
+    AVPixelFormat source_format = sourcePixelFormat(channels);
+    AVPixelFormat encoded_format = encoderPixelFormat(m_settings.codec);
+    if(source_format == AV_PIX_FMT_NONE){
+        qDebug()<<"Frames of"<<channels<<"channels can not be recorded as video";
+        return false;
+    }
+
+    const AVCodec *codec = avcodec_find_encoder_by_name(encoderName(m_settings.codec));
+    if(codec == NULL){
+        qDebug()<<"The video encoder"<<encoderName(m_settings.codec)<<"is not available in this FFmpeg build";
+        return false;
+    }
+
+    //!named as the image files, after the timestamp of the first frame
+    QString base_name = QDir::cleanPath(m_folder + "/" + QString("%1_%2").arg(time_stamp).arg(m_stream_name));
+    m_file_name = base_name + getFileExtension(m_settings.codec);
+    std::string path = m_file_name.toStdString();
+
+    if(avformat_alloc_output_context2(&m_format_context, NULL, NULL, path.c_str()) < 0 || m_format_context == NULL){
+        qDebug()<<"The video"<<m_file_name<<"could not be created";
+        m_format_context = NULL;
+        return false;
+    }
+
+    m_codec_context = avcodec_alloc_context3(codec);
+    m_codec_context->width = width;
+    m_codec_context->height = height;
+    m_codec_context->pix_fmt = encoded_format;
+    m_codec_context->time_base = av_make_q(1, std::max(m_settings.frames_per_second, 1));
+    m_codec_context->framerate = av_make_q(std::max(m_settings.frames_per_second, 1), 1);
+    m_codec_context->gop_size = std::max(m_settings.keyframe_interval, 1);
+    //!as many threads as cores, the frames reach the encoder one by one
+    m_codec_context->thread_count = 0;
+
+    //!libswscale converts RGB to limited range BT.601
+    m_codec_context->color_range = AVCOL_RANGE_MPEG;
+    m_codec_context->colorspace = AVCOL_SPC_SMPTE170M;
+
+    if(m_format_context->oformat->flags & AVFMT_GLOBALHEADER){
+        m_codec_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    AVDictionary *options = NULL;
+    if(m_settings.codec == video_codec_ffv1){
+        //!version 3 encodes slices in parallel and checks each one with a crc
+        av_dict_set(&options, "level", "3", 0);
+        av_dict_set(&options, "slices", "16", 0);
+        av_dict_set(&options, "slicecrc", "1", 0);
+    }else{
+        //!the rate factor goes from 51 at quality 0 to 0 (lossless) at quality 100
+        int quality = std::min(std::max(m_settings.quality, 0), 100);
+        av_dict_set_int(&options, "crf", (100 - quality) * 51 / 100, 0);
+        //!fast enough to encode the full resolution of the cameras as they stream
+        av_dict_set(&options, "preset", "veryfast", 0);
+        if(m_settings.codec == video_codec_hevc){
+            av_dict_set(&options, "x265-params", "log-level=error", 0);
+        }
+    }
+    int result = avcodec_open2(m_codec_context, codec, &options);
+    av_dict_free(&options);
+    if(result < 0){
+        qDebug()<<"The video encoder"<<encoderName(m_settings.codec)<<"could not be opened for frames of"<<width<<"x"<<height;
+        releaseEncoder();
+        return false;
+    }
+
+    m_stream = avformat_new_stream(m_format_context, NULL);
+    if(m_stream == NULL || avcodec_parameters_from_context(m_stream->codecpar, m_codec_context) < 0){
+        releaseEncoder();
+        return false;
+    }
+    m_stream->time_base = m_codec_context->time_base;
+
+    if(avio_open(&m_format_context->pb, path.c_str(), AVIO_FLAG_WRITE) < 0 ||
+            avformat_write_header(m_format_context, NULL) < 0){
+        qDebug()<<"The video"<<m_file_name<<"could not be created";
+        releaseEncoder();
+        return false;
+    }
+
+    m_frame = av_frame_alloc();
+    m_frame->format = encoded_format;
+    m_frame->width = width;
+    m_frame->height = height;
+    m_packet = av_packet_alloc();
+    m_scaler = sws_getContext(width, height, source_format, width, height, encoded_format, SWS_BILINEAR, NULL, NULL, NULL);
+    m_index_file = fopen((base_name + ".csv").toStdString().c_str(), "w");
+
+    if(av_frame_get_buffer(m_frame, 0) < 0 || m_packet == NULL || m_scaler == NULL || m_index_file == NULL){
+        qDebug()<<"The video"<<m_file_name<<"could not be created";
+        close();
+        return false;
+    }
+
+    fprintf(m_index_file, "frame,timestamp,host_time_ms\n");
+    return true;
+}
+
+void videoStreamWriter::close()
+{
+    if(m_format_context == NULL){
+        return;
+    }
+
+    //!the encoder keeps a few frames to look ahead, they are written before the trailer
+    if(m_packet != NULL){
+        encodeFrame(NULL);
+    }
+    av_write_trailer(m_format_context);
+
+    releaseEncoder();
+
+    qDebug()<<"Video"<<m_file_name<<"closed,"<<m_statistics.frames_written<<"frames,"
+            <<m_statistics.frames_skipped<<"skipped,"<<(m_statistics.bytes_written / 1048576.0)<<"MB";
+}
+
+bool videoStreamWriter::encodeFrame(AVFrame *frame)
+{
+    if(avcodec_send_frame(m_codec_context, frame) < 0){
+        return false;
+    }
+
+    while(true){
+        int result = avcodec_receive_packet(m_codec_context, m_packet);
+        if(result == AVERROR(EAGAIN) || result == AVERROR_EOF){
+            return true;
+        }
+        if(result < 0){
+            return false;
+        }
+
+        av_packet_rescale_ts(m_packet, m_codec_context->time_base, m_stream->time_base);
+        m_packet->stream_index = m_stream->index;
+        m_statistics.bytes_written += m_packet->size;
+
+        //!the muxer takes the data of the packet and leaves it blank for the next one
+        if(av_interleaved_write_frame(m_format_context, m_packet) < 0){
+            return false;
+        }
+    }
+}
+
+void videoStreamWriter::releaseEncoder()
+{
+    if(m_format_context != NULL){
+        avio_closep(&m_format_context->pb);
+        avformat_free_context(m_format_context);
+        m_format_context = NULL;
+    }
+    m_stream = NULL;
+
+    avcodec_free_context(&m_codec_context);
+    av_frame_free(&m_frame);
+    av_packet_free(&m_packet);
+
+    sws_freeContext(m_scaler);
+    m_scaler = NULL;
+
+    if(m_index_file != NULL){
+        fclose(m_index_file);
+        m_index_file = NULL;
+    }
+}
@@ -0,0 +1,159 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef VIDEOSTREAMWRITER_H
+#define VIDEOSTREAMWRITER_H
+
+#include <QString>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct AVStream;
+struct SwsContext;
+
+typedef enum videoCodecs{
+    video_codec_h264 = 0,           //!< libx264, .mp4
+    video_codec_hevc,               //!< libx265, .mp4, about half the size of h264 for the same quality
+    video_codec_ffv1                //!< lossless, .mkv, the pixels of the camera are kept
+}videoCodecs;
+
+typedef struct videoRecordingSettings{
+    uint8_t codec;                  //!< one of videoCodecs
+    int quality;                    //!< 0 to 100, the rate factor of the codec, ignored by ffv1
+    int keyframe_interval;          //!< frames between key frames, a reader decodes at most this many to seek
+    int frames_per_second;          //!< nominal rate of the stream, the times of the frames are in the index
+}videoRecordingSettings;
+
+typedef struct videoRecordingStatistics{
+    uint32_t frames_written;
+    uint32_t frames_skipped;        //!< frames that could not be converted or encoded
+    uint64_t bytes_written;
+}videoRecordingStatistics;
+
+//! @brief  Encodes the frames of a camera stream in a video file through FFmpeg (libav),
+//!         with a sidecar index (.csv) of the frame number, the device timestamp and the host
+//!         time of every frame. The file is created with the first frame, named after its
+//!         timestamp, and finished by finish() or when the writer is destroyed, so a writer
+//!         shared by the frames queued is closed after the last of them as the session
+//!         containers are.
+//!         The frames are encoded in the order they were taken from the queue, several
+//!         workers can write at once, each one waits for the frames taken before its own.
+//!         The frames are the RGB images of the image files, libswscale converts them to
+//!         the 4:2:0 YUV of h264 and hevc, ffv1 keeps the RGB values.
+class videoStreamWriter
+{
+public:
+    //! @param  folder Folder of the video and its index
+    //! @param  stream_name Appended to the file names, e.g. "rgb"
+    videoStreamWriter(const QString &folder, const QString &stream_name, const videoRecordingSettings &settings);
+
+    //! @brief  Flushes the encoder and finishes the video and its index
+    ~videoStreamWriter();
+
+    //! @brief  Returns h264, quality 60, a key frame every 30 frames and 10 fps
+    static videoRecordingSettings defaultSettings();
+
+    //! @brief  Returns the extension of the videos of a codec, with the dot
+    static QString getFileExtension(uint8_t codec);
+
+    //! @brief  Reserves the position of a frame in the video, call it in the order the
+    //!         frames are taken from the queue and write every position reserved
+    //! @return position to pass to writeFrame
+    uint32_t reserveFrame();
+
+    //! @brief  Encodes a frame once the frames reserved before it are written
+    //! @param  position Returned by reserveFrame
+    //! @param  time_stamp Device timestamp of the frame
+    //! @param  image_pointer Pixels, RGB (3 channels), other frames are skipped
+    //! @return false if the frame was skipped, its position is released anyway
+    bool writeFrame(uint32_t position, uint32_t time_stamp, const uint8_t *image_pointer, uint16_t width, uint16_t height, uint8_t channels);
+
+    //! @brief  Waits for the frames reserved to be written, then flushes the encoder and writes
+    //!         the trailer of the video and the end of its index. The frames written after it
+    //!         are skipped. Call it once the queue of the frames is drained, e.g. at shutdown,
+    //!         where the last owner of the writer may not release it.
+    //! @return none
+    void finish();
+
+    //! @brief  Returns the path of the video, empty until the first frame is written
+    QString getFileName();
+
+private:
+
+    //! @brief  Creates the video, its encoder and the index for frames of the given size
+    //! @return false if the codec is not available or the files can not be created
+    bool open(uint16_t width, uint16_t height, uint8_t channels, uint32_t time_stamp);
+
+    //! @brief  Flushes the encoder and closes the files, call it locked
+    void close();
+
+    //! @brief  Sends a frame to the encoder and muxes the packets ready, NULL flushes it
+    bool encodeFrame(AVFrame *frame);
+
+    //! @brief  Frees the contexts of libav, call it locked
+    void releaseEncoder();
+
+private:
+
+    std::mutex m_mutex;
+    std::condition_variable m_turn_condition;
+
+    QString m_folder;
+    QString m_stream_name;
+    QString m_file_name;
+    videoRecordingSettings m_settings;
+
+    //! positions are reserved from the queue while it is locked, without waiting for the encoder
+    std::atomic<uint32_t> m_reserved_frames;
+    uint32_t m_next_frame;
+
+    AVFormatContext *m_format_context;
+    AVCodecContext *m_codec_context;
+    AVStream *m_stream;
+    AVFrame *m_frame;
+    AVPacket *m_packet;
+    SwsContext *m_scaler;
+    FILE *m_index_file;
+
+    uint16_t m_width;
+    uint16_t m_height;
+    uint8_t m_channels;
+    bool m_failed;
+    bool m_finished;
+
+    videoRecordingStatistics m_statistics;
+};
+
+#endif // VIDEOSTREAMWRITER_H
@@ -0,0 +1,660 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "batchedFileWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <QDebug>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+const size_t batchedFileWriter::direct_io_alignment;
+
+static size_t alignedBytes(size_t bytes)
+{
+    return (bytes + batchedFileWriter::direct_io_alignment - 1) & ~(batchedFileWriter::direct_io_alignment - 1);
+}
+
+batchedFileWriter::batchedFileWriter()
+{
+    m_settings = defaultSettings();
+    m_backend = batched_backend_stdio;
+    m_current = 0;
+#ifdef _WIN32
+    m_file = NULL;
+#else
+    m_file_descriptor = -1;
+#endif
+    m_direct_io = false;
+    m_offset = 0;
+    m_error = false;
+    memset(&m_statistics, 0, sizeof(m_statistics));
+
+    m_ring_descriptor = -1;
+    m_ring_registered = false;
+    m_ring_entries = 0;
+    m_in_flight = 0;
+    m_sq_ring = NULL;
+    m_sq_ring_bytes = 0;
+    m_cq_ring = NULL;
+    m_cq_ring_bytes = 0;
+    m_sqes = NULL;
+    m_sqes_bytes = 0;
+    m_sq_head = NULL;
+    m_sq_tail = NULL;
+    m_sq_mask = NULL;
+    m_sq_array = NULL;
+    m_cq_head = NULL;
+    m_cq_tail = NULL;
+    m_cq_mask = NULL;
+    m_cqes = NULL;
+}
+
+batchedFileWriter::~batchedFileWriter()
+{
+    release();
+}
+
+batchedWriterSettings batchedFileWriter::defaultSettings()
+{
+    batchedWriterSettings settings;
+    settings.buffer_bytes = 8 * 1024 * 1024;
+    settings.buffers = 4;
+    settings.direct_io = false;
+    settings.use_io_uring = true;
+    settings.preallocate_bytes = 0;
+    return settings;
+}
+
+bool batchedFileWriter::setup(const batchedWriterSettings &settings)
+{
+    try{
+        if(isOpen()){
+            return false;
+        }
+        release();
+
+        m_settings = settings;
+        m_settings.buffers = std::min(std::max(settings.buffers, 1u), 64u);
+        m_settings.buffer_bytes = alignedBytes(std::max(settings.buffer_bytes, direct_io_alignment));
+
+        m_buffers.resize(m_settings.buffers);
+        for(batchedBuffer &buffer : m_buffers){
+            memset(&buffer, 0, sizeof(buffer));
+#ifdef _WIN32
+            buffer.data = (uint8_t*)malloc(m_settings.buffer_bytes);
+#else
+            void *data = NULL;
+            if(posix_memalign(&data, direct_io_alignment, m_settings.buffer_bytes) == 0){
+                buffer.data = (uint8_t*)data;
+            }
+#endif
+            if(buffer.data == NULL){
+                qDebug()<<"Write buffers can not be allocated";
+                release();
+                return false;
+            }
+        }
+        m_current = 0;
+        m_queued.clear();
+        m_queued.reserve(m_buffers.size());
+
+        m_backend = batched_backend_stdio;
+#ifndef _WIN32
+        m_backend = batched_backend_pwritev;
+        if(m_settings.use_io_uring && setupRing()){
+            m_backend = batched_backend_io_uring;
+        }
+#endif
+        return true;
+
+    }catch(...){
+        qDebug()<<"Unhandled error at batchedFileWriter::setup";
+    }
+    return false;
+}
+
+void batchedFileWriter::release()
+{
+    close();
+    releaseRing();
+    for(batchedBuffer &buffer : m_buffers){
+        free(buffer.data);
+    }
+    m_buffers.clear();
+    m_queued.clear();
+}
+
+bool batchedFileWriter::open(const std::string &path)
+{
+    try{
+        if(isOpen()){
+            close();
+        }
+        if(m_buffers.empty() && !setup(m_settings)){
+            return false;
+        }
+        m_current = 0;
+        m_offset = 0;
+        m_error = false;
+
+#ifdef _WIN32
+        m_file = std::fopen(path.c_str(), "wb");
+        if(m_file == NULL){
+            qDebug()<<"File can not be created"<<path.c_str();
+            return false;
+        }
+        //!the buffers are the only ones, every write goes straight to the file
+        setvbuf(m_file, NULL, _IONBF, 0);
+        m_direct_io = false;
+#else
+        int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        m_direct_io = m_settings.direct_io;
+        if(m_direct_io){
+            m_file_descriptor = ::open(path.c_str(), flags | O_DIRECT, 0644);
+            if(m_file_descriptor < 0){
+                qDebug()<<"Direct I/O is not supported for"<<path.c_str()<<", the page cache is used";
+                m_direct_io = false;
+            }
+        }
+        if(m_file_descriptor < 0){
+            m_file_descriptor = ::open(path.c_str(), flags, 0644);
+        }
+        if(m_file_descriptor < 0){
+            qDebug()<<"File can not be created"<<path.c_str()<<strerror(errno);
+            return false;
+        }
+        //!the size is kept, a file interrupted ends with its last record written
+        if(m_settings.preallocate_bytes > 0 &&
+                fallocate(m_file_descriptor, FALLOC_FL_KEEP_SIZE, 0, m_settings.preallocate_bytes) != 0){
+            qDebug()<<"File can not be preallocated"<<path.c_str()<<strerror(errno);
+        }
+#endif
+        m_path = path;
+        return true;
+
+    }catch(...){
+        qDebug()<<"Unhandled error at batchedFileWriter::open";
+    }
+    return false;
+}
+
+bool batchedFileWriter::close()
+{
+    if(!isOpen()){
+        return true;
+    }
+    waitBuffers(-1);
+
+#ifdef _WIN32
+    std::fclose(m_file);
+    m_file = NULL;
+#else
+    //!removes the padding of the last buffer and the space preallocated and not used
+    if(ftruncate(m_file_descriptor, m_offset) != 0){
+        qDebug()<<"File size can not be set"<<m_path.c_str()<<strerror(errno);
+        m_error = true;
+    }
+    ::close(m_file_descriptor);
+    m_file_descriptor = -1;
+#endif
+    m_current = 0;
+    return !m_error;
+}
+
+bool batchedFileWriter::isOpen()
+{
+#ifdef _WIN32
+    return m_file != NULL;
+#else
+    return m_file_descriptor >= 0;
+#endif
+}
+
+uint8_t *batchedFileWriter::getBuffer()
+{
+    if(m_buffers.empty()){
+        return NULL;
+    }
+    if(m_buffers[m_current].busy){
+        m_statistics.waits++;
+        waitBuffers(m_current);
+    }
+    return m_buffers[m_current].data;
+}
+
+size_t batchedFileWriter::getBufferBytes()
+{
+    return m_settings.buffer_bytes;
+}
+
+bool batchedFileWriter::submit(size_t bytes)
+{
+    if(!isOpen() || bytes > m_settings.buffer_bytes){
+        return false;
+    }
+    if(bytes == 0){
+        return !m_error;
+    }
+    if(m_buffers[m_current].busy){
+        waitBuffers(m_current);
+    }
+
+    batchedBuffer &buffer = m_buffers[m_current];
+    buffer.bytes = bytes;
+    buffer.length = bytes;
+    buffer.offset = m_offset;
+    m_offset += bytes;
+
+    bool written = writeBuffer(m_current);
+    m_current = (m_current + 1) % m_buffers.size();
+    return written && !m_error;
+}
+
+int batchedFileWriter::getBackend()
+{
+    return m_backend;
+}
+
+batchedWriterStatistics batchedFileWriter::getStatistics()
+{
+    return m_statistics;
+}
+
+bool batchedFileWriter::writeBuffer(uint32_t index)
+{
+    batchedBuffer &buffer = m_buffers[index];
+
+#ifdef _WIN32
+    size_t written = std::fwrite(buffer.data, 1, buffer.length, m_file);
+    m_statistics.system_calls++;
+    m_statistics.buffers_written++;
+    if(written != buffer.length){
+        qDebug()<<"Write failed"<<m_path.c_str();
+        m_error = true;
+    }
+    return !m_error;
+#else
+    if(m_direct_io){
+        if(buffer.offset % direct_io_alignment != 0){
+            //!a partial buffer was written before, the rest of the file goes through the page cache
+            waitBuffers(-1);
+            fcntl(m_file_descriptor, F_SETFL, fcntl(m_file_descriptor, F_GETFL) & ~O_DIRECT);
+            m_direct_io = false;
+        }else{
+            //!the padding is removed when the file is closed
+            buffer.length = alignedBytes(buffer.bytes);
+            memset(buffer.data + buffer.bytes, 0, buffer.length - buffer.bytes);
+        }
+    }
+
+    buffer.busy = true;
+    if(m_backend == batched_backend_io_uring){
+        return submitToRing(index, buffer.length);
+    }
+
+    //!the buffers are written together once none is left to fill
+    m_queued.push_back(index);
+    if(m_queued.size() == m_buffers.size()){
+        return writeQueued();
+    }
+    return true;
+#endif
+}
+
+bool batchedFileWriter::waitBuffers(int64_t index)
+{
+#ifndef _WIN32
+    while(m_backend == batched_backend_io_uring && (index < 0 ? m_in_flight > 0 : m_buffers[index].busy)){
+        if(!reapRing(true)){
+            fallBackFromRing();
+        }
+    }
+    if(m_backend != batched_backend_io_uring){
+        return writeQueued();
+    }
+#endif
+    return !m_error;
+}
+
+#ifdef _WIN32
+
+bool batchedFileWriter::writeQueued()
+{
+    return !m_error;
+}
+
+bool batchedFileWriter::writeAt(const uint8_t *, size_t, uint64_t)
+{
+    return false;
+}
+
+bool batchedFileWriter::setupRing()
+{
+    return false;
+}
+
+void batchedFileWriter::releaseRing()
+{
+}
+
+bool batchedFileWriter::submitToRing(uint32_t, size_t)
+{
+    return false;
+}
+
+bool batchedFileWriter::reapRing(bool)
+{
+    return false;
+}
+
+void batchedFileWriter::fallBackFromRing()
+{
+}
+
+#else
+
+bool batchedFileWriter::writeQueued()
+{
+    if(m_queued.empty()){
+        return !m_error;
+    }
+
+    //!the queued buffers follow each other in the file
+    struct iovec vectors[64];
+    int count = m_queued.size();
+    for(int i = 0; i < count; i++){
+        vectors[i].iov_base = m_buffers[m_queued[i]].data;
+        vectors[i].iov_len = m_buffers[m_queued[i]].length;
+    }
+    uint64_t offset = m_buffers[m_queued[0]].offset;
+
+    int first = 0;
+    while(first < count){
+        ssize_t written = pwritev(m_file_descriptor, &vectors[first], count - first, offset);
+        m_statistics.system_calls++;
+        if(written < 0 && errno == EINTR){
+            continue;
+        }
+        if(written <= 0){
+            qDebug()<<"Write failed"<<m_path.c_str()<<strerror(errno);
+            m_error = true;
+            break;
+        }
+        //!a short write goes on where it stopped
+        offset += written;
+        while(written > 0){
+            if((size_t)written >= vectors[first].iov_len){
+                written -= vectors[first].iov_len;
+                first++;
+            }else{
+                vectors[first].iov_base = (uint8_t*)vectors[first].iov_base + written;
+                vectors[first].iov_len -= written;
+                written = 0;
+            }
+        }
+    }
+
+    for(uint32_t index : m_queued){
+        m_buffers[index].busy = false;
+    }
+    m_statistics.buffers_written += m_queued.size();
+    m_queued.clear();
+    return !m_error;
+}
+
+bool batchedFileWriter::writeAt(const uint8_t *data, size_t bytes, uint64_t offset)
+{
+    while(bytes > 0){
+        ssize_t written = pwrite(m_file_descriptor, data, bytes, offset);
+        m_statistics.system_calls++;
+        if(written < 0 && errno == EINTR){
+            continue;
+        }
+        if(written <= 0){
+            qDebug()<<"Write failed"<<m_path.c_str()<<strerror(errno);
+            return false;
+        }
+        data += written;
+        bytes -= written;
+        offset += written;
+    }
+    return true;
+}
+
+bool batchedFileWriter::setupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    m_ring_descriptor = syscall(__NR_io_uring_setup, m_buffers.size(), &params);
+    if(m_ring_descriptor < 0){
+        qDebug()<<"io_uring is not available, the writes use pwritev"<<strerror(errno);
+        m_ring_descriptor = -1;
+        return false;
+    }
+    m_ring_entries = params.sq_entries;
+
+    m_sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    m_sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sq_ring = mmap(NULL, m_sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_descriptor, IORING_OFF_SQ_RING);
+    m_cq_ring = mmap(NULL, m_cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_descriptor, IORING_OFF_CQ_RING);
+    void *sqes = mmap(NULL, m_sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_descriptor, IORING_OFF_SQES);
+    m_sq_ring = (m_sq_ring == MAP_FAILED) ? NULL : m_sq_ring;
+    m_cq_ring = (m_cq_ring == MAP_FAILED) ? NULL : m_cq_ring;
+    m_sqes = (sqes == MAP_FAILED) ? NULL : (struct io_uring_sqe*)sqes;
+    if(m_sq_ring == NULL || m_cq_ring == NULL || m_sqes == NULL){
+        qDebug()<<"io_uring can not be mapped, the writes use pwritev";
+        releaseRing();
+        return false;
+    }
+
+    uint8_t *sq = (uint8_t*)m_sq_ring;
+    m_sq_head = (unsigned*)(sq + params.sq_off.head);
+    m_sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    m_sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    m_sq_array = (unsigned*)(sq + params.sq_off.array);
+    uint8_t *cq = (uint8_t*)m_cq_ring;
+    m_cq_head = (unsigned*)(cq + params.cq_off.head);
+    m_cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    m_cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    m_cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    //!registered buffers are mapped once by the kernel instead of on every write
+    std::vector<struct iovec> vectors(m_buffers.size());
+    for(size_t i = 0; i < m_buffers.size(); i++){
+        vectors[i].iov_base = m_buffers[i].data;
+        vectors[i].iov_len = m_settings.buffer_bytes;
+    }
+    m_ring_registered = syscall(__NR_io_uring_register, m_ring_descriptor, IORING_REGISTER_BUFFERS, vectors.data(), vectors.size()) == 0;
+    if(!m_ring_registered){
+        qDebug()<<"Write buffers can not be registered in io_uring"<<strerror(errno);
+
+#ifdef IO_URING_OP_SUPPORTED
+        //!the plain write of io_uring came with the probe in Linux 5.6, the fixed one is older
+        std::vector<uint8_t> probe(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op), 0);
+        struct io_uring_probe *operations = (struct io_uring_probe*)probe.data();
+        bool supported = syscall(__NR_io_uring_register, m_ring_descriptor, IORING_REGISTER_PROBE, operations, 256) == 0 &&
+                IORING_OP_WRITE <= operations->last_op && (operations->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+#else
+        //!the headers are older than Linux 5.6, only the write of registered buffers is known
+        bool supported = false;
+#endif
+        if(!supported){
+            qDebug()<<"io_uring can not write unregistered buffers, the writes use pwritev";
+            releaseRing();
+            return false;
+        }
+    }
+    m_in_flight = 0;
+    return true;
+}
+
+void batchedFileWriter::releaseRing()
+{
+    if(m_sq_ring != NULL){
+        munmap(m_sq_ring, m_sq_ring_bytes);
+    }
+    if(m_cq_ring != NULL){
+        munmap(m_cq_ring, m_cq_ring_bytes);
+    }
+    if(m_sqes != NULL){
+        munmap(m_sqes, m_sqes_bytes);
+    }
+    if(m_ring_descriptor >= 0){
+        ::close(m_ring_descriptor);
+    }
+    m_ring_descriptor = -1;
+    m_ring_registered = false;
+    m_sq_ring = NULL;
+    m_cq_ring = NULL;
+    m_sqes = NULL;
+    m_in_flight = 0;
+}
+
+bool batchedFileWriter::submitToRing(uint32_t index, size_t bytes)
+{
+    batchedBuffer &buffer = m_buffers[index];
+
+    //!every entry is submitted right away, so there is always a free one
+    unsigned tail = *m_sq_tail;
+    unsigned slot = tail & *m_sq_mask;
+    struct io_uring_sqe *entry = &m_sqes[slot];
+    memset(entry, 0, sizeof(*entry));
+#ifdef IO_URING_OP_SUPPORTED
+    entry->opcode = m_ring_registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+#else
+    entry->opcode = IORING_OP_WRITE_FIXED;
+#endif
+    entry->fd = m_file_descriptor;
+    entry->addr = (uint64_t)(uintptr_t)buffer.data;
+    entry->len = bytes;
+    entry->off = buffer.offset;
+    entry->buf_index = m_ring_registered ? index : 0;
+    entry->user_data = index;
+    m_sq_array[slot] = slot;
+    __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    do{
+        submitted = syscall(__NR_io_uring_enter, m_ring_descriptor, 1, 0, 0, NULL, 0);
+        m_statistics.system_calls++;
+    }while(submitted < 0 && errno == EINTR);
+
+    //!the entry is in flight once the kernel takes it, even if the call failed afterwards
+    if(submitted == 1 || __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) == tail + 1){
+        m_in_flight++;
+    }
+    if(submitted != 1){
+        qDebug()<<"Write can not be submitted"<<m_path.c_str()<<strerror(errno);
+        fallBackFromRing();
+    }
+    return !m_error;
+}
+
+bool batchedFileWriter::reapRing(bool wait)
+{
+    if(wait){
+        int result = syscall(__NR_io_uring_enter, m_ring_descriptor, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        m_statistics.system_calls++;
+        if(result < 0 && errno != EINTR){
+            qDebug()<<"io_uring can not be waited"<<strerror(errno);
+            return false;
+        }
+    }
+
+    unsigned head = *m_cq_head;
+    unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    while(head != tail){
+        struct io_uring_cqe *completion = &m_cqes[head & *m_cq_mask];
+        batchedBuffer &buffer = m_buffers[completion->user_data];
+        int result = completion->res;
+        //!the kernel cancels the writes left to its workers when the thread that submitted them
+        //!exits, the buffer is still ours and is written here, as the rest of a short write
+        if(result == -ECANCELED || result == -EINTR || result == -EAGAIN){
+            result = 0;
+        }
+        if(result < 0){
+            qDebug()<<"Write failed"<<m_path.c_str()<<strerror(-result);
+            m_error = true;
+        }else if((size_t)result < buffer.length &&
+                 !writeAt(buffer.data + result, buffer.length - result, buffer.offset + result)){
+            m_error = true;
+        }
+        buffer.busy = false;
+        m_in_flight--;
+        m_statistics.buffers_written++;
+        head++;
+    }
+    __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+    return true;
+}
+
+void batchedFileWriter::fallBackFromRing()
+{
+    qDebug()<<"io_uring failed, the writes of"<<m_path.c_str()<<"use pwritev";
+    while(m_in_flight > 0 && reapRing(true)){
+    }
+
+    //!the buffers still in flight are written again, the kernel writes the same bytes if it
+    //!gets to them. They can be read by the kernel until the ring is gone, so they are left
+    //!allocated and the writer takes new ones
+    for(batchedBuffer &buffer : m_buffers){
+        if(!buffer.busy){
+            continue;
+        }
+        if(!writeAt(buffer.data, buffer.length, buffer.offset)){
+            m_error = true;
+        }
+        if(m_in_flight > 0){
+            void *data = NULL;
+            buffer.data = (posix_memalign(&data, direct_io_alignment, m_settings.buffer_bytes) == 0) ? (uint8_t*)data : NULL;
+            if(buffer.data == NULL){
+                qDebug()<<"Write buffers can not be allocated";
+                m_error = true;
+            }
+        }
+        buffer.busy = false;
+        m_statistics.buffers_written++;
+    }
+
+    releaseRing();
+    m_backend = batched_backend_pwritev;
+}
+
+#endif
@@ -0,0 +1,185 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BATCHEDFILEWRITER_H
+#define BATCHEDFILEWRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+typedef enum batchedWriterBackends{
+    batched_backend_stdio = 0,      //!< fwrite, where the others are not available
+    batched_backend_pwritev,        //!< the buffers filled are written together in one pwritev call
+    batched_backend_io_uring        //!< the buffers are registered in an io_uring and written asynchronously
+}batchedWriterBackends;
+
+typedef struct batchedWriterSettings{
+    size_t buffer_bytes;            //!< rounded up to the direct I/O alignment
+    uint32_t buffers;               //!< buffers that can be in flight at once
+    bool direct_io;                 //!< O_DIRECT, the data does not go through the page cache
+    bool use_io_uring;              //!< pwritev is used if false or if the kernel does not support it
+    uint64_t preallocate_bytes;     //!< reserved with fallocate when a file is created, 0 to disable
+}batchedWriterSettings;
+
+typedef struct batchedWriterStatistics{
+    uint64_t buffers_written;
+    uint64_t system_calls;          //!< writes, submissions and waits
+    uint64_t waits;                 //!< times a buffer was asked for while all of them were in flight
+}batchedWriterStatistics;
+
+//! @brief  Writes a file sequentially through a few large buffers. The caller fills the
+//!         buffer returned by getBuffer and submits it, it is written while the next one is
+//!         filled. On Linux the buffers are registered in an io_uring, so several of them
+//!         are in flight at once, or gathered and written in one pwritev call where io_uring
+//!         is not available. The buffers are aligned for O_DIRECT and the files can be
+//!         preallocated. The buffers are kept from one file to the next.
+//!         Not thread safe, the caller serializes the calls.
+class batchedFileWriter
+{
+public:
+    batchedFileWriter();
+
+    ~batchedFileWriter();
+
+    //! @brief  Allocates the buffers and selects the backend, call it without a file open
+    //! @return false if the buffers can not be allocated
+    bool setup(const batchedWriterSettings &settings);
+
+    //! @brief  Closes the file and releases the buffers, setup allocates them again
+    void release();
+
+    //! @brief  Creates a file, O_DIRECT is not used if the file system does not support it
+    bool open(const std::string &path);
+
+    //! @brief  Writes the buffers left, sets the size of the file to the bytes submitted and closes it
+    //! @return false if any write of the file failed
+    bool close();
+
+    bool isOpen();
+
+    //! @brief  Returns the buffer to fill, it waits if all the buffers are in flight
+    uint8_t *getBuffer();
+
+    size_t getBufferBytes();
+
+    //! @brief  Writes the buffer returned by getBuffer at the end of the file. With direct I/O
+    //!         only the last buffer of a file should be partially filled, otherwise direct I/O
+    //!         is disabled for the rest of the file.
+    //! @param  bytes Bytes filled in the buffer
+    //! @return false if a previous write failed
+    bool submit(size_t bytes);
+
+    //! @brief  Returns one of batchedWriterBackends
+    int getBackend();
+
+    batchedWriterStatistics getStatistics();
+
+    static batchedWriterSettings defaultSettings();
+
+    static const size_t direct_io_alignment = 4096;
+
+private:
+
+    typedef struct batchedBuffer{
+        uint8_t *data;
+        size_t bytes;
+        size_t length;              //!< bytes written, padded for direct I/O
+        uint64_t offset;
+        bool busy;                  //!< in flight, or queued for pwritev
+    }batchedBuffer;
+
+    //! @brief  Writes the buffer, or queues it, with the selected backend
+    bool writeBuffer(uint32_t index);
+
+    //! @brief  Writes all the buffers queued for pwritev in one call
+    bool writeQueued();
+
+    //! @brief  Waits until the buffer is written, or all of them if index is negative
+    bool waitBuffers(int64_t index);
+
+    //! @brief  Writes bytes at the offset with pwrite, going on after short writes
+    bool writeAt(const uint8_t *data, size_t bytes, uint64_t offset);
+
+    bool setupRing();
+    void releaseRing();
+    bool submitToRing(uint32_t index, size_t bytes);
+    //! @brief  Collects the writes completed, waiting for at least one if wait is true.
+    //!         A write cancelled or cut short by the kernel is finished with pwrite.
+    //! @return false if the ring can not be waited
+    bool reapRing(bool wait);
+    //! @brief  Tears the ring down after it failed, the buffers not written are written
+    //!         with pwrite and the rest of the file uses pwritev
+    void fallBackFromRing();
+
+private:
+
+    batchedWriterSettings m_settings;
+    int m_backend;
+
+    std::vector<batchedBuffer> m_buffers;
+    uint32_t m_current;
+    std::vector<uint32_t> m_queued;
+
+    std::string m_path;
+#ifdef _WIN32
+    FILE *m_file;
+#else
+    int m_file_descriptor;
+#endif
+    bool m_direct_io;
+    uint64_t m_offset;
+    bool m_error;
+
+    batchedWriterStatistics m_statistics;
+
+    int m_ring_descriptor;
+    bool m_ring_registered;
+    uint32_t m_ring_entries;
+    uint32_t m_in_flight;
+    void *m_sq_ring;
+    size_t m_sq_ring_bytes;
+    void *m_cq_ring;
+    size_t m_cq_ring_bytes;
+    struct io_uring_sqe *m_sqes;
+    size_t m_sqes_bytes;
+    unsigned *m_sq_head;
+    unsigned *m_sq_tail;
+    unsigned *m_sq_mask;
+    unsigned *m_sq_array;
+    unsigned *m_cq_head;
+    unsigned *m_cq_tail;
+    unsigned *m_cq_mask;
+    struct io_uring_cqe *m_cqes;
+};
+
+#endif // BATCHEDFILEWRITER_H
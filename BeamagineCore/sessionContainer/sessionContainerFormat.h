@@ -0,0 +1,104 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SESSIONCONTAINERFORMAT_H
+#define SESSIONCONTAINERFORMAT_H
+
+#include <stdint.h>
+
+//! On disk layout of a recording session. A session is a folder of segment files
+//! (session_000000.bsc, session_000001.bsc, ...) where all the streams are appended.
+//! A segment starts with its header, then come the records, each one a record header
+//! followed by its payload padded to 8 bytes. When the segment is closed the index of
+//! its records and the table of its streams are appended, and the footer at the very
+//! end of the file points to them. A segment without footer, if the recording was
+//! interrupted, can still be read walking the record headers from the start.
+//! All the values are little endian.
+
+#define SESSION_SEGMENT_MAGIC "BEAMSES1"
+#define SESSION_FOOTER_MAGIC "BEAMIDX1"
+#define SESSION_RECORD_MAGIC 0x43455242u /* "BREC" */
+#define SESSION_FORMAT_VERSION 1
+#define SESSION_RECORD_ALIGNMENT 8
+
+//! Content of the payload of a record, it is what the file of the frame would hold
+typedef enum sessionRecordFormats{
+    session_format_pointcloud = 0,  //!< number of points and the points, as the .bin files
+    session_format_png,             //!< png file
+    session_format_bmp,             //!< bmp file
+    session_format_float32,         //!< raw float values, as the thermal .bin files
+    session_format_pointcloud_bpc,  //!< point cloud coded by pointCloudCodec, as the .bpc files
+    session_format_float32_btc      //!< temperatures coded by temperatureCodec, as the thermal .btc files
+}sessionRecordFormats;
+
+typedef struct sessionSegmentHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t segment_index;
+    uint64_t created_ms;            //!< host time since epoch
+}sessionSegmentHeader;
+
+typedef struct sessionRecordHeader{
+    uint32_t magic;
+    uint16_t stream_id;
+    uint16_t format;
+    uint32_t device_timestamp;      //!< hhmmssmmm as sent by the device
+    uint32_t payload_bytes;         //!< without the padding
+    uint64_t host_time_ns;          //!< host time since epoch when the record was written
+}sessionRecordHeader;
+
+typedef struct sessionIndexEntry{
+    uint64_t offset;                //!< of the record header in the segment
+    uint64_t host_time_ns;
+    uint32_t device_timestamp;
+    uint32_t payload_bytes;
+    uint16_t stream_id;
+    uint16_t format;
+    uint32_t reserved;
+}sessionIndexEntry;
+
+typedef struct sessionStreamEntry{
+    uint16_t stream_id;
+    uint16_t format;
+    uint32_t records;               //!< in this segment
+    char name[24];
+}sessionStreamEntry;
+
+typedef struct sessionSegmentFooter{
+    uint64_t index_offset;          //!< the stream table follows the index
+    uint32_t index_entries;
+    uint32_t streams;
+    char magic[8];
+}sessionSegmentFooter;
+
+static_assert(sizeof(sessionSegmentHeader) == 24, "sessionSegmentHeader layout");
+static_assert(sizeof(sessionRecordHeader) == 24, "sessionRecordHeader layout");
+static_assert(sizeof(sessionIndexEntry) == 32, "sessionIndexEntry layout");
+static_assert(sizeof(sessionStreamEntry) == 32, "sessionStreamEntry layout");
+static_assert(sizeof(sessionSegmentFooter) == 24, "sessionSegmentFooter layout");
+
+#endif // SESSIONCONTAINERFORMAT_H
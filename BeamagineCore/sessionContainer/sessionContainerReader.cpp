@@ -0,0 +1,354 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sessionContainerReader.h"
+#include "sessionContainerWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QDebug>
+
+#include <beam_aux.h>
+
+static const int64_t milliseconds_per_day = 24 * 3600 * 1000;
+
+static uint64_t paddedBytes(uint64_t bytes)
+{
+    return (bytes + SESSION_RECORD_ALIGNMENT - 1) & ~(uint64_t)(SESSION_RECORD_ALIGNMENT - 1);
+}
+
+sessionContainerReader::sessionContainerReader()
+{
+    m_has_reference = false;
+    m_reference_device_ms = 0;
+    m_reference_host_ms = 0;
+}
+
+sessionContainerReader::~sessionContainerReader()
+{
+    close();
+}
+
+bool sessionContainerReader::open(const std::string &folder)
+{
+    close();
+
+    try{
+        std::string segments_folder = folder;
+        if(!segments_folder.empty() && segments_folder.back() != '/'){
+            segments_folder += "/";
+        }
+
+        //!the segments are numbered from 0 without gaps
+        for(uint32_t segment = 0; ; ++segment){
+            std::unique_ptr<QFile> file(new QFile(QString::fromStdString(sessionContainerWriter::getSegmentPath(segments_folder, segment))));
+            if(!file->exists()){
+                break;
+            }
+            mappedSegment mapped;
+            mapped.size = file->size();
+            mapped.data = NULL;
+            if(file->open(QIODevice::ReadOnly) && mapped.size >= sizeof(sessionSegmentHeader)){
+                mapped.data = file->map(0, mapped.size);
+            }
+            if(mapped.data == NULL){
+                qDebug()<<"Session segment can not be mapped"<<file->fileName();
+            }
+            mapped.file = std::move(file);
+            m_segments.push_back(std::move(mapped));
+
+            loadSegment(segment);
+        }
+
+        //!the workers of a stream finish out of order, the records are sorted once here
+        for(auto &stream : m_records){
+            std::vector<recordLocation> &locations = stream.second;
+            std::stable_sort(locations.begin(), locations.end(), [](const recordLocation &a, const recordLocation &b){
+                return a.device_time_ms < b.device_time_ms;
+            });
+
+            std::vector<recordLocation> &by_host_time = m_records_by_host_time[stream.first];
+            by_host_time = locations;
+            std::stable_sort(by_host_time.begin(), by_host_time.end(), [](const recordLocation &a, const recordLocation &b){
+                return a.host_time_ns < b.host_time_ns;
+            });
+
+            m_streams[stream.first].stream_id = stream.first;
+            m_streams[stream.first].records = locations.size();
+        }
+
+        return !m_records.empty();
+
+    }catch(...){
+        qDebug()<<"Unhandled error at sessionContainerReader::open";
+    }
+    return false;
+}
+
+void sessionContainerReader::close()
+{
+    //!the files unmap their memory when they are closed
+    m_segments.clear();
+    m_streams.clear();
+    m_records.clear();
+    m_records_by_host_time.clear();
+    m_has_reference = false;
+}
+
+std::vector<sessionStreamEntry> sessionContainerReader::getStreams()
+{
+    std::vector<sessionStreamEntry> streams;
+    for(auto &stream : m_streams){
+        streams.push_back(stream.second);
+    }
+    return streams;
+}
+
+size_t sessionContainerReader::getNumberOfRecords(uint16_t stream_id)
+{
+    auto stream = m_records.find(stream_id);
+    return stream == m_records.end() ? 0 : stream->second.size();
+}
+
+bool sessionContainerReader::getRecord(uint16_t stream_id, size_t position, sessionRecordView &record)
+{
+    auto stream = m_records.find(stream_id);
+    if(stream == m_records.end() || position >= stream->second.size()){
+        return false;
+    }
+    return makeView(stream->second[position], record);
+}
+
+int64_t sessionContainerReader::findNearest(uint16_t stream_id, uint32_t device_timestamp, sessionRecordView &record)
+{
+    auto stream = m_records.find(stream_id);
+    if(stream == m_records.end() || stream->second.empty()){
+        return -1;
+    }
+
+    //!the time searched is taken in the day closest to the reference record
+    int64_t time_ms = timestampToMilliseconds(device_timestamp);
+    if(m_has_reference){
+        time_ms += std::llround((m_reference_device_ms - time_ms) / (double)milliseconds_per_day) * milliseconds_per_day;
+    }
+
+    int64_t position = nearestPosition(stream->second, time_ms, &recordLocation::device_time_ms);
+    makeView(stream->second[position], record);
+    return position;
+}
+
+int64_t sessionContainerReader::findNearestHostTime(uint16_t stream_id, uint64_t host_time_ns, sessionRecordView &record)
+{
+    auto stream = m_records_by_host_time.find(stream_id);
+    if(stream == m_records_by_host_time.end() || stream->second.empty()){
+        return -1;
+    }
+
+    int64_t position = nearestPosition(stream->second, host_time_ns, &recordLocation::host_time_ns);
+    makeView(stream->second[position], record);
+    return position;
+}
+
+bool sessionContainerReader::decodePointCloud(const sessionRecordView &record, std::vector<tPointPcd> &points)
+{
+    try{
+        if(record.payload == NULL){
+            return false;
+        }
+
+        if(record.format == session_format_pointcloud){
+            //!as the .bin files, the number of points and the points
+            int32_t number_of_points = -1;
+            if(record.payload_bytes >= sizeof(number_of_points)){
+                memcpy(&number_of_points, record.payload, sizeof(number_of_points));
+            }
+            if(number_of_points < 0 || (uint64_t)number_of_points * sizeof(tPointPcd) > record.payload_bytes - sizeof(number_of_points)){
+                qDebug()<<"Point cloud record of"<<record.payload_bytes<<"bytes is not valid";
+                return false;
+            }
+            points.resize(number_of_points);
+            memcpy(points.data(), record.payload + sizeof(number_of_points), (size_t)number_of_points * sizeof(tPointPcd));
+            return true;
+        }
+
+        if(record.format == session_format_pointcloud_bpc){
+            //!every point takes at least a bit of each of its streams, a larger count is not allocated
+            int32_t number_of_points = pointCloudCodec::getNumberOfPoints(record.payload, record.payload_bytes);
+            if(number_of_points < 0 || (uint64_t)number_of_points > (uint64_t)record.payload_bytes * 2){
+                qDebug()<<"Compressed point cloud record is not valid";
+                return false;
+            }
+            points.resize(number_of_points);
+            if(!m_point_cloud_codec.decode(record.payload, record.payload_bytes, points.data())){
+                qDebug()<<"Compressed point cloud record could not be decoded";
+                points.clear();
+                return false;
+            }
+            return true;
+        }
+
+        qDebug()<<"Record of format"<<record.format<<"is not a point cloud";
+
+    }catch(...){
+        qDebug()<<"Unhandled error at sessionContainerReader::decodePointCloud";
+    }
+    return false;
+}
+
+bool sessionContainerReader::loadSegment(uint32_t segment)
+{
+    const uint8_t *data = m_segments[segment].data;
+    uint64_t size = m_segments[segment].size;
+    if(data == NULL){
+        return false;
+    }
+
+    sessionSegmentHeader header;
+    memcpy(&header, data, sizeof(header));
+    if(memcmp(header.magic, SESSION_SEGMENT_MAGIC, sizeof(header.magic)) != 0){
+        qDebug()<<"Not a session segment"<<m_segments[segment].file->fileName();
+        return false;
+    }
+
+    //!a closed segment ends with its footer, only the index is read
+    sessionSegmentFooter footer;
+    bool has_index = false;
+    if(size >= sizeof(header) + sizeof(footer)){
+        memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+        has_index = memcmp(footer.magic, SESSION_FOOTER_MAGIC, sizeof(footer.magic)) == 0 &&
+                    footer.index_offset + (uint64_t)footer.index_entries * sizeof(sessionIndexEntry) +
+                    (uint64_t)footer.streams * sizeof(sessionStreamEntry) + sizeof(footer) == size;
+    }
+
+    if(has_index){
+        const uint8_t *index = data + footer.index_offset;
+        for(uint32_t i = 0; i < footer.index_entries; ++i){
+            sessionIndexEntry entry;
+            memcpy(&entry, index + i * sizeof(entry), sizeof(entry));
+            if(entry.offset + sizeof(sessionRecordHeader) + entry.payload_bytes > footer.index_offset){
+                continue;
+            }
+            sessionRecordHeader record;
+            record.magic = SESSION_RECORD_MAGIC;
+            record.stream_id = entry.stream_id;
+            record.format = entry.format;
+            record.device_timestamp = entry.device_timestamp;
+            record.payload_bytes = entry.payload_bytes;
+            record.host_time_ns = entry.host_time_ns;
+            addRecord(segment, entry.offset, record);
+        }
+
+        const uint8_t *streams = index + (uint64_t)footer.index_entries * sizeof(sessionIndexEntry);
+        for(uint32_t i = 0; i < footer.streams; ++i){
+            sessionStreamEntry stream;
+            memcpy(&stream, streams + i * sizeof(stream), sizeof(stream));
+            stream.name[sizeof(stream.name) - 1] = 0;
+            m_streams[stream.stream_id] = stream;
+        }
+        return true;
+    }
+
+    //!the recording was interrupted, the records written are found walking their headers
+    uint64_t offset = sizeof(header);
+    while(offset + sizeof(sessionRecordHeader) <= size){
+        sessionRecordHeader record;
+        memcpy(&record, data + offset, sizeof(record));
+        if(record.magic != SESSION_RECORD_MAGIC || offset + sizeof(record) + record.payload_bytes > size){
+            break;
+        }
+        addRecord(segment, offset, record);
+        if(m_streams.find(record.stream_id) == m_streams.end()){
+            sessionStreamEntry stream;
+            memset(&stream, 0, sizeof(stream));
+            stream.stream_id = record.stream_id;
+            stream.format = record.format;
+            m_streams[record.stream_id] = stream;
+        }
+        offset += sizeof(record) + paddedBytes(record.payload_bytes);
+    }
+    qDebug()<<"Session segment without index, records found walking it"<<m_segments[segment].file->fileName();
+    return true;
+}
+
+void sessionContainerReader::addRecord(uint32_t segment, uint64_t offset, const sessionRecordHeader &header)
+{
+    int64_t device_ms = timestampToMilliseconds(header.device_timestamp);
+    int64_t host_ms = header.host_time_ns / 1000000;
+    if(!m_has_reference){
+        m_reference_device_ms = device_ms;
+        m_reference_host_ms = host_ms;
+        m_has_reference = true;
+    }
+
+    //!the device time restarts at midnight, the host time tells the days elapsed since the reference
+    int64_t drift = (host_ms - m_reference_host_ms) - (device_ms - m_reference_device_ms);
+    int64_t days = std::llround(drift / (double)milliseconds_per_day);
+
+    recordLocation location;
+    location.device_time_ms = device_ms + days * milliseconds_per_day;
+    location.host_time_ns = header.host_time_ns;
+    location.segment = segment;
+    location.offset = offset;
+    m_records[header.stream_id].push_back(location);
+}
+
+bool sessionContainerReader::makeView(const recordLocation &location, sessionRecordView &record)
+{
+    const uint8_t *data = m_segments[location.segment].data + location.offset;
+
+    sessionRecordHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    record.stream_id = header.stream_id;
+    record.format = header.format;
+    record.device_timestamp = header.device_timestamp;
+    record.host_time_ns = header.host_time_ns;
+    record.segment_index = location.segment;
+    record.payload_bytes = header.payload_bytes;
+    record.payload = data + sizeof(header);
+    return header.magic == SESSION_RECORD_MAGIC;
+}
+
+template <typename K>
+int64_t sessionContainerReader::nearestPosition(const std::vector<recordLocation> &locations, K key, K recordLocation::*member)
+{
+    auto after = std::lower_bound(locations.begin(), locations.end(), key, [member](const recordLocation &location, K value){
+        return location.*member < value;
+    });
+
+    if(after == locations.begin()){
+        return 0;
+    }
+    if(after == locations.end()){
+        return locations.size() - 1;
+    }
+    auto before = after - 1;
+    //!ties go to the earlier record
+    return ((*after).*member - key < key - (*before).*member) ? (after - locations.begin()) : (before - locations.begin());
+}
@@ -0,0 +1,154 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SESSIONCONTAINERREADER_H
+#define SESSIONCONTAINERREADER_H
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QFile>
+
+#include "sessionContainerFormat.h"
+#include "pointCloudCodec.h"
+
+//! @brief  Record of a session as it is in the mapped segment, the payload is not copied
+//!         and it is valid while the reader is open
+typedef struct sessionRecordView{
+    uint16_t stream_id;
+    uint16_t format;
+    uint32_t device_timestamp;
+    uint64_t host_time_ns;
+    uint32_t segment_index;
+    uint32_t payload_bytes;
+    const uint8_t *payload;
+}sessionRecordView;
+
+//! @brief  Reads the sessions recorded by sessionContainerWriter. The segments are mapped
+//!         in memory, only their indexes are read when the session is opened, and the
+//!         records of every stream are sorted by time so a frame is found by binary search.
+//!         Segments without index, from an interrupted recording, are walked once instead.
+//!         The payloads are given as they were recorded, decodePointCloud gives the points of
+//!         the point cloud records, compressed or not.
+class sessionContainerReader
+{
+public:
+    sessionContainerReader();
+
+    ~sessionContainerReader();
+
+    //! @brief  Maps the segments of a session and loads their indexes
+    //! @param  folder Folder of the session
+    //! @return false if there are no readable segments
+    bool open(const std::string &folder);
+
+    //! @brief  Unmaps the segments, the record views returned become invalid
+    void close();
+
+    //! @brief  Returns the streams found in the session
+    std::vector<sessionStreamEntry> getStreams();
+
+    //! @brief  Returns the number of records of a stream
+    size_t getNumberOfRecords(uint16_t stream_id);
+
+    //! @brief  Returns a record of a stream by its position in time order
+    //! @param  stream_id Stream
+    //! @param  position From 0 to getNumberOfRecords() - 1
+    //! @param  record Returns the view of the record
+    //! @return false if there is no such record
+    bool getRecord(uint16_t stream_id, size_t position, sessionRecordView &record);
+
+    //! @brief  Finds the record of a stream captured nearest to a device time
+    //! @param  stream_id Stream
+    //! @param  device_timestamp Time of the device (hhmmssmmm), as the records are stamped
+    //! @param  record Returns the view of the record
+    //! @return position of the record, -1 if the stream has no records
+    int64_t findNearest(uint16_t stream_id, uint32_t device_timestamp, sessionRecordView &record);
+
+    //! @brief  Finds the record of a stream written nearest to a host time
+    //! @param  host_time_ns Host time since epoch
+    //! @return position of the record, -1 if the stream has no records
+    int64_t findNearestHostTime(uint16_t stream_id, uint64_t host_time_ns, sessionRecordView &record);
+
+    //! @brief  Returns the points of a point cloud record, decoding them if it was recorded compressed
+    //! @param  record Record of a point cloud stream, session_format_pointcloud or session_format_pointcloud_bpc
+    //! @param  points Returns the points of the frame
+    //! @return false if the record is not a valid point cloud
+    bool decodePointCloud(const sessionRecordView &record, std::vector<tPointPcd> &points);
+
+private:
+
+    typedef struct recordLocation{
+        int64_t device_time_ms;     //!< unwrapped past midnight
+        uint64_t host_time_ns;
+        uint32_t segment;
+        uint64_t offset;
+    }recordLocation;
+
+    typedef struct mappedSegment{
+        std::unique_ptr<QFile> file;
+        const uint8_t *data;
+        uint64_t size;
+    }mappedSegment;
+
+    //! @brief  Adds the records of a segment from its index, or walking them if it has none
+    bool loadSegment(uint32_t segment);
+
+    void addRecord(uint32_t segment, uint64_t offset, const sessionRecordHeader &header);
+
+    bool makeView(const recordLocation &location, sessionRecordView &record);
+
+    //! @brief  Returns the position of the record nearest to a key in a sorted stream
+    template <typename K>
+    int64_t nearestPosition(const std::vector<recordLocation> &locations, K key, K recordLocation::*member);
+
+private:
+
+    std::vector<mappedSegment> m_segments;
+
+    std::map<uint16_t, sessionStreamEntry> m_streams;
+
+    //! records of every stream sorted by device time
+    std::map<uint16_t, std::vector<recordLocation> > m_records;
+
+    //! records of every stream sorted by host time, the workers of a stream can write them out of order
+    std::map<uint16_t, std::vector<recordLocation> > m_records_by_host_time;
+
+    //! keeps its work buffers between the frames decoded
+    pointCloudCodec m_point_cloud_codec;
+
+    //! the first record unwraps the device times of the others past midnight
+    bool m_has_reference;
+    int64_t m_reference_device_ms;
+    int64_t m_reference_host_ms;
+};
+
+#endif // SESSIONCONTAINERREADER_H
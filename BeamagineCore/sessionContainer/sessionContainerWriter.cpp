@@ -0,0 +1,293 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sessionContainerWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <QDebug>
+
+const uint64_t sessionContainerWriter::default_segment_bytes;
+
+static uint64_t hostTimeNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t paddedBytes(uint32_t bytes)
+{
+    return (bytes + SESSION_RECORD_ALIGNMENT - 1) & ~(uint32_t)(SESSION_RECORD_ALIGNMENT - 1);
+}
+
+sessionContainerWriter::sessionContainerWriter()
+{
+    m_segment_bytes = default_segment_bytes;
+    m_segment_index = 0;
+    m_segment_offset = 0;
+    m_chunk = NULL;
+    m_chunk_used = 0;
+    memset(&m_statistics, 0, sizeof(m_statistics));
+}
+
+sessionContainerWriter::~sessionContainerWriter()
+{
+    close();
+}
+
+bool sessionContainerWriter::open(const std::string &folder, uint64_t segment_bytes, const batchedWriterSettings &file_settings)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try{
+        if(m_file.isOpen()){
+            closeSegment();
+        }
+        m_folder = folder;
+        if(!m_folder.empty() && m_folder.back() != '/'){
+            m_folder += "/";
+        }
+        m_segment_bytes = segment_bytes;
+        m_segment_index = 0;
+        m_chunk = NULL;
+        m_chunk_used = 0;
+        memset(&m_statistics, 0, sizeof(m_statistics));
+        if(!m_file.setup(file_settings)){
+            return false;
+        }
+        m_statistics.backend = m_file.getBackend();
+
+        return openSegment();
+
+    }catch(...){
+        qDebug()<<"Unhandled error at sessionContainerWriter::open";
+    }
+    return false;
+}
+
+void sessionContainerWriter::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try{
+        if(m_file.isOpen()){
+            closeSegment();
+        }
+        //!the chunks are not kept while the writer waits to be released
+        m_file.release();
+    }catch(...){
+        qDebug()<<"Unhandled error at sessionContainerWriter::close";
+    }
+}
+
+bool sessionContainerWriter::isOpen()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.isOpen();
+}
+
+void sessionContainerWriter::addStream(uint16_t stream_id, uint16_t format, const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sessionStreamEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.stream_id = stream_id;
+    entry.format = format;
+    strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+    m_streams[stream_id] = entry;
+}
+
+bool sessionContainerWriter::writeRecord(uint16_t stream_id, uint16_t format, uint32_t device_timestamp, const void *payload, uint32_t payload_bytes)
+{
+    return writeRecord(stream_id, format, device_timestamp, NULL, 0, payload, payload_bytes);
+}
+
+bool sessionContainerWriter::writeRecord(uint16_t stream_id, uint16_t format, uint32_t device_timestamp,
+                                         const void *header, uint32_t header_bytes, const void *payload, uint32_t payload_bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try{
+        if(!m_file.isOpen()){
+            return false;
+        }
+
+        sessionRecordHeader record;
+        record.magic = SESSION_RECORD_MAGIC;
+        record.stream_id = stream_id;
+        record.format = format;
+        record.device_timestamp = device_timestamp;
+        record.payload_bytes = header_bytes + payload_bytes;
+        record.host_time_ns = hostTimeNs();
+
+        uint64_t record_bytes = sizeof(record) + paddedBytes(record.payload_bytes);
+
+        //!a record larger than a segment gets a segment of its own
+        if(!m_index.empty() && m_segment_offset + record_bytes > m_segment_bytes){
+            closeSegment();
+            m_segment_index++;
+            if(!openSegment()){
+                return false;
+            }
+        }
+
+        sessionIndexEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.offset = m_segment_offset;
+        entry.host_time_ns = record.host_time_ns;
+        entry.device_timestamp = device_timestamp;
+        entry.payload_bytes = record.payload_bytes;
+        entry.stream_id = stream_id;
+        entry.format = format;
+
+        static const uint8_t padding[SESSION_RECORD_ALIGNMENT] = {0};
+        bool written = append(&record, sizeof(record)) &&
+                       append(header, header_bytes) &&
+                       append(payload, payload_bytes) &&
+                       append(padding, paddedBytes(record.payload_bytes) - record.payload_bytes);
+        if(!written){
+            return false;
+        }
+
+        m_index.push_back(entry);
+        m_streams[stream_id].stream_id = stream_id;
+        m_streams[stream_id].records++;
+        m_statistics.records++;
+        return true;
+
+    }catch(...){
+        qDebug()<<"Unhandled error at sessionContainerWriter::writeRecord";
+    }
+    return false;
+}
+
+std::string sessionContainerWriter::getFolder()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_folder;
+}
+
+sessionContainerStatistics sessionContainerWriter::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+std::string sessionContainerWriter::getSegmentPath(const std::string &folder, uint32_t segment_index)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "session_%06u.bsc", segment_index);
+    return folder + name;
+}
+
+bool sessionContainerWriter::openSegment()
+{
+    std::string path = getSegmentPath(m_folder, m_segment_index);
+    if(!m_file.open(path)){
+        qDebug()<<"Session segment can not be created"<<path.c_str();
+        return false;
+    }
+
+    m_segment_offset = 0;
+    m_index.clear();
+    for(auto &stream : m_streams){
+        stream.second.records = 0;
+    }
+
+    sessionSegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SESSION_SEGMENT_MAGIC, sizeof(header.magic));
+    header.version = SESSION_FORMAT_VERSION;
+    header.segment_index = m_segment_index;
+    header.created_ms = hostTimeNs() / 1000000;
+
+    m_statistics.segments++;
+    return append(&header, sizeof(header));
+}
+
+void sessionContainerWriter::closeSegment()
+{
+    sessionSegmentFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.index_offset = m_segment_offset;
+    footer.index_entries = m_index.size();
+    footer.streams = m_streams.size();
+    memcpy(footer.magic, SESSION_FOOTER_MAGIC, sizeof(footer.magic));
+
+    append(m_index.data(), m_index.size() * sizeof(sessionIndexEntry));
+    for(auto &stream : m_streams){
+        append(&stream.second, sizeof(sessionStreamEntry));
+    }
+    append(&footer, sizeof(footer));
+    flushChunk();
+
+    if(!m_file.close()){
+        qDebug()<<"Session segment not completely written"<<m_segment_index;
+    }
+    m_chunk = NULL;
+    m_index.clear();
+}
+
+bool sessionContainerWriter::append(const void *data, size_t bytes)
+{
+    const uint8_t *source = (const uint8_t*)data;
+    m_segment_offset += bytes;
+
+    //!the data is always copied, the chunks are still being written when this returns
+    while(bytes > 0){
+        if(m_chunk == NULL){
+            m_chunk = m_file.getBuffer();
+            if(m_chunk == NULL){
+                return false;
+            }
+        }
+        size_t to_copy = std::min(bytes, m_file.getBufferBytes() - m_chunk_used);
+        memcpy(&m_chunk[m_chunk_used], source, to_copy);
+        m_chunk_used += to_copy;
+        source += to_copy;
+        bytes -= to_copy;
+        if(m_chunk_used == m_file.getBufferBytes() && !flushChunk()){
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sessionContainerWriter::flushChunk()
+{
+    if(m_chunk_used == 0){
+        return true;
+    }
+    bool written = m_file.submit(m_chunk_used);
+    m_statistics.writes++;
+    m_statistics.bytes_written += m_chunk_used;
+    m_statistics.waits = m_file.getStatistics().waits;
+    m_chunk = NULL;
+    m_chunk_used = 0;
+    if(!written){
+        qDebug()<<"Session segment write failed"<<m_segment_index;
+    }
+    return written;
+}
@@ -0,0 +1,142 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SESSIONCONTAINERWRITER_H
+#define SESSIONCONTAINERWRITER_H
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "batchedFileWriter.h"
+#include "sessionContainerFormat.h"
+
+typedef struct sessionContainerStatistics{
+    uint32_t segments;
+    uint64_t records;
+    uint64_t bytes_written;
+    uint64_t writes;                //!< chunks given to the file writer
+    uint64_t waits;                 //!< times a record waited for a chunk still being written
+    int backend;                    //!< one of batchedWriterBackends
+}sessionContainerStatistics;
+
+//! @brief  Appends the frames of all the streams of a recording in a few large segment
+//!         files instead of one file per frame. The records are gathered in a chunk in
+//!         memory that is written when it is full, so the disk only gets large sequential
+//!         writes, and several chunks can be in flight while the next one is filled.
+//!         The index of a segment is written when it is closed.
+//!         Several threads can write records at once.
+class sessionContainerWriter
+{
+public:
+    sessionContainerWriter();
+
+    //! @brief  Closes the session, the records still in memory are written
+    ~sessionContainerWriter();
+
+    //! @brief  Starts a session, the first segment is created
+    //! @param  folder Existing folder for the segments
+    //! @param  segment_bytes A new segment is started when a record would not fit in this size
+    //! @param  file_settings Chunks, backend, direct I/O and preallocation of the segment files
+    //! @return false if the first segment can not be created
+    bool open(const std::string &folder, uint64_t segment_bytes = default_segment_bytes,
+              const batchedWriterSettings &file_settings = batchedFileWriter::defaultSettings());
+
+    //! @brief  Writes the records left, the index and closes the last segment
+    void close();
+
+    bool isOpen();
+
+    //! @brief  Describes a stream in the table of the segments
+    //! @param  stream_id Id written in its records
+    //! @param  format One of sessionRecordFormats
+    //! @param  name Name of the stream, up to 23 characters
+    //! @return none
+    void addStream(uint16_t stream_id, uint16_t format, const std::string &name);
+
+    //! @brief  Appends a record
+    //! @param  stream_id Stream of the record
+    //! @param  format One of sessionRecordFormats
+    //! @param  device_timestamp Timestamp of the frame (hhmmssmmm)
+    //! @param  payload Content of the record
+    //! @param  payload_bytes Size of the content
+    //! @return false if the record could not be written
+    bool writeRecord(uint16_t stream_id, uint16_t format, uint32_t device_timestamp, const void *payload, uint32_t payload_bytes);
+
+    //! @brief  Appends a record whose content is in two parts, a header and its data
+    bool writeRecord(uint16_t stream_id, uint16_t format, uint32_t device_timestamp,
+                     const void *header, uint32_t header_bytes, const void *payload, uint32_t payload_bytes);
+
+    std::string getFolder();
+
+    sessionContainerStatistics getStatistics();
+
+    //! @brief  Returns the path of a segment of a session
+    static std::string getSegmentPath(const std::string &folder, uint32_t segment_index);
+
+    static const uint64_t default_segment_bytes = 1024ull * 1024 * 1024;
+
+private:
+
+    //! @brief  Creates the next segment and writes its header, call it locked
+    bool openSegment();
+
+    //! @brief  Writes the records left, the index, the stream table and the footer, call it locked
+    void closeSegment();
+
+    //! @brief  Adds bytes to the chunk, it is written when it is full, call it locked
+    bool append(const void *data, size_t bytes);
+
+    //! @brief  Gives the chunk to the file writer, call it locked
+    bool flushChunk();
+
+private:
+
+    std::mutex m_mutex;
+
+    std::string m_folder;
+    batchedFileWriter m_file;
+
+    uint64_t m_segment_bytes;
+    uint32_t m_segment_index;
+    //! bytes of the segment, including the ones still in the chunk
+    uint64_t m_segment_offset;
+
+    //! buffer of the file writer being filled, NULL until a record needs it
+    uint8_t *m_chunk;
+    size_t m_chunk_used;
+
+    std::vector<sessionIndexEntry> m_index;
+    std::map<uint16_t, sessionStreamEntry> m_streams;
+
+    sessionContainerStatistics m_statistics;
+};
+
+#endif // SESSIONCONTAINERWRITER_H
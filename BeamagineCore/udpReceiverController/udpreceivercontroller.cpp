@@ -51,6 +51,9 @@ udpReceiverController::udpReceiverController(QObject *parent) : QObject(parent)
     m_error_code = 0;
     m_read_temperatures = false;
 
+    m_pipeline = NULL;
+    m_clusters_emitted = false;
+
     m_event_handlers.clear();
 
     m_controller_thread = new QThread();
@@ -65,6 +68,17 @@ void udpReceiverController::setIpAddress(QString address)
     m_address = address;
 }
 
+void udpReceiverController::setPointCloudPipeline(pointCloudPipeline *pipeline)
+{
+    m_pipeline = pipeline;
+}
+
+void udpReceiverController::setPointCloudListener(std::function<void(const int32_t*, uint32_t)> listener)
+{
+    std::lock_guard<std::mutex> lock(m_listener_mutex);
+    m_pointcloud_listener = listener;
+}
+
 void udpReceiverController::setPort(qint16 port)
 {
     m_udp_port = port;
@@ -289,6 +303,7 @@ void udpReceiverController::readThermalData()
 void udpReceiverController::readPointcloud(){
 
     int points_received = 1;
+    organizedFrame *organized_frame = NULL;
     socklen_t socket_len = sizeof(m_socket);
     char* buffer = NULL;
     buffer = (char*)malloc(64004);
@@ -323,6 +338,13 @@ void udpReceiverController::readPointcloud(){
             memcpy(&m_timestamp, &buffer[13], sizeof(uint32_t));
             m_is_reading_pointcloud = true;
             points_received = 1;
+
+            //!the organized view is filled as the packets arrive, only when a stage uses it
+            organized_frame = NULL;
+            if(m_pipeline != NULL && m_pipeline->usesOrganizedFrame()){
+                organized_frame = m_pipeline->getOrganizedInput();
+                organized_frame->reset();
+            }
             emit pointcloudHeaderReceived(suma_1, suma_2);
         }
         else if(size_read == 1 && m_is_reading_pointcloud){
@@ -330,10 +352,40 @@ void udpReceiverController::readPointcloud(){
             m_is_reading_pointcloud = false;
 
             //if(m_pointcloud_data != NULL){
-            int32_t *data_received = (int32_t*)malloc(sizeof(int32_t)*(m_pointcloud_size*5)+1);
-            memcpy(&data_received[0], &m_pointcloud_data[0], sizeof(int32_t)*((m_pointcloud_size*5)+1));
+            int32_t *data_received = (int32_t*)malloc(sizeof(int32_t)*((m_pointcloud_size*5)+1));
+            int32_t foreground_points = m_pointcloud_size;
+            if(m_pipeline != NULL){
+                //!host processing runs before the frame is shown or saved
+                foreground_points = m_pipeline->process(m_pointcloud_data, data_received, m_timestamp);
+
+                //!an empty list is sent once so the boxes of the last objects are removed
+                std::vector<pointCloudCluster> clusters = m_pipeline->getLastClusters();
+                if(!clusters.empty() || m_clusters_emitted){
+                    emit clustersReadyToShow(clusters, m_timestamp);
+                }
+                m_clusters_emitted = !clusters.empty();
+            }else{
+                memcpy(&data_received[0], &m_pointcloud_data[0], sizeof(int32_t)*((m_pointcloud_size*5)+1));
+            }
             memset(m_pointcloud_data, 0, buffer_size);
-            emit pointcloudReadyToShow(data_received, m_timestamp);
+
+            //!the viewers get a shaded copy, the frame saved keeps the colors of the device
+            int32_t *shaded_data = NULL;
+            if(m_pipeline != NULL && m_pipeline->getNormalEstimation()->isEnabled()){
+                shaded_data = (int32_t*)malloc(sizeof(int32_t)*((data_received[0]*5)+1));
+                if(!m_pipeline->shadeLastFrame(data_received, shaded_data)){
+                    free(shaded_data);
+                    shaded_data = NULL;
+                }
+            }
+            {
+                //!the lock is kept during the call, the listener is not removed while it runs
+                std::lock_guard<std::mutex> lock(m_listener_mutex);
+                if(m_pointcloud_listener){
+                    m_pointcloud_listener(shaded_data != NULL ? shaded_data : data_received, m_timestamp);
+                }
+            }
+            emit pointcloudReadyToShow(data_received, m_timestamp, foreground_points, shaded_data);
             //free(m_pointcloud_data);
             //m_pointcloud_data = NULL;
             //}
@@ -345,6 +397,9 @@ void udpReceiverController::readPointcloud(){
             int32_t points = 0;
             memcpy(&points, &buffer[0], 4); //!copy number points in the package
             memcpy(&m_pointcloud_data[points_received], &buffer[4], (sizeof(int32_t)*(points*5)));
+            if(organized_frame != NULL){
+                organized_frame->addPoints((tPointPcd*)&m_pointcloud_data[points_received], (points_received - 1) / 5, points);
+            }
             points_received+=points*5;
             //}
 
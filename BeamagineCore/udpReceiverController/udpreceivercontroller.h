@@ -34,6 +34,8 @@
 #include <QCoreApplication>
 
 #include <stdint.h>
+#include <functional>
+#include <mutex>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -50,6 +52,8 @@
 
 #include <udpReceiverControllerMessages.h>
 
+#include <pointCloudPipeline.h>
+
 class udpReceiverController : public QObject
 {
     Q_OBJECT
@@ -60,6 +64,19 @@ public:
 
     void setPort(qint16 port);
 
+    //! @brief  Sets the host processing applied to every point cloud received
+    //! @param  pipeline Pipeline to use, NULL to forward the point clouds as received
+    //! @return none
+    void setPointCloudPipeline(pointCloudPipeline *pipeline);
+
+    //! @brief  Sets a function called on the receiver thread with every point cloud, after
+    //!         the host processing and before it is sent to the main thread
+    //! @param  listener Function called with the point cloud and its timestamp, it must
+    //!         not keep the pointer. An empty function removes it, once this returns the
+    //!         previous listener is not running and is not called again.
+    //! @return none
+    void setPointCloudListener(std::function<void(const int32_t *pointcloud_data, uint32_t timestamp)> listener);
+
     void doReadPointcloud(bool read);
 
     void doReadImageRgb(bool read);
@@ -88,7 +105,11 @@ signals:
 
     void temperatureDataReceived(float *temperature_data, uint16_t height, uint16_t width, uint32_t timestamp);
 
-    void pointcloudReadyToShow(int32_t *pointcloud_data, uint32_t timestamp);
+    //! shaded_data is the frame with the points shaded for the viewers, NULL if the shading is off.
+    //! The receiver of the signal frees both buffers.
+    void pointcloudReadyToShow(int32_t *pointcloud_data, uint32_t timestamp, int32_t foreground_points, int32_t *shaded_data);
+
+    void clustersReadyToShow(std::vector<pointCloudCluster> clusters, uint32_t timestamp);
 
     void pointcloudHeaderReceived(int32_t suma_1, int32_t suma_2);
 
@@ -141,6 +162,10 @@ private:
 
     int32_t m_pointcloud_size;
     int32_t *m_pointcloud_data;
+    pointCloudPipeline *m_pipeline;
+    std::function<void(const int32_t*, uint32_t)> m_pointcloud_listener;
+    std::mutex m_listener_mutex;
+    bool m_clusters_emitted;
     quint16 m_udp_port;
 
     uint16_t m_image_width;
@@ -28,33 +28,80 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 
 SOURCES += \
+        BeamagineCore/pclPointCloudViewer/displayedPointCloud.cpp \
         BeamagineCore/pclPointCloudViewer/pclPointCloudViewerController.cpp \
         BeamagineCore/pclPointCloudViewer/pclPointCloudViewerControllerMessages.cpp \
+        BeamagineCore/pclPointCloudViewer/offscreenRenderer.cpp \
+        BeamagineCore/pclPointCloudViewer/pointCloudAccumulator.cpp \
+        BeamagineCore/pclPointCloudViewer/pointPickingService.cpp \
+        BeamagineCore/pclPointCloudViewer/renderScheduler.cpp \
+        BeamagineCore/glPointCloudViewer/glPointCloudWidget.cpp \
+        BeamagineCore/pointCloudProcessing/voxelGridIndex.cpp \
+        BeamagineCore/pointCloudProcessing/pointCloudFilter.cpp \
+        BeamagineCore/pointCloudProcessing/pointCloudPipeline.cpp \
+        BeamagineCore/pointCloudProcessing/backgroundModel.cpp \
+        BeamagineCore/pointCloudProcessing/outlierFilter.cpp \
+        BeamagineCore/pointCloudProcessing/pointPartition.cpp \
+        BeamagineCore/pointCloudProcessing/euclideanClustering.cpp \
+        BeamagineCore/pointCloudProcessing/organizedFrame.cpp \
+        BeamagineCore/pointCloudProcessing/cameraFusion.cpp \
+        BeamagineCore/pointCloudProcessing/depthImageRasterizer.cpp \
+        BeamagineCore/pointCloudProcessing/normalEstimation.cpp \
+        BeamagineCore/pointCloudProcessing/mortonOrder.cpp \
+        BeamagineCore/pointCloudProcessing/pointCloudCodec.cpp \
+        BeamagineCore/codecs/streamCoder.cpp \
+        BeamagineCore/beam_parallel.cpp \
         BeamagineCore/udpReceiverController/udpReceiverControllerMessages.cpp \
         BeamagineCore/udpReceiverController/udpreceivercontroller.cpp \
         BeamagineCore/saveDataManager/imageSaveDataExecutor.cpp \
-        BeamagineCore/saveDataManager/imageSaveDataExecutorMessages.cpp \
         BeamagineCore/saveDataManager/pointCloudSaveDataExecutor.cpp \
-        BeamagineCore/saveDataManager/pointCloudSaveDataExecutorMessages.cpp \
         BeamagineCore/saveDataManager/saveDataManager.cpp \
-        BeamagineCore/saveDataManager/saveDataManagerMessages.cpp \
+        BeamagineCore/saveDataManager/temperatureCodec.cpp \
+        BeamagineCore/saveDataManager/videoStreamWriter.cpp \
+        BeamagineCore/sessionContainer/batchedFileWriter.cpp \
+        BeamagineCore/sessionContainer/sessionContainerReader.cpp \
+        BeamagineCore/sessionContainer/sessionContainerWriter.cpp \
         imageviewerform.cpp \
         main.cpp \
         mainwindow.cpp
 
 HEADERS += \
+        BeamagineCore/pclPointCloudViewer/displayedPointCloud.h \
         BeamagineCore/pclPointCloudViewer/pclPointCloudViewerController.h \
         BeamagineCore/pclPointCloudViewer/pclPointCloudViewerControllerMessages.h \
+        BeamagineCore/pclPointCloudViewer/offscreenRenderer.h \
+        BeamagineCore/pclPointCloudViewer/pointCloudAccumulator.h \
+        BeamagineCore/pclPointCloudViewer/pointPickingService.h \
+        BeamagineCore/pclPointCloudViewer/renderScheduler.h \
+        BeamagineCore/glPointCloudViewer/glPointCloudWidget.h \
+        BeamagineCore/pointCloudProcessing/voxelGridIndex.h \
+        BeamagineCore/pointCloudProcessing/pointCloudFilter.h \
+        BeamagineCore/pointCloudProcessing/pointCloudPipeline.h \
+        BeamagineCore/pointCloudProcessing/backgroundModel.h \
+        BeamagineCore/pointCloudProcessing/outlierFilter.h \
+        BeamagineCore/pointCloudProcessing/pointPartition.h \
+        BeamagineCore/pointCloudProcessing/euclideanClustering.h \
+        BeamagineCore/pointCloudProcessing/organizedFrame.h \
+        BeamagineCore/pointCloudProcessing/cameraFusion.h \
+        BeamagineCore/pointCloudProcessing/depthImageRasterizer.h \
+        BeamagineCore/pointCloudProcessing/normalEstimation.h \
+        BeamagineCore/pointCloudProcessing/mortonOrder.h \
+        BeamagineCore/pointCloudProcessing/pointCloudCodec.h \
+        BeamagineCore/codecs/streamCoder.h \
         BeamagineCore/udpReceiverController/udpReceiverControllerMessages.h \
         BeamagineCore/udpReceiverController/udpreceivercontroller.h \
         BeamagineCore/saveDataManager/imageSaveDataExecutor.h \
-        BeamagineCore/saveDataManager/imageSaveDataExecutorMessages.h \
         BeamagineCore/saveDataManager/pointCloudSaveDataExecutor.h \
-        BeamagineCore/saveDataManager/pointCloudSaveDataExecutorMessages.h \
         BeamagineCore/saveDataManager/saveDataManager.h \
-        BeamagineCore/saveDataManager/saveDataManagerMessages.h \
         BeamagineCore/saveDataManager/saveDataStructs.h \
+        BeamagineCore/saveDataManager/temperatureCodec.h \
+        BeamagineCore/saveDataManager/videoStreamWriter.h \
+        BeamagineCore/sessionContainer/batchedFileWriter.h \
+        BeamagineCore/sessionContainer/sessionContainerFormat.h \
+        BeamagineCore/sessionContainer/sessionContainerReader.h \
+        BeamagineCore/sessionContainer/sessionContainerWriter.h \
         BeamagineCore/beam_aux.h \
+        BeamagineCore/beam_parallel.h \
         imageviewerform.h \
         mainwindow.h
 
@@ -66,7 +113,11 @@ INCLUDEPATH += \
         libs/libL3Cam/ \
         BeamagineCore/udpReceiverController/ \
         BeamagineCore/pclPointCloudViewer/ \
+        BeamagineCore/glPointCloudViewer/ \
+        BeamagineCore/pointCloudProcessing/ \
+        BeamagineCore/codecs/ \
         BeamagineCore/saveDataManager/ \
+        BeamagineCore/sessionContainer/ \
         BeamagineCore/
 
 
@@ -83,8 +134,15 @@ LIBS += -L$(HOME)/openCV4.5.5/install/lib/ \
     -lopencv_highgui \
     -lopencv_imgproc \
     -lopencv_imgcodecs \
+    -lopencv_videoio \
     -lopencv_dnn
 
+#FFMPEG (libavcodec-dev, libavformat-dev and libswscale-dev, with libx264 and libx265)
+LIBS += -lavformat \
+    -lavcodec \
+    -lswscale \
+    -lavutil
+
 equals(OS_INFO, 20.04):{
     #PCL
     INCLUDEPATH += $(HOME)/pcl-1.9.0/libs/include/pcl-1.9 \
@@ -151,6 +209,11 @@ INCLUDEPATH += 'D:/OpenCV/opencv/build/include/'
 
 LIBS += -L"$$PWD/libs/opencv4/" -lopencv_world440
 
+#FFMPEG (shared build with libx264 and libx265)
+INCLUDEPATH += 'D:/ffmpeg/include/'
+
+LIBS += -L'D:/ffmpeg/lib/' -lavformat -lavcodec -lswscale -lavutil
+
 #PCL
 PCL_BASE_PATH = "D:/PCL_1.13.1/PCL 1.13.1/"
 
@@ -27,14 +27,126 @@
 
 #include "mainwindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+
+#include <csignal>
+
+#include <pclPointCloudViewerController.h>
+
+//! Set by the signal handler, a timer of the event loop quits the application
+static volatile std::sig_atomic_t quit_requested = 0;
+
+static void quitOnSignal(int signal_number)
+{
+    Q_UNUSED(signal_number);
+    //!only a flag can be set safely from a signal handler
+    quit_requested = 1;
+}
+
+//! @brief  Reads a list of comma separated numbers
+//! @param  text Numbers separated by commas
+//! @param  values Returns the numbers read
+//! @param  count Number of values expected
+//! @return true if there were count valid numbers
+static bool parseValues(const QString &text, float *values, int count)
+{
+    QStringList items = text.split(",");
+    if(items.size() != count){
+        return false;
+    }
+    for(int i = 0; i < count; ++i){
+        bool ok = false;
+        values[i] = items[i].toFloat(&ok);
+        if(!ok){
+            return false;
+        }
+    }
+    return true;
+}
 
 int main(int argc, char *argv[])
 {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("L3Cam viewer");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption headless_option("headless", "Runs without windows, finds and starts the first device.");
+    QCommandLineOption images_option("render-images", "Renders the point clouds offscreen to a PNG sequence in <directory>.", "directory");
+    QCommandLineOption video_option("render-video", "Renders the point clouds offscreen to an MJPG video <file>.", "file");
+    QCommandLineOption size_option("render-size", "Size of the rendered images, 1280x720 by default.", "WxH");
+    QCommandLineOption point_size_option("render-point-size", "Size of the rendered points in pixels, 2 by default.", "pixels");
+    QCommandLineOption fps_option("render-fps", "Frames rendered per second and video frame rate, 10 by default.", "fps");
+    QCommandLineOption camera_option("camera", "Fixed camera eye and target in mm, 0,0,-1500,0,0,20000 by default.", "ex,ey,ez,tx,ty,tz");
+    QCommandLineOption camera_path_option("camera-path", "Camera keyframes, one per line: time_s,ex,ey,ez,tx,ty,tz[,fov].", "file");
+    QCommandLineOption duration_option("duration", "Quits after <seconds> when running headless.", "seconds");
+    parser.addOptions({headless_option, images_option, video_option, size_option, point_size_option,
+                       fps_option, camera_option, camera_path_option, duration_option});
+
+    //!the platform has to be chosen before the application is created
+    QStringList arguments;
+    for(int i = 0; i < argc; ++i){
+        arguments << QString::fromLocal8Bit(argv[i]);
+    }
+    parser.parse(arguments);
+    bool headless = parser.isSet(headless_option);
+    if(headless && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication a(argc, argv);
     qApp->setApplicationVersion("2.0.1");
 
+    parser.process(a);
+
+    offscreenRenderSettings render_settings = offscreenRenderer::getDefaultSettings();
+    render_settings.image_directory = parser.value(images_option);
+    render_settings.video_file = parser.value(video_option);
+    render_settings.camera_path_file = parser.value(camera_path_option);
+    render_settings.enabled = headless || !render_settings.image_directory.isEmpty() || !render_settings.video_file.isEmpty();
+
+    if(parser.isSet(size_option)){
+        QStringList size = parser.value(size_option).split("x");
+        if(size.size() == 2){
+            render_settings.width = size[0].toInt();
+            render_settings.height = size[1].toInt();
+        }
+    }
+    if(parser.isSet(point_size_option)){
+        render_settings.point_size = parser.value(point_size_option).toInt();
+    }
+    if(parser.isSet(fps_option)){
+        render_settings.video_fps = std::max(parser.value(fps_option).toDouble(), 1.0);
+    }
+    if(parser.isSet(camera_option)){
+        float camera[6];
+        if(parseValues(parser.value(camera_option), camera, 6)){
+            std::copy(camera, camera + 3, render_settings.camera.eye);
+            std::copy(camera + 3, camera + 6, render_settings.camera.target);
+        }else{
+            qWarning("Invalid camera, the default one is used");
+        }
+    }
+
+    pclPointCloudViewerController::setOffscreenRendering(render_settings);
+
     MainWindow w;
-    w.show();
+
+    QTimer signal_timer;
+    if(headless){
+        QObject::connect(&signal_timer, &QTimer::timeout, [](){
+            if(quit_requested){
+                QCoreApplication::quit();
+            }
+        });
+        signal_timer.start(100);
+        std::signal(SIGINT, quitOnSignal);
+        std::signal(SIGTERM, quitOnSignal);
+        w.startHeadless(parser.value(duration_option).toInt());
+    }else{
+        w.show();
+    }
 
     return a.exec();
 }
@@ -38,6 +38,7 @@ Q_DECLARE_METATYPE(uint16_t)
 Q_DECLARE_METATYPE(uint8_t)
 Q_DECLARE_METATYPE(int32_t)
 Q_DECLARE_METATYPE(std::vector<detectionImage>)
+Q_DECLARE_METATYPE(std::vector<pointCloudCluster>)
 Q_DECLARE_METATYPE(pointcloudData)
 Q_DECLARE_METATYPE(imageData)
 Q_DECLARE_METATYPE(uint32_t)
@@ -47,6 +48,22 @@ Q_DECLARE_METATYPE(binaryFloatData)
 
 static MainWindow *mainWindowObj = nullptr;
 
+//! Ids of the streams in the session containers
+typedef enum sessionStreams{
+    session_stream_pointcloud = 1,
+    session_stream_rgb,
+    session_stream_polarimetric,
+    session_stream_thermal,
+    session_stream_temperatures
+}sessionStreams;
+
+//! @brief  Shares the pixels of an image with the save queue, the image keeps them
+//!         alive until the last reference is released. It must not be modified after.
+static std::shared_ptr<const uint8_t> shareImage(const cv::Mat &image)
+{
+    return std::shared_ptr<const uint8_t>(image.data, [image](const uint8_t*) {});
+}
+
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
@@ -104,6 +121,25 @@ MainWindow::MainWindow(QWidget *parent) :
     m_rgb_pol_image_reader = new udpReceiverController();
     m_temperatures_reader = new udpReceiverController();
 
+    m_point_cloud_pipeline = new pointCloudPipeline();
+    m_pointcloud_reader->setPointCloudPipeline(m_point_cloud_pipeline);
+
+    //!the embedded viewer takes the frames on the receiver thread, with a single copy
+    glPointCloudWidget *gl_viewer = ui->openGLWidget_point_cloud;
+    m_pointcloud_reader->setPointCloudListener([gl_viewer](const int32_t *pointcloud_data, uint32_t timestamp){
+        if(gl_viewer->isRenderingEnabled()){
+            gl_viewer->writeFrame((const tPointPcd*)&pointcloud_data[1], pointcloud_data[0], timestamp);
+        }
+    });
+
+    m_pipeline_timing_timer = new QTimer();
+    connect(m_pipeline_timing_timer, SIGNAL(timeout()), this, SLOT(pipelineTimingTimerTimeOut()));
+    m_pipeline_timing_timer->start(1000);
+
+    m_save_queues_timer = new QTimer();
+    connect(m_save_queues_timer, SIGNAL(timeout()), this, SLOT(saveQueuesTimerTimeOut()));
+    m_save_queues_timer->start(1000);
+
     m_rgb_port = 6020;
     m_thermal_port = 6030;
     m_pcd_port = 6050;
@@ -141,6 +177,11 @@ MainWindow::MainWindow(QWidget *parent) :
 
     m_temperatures_viewer->setWindowTitle("Thermal data");
 
+    m_depth_image_viewer = new imageViewerForm();
+    m_depth_image_viewer->setWindowTitle("Depth image");
+    m_depth_image_rasterizer = new depthImageRasterizer();
+    m_depth_image_timestamp = 0;
+
     m_save_thermal_image_manager->setDataTypeToSave(images);
     m_save_rgb_image_manager->setDataTypeToSave(images);
     m_save_pointcloud_manager->setDataTypeToSave(pointcloud);
@@ -148,17 +189,28 @@ MainWindow::MainWindow(QWidget *parent) :
 
     m_save_thermal_data_manager->setDataTypeToSave(binaryFloat);
 
+    //!the executors take the frames from their queue as soon as they are free
+    m_save_thermal_image_executor->setSaveDataManager(m_save_thermal_image_manager);
+    m_save_thermal_data_executor->setSaveDataManager(m_save_thermal_data_manager);
+    m_save_rgb_image_executor->setSaveDataManager(m_save_rgb_image_manager);
+    m_save_pointcloud_executor->setSaveDataManager(m_save_pointcloud_manager);
+    m_save_polarimetric_executor->setSaveDataManager(m_save_polarimetric_manager);
+
+    //!png encoding is the slow part of saving, by default half the cores encode every stream
+    ui->spinBox_save_workers->setValue(std::max(1, QThread::idealThreadCount() / 2));
+    ui->lineEdit_save_session_path->setText(QDir::homePath() + "/sessions/");
+
 
     qRegisterMetaType<uint16_t>("uint16_t");
     qRegisterMetaType<uint8_t>("uint8_t");
     qRegisterMetaType<int32_t>("int32_t");
     qRegisterMetaType<uint32_t>("uint32_t");
     qRegisterMetaType<std::vector<detectionImage> >("std::vector<detectionImage>");
-    qRegisterMetaType<pointcloudData>("pointcloudData");
-    qRegisterMetaType<imageData>("imageData");
-    qRegisterMetaType<binaryFloatData>("binaryFloatData");
+    qRegisterMetaType<std::vector<pointCloudCluster> >("std::vector<pointCloudCluster>");
+
+    connect(m_pointcloud_reader, SIGNAL(pointcloudReadyToShow(int32_t*,uint32_t,int32_t,int32_t*)), this, SLOT(pointCloudReadyToShow(int32_t*,uint32_t,int32_t,int32_t*)));
 
-    connect(m_pointcloud_reader, SIGNAL(pointcloudReadyToShow(int32_t*,uint32_t)), this, SLOT(pointCloudReadyToShow(int32_t*,uint32_t)));
+    connect(m_pointcloud_reader, SIGNAL(clustersReadyToShow(std::vector<pointCloudCluster>,uint32_t)), this, SLOT(clustersReadyToShow(std::vector<pointCloudCluster>,uint32_t)));
 
     connect(m_rgb_image_reader, SIGNAL(imageRgbReadyToShow(uint8_t*,uint16_t,uint16_t,uint8_t,std::vector<detectionImage>,uint32_t)),
             this, SLOT(imageRgbReadyToShow(uint8_t*,uint16_t,uint16_t,uint8_t,std::vector<detectionImage>,uint32_t)));
@@ -172,22 +224,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(m_rgb_pol_image_reader, SIGNAL(imageRgbReadyToShow(uint8_t*,uint16_t,uint16_t,uint8_t,std::vector<detectionImage>,uint32_t)),
             this, SLOT(imageRgbPolReadyToShow(uint8_t*,uint16_t,uint16_t,uint8_t,std::vector<detectionImage>,uint32_t)));
 
-    connect(m_save_thermal_image_executor, SIGNAL(executorIsAvailable(bool)), this, SLOT(thermalSaveExecutorIsAvailable(bool)));
-    connect(m_save_thermal_image_manager, SIGNAL(sendImageToSave(imageData)), this, SLOT(thermalImageToSaveReceived(imageData)));
-
-    connect(m_save_thermal_data_executor, SIGNAL(executorIsAvailable(bool)), this, SLOT(thermalDataSaveExecutorAvailable(bool)));
-    connect(m_save_thermal_data_manager, SIGNAL(sendBufferToSave(binaryFloatData)), this, SLOT(thermalDataBufferToSaveReceived(binaryFloatData)));
-
-    connect(m_save_rgb_image_executor, SIGNAL(executorIsAvailable(bool)), this, SLOT(rgbSaveExecutorIsAvailable(bool)));
-    connect(m_save_rgb_image_manager, SIGNAL(sendImageToSave(imageData)), this, SLOT(rgbImageToSaveReceived(imageData)));
-
-    connect(m_save_pointcloud_executor, SIGNAL(executorIsAvailable(bool)), this, SLOT(pointcloudSaveExecutorIsAvailable(bool)));
-    connect(m_save_pointcloud_manager, SIGNAL(sendPointCloudToSave(pointcloudData)), this, SLOT(pointcloudToSaveReceived(pointcloudData)));
-
-    connect(m_save_polarimetric_executor, SIGNAL(executorIsAvailable(bool)), this, SLOT(polSaveExecutorIsAvailable(bool)));
-    connect(m_save_polarimetric_manager, SIGNAL(sendImageToSave(imageData)), this, SLOT(polImageToSaveReceived(imageData)));
-
     m_temperatures_viewer->hide();
+    m_depth_image_viewer->hide();
 
     m_save_data = false;
     m_save_images_counter = 0;
@@ -238,6 +276,8 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    //!the receiver thread keeps running, the viewer it writes to is deleted with the ui
+    m_pointcloud_reader->setPointCloudListener(nullptr);
     delete ui;
 }
 
@@ -246,6 +286,37 @@ void MainWindow::setMainWindowObj(MainWindow *ptr)
     mainWindowObj = ptr;
 }
 
+void MainWindow::startHeadless(int duration_s)
+{
+    connect(qApp, SIGNAL(aboutToQuit()), this, SLOT(stopHeadless()));
+
+    on_pushButton_fast_init_clicked();
+
+    if(duration_s > 0){
+        QTimer::singleShot(duration_s * 1000, qApp, SLOT(quit()));
+    }
+}
+
+void MainWindow::stopHeadless()
+{
+    if(m_device_streaming){
+        STOP_STREAM(m_devices[0]);
+        m_device_streaming = false;
+    }
+    if(m_device_started){
+        STOP_DEVICE(m_devices[0]);
+        m_device_started = false;
+    }
+    if(m_dev_initialized){
+        TERMINATE(m_devices[0]);
+    }
+
+    stopSaveExecutors();
+
+    //!closes the rendered video
+    m_point_cloud_viewer->stopController();
+}
+
 void MainWindow::deviceDetected()
 {
     ui->pushButton_start_device->setEnabled(true);
@@ -409,6 +480,8 @@ void MainWindow::initializePolDefault()
 
 void MainWindow::initializeReceivers()
 {
+    int save_workers = ui->spinBox_save_workers->value();
+
     if(m_lidar_sensor != NULL){
 
         m_pointcloud_reader->setIpAddress(m_server_address);
@@ -417,8 +490,9 @@ void MainWindow::initializeReceivers()
         m_pointcloud_reader->startController();
 
         m_save_pointcloud_executor->setPathToSavePcd(ui->lineEdit_save_pointcloud_path->text());
-        m_save_pointcloud_executor->startController();
         m_save_pointcloud_manager->startController();
+        m_save_pointcloud_executor->setNumberOfWorkers(save_workers);
+        m_save_pointcloud_executor->startController();
     }
 
     if(m_rgb_sensor != NULL || m_allied_narrow_sensor != NULL){
@@ -430,6 +504,7 @@ void MainWindow::initializeReceivers()
 
         m_save_rgb_image_executor->setPathToSaveImages((m_rgb_sensor != NULL) ? ui->lineEdit_save_narrow_path->text() : ui->lineEdit_save_rgb_path->text());
         m_save_rgb_image_manager->startController();
+        m_save_rgb_image_executor->setNumberOfWorkers(save_workers);
         m_save_rgb_image_executor->startController();
     }
 
@@ -442,6 +517,7 @@ void MainWindow::initializeReceivers()
 
         m_save_polarimetric_executor->setPathToSaveImages((m_pol_sensor != NULL) ? ui->lineEdit_save_wide_path->text() : ui->lineEdit_save_pol_path->text());
         m_save_polarimetric_manager->startController();
+        m_save_polarimetric_executor->setNumberOfWorkers(save_workers);
         m_save_polarimetric_executor->startController();
     }
 
@@ -454,10 +530,12 @@ void MainWindow::initializeReceivers()
 
         m_save_thermal_image_executor->setPathToSaveImages(ui->lineEdit_save_thermal_path->text());
         m_save_thermal_image_manager->startController();
+        m_save_thermal_image_executor->setNumberOfWorkers(save_workers);
         m_save_thermal_image_executor->startController();
 
         m_save_thermal_data_executor->setPathToSaveImages(ui->lineEdit_save_thermal_path->text());
         m_save_thermal_data_manager->startController();
+        m_save_thermal_data_executor->setNumberOfWorkers(save_workers);
         m_save_thermal_data_executor->startController();
 
         m_temperatures_reader->setIpAddress(m_server_address);
@@ -509,9 +587,14 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
             event->accept();
 
+            stopSaveExecutors();
+
             if(m_temperatures_viewer->isVisible()){
                 m_temperatures_viewer->close();
             }
+            if(m_depth_image_viewer->isVisible()){
+                m_depth_image_viewer->close();
+            }
         }
         else {
             event->ignore();
@@ -520,9 +603,14 @@ void MainWindow::closeEvent(QCloseEvent *event)
     else{
         event->accept();
 
+        stopSaveExecutors();
+
         if(m_temperatures_viewer->isVisible()){
             m_temperatures_viewer->close();
         }
+        if(m_depth_image_viewer->isVisible()){
+            m_depth_image_viewer->close();
+        }
     }
 
 
@@ -1037,19 +1125,25 @@ void MainWindow::on_pushButton_start_streaming_clicked()
     ui->horizontalSlider_sharpness_wide->setDisabled(m_device_streaming);
 }
 
-void MainWindow::pointCloudReadyToShow(int32_t *pointcloud_data, uint32_t timestamp)
+void MainWindow::pointCloudReadyToShow(int32_t *pointcloud_data, uint32_t timestamp, int32_t foreground_points, int32_t *shaded_data)
 {
-    Q_UNUSED(timestamp)
+    //!the frame is handed to this slot, the save queue keeps a reference to it instead of a copy
+    std::shared_ptr<const int32_t> frame(pointcloud_data, free);
+
+    //!the viewers show the shaded copy, it is only used in this slot
+    std::unique_ptr<int32_t, void(*)(void*)> shaded_frame(shaded_data, free);
+    int32_t *display_data = (shaded_data != NULL) ? shaded_data : pointcloud_data;
 
     if(m_save_data && m_save_pointcloud){
 
         if(m_save_pointcloud_counter > 0 || m_save_all){
-            int buff_size = ((pointcloud_data[0] * 5) + 1) * sizeof(int32_t);
-            int32_t *temp_buff = (int32_t*) malloc(buff_size);
-            memcpy(temp_buff, pointcloud_data, buff_size);
+            //!foreground points are placed first, saving only them is saving a shorter frame
+            int32_t points_to_save = pointcloud_data[0];
+            if(ui->checkBox_background_save_foreground->isChecked()){
+                points_to_save = foreground_points;
+            }
 
-            m_save_pointcloud_manager->doSavePointCloudToBin(temp_buff, pointcloud_data[0], timestamp);
-            free(temp_buff);
+            m_save_pointcloud_manager->doSavePointCloudToBin(frame, points_to_save, timestamp);
 
             if(!m_save_all){
                 m_save_pointcloud_counter--;
@@ -1060,52 +1154,66 @@ void MainWindow::pointCloudReadyToShow(int32_t *pointcloud_data, uint32_t timest
     }
 
     if(m_device_started){
-        m_point_cloud_viewer->doShowPointCloud(pointcloud_data);
+        m_point_cloud_viewer->doShowPointCloud(display_data, timestamp, foreground_points);
+
+        if(m_depth_image_viewer->isVisible()){
+            m_depth_image_rasterizer->render((tPointPcd*)&display_data[1], display_data[0]);
+            m_depth_image_timestamp = timestamp;
+
+            const std::vector<uint8_t> &color_image = m_depth_image_rasterizer->getColorImage();
+            int columns = m_depth_image_rasterizer->getColumns();
+            QImage image = QImage(color_image.data(), columns, m_depth_image_rasterizer->getRows(), columns * 3, QImage::Format_RGB888);
+            m_depth_image_viewer->showImage(image);
+        }
     }
+}
+
+void MainWindow::clustersReadyToShow(std::vector<pointCloudCluster> clusters, uint32_t timestamp)
+{
+    Q_UNUSED(timestamp);
 
-    free(pointcloud_data);
+    if(m_device_started){
+        m_point_cloud_viewer->doShowClusters(clusters);
+    }
 }
 
 void MainWindow::imageRgbReadyToShow(uint8_t *image_data, uint16_t height, uint16_t width, uint8_t channels, std::vector<detectionImage> detections, uint32_t timestamp)
 {
     cv::Mat image_to_show;
+    bool frame_shared = false;
 
     if(m_device_started){
 
+        //!the receiver reuses its buffer, the frame is converted once to a new rgb image
+        //!that is shown, fused and saved without more copies
         if(channels == 1){
-            image_to_show = cv::Mat(height, width, CV_8UC1, image_data);
-            cv::cvtColor(image_to_show, image_to_show, cv::COLOR_GRAY2BGR);
+            cv::cvtColor(cv::Mat(height, width, CV_8UC1, image_data), image_to_show, cv::COLOR_GRAY2RGB);
         }
         else if(channels == 2){
-            image_to_show = cv::Mat(height, width, CV_8UC2, image_data);
             if(m_econ_wide_connected || m_allied_narrow_sensor != NULL){
-                cv::cvtColor(image_to_show, image_to_show, cv::COLOR_YUV2BGR_Y422);
+                cv::cvtColor(cv::Mat(height, width, CV_8UC2, image_data), image_to_show, cv::COLOR_YUV2RGB_Y422);
             }else{
-                cv::cvtColor(image_to_show, image_to_show, cv::COLOR_YUV2BGR_YUYV);
+                cv::cvtColor(cv::Mat(height, width, CV_8UC2, image_data), image_to_show, cv::COLOR_YUV2RGB_YUYV);
             }
         }
         else if(channels == 3){
-            image_to_show = cv::Mat(height, width, CV_8UC3, image_data);
+            cv::cvtColor(cv::Mat(height, width, CV_8UC3, image_data), image_to_show, cv::COLOR_BGR2RGB);
         }
 
-        cv::cvtColor(image_to_show, image_to_show, cv::COLOR_BGR2RGB);
-
         if(m_blurring_loaded && m_apply_blurring){
             applyFaceBlurring(image_to_show);
         }
 
+        if(m_point_cloud_pipeline->getCameraFusion()->usesSource(fusion_source_rgb)){
+            m_point_cloud_pipeline->getCameraFusion()->addImage(fusion_source_rgb, image_to_show.data, image_to_show.rows, image_to_show.cols, 3, timestamp);
+        }
+
         if(m_save_data && (m_save_rgb_image || m_save_narrow_image)){
 
             if(m_save_images_rgb_counter > 0 || m_save_narrow_counter > 0 || m_save_all){
 
-                int buff_size = sizeof(uint8_t)*height*width*3;
-                uint8_t *temp_buf = (uint8_t*)malloc(buff_size);
-
-                memcpy(temp_buf, (uint8_t*)image_to_show.data, buff_size*sizeof(uint8_t));
-
-                m_save_rgb_image_manager->doSavePointerToPng(temp_buf, width, height, 3, timestamp);
-
-                free(temp_buf);
+                m_save_rgb_image_manager->doSavePointerToPng(shareImage(image_to_show), width, height, 3, timestamp);
+                frame_shared = true;
 
                 if(!m_save_all){
                     if(m_save_rgb_image) m_save_images_rgb_counter--;
@@ -1116,6 +1224,10 @@ void MainWindow::imageRgbReadyToShow(uint8_t *image_data, uint16_t height, uint1
         }
 
         if(!detections.empty()){
+            //!the saved frame is shared with the save queue, the boxes are drawn on a copy
+            if(frame_shared){
+                image_to_show = image_to_show.clone();
+            }
             drawDetections(image_to_show, detections, 30);
         }
 
@@ -1134,40 +1246,36 @@ void MainWindow::imageRgbReadyToShow(uint8_t *image_data, uint16_t height, uint1
 void MainWindow::imageRgbPolReadyToShow(uint8_t *image_data, uint16_t height, uint16_t width, uint8_t channels, std::vector<detectionImage> detections, uint32_t timestamp)
 {
     cv::Mat image_to_show;
+    bool frame_shared = false;
 
     if(m_device_started){
 
+        //!converted once to a new rgb image, as the rgb frames
         if(channels == 1){
-            image_to_show = cv::Mat(height, width, CV_8UC1, image_data);
-            cv::cvtColor(image_to_show, image_to_show, cv::COLOR_GRAY2BGR);
+            cv::cvtColor(cv::Mat(height, width, CV_8UC1, image_data), image_to_show, cv::COLOR_GRAY2RGB);
         }
         else if(channels == 2){
-            image_to_show = cv::Mat(height, width, CV_8UC2, image_data);
-            cv::cvtColor(image_to_show, image_to_show, cv::COLOR_YUV2BGR_Y422);
+            cv::cvtColor(cv::Mat(height, width, CV_8UC2, image_data), image_to_show, cv::COLOR_YUV2RGB_Y422);
         }
         else if(channels == 3){
-            image_to_show = cv::Mat(height, width, CV_8UC3, image_data);
+            cv::cvtColor(cv::Mat(height, width, CV_8UC3, image_data), image_to_show, cv::COLOR_BGR2RGB);
         }
 
-        cv::cvtColor(image_to_show, image_to_show, cv::COLOR_BGR2RGB);
-
         if(m_blurring_loaded && m_apply_blurring){
             applyFaceBlurring(image_to_show);
         }
 
+        if(m_point_cloud_pipeline->getCameraFusion()->usesSource(fusion_source_polarimetric)){
+            m_point_cloud_pipeline->getCameraFusion()->addImage(fusion_source_polarimetric, image_to_show.data, image_to_show.rows, image_to_show.cols, 3, timestamp);
+        }
         
         if(m_save_data && (m_save_pol_image || m_save_wide_image)){
 
             if(m_save_pol_counter > 0 || m_save_wide_counter > 0 || m_save_all){
                 
                 //!Always save the rgb image
-                int buff_size = sizeof(uint8_t)*height*width*3;
-                uint8_t *temp_buf = (uint8_t*)malloc(buff_size);
-                memcpy(temp_buf, (uint8_t*)image_to_show.data, buff_size*sizeof(uint8_t));
-
-                m_save_polarimetric_manager->doSavePointerToPng(temp_buf, width, height, 3, timestamp);
-
-                free(temp_buf);
+                m_save_polarimetric_manager->doSavePointerToPng(shareImage(image_to_show), width, height, 3, timestamp);
+                frame_shared = true;
 
                 if(!m_save_all){
                     if(m_save_pol_image) m_save_pol_counter--;
@@ -1179,6 +1287,10 @@ void MainWindow::imageRgbPolReadyToShow(uint8_t *image_data, uint16_t height, ui
         }
 
         if(!detections.empty()){
+            //!the saved frame is shared with the save queue, the boxes are drawn on a copy
+            if(frame_shared){
+                image_to_show = image_to_show.clone();
+            }
             drawDetections(image_to_show, detections, 30);
         }
 
@@ -1197,22 +1309,24 @@ void MainWindow::imageRgbPolReadyToShow(uint8_t *image_data, uint16_t height, ui
 void MainWindow::imageThermalReadyToShow(uint8_t *image_data, uint16_t height, uint16_t width, uint8_t channels, std::vector<detectionImage> detections, uint32_t timestamp)
 {
     cv::Mat image_to_show;
+    bool frame_shared = false;
+
+    Q_UNUSED(channels);
 
     if(m_device_started){
 
-        image_to_show = cv::Mat(height, width, CV_8UC3, image_data);
-        cv::cvtColor(image_to_show, image_to_show, cv::COLOR_BGR2RGB);
+        //!converted once to a new rgb image, as the rgb frames
+        cv::cvtColor(cv::Mat(height, width, CV_8UC3, image_data), image_to_show, cv::COLOR_BGR2RGB);
+
+        if(m_point_cloud_pipeline->getCameraFusion()->usesSource(fusion_source_thermal)){
+            m_point_cloud_pipeline->getCameraFusion()->addImage(fusion_source_thermal, image_to_show.data, height, width, 3, timestamp);
+        }
 
         if(m_save_data && m_save_thermal_image ){
 
             if(m_save_thermal_counter > 0 || m_save_all){
-                int buff_size = sizeof(uint8_t)*height*width*channels;
-                uint8_t *temp_buf = (uint8_t*)malloc(buff_size);
-                memcpy(temp_buf, image_to_show.data, buff_size*sizeof(uint8_t));
-
-                m_save_thermal_image_manager->doSavePointerToPng(temp_buf, width, height, channels, timestamp);
-
-                free(temp_buf);
+                m_save_thermal_image_manager->doSavePointerToPng(shareImage(image_to_show), width, height, 3, timestamp);
+                frame_shared = true;
 
                 if(!m_save_all){
                     m_save_thermal_counter--;
@@ -1223,6 +1337,9 @@ void MainWindow::imageThermalReadyToShow(uint8_t *image_data, uint16_t height, u
         }
 
         if(detections.size() > 0){
+            if(frame_shared){
+                image_to_show = image_to_show.clone();
+            }
             drawDetections(image_to_show, detections, 30);
         }
         cv::resize(image_to_show, image_to_show, cv::Size(600,400));
@@ -1242,17 +1359,17 @@ void MainWindow::temperatureDataReady(float *temperature_data, uint16_t height,
 {
     if(m_device_started){
 
+        if(m_point_cloud_pipeline->getCameraFusion()->usesSource(fusion_source_temperatures)){
+            m_point_cloud_pipeline->getCameraFusion()->addTemperatures(temperature_data, height, width, timestamp);
+        }
+
         if(m_save_data && m_save_thermal_data_image){
 
             if(m_save_thermal_data_counter > 0 || m_save_all){
 
+                //!the receiver reuses its buffer, the manager keeps the only copy
                 int buff_size = height * width * sizeof(float);
-                float *temp_buff = (float*)malloc(buff_size);
-                memcpy(temp_buff, temperature_data, buff_size);
-
-                m_save_thermal_data_manager->doSaveFloatDataToBin(temp_buff, buff_size, timestamp);
-
-                free(temp_buff);
+                m_save_thermal_data_manager->doSaveFloatDataToBin(temperature_data, buff_size, width, timestamp);
 
                 if(!m_save_all){
                     m_save_thermal_data_counter--;
@@ -1483,6 +1600,158 @@ void MainWindow::changeSaveDataSettings()
 
     ui->spinBox_save_counter->setDisabled(m_save_data);
 
+    ui->checkBox_save_session->setDisabled(m_save_data);
+    ui->lineEdit_save_session_path->setDisabled(m_save_data);
+    ui->pushButton_save_session->setDisabled(m_save_data);
+    ui->spinBox_save_session_segment->setDisabled(m_save_data);
+    ui->checkBox_save_session_direct->setDisabled(m_save_data);
+    ui->comboBox_save_pointcloud_format->setDisabled(m_save_data);
+    ui->comboBox_save_temperatures_format->setDisabled(m_save_data);
+
+    ui->checkBox_save_video->setDisabled(m_save_data);
+    ui->comboBox_save_video_codec->setDisabled(m_save_data);
+    ui->spinBox_save_video_quality->setDisabled(m_save_data);
+    ui->spinBox_save_video_keyframes->setDisabled(m_save_data);
+    ui->spinBox_save_video_fps->setDisabled(m_save_data);
+}
+
+bool MainWindow::startSessionContainer()
+{
+    try{
+        //!every recording gets its own folder of segments
+        QString folder = QDir::cleanPath(ui->lineEdit_save_session_path->text() + "/" + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+        if(!QDir().mkpath(folder)){
+            return false;
+        }
+
+        uint64_t segment_bytes = (uint64_t)ui->spinBox_save_session_segment->value() * 1024 * 1024;
+        batchedWriterSettings file_settings = batchedFileWriter::defaultSettings();
+        file_settings.direct_io = ui->checkBox_save_session_direct->isChecked();
+        //!the segments are reserved on disk when they are created, so they are not fragmented
+        file_settings.preallocate_bytes = segment_bytes;
+
+        std::shared_ptr<sessionContainerWriter> session = std::make_shared<sessionContainerWriter>();
+        if(!session->open(folder.toStdString(), segment_bytes, file_settings)){
+            return false;
+        }
+
+        session->addStream(session_stream_pointcloud, (ui->comboBox_save_pointcloud_format->currentIndex() == 1) ?
+                               session_format_pointcloud_bpc : session_format_pointcloud, "pointcloud");
+        session->addStream(session_stream_rgb, session_format_png, (m_allied_narrow_sensor != NULL) ? "narrow" : "rgb");
+        session->addStream(session_stream_polarimetric, session_format_png, (m_allied_wide_sensor != NULL) ? "wide" : "polarimetric");
+        session->addStream(session_stream_thermal, session_format_png, "thermal");
+        session->addStream(session_stream_temperatures, (ui->comboBox_save_temperatures_format->currentIndex() != temperature_encoding_raw) ?
+                               session_format_float32_btc : session_format_float32, "temperatures");
+
+        m_save_pointcloud_manager->setSessionContainer(session, session_stream_pointcloud);
+        m_save_rgb_image_manager->setSessionContainer(session, session_stream_rgb);
+        m_save_polarimetric_manager->setSessionContainer(session, session_stream_polarimetric);
+        m_save_thermal_image_manager->setSessionContainer(session, session_stream_thermal);
+        m_save_thermal_data_manager->setSessionContainer(session, session_stream_temperatures);
+
+        m_session_container = session;
+        addMessageToLogWindow("Recording session in " + folder);
+        return true;
+
+    }catch(...){
+        qDebug()<<"Unhandled error at MainWindow::startSessionContainer";
+    }
+    return false;
+}
+
+void MainWindow::stopSessionContainer()
+{
+    saveDataManager *managers[] = {m_save_pointcloud_manager, m_save_rgb_image_manager, m_save_polarimetric_manager,
+                                   m_save_thermal_image_manager, m_save_thermal_data_manager};
+    for(saveDataManager *manager : managers){
+        manager->setSessionContainer(NULL, 0);
+    }
+
+    //!the frames still queued keep the session, the last one written closes it
+    m_session_container.reset();
+}
+
+void MainWindow::startVideoRecording()
+{
+    try{
+        videoRecordingSettings settings = videoStreamWriter::defaultSettings();
+        settings.codec = (uint8_t)ui->comboBox_save_video_codec->currentIndex();
+        settings.quality = ui->spinBox_save_video_quality->value();
+        settings.keyframe_interval = ui->spinBox_save_video_keyframes->value();
+        settings.frames_per_second = ui->spinBox_save_video_fps->value();
+
+        //!every video is written in the folder of the images of its stream
+        if(m_save_rgb_image || m_save_narrow_image){
+            m_rgb_video = std::make_shared<videoStreamWriter>(m_save_narrow_image ? ui->lineEdit_save_narrow_path->text() : ui->lineEdit_save_rgb_path->text(),
+                                                              m_save_narrow_image ? "narrow" : "rgb", settings);
+            m_save_rgb_image_manager->setVideoWriter(m_rgb_video);
+        }
+
+        if(m_save_pol_image || m_save_wide_image){
+            videoRecordingSettings polarimetric_settings = settings;
+            if(m_save_pol_image){
+                //!neighbour pixels of the polarimetric camera see different polarizers, they can not be subsampled
+                polarimetric_settings.codec = video_codec_ffv1;
+            }
+            m_polarimetric_video = std::make_shared<videoStreamWriter>(m_save_wide_image ? ui->lineEdit_save_wide_path->text() : ui->lineEdit_save_pol_path->text(),
+                                                                       m_save_wide_image ? "wide" : "polarimetric", polarimetric_settings);
+            m_save_polarimetric_manager->setVideoWriter(m_polarimetric_video);
+        }
+
+    }catch(...){
+        qDebug()<<"Unhandled error at MainWindow::startVideoRecording";
+    }
+}
+
+void MainWindow::stopVideoRecording()
+{
+    m_save_rgb_image_manager->setVideoWriter(NULL);
+    m_save_polarimetric_manager->setVideoWriter(NULL);
+
+    std::shared_ptr<videoStreamWriter> videos[] = {m_rgb_video, m_polarimetric_video};
+    for(const std::shared_ptr<videoStreamWriter> &video : videos){
+        if(video && !video->getFileName().isEmpty()){
+            addMessageToLogWindow("Video recorded in " + video->getFileName());
+        }
+    }
+
+    //!the images still queued keep their video, the last one encoded finishes it
+    m_rgb_video.reset();
+    m_polarimetric_video.reset();
+}
+
+void MainWindow::stopSaveExecutors()
+{
+    try{
+        //!the queues release the videos with their last frame, they are finished here once drained
+        std::shared_ptr<videoStreamWriter> videos[] = {m_rgb_video, m_polarimetric_video};
+
+        stopSessionContainer();
+        stopVideoRecording();
+
+        //!the executors write what is left in their queues once they are closed, the last
+        //!frames close the session and the videos
+        saveDataManager *managers[] = {m_save_pointcloud_manager, m_save_rgb_image_manager, m_save_polarimetric_manager,
+                                       m_save_thermal_image_manager, m_save_thermal_data_manager};
+        for(saveDataManager *manager : managers){
+            manager->stopController();
+        }
+
+        m_save_pointcloud_executor->stopController();
+        m_save_rgb_image_executor->stopController();
+        m_save_polarimetric_executor->stopController();
+        m_save_thermal_image_executor->stopController();
+        m_save_thermal_data_executor->stopController();
+
+        for(const std::shared_ptr<videoStreamWriter> &video : videos){
+            if(video){
+                video->finish();
+            }
+        }
+
+    }catch(...){
+        qDebug()<<"Unhandled error at MainWindow::stopSaveExecutors";
+    }
 }
 
 void MainWindow::checkAllFramesSaved()
@@ -1892,6 +2161,366 @@ void MainWindow::on_pushButton_apply_filter_clicked()
     }
 }
 
+void MainWindow::on_pushButton_apply_persistence_clicked()
+{
+    m_point_cloud_viewer->doSetPersistence(ui->spinBox_persistence_frames->value(),
+                                           ui->spinBox_persistence_time->value(),
+                                           ui->checkBox_persistence_fade->isChecked(),
+                                           ui->doubleSpinBox_persistence_voxel->value(),
+                                           ui->spinBox_persistence_memory->value());
+}
+
+void MainWindow::on_pushButton_apply_render_clicked()
+{
+    m_point_cloud_viewer->setRenderSettings(ui->spinBox_render_target_fps->value(),
+                                            ui->checkBox_render_statistics->isChecked());
+}
+
+void MainWindow::on_pushButton_apply_host_filter_clicked()
+{
+    pointCloudFilterSettings settings;
+
+    settings.box_enabled = ui->checkBox_filter_box->isChecked();
+    settings.min_x = ui->spinBox_filter_min_x->value();
+    settings.max_x = ui->spinBox_filter_max_x->value();
+    settings.min_y = ui->spinBox_filter_min_y->value();
+    settings.max_y = ui->spinBox_filter_max_y->value();
+    settings.min_z = ui->spinBox_filter_min_z->value();
+    settings.max_z = ui->spinBox_filter_max_z->value();
+
+    settings.range_enabled = ui->checkBox_filter_range->isChecked();
+    settings.min_range = ui->spinBox_filter_min_range->value();
+    settings.max_range = ui->spinBox_filter_max_range->value();
+
+    settings.intensity_enabled = ui->checkBox_filter_intensity->isChecked();
+    settings.min_intensity = ui->spinBox_filter_min_intensity->value();
+
+    settings.sector_enabled = ui->checkBox_filter_sector->isChecked();
+    settings.min_azimuth = ui->doubleSpinBox_filter_min_azimuth->value();
+    settings.max_azimuth = ui->doubleSpinBox_filter_max_azimuth->value();
+    settings.min_elevation = ui->doubleSpinBox_filter_min_elevation->value();
+    settings.max_elevation = ui->doubleSpinBox_filter_max_elevation->value();
+
+    m_point_cloud_pipeline->getFilter()->setSettings(settings);
+}
+
+void MainWindow::on_pushButton_apply_background_clicked()
+{
+    backgroundModelSettings settings;
+
+    settings.enabled = ui->checkBox_background_enabled->isChecked();
+    settings.voxel_size = ui->spinBox_background_voxel->value();
+    settings.learning_frames = ui->spinBox_background_frames->value();
+    settings.min_occupancy = ui->spinBox_background_occupancy->value() / 100.0;
+
+    m_point_cloud_pipeline->getBackgroundModel()->setSettings(settings);
+
+    m_point_cloud_viewer->setForegroundOnly(settings.enabled && ui->checkBox_background_show_foreground->isChecked());
+}
+
+void MainWindow::on_pushButton_relearn_background_clicked()
+{
+    m_point_cloud_pipeline->getBackgroundModel()->relearn();
+}
+
+void MainWindow::on_pushButton_apply_outliers_clicked()
+{
+    outlierFilterSettings settings;
+
+    settings.enabled = ui->checkBox_outliers_enabled->isChecked();
+    settings.neighbours = ui->spinBox_outliers_neighbours->value();
+    settings.std_multiplier = ui->doubleSpinBox_outliers_std->value();
+    settings.search_radius = ui->spinBox_outliers_radius->value();
+    settings.use_range_image = ui->checkBox_outliers_range_image->isChecked();
+
+    m_point_cloud_pipeline->getOutlierFilter()->setSettings(settings);
+}
+
+void MainWindow::on_pushButton_apply_clustering_clicked()
+{
+    euclideanClusteringSettings settings;
+
+    settings.enabled = ui->checkBox_clustering_enabled->isChecked();
+    settings.tolerance = ui->spinBox_clustering_tolerance->value();
+    settings.min_points = ui->spinBox_clustering_min_points->value();
+    settings.max_points = ui->spinBox_clustering_max_points->value();
+
+    m_point_cloud_pipeline->getClustering()->setSettings(settings);
+}
+
+void MainWindow::on_pushButton_apply_fusion_clicked()
+{
+    //!the calibration is kept, it is only changed by loading a file
+    cameraFusionSettings settings = m_point_cloud_pipeline->getCameraFusion()->getSettings();
+
+    settings.enabled = ui->checkBox_fusion_enabled->isChecked();
+    settings.source = ui->comboBox_fusion_source->currentIndex();
+    settings.max_time_difference = ui->spinBox_fusion_max_time->value();
+    settings.min_temperature = ui->doubleSpinBox_fusion_min_temperature->value();
+    settings.max_temperature = ui->doubleSpinBox_fusion_max_temperature->value();
+    settings.keep_color_out_of_view = ui->checkBox_fusion_keep_color->isChecked();
+
+    m_point_cloud_pipeline->getCameraFusion()->setSettings(settings);
+}
+
+void MainWindow::on_pushButton_apply_shading_clicked()
+{
+    normalEstimationSettings settings = m_point_cloud_pipeline->getNormalEstimation()->getSettings();
+
+    settings.enabled = ui->checkBox_shading_enabled->isChecked();
+    settings.ambient = ui->doubleSpinBox_shading_ambient->value();
+    settings.light_elevation = ui->spinBox_shading_light_elevation->value();
+
+    m_point_cloud_pipeline->getNormalEstimation()->setSettings(settings);
+}
+
+void MainWindow::on_checkBox_morton_enabled_clicked(bool checked)
+{
+    m_point_cloud_pipeline->getMortonOrder()->setEnabled(checked);
+}
+
+void MainWindow::on_pushButton_fusion_calibration_clicked()
+{
+    QString file_name = QFileDialog::getOpenFileName(this, "Camera calibration", QDir::homePath(), "Calibration (*.yml *.yaml *.xml *.json)");
+    if(file_name.isEmpty()){
+        return;
+    }
+
+    try{
+        cv::FileStorage file(file_name.toStdString(), cv::FileStorage::READ);
+        if(!file.isOpened()){
+            addMessageToLogWindow("Error opening calibration file " + file_name, logType::error);
+            return;
+        }
+
+        cv::Mat camera_matrix, distortion, rotation, translation;
+        file["camera_matrix"] >> camera_matrix;
+        file["distortion_coefficients"] >> distortion;
+        file["rotation"] >> rotation;
+        file["translation"] >> translation;
+
+        if(camera_matrix.total() != 9 || translation.total() != 3 || (rotation.total() != 9 && rotation.total() != 3)){
+            addMessageToLogWindow("Calibration file needs camera_matrix, rotation and translation", logType::error);
+            return;
+        }
+
+        //!a rotation vector is accepted too, as given by cv::solvePnP or cv::calibrateCamera
+        camera_matrix.convertTo(camera_matrix, CV_32F);
+        translation.convertTo(translation, CV_32F);
+        rotation.convertTo(rotation, CV_32F);
+        if(rotation.total() == 3){
+            cv::Rodrigues(rotation.reshape(1, 3), rotation);
+        }
+        rotation = rotation.reshape(1, 3);
+
+        cameraFusionSettings settings = m_point_cloud_pipeline->getCameraFusion()->getSettings();
+        settings.fx = camera_matrix.at<float>(0, 0);
+        settings.fy = camera_matrix.at<float>(1, 1);
+        settings.cx = camera_matrix.at<float>(0, 2);
+        settings.cy = camera_matrix.at<float>(1, 2);
+        settings.calibration_width = (int)file["image_width"];
+        settings.calibration_height = (int)file["image_height"];
+
+        std::fill(settings.distortion, settings.distortion + 5, 0.0f);
+        if(!distortion.empty()){
+            distortion.convertTo(distortion, CV_32F);
+            for(size_t i = 0; i < std::min<size_t>(distortion.total(), 5); ++i){
+                settings.distortion[i] = distortion.at<float>(i);
+            }
+        }
+
+        //!the translation is in mm, as the points
+        for(int r = 0; r < 3; ++r){
+            for(int c = 0; c < 3; ++c){
+                settings.rotation[r][c] = rotation.at<float>(r, c);
+            }
+            settings.translation[r] = translation.at<float>(r);
+        }
+
+        m_point_cloud_pipeline->getCameraFusion()->setSettings(settings);
+        addMessageToLogWindow("Camera calibration loaded from " + file_name, logType::verbose);
+
+    }catch(cv::Exception &e){
+        addMessageToLogWindow("Error reading calibration file " + QString(e.what()), logType::error);
+    }
+}
+
+void MainWindow::on_pushButton_fusion_image_clicked()
+{
+    QString file_name = QFileDialog::getOpenFileName(this, "Recorded image", QDir::homePath(), "Images (*.png *.jpg *.jpeg *.bmp)");
+    if(file_name.isEmpty()){
+        return;
+    }
+
+    cv::Mat image = cv::imread(file_name.toStdString(), cv::IMREAD_COLOR);
+    if(image.empty()){
+        addMessageToLogWindow("Error reading image " + file_name, logType::error);
+        return;
+    }
+    cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+
+    m_point_cloud_pipeline->getCameraFusion()->setStaticImage(image.data, image.rows, image.cols);
+}
+
+void MainWindow::on_pushButton_fusion_clear_image_clicked()
+{
+    m_point_cloud_pipeline->getCameraFusion()->setStaticImage(NULL, 0, 0);
+}
+
+void MainWindow::on_checkBox_depth_image_show_clicked(bool checked)
+{
+    if(checked){
+        m_depth_image_viewer->show();
+    }else{
+        m_depth_image_viewer->hide();
+    }
+}
+
+void MainWindow::on_pushButton_apply_depth_image_clicked()
+{
+    depthImageSettings settings = m_depth_image_rasterizer->getSettings();
+
+    switch(ui->comboBox_depth_image_view->currentIndex()){
+    case 1:
+        settings.view = visualizationTypes::DEPTH_Z;
+        break;
+    case 2:
+        settings.view = visualizationTypes::INTENSITY;
+        break;
+    default:
+        settings.view = visualizationTypes::DEPTH_TOT;
+        break;
+    }
+    settings.min_value = ui->spinBox_depth_image_min->value();
+    settings.max_value = ui->spinBox_depth_image_max->value();
+    settings.fill_holes = ui->spinBox_depth_image_fill->value();
+
+    m_depth_image_rasterizer->setSettings(settings);
+}
+
+void MainWindow::on_pushButton_depth_image_save_clicked()
+{
+    if(m_depth_image_timestamp == 0){
+        addMessageToLogWindow("There is no depth image to save, show it first", logType::warning);
+        return;
+    }
+
+    QString file_name = QFileDialog::getSaveFileName(this, "Save depth image", QDir(m_path_to_save_pointcloud).filePath(QString("depth_%1.png").arg(m_depth_image_timestamp)), "PNG (*.png)");
+    if(file_name.isEmpty()){
+        return;
+    }
+
+    //!the values are saved as they are, mm for the depth views
+    const std::vector<uint16_t> &values = m_depth_image_rasterizer->getValueImage();
+    cv::Mat image(m_depth_image_rasterizer->getRows(), m_depth_image_rasterizer->getColumns(), CV_16UC1, (void*)values.data());
+
+    try{
+        if(!cv::imwrite(file_name.toStdString(), image)){
+            addMessageToLogWindow("Error saving depth image " + file_name, logType::error);
+        }
+    }catch(cv::Exception &e){
+        addMessageToLogWindow("Error saving depth image " + QString(e.what()), logType::error);
+    }
+}
+
+void MainWindow::on_checkBox_gl_viewer_enabled_clicked(bool checked)
+{
+    ui->openGLWidget_point_cloud->setRenderingEnabled(checked);
+    ui->label_gl_status->setText(ui->openGLWidget_point_cloud->usesPersistentMapping() ? "Persistent mapped buffers" : "Buffer uploads");
+}
+
+void MainWindow::on_spinBox_gl_point_size_valueChanged(int value)
+{
+    ui->openGLWidget_point_cloud->setPointSize(value);
+}
+
+void MainWindow::on_comboBox_gl_color_currentIndexChanged(int index)
+{
+    ui->openGLWidget_point_cloud->setUseRgbField(index == 0);
+}
+
+void MainWindow::on_checkBox_gl_axis_clicked(bool checked)
+{
+    ui->openGLWidget_point_cloud->setShowAxis(checked);
+}
+
+void MainWindow::on_pushButton_gl_reset_camera_clicked()
+{
+    ui->openGLWidget_point_cloud->resetCamera();
+}
+
+void MainWindow::pipelineTimingTimerTimeOut()
+{
+    pointCloudPipelineTiming timing = m_point_cloud_pipeline->getLastTiming();
+
+    ui->label_pipeline_timing->setText(QString("Pipeline: %1 ms, %2 outliers, %3 objects\nfilter %4 | denoise %5 | background %6 | objects %7 | fusion %8 | normals %9 | morton %10 ms")
+                                       .arg(timing.total_ms, 0, 'f', 1)
+                                       .arg(timing.outliers_removed)
+                                       .arg(timing.clusters)
+                                       .arg(timing.filter_ms, 0, 'f', 1)
+                                       .arg(timing.outliers_ms, 0, 'f', 1)
+                                       .arg(timing.background_ms, 0, 'f', 1)
+                                       .arg(timing.clustering_ms, 0, 'f', 1)
+                                       .arg(timing.fusion_ms, 0, 'f', 1)
+                                       .arg(timing.normals_ms, 0, 'f', 1)
+                                       .arg(timing.morton_ms, 0, 'f', 1));
+}
+
+void MainWindow::saveQueuesTimerTimeOut()
+{
+    const QStringList names = {"Point cloud", "RGB / narrow", "Polarimetric / wide", "Thermal", "Thermal data"};
+    saveDataManager *managers[] = {m_save_pointcloud_manager, m_save_rgb_image_manager, m_save_polarimetric_manager,
+                                   m_save_thermal_image_manager, m_save_thermal_data_manager};
+
+    QString text;
+    for(int i = 0; i < names.size(); ++i){
+        saveQueueStatistics statistics = managers[i]->getQueueStatistics();
+        if(statistics.high_water_frames == 0 && statistics.dropped_frames == 0){
+            continue;
+        }
+        text += QString("%1: %2 queued (%3 MB), max %4 MB, %5 dropped\n")
+                .arg(names.at(i))
+                .arg(statistics.queued_frames)
+                .arg(statistics.queued_bytes / 1048576.0, 0, 'f', 1)
+                .arg(statistics.high_water_bytes / 1048576.0, 0, 'f', 1)
+                .arg(statistics.dropped_frames);
+    }
+
+    ui->label_save_queues->setText(text.isEmpty() ? QString("Save queues: -") : text.trimmed());
+
+    if(m_session_container){
+        sessionContainerStatistics statistics = m_session_container->getStatistics();
+        QString backend = (statistics.backend == batched_backend_io_uring) ? "io_uring" :
+                          (statistics.backend == batched_backend_pwritev) ? "pwritev" : "stdio";
+        ui->label_save_session->setText(QString("Session: %1 records, %2 MB in %3 segments (%4, %5 waits)")
+                                        .arg(statistics.records)
+                                        .arg(statistics.bytes_written / 1048576.0, 0, 'f', 1)
+                                        .arg(statistics.segments)
+                                        .arg(backend)
+                                        .arg(statistics.waits));
+    }
+}
+
+void MainWindow::on_pushButton_save_session_clicked()
+{
+    setPathToSaveData(ui->lineEdit_save_session_path);
+}
+
+void MainWindow::on_pushButton_apply_save_queues_clicked()
+{
+    uint64_t stream_budget = (uint64_t)ui->spinBox_save_stream_budget->value() * 1024 * 1024;
+    uint8_t policy = ui->comboBox_save_queue_policy->currentIndex();
+
+    saveDataManager::setTotalQueueBudget((uint64_t)ui->spinBox_save_total_budget->value() * 1024 * 1024);
+
+    saveDataManager *managers[] = {m_save_pointcloud_manager, m_save_rgb_image_manager, m_save_polarimetric_manager,
+                                   m_save_thermal_image_manager, m_save_thermal_data_manager};
+    for(saveDataManager *manager : managers){
+        manager->setQueueBudget(stream_budget);
+        manager->setQueuePolicy(policy);
+    }
+}
+
 void MainWindow::on_pushButton_apply_color_ranges_clicked()
 {
     int min_value = ui->spinBox_min_range->value();
@@ -2684,72 +3313,6 @@ void MainWindow::on_pushButton_save_narrow_clicked()
 }
 
 
-void MainWindow::thermalSaveExecutorIsAvailable(bool available)
-{
-    m_save_thermal_image_manager->setExecutorAvailable(available);
-}
-
-void MainWindow::thermalDataSaveExecutorAvailable(bool available)
-{
-    m_save_thermal_data_manager->setExecutorAvailable(available);
-}
-
-void MainWindow::rgbSaveExecutorIsAvailable(bool available)
-{
-    m_save_rgb_image_manager->setExecutorAvailable(available);
-}
-
-void MainWindow::pointcloudSaveExecutorIsAvailable(bool available)
-{
-    m_save_pointcloud_manager->setExecutorAvailable(available);
-}
-
-void MainWindow::polSaveExecutorIsAvailable(bool available)
-{
-    m_save_polarimetric_manager->setExecutorAvailable(available);
-}
-
-void MainWindow::thermalImageToSaveReceived(imageData data)
-{
-    QString file_name = QString("%1").arg(data.timestamp);
-    m_save_thermal_image_executor->doSavePointerToPng(data.image_buffer, data.image_width, data.image_height, data.image_channels, file_name);
-    free(data.image_buffer);
-}
-
-void MainWindow::thermalDataBufferToSaveReceived(binaryFloatData data)
-{
-    QString file_name = QString("%1").arg(data.timestamp);
-
-    m_save_thermal_data_executor->doSaveFloatData(data.data_buffer, data.data_size, file_name);
-    free(data.data_buffer);
-}
-
-void MainWindow::rgbImageToSaveReceived(imageData data)
-{
-    QString file_name = QString("%1").arg(data.timestamp);
-
-    cv::Mat image = cv::Mat(data.image_width, data.image_height, CV_8UC3, data.image_buffer );
-
-    m_save_rgb_image_executor->doSavePointerToPng(image.data, data.image_width, data.image_height, data.image_channels, file_name);
-
-    free(data.image_buffer);
-}
-
-void MainWindow::pointcloudToSaveReceived(pointcloudData data)
-{
-    QString file_name = QString("%1").arg(data.timestamp);
-    m_save_pointcloud_executor->doSaveBinaryData(data.pointcloud_buffer, file_name);
-
-    free(data.pointcloud_buffer);
-}
-
-void MainWindow::polImageToSaveReceived(imageData data)
-{
-    QString file_name = QString("%1").arg(data.timestamp);
-    m_save_polarimetric_executor->doSavePointerToPng(data.image_buffer, data.image_width, data.image_height, data.image_channels, file_name);
-    free(data.image_buffer);
-}
-
 void MainWindow::on_checkBox_blur_faces_clicked(bool checked)
 {
     m_apply_blurring = checked;
@@ -2770,6 +3333,7 @@ void MainWindow::on_pushButton_save_clicked()
 
         if(ui->checkBox_save_pointcloud->isChecked()){
             m_save_pointcloud_executor->setPathToSavePcd(ui->lineEdit_save_pointcloud_path->text());
+            m_save_pointcloud_executor->setCompression(ui->comboBox_save_pointcloud_format->currentIndex() == 1);
         }
 
         if(ui->checkBox_save_thermal->isChecked()){
@@ -2778,6 +3342,7 @@ void MainWindow::on_pushButton_save_clicked()
 
         if(ui->checkBox_save_thermal_data->isChecked()){
             m_save_thermal_data_executor->setPathToSaveImages(ui->lineEdit_save_thermal_bin_path->text());
+            m_save_thermal_data_executor->setTemperatureEncoding(ui->comboBox_save_temperatures_format->currentIndex());
         }
 
         if(ui->checkBox_save_rgb->isChecked()){
@@ -2813,7 +3378,17 @@ void MainWindow::on_pushButton_save_clicked()
             m_save_narrow_counter = (m_save_narrow_image ? m_save_images_counter : 0);
         }
 
+        if(ui->checkBox_save_session->isChecked() && !startSessionContainer()){
+            addMessageToLogWindow("The session container could not be created, frames are saved to files", logType::error);
+        }
+
+        if(ui->checkBox_save_video->isChecked()){
+            startVideoRecording();
+        }
 
+    }else{
+        stopSessionContainer();
+        stopVideoRecording();
     }
 
     changeSaveDataSettings();
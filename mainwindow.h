@@ -47,8 +47,11 @@
 #include <saveDataManager.h>
 #include <imageSaveDataExecutor.h>
 #include <pointCloudSaveDataExecutor.h>
+#include <sessionContainerWriter.h>
+#include <videoStreamWriter.h>
 
 #include <pclPointCloudViewerController.h>
+#include <depthImageRasterizer.h>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/dnn/dnn.hpp>
@@ -73,6 +76,11 @@ public:
 
     void setMainWindowObj(MainWindow *ptr);
 
+    //! @brief  Finds and starts the first device and its streaming without user interaction
+    //! @param  duration_s Seconds to run before quitting, 0 to run until the application quits
+    //! @return none
+    void startHeadless(int duration_s);
+
 private:
     void deviceDetected();
 
@@ -96,6 +104,25 @@ private:
 
     void checkAllFramesSaved();
 
+    //! @brief  Opens a new session in the session folder and sets it to the save queues
+    //! @return false if the session could not be created
+    bool startSessionContainer();
+
+    //! @brief  Frames queued from now on are written to their own files, the session is
+    //!         closed once the frames already queued are appended to it
+    void stopSessionContainer();
+
+    //! @brief  Creates a video for every camera stream saved and sets it to its save queue
+    void startVideoRecording();
+
+    //! @brief  Images queued from now on are saved as before, the videos are finished once
+    //!         the images already queued are encoded
+    void stopVideoRecording();
+
+    //! @brief  Stops the recordings and closes the save queues, returns once the executors
+    //!         have written every frame queued, the session is closed and the videos finished
+    void stopSaveExecutors();
+
     void loadBlurringNetworks();
 
     void applyFaceBlurring(cv::Mat &image);
@@ -120,6 +147,8 @@ public slots:
 
 private slots:
 
+    void stopHeadless();
+
     void on_pushButton_getVersion_clicked();
 
     void on_pushButton_initialize_clicked();
@@ -192,7 +221,9 @@ private slots:
 
     void on_pushButton_start_streaming_clicked();
 
-    void pointCloudReadyToShow(int32_t* pointcloud_data, uint32_t timestamp);
+    void pointCloudReadyToShow(int32_t* pointcloud_data, uint32_t timestamp, int32_t foreground_points, int32_t *shaded_data);
+
+    void clustersReadyToShow(std::vector<pointCloudCluster> clusters, uint32_t timestamp);
 
     void imageRgbReadyToShow(uint8_t* image_data, uint16_t height, uint16_t width, uint8_t channels, std::vector<detectionImage> detections, uint32_t timestamp);
 
@@ -224,8 +255,58 @@ private slots:
 
     void on_pushButton_apply_filter_clicked();
 
+    void on_pushButton_apply_host_filter_clicked();
+
+    void on_pushButton_apply_background_clicked();
+
+    void on_pushButton_relearn_background_clicked();
+
     void on_pushButton_apply_color_ranges_clicked();
 
+    void on_pushButton_apply_persistence_clicked();
+
+    void on_pushButton_apply_render_clicked();
+
+    void on_pushButton_apply_outliers_clicked();
+
+    void on_pushButton_apply_clustering_clicked();
+
+    void on_pushButton_apply_fusion_clicked();
+
+    void on_pushButton_apply_shading_clicked();
+
+    void on_checkBox_morton_enabled_clicked(bool checked);
+
+    void on_pushButton_fusion_calibration_clicked();
+
+    void on_pushButton_fusion_image_clicked();
+
+    void on_pushButton_fusion_clear_image_clicked();
+
+    void on_checkBox_depth_image_show_clicked(bool checked);
+
+    void on_pushButton_apply_depth_image_clicked();
+
+    void on_pushButton_depth_image_save_clicked();
+
+    void on_checkBox_gl_viewer_enabled_clicked(bool checked);
+
+    void on_spinBox_gl_point_size_valueChanged(int value);
+
+    void on_comboBox_gl_color_currentIndexChanged(int index);
+
+    void on_checkBox_gl_axis_clicked(bool checked);
+
+    void on_pushButton_gl_reset_camera_clicked();
+
+    void pipelineTimingTimerTimeOut();
+
+    void saveQueuesTimerTimeOut();
+
+    void on_pushButton_apply_save_queues_clicked();
+
+    void on_pushButton_save_session_clicked();
+
     void on_pushButton_set_lidar_protocol_clicked();
 
     void on_pushButton_set_network_settings_clicked();
@@ -356,26 +437,6 @@ private slots:
 
     void on_pushButton_save_narrow_clicked();
 
-    void thermalSaveExecutorIsAvailable(bool available);
-
-    void thermalDataSaveExecutorAvailable(bool available);
-
-    void rgbSaveExecutorIsAvailable(bool available);
-
-    void pointcloudSaveExecutorIsAvailable(bool available);
-
-    void polSaveExecutorIsAvailable(bool available);
-
-    void thermalImageToSaveReceived(imageData data);
-
-    void thermalDataBufferToSaveReceived(binaryFloatData data);
-
-    void rgbImageToSaveReceived(imageData data);
-
-    void pointcloudToSaveReceived(pointcloudData data);
-
-    void polImageToSaveReceived(imageData data);
-
     void on_checkBox_blur_faces_clicked(bool checked);
 
     void on_pushButton_save_clicked();
@@ -449,12 +510,22 @@ private:
 
     imageViewerForm *m_temperatures_viewer;
 
+    imageViewerForm *m_depth_image_viewer;
+    depthImageRasterizer *m_depth_image_rasterizer;
+    uint32_t m_depth_image_timestamp;
+
     udpReceiverController *m_rgb_image_reader;
     udpReceiverController *m_thermal_image_reader;
     udpReceiverController *m_pointcloud_reader;
     udpReceiverController *m_rgb_pol_image_reader;
     udpReceiverController *m_temperatures_reader;
 
+    pointCloudPipeline *m_point_cloud_pipeline;
+
+    std::shared_ptr<sessionContainerWriter> m_session_container;
+    std::shared_ptr<videoStreamWriter> m_rgb_video;
+    std::shared_ptr<videoStreamWriter> m_polarimetric_video;
+
     saveDataManager* m_save_thermal_image_manager;
     imageSaveDataExecutor *m_save_thermal_image_executor;
 
@@ -506,6 +577,8 @@ private:
     QString m_path_to_save_narrow;
 
     QTimer *m_search_timer;
+    QTimer *m_pipeline_timing_timer;
+    QTimer *m_save_queues_timer;
     QTimer *m_rgb_value_changed;
 
     float m_pol_black_level;
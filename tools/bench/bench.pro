@@ -0,0 +1,11 @@
+#-------------------------------------------------
+#
+# Benchmarks of the processing and recording stages, see README.md
+#
+#-------------------------------------------------
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        morton_order \
+        save_queue \
+        session_writer
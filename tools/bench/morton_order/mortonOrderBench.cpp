@@ -0,0 +1,223 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//! Cost of the Morton order stage and what it changes downstream, on the sample point cloud
+//! as received (wire order), shuffled, and sorted by mortonOrder. The frame is also repeated
+//! with a jitter of 15 mm to get a denser one. It checks that the output is the input
+//! permuted, in increasing codes and stable, and returns 1 if it is not.
+
+#include "euclideanClustering.h"
+#include "mortonOrder.h"
+#include "voxelGridIndex.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock benchClock;
+
+static double millisecondsSince(benchClock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(benchClock::now() - start).count();
+}
+
+//! @brief  Returns the compression ratio of zlib at level 1
+static double zlibRatio(const void *data, size_t bytes)
+{
+    uLongf compressed_bytes = compressBound(bytes);
+    std::vector<Bytef> compressed(compressed_bytes);
+    compress2(compressed.data(), &compressed_bytes, (const Bytef*)data, bytes, 1);
+    return (double)bytes / compressed_bytes;
+}
+
+//! @brief  Measures the stages that walk the points in their order
+static void measureOrder(const char *name, const std::vector<tPointPcd> &points)
+{
+    int32_t number_of_points = points.size();
+    const int repetitions = 3;
+
+    voxelGridIndex grid;
+    benchClock::time_point start = benchClock::now();
+    for(int i = 0; i < repetitions; ++i){
+        grid.build(points.data(), number_of_points, 200.0f);
+    }
+    double build_time = millisecondsSince(start) / repetitions;
+
+    double sum = 0.0;
+    start = benchClock::now();
+    for(int i = 0; i < repetitions; ++i){
+        grid.forEachNearestK(0, grid.getNumberOfCells(), 8, 1000.0f, [&](int, const std::vector<float> &distances, int found){
+            if(found > 0){
+                sum += distances[0];
+            }
+        });
+    }
+    double neighbours_time = millisecondsSince(start) / repetitions;
+
+    euclideanClustering clustering;
+    euclideanClusteringSettings settings = {true, 300.0f, 20, 1000000};
+    clustering.setSettings(settings);
+    std::vector<pointCloudCluster> clusters;
+    start = benchClock::now();
+    for(int i = 0; i < repetitions; ++i){
+        clustering.apply(points.data(), number_of_points, clusters);
+    }
+    double clustering_time = millisecondsSince(start) / repetitions;
+
+    //!x, y and z as the difference with the previous point, one field after the other
+    std::vector<int32_t> fields(number_of_points * 5);
+    for(int32_t i = 0; i < number_of_points; ++i){
+        const tPointPcd &point = points[i];
+        const tPointPcd &previous = points[std::max(i - 1, 0)];
+        bool first = (i == 0);
+        fields[i] = point.x - (first ? 0 : previous.x);
+        fields[number_of_points + i] = point.y - (first ? 0 : previous.y);
+        fields[2 * number_of_points + i] = point.z - (first ? 0 : previous.z);
+        fields[3 * number_of_points + i] = point.intensity;
+        fields[4 * number_of_points + i] = point.RGB;
+    }
+
+    printf("  %-11s grid build %6.2f ms, 8-NN of all points %7.2f ms, clustering %6.2f ms (%zu clusters), "
+           "zlib -1 %.2fx, delta + zlib %.2fx\n", name, build_time, neighbours_time, clustering_time, clusters.size(),
+           zlibRatio(points.data(), number_of_points * sizeof(tPointPcd)), zlibRatio(fields.data(), fields.size() * sizeof(int32_t)));
+}
+
+//! @brief  Checks that the output is the input permuted, sorted by code and stable
+static bool checkOrder(const std::vector<tPointPcd> &input, const std::vector<tPointPcd> &output, const std::vector<int32_t> &permutation)
+{
+    int32_t number_of_points = input.size();
+    if((int32_t)permutation.size() != number_of_points){
+        return false;
+    }
+    std::vector<char> seen(number_of_points, 0);
+    for(int32_t i = 0; i < number_of_points; ++i){
+        int32_t source = permutation[i];
+        if(source < 0 || source >= number_of_points || seen[source] ||
+                memcmp(&output[i], &input[source], sizeof(tPointPcd)) != 0){
+            return false;
+        }
+        seen[source] = 1;
+    }
+
+    //!the codes of the stage, 10 bits per axis in the bounding cube of the frame
+    int32_t minimum[3] = {INT_MAX, INT_MAX, INT_MAX};
+    int32_t maximum[3] = {INT_MIN, INT_MIN, INT_MIN};
+    for(const tPointPcd &point : input){
+        const int32_t coordinates[3] = {point.x, point.y, point.z};
+        for(int axis = 0; axis < 3; ++axis){
+            minimum[axis] = std::min(minimum[axis], coordinates[axis]);
+            maximum[axis] = std::max(maximum[axis], coordinates[axis]);
+        }
+    }
+    double extent = 0.0;
+    for(int axis = 0; axis < 3; ++axis){
+        extent = std::max(extent, (double)maximum[axis] - minimum[axis]);
+    }
+    float scale = 1023.0f / (float)extent;
+
+    uint32_t previous_code = 0;
+    for(int32_t i = 0; i < number_of_points; ++i){
+        const tPointPcd &point = output[i];
+        uint32_t code = mortonOrder::encode((uint32_t)((point.x - (double)minimum[0]) * scale),
+                                            (uint32_t)((point.y - (double)minimum[1]) * scale),
+                                            (uint32_t)((point.z - (double)minimum[2]) * scale));
+        if(i > 0 && (code < previous_code || (code == previous_code && permutation[i - 1] > permutation[i]))){
+            return false;
+        }
+        previous_code = code;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *file_name = (argc > 1) ? argv[1] : "../../sample_data/115550076.bin";
+
+    std::vector<tPointPcd> sample;
+    FILE *file_handler = fopen(file_name, "rb");
+    int32_t number_of_points = 0;
+    if(file_handler != NULL){
+        if(fread(&number_of_points, sizeof(number_of_points), 1, file_handler) == 1 && number_of_points > 0){
+            sample.resize(number_of_points);
+            sample.resize(fread(sample.data(), sizeof(tPointPcd), number_of_points, file_handler));
+        }
+        fclose(file_handler);
+    }
+    if(sample.empty()){
+        printf("%s is not a point cloud frame\n", file_name);
+        return 1;
+    }
+
+    bool sorted_right = true;
+    const int copies[] = {1, 7};
+    for(int frame_copies : copies){
+        std::vector<tPointPcd> wire;
+        for(int copy = 0; copy < frame_copies; ++copy){
+            std::mt19937 generator(copy);
+            std::uniform_int_distribution<int> jitter(-15, 15);
+            for(tPointPcd point : sample){
+                if(copy > 0){
+                    point.x += jitter(generator);
+                    point.y += jitter(generator);
+                    point.z += jitter(generator);
+                }
+                wire.push_back(point);
+            }
+        }
+        std::vector<tPointPcd> shuffled = wire;
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+
+        mortonOrder order;
+        order.setEnabled(true);
+        std::vector<tPointPcd> sorted(wire.size());
+
+        const int repetitions = 20;
+        benchClock::time_point start = benchClock::now();
+        for(int i = 0; i < repetitions; ++i){
+            order.apply(wire.data(), wire.size(), sorted.data());
+        }
+        double sort_time = millisecondsSince(start) / repetitions;
+        bool right = checkOrder(wire, sorted, order.getLastPermutation());
+        sorted_right = sorted_right && right;
+
+        printf("%zu points, Morton order %.2f ms, %s\n", wire.size(), sort_time, right ? "sorted and stable" : "WRONG ORDER");
+        measureOrder("wire", wire);
+        measureOrder("shuffled", shuffled);
+        measureOrder("morton", sorted);
+
+        order.apply(shuffled.data(), shuffled.size(), sorted.data());
+        measureOrder("shuf+morton", sorted);
+    }
+
+    return sorted_right ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+#-------------------------------------------------
+#
+# Benchmark of the Morton order stage, run it from this folder:
+#   qmake && make && ./morton_order [point cloud .bin]
+#
+#-------------------------------------------------
+unix{
+QMAKE_CXXFLAGS += -std=gnu++14
+}
+
+CONFIG += c++14 console release
+CONFIG -= app_bundle
+QT = core
+
+TARGET = morton_order
+TEMPLATE = app
+
+SOURCES += \
+        ../../../BeamagineCore/pointCloudProcessing/euclideanClustering.cpp \
+        ../../../BeamagineCore/pointCloudProcessing/mortonOrder.cpp \
+        ../../../BeamagineCore/pointCloudProcessing/voxelGridIndex.cpp \
+        ../../../BeamagineCore/beam_parallel.cpp \
+        mortonOrderBench.cpp
+
+HEADERS += \
+        ../../../BeamagineCore/pointCloudProcessing/euclideanClustering.h \
+        ../../../BeamagineCore/pointCloudProcessing/mortonOrder.h \
+        ../../../BeamagineCore/pointCloudProcessing/voxelGridIndex.h \
+        ../../../BeamagineCore/beam_parallel.h
+
+INCLUDEPATH += \
+        ../../../libs/libL3Cam/ \
+        ../../../BeamagineCore/pointCloudProcessing/ \
+        ../../../BeamagineCore/
+
+LIBS += -lz
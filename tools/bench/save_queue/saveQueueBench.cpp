@@ -0,0 +1,171 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//! Frames per second the point cloud save path sustains: a burst of frames is queued in
+//! saveDataManager and written by pointCloudSaveDataExecutor and its workers, as files or
+//! in a session container, raw or compressed. The time counts until the executor has
+//! written the last frame and until the files are on disk (sync), run it on the disk the
+//! recordings go to.
+
+#include <QCoreApplication>
+#include <QDir>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "pointCloudSaveDataExecutor.h"
+#include "saveDataManager.h"
+#include "sessionContainerWriter.h"
+
+typedef std::chrono::steady_clock benchClock;
+
+static double secondsSince(benchClock::time_point start)
+{
+    return std::chrono::duration<double>(benchClock::now() - start).count();
+}
+
+typedef struct saveBenchResult{
+    double written_seconds;         //!< until the executor has written every frame
+    double on_disk_seconds;         //!< until sync returns
+    uint32_t dropped_frames;
+}saveBenchResult;
+
+//! @brief  Queues the frames at once and waits for them to be written
+//! @param  frame Point cloud as assembled by the receiver, shared by every frame queued
+static saveBenchResult measureSave(const QString &folder, std::shared_ptr<const int32_t> frame, int frames,
+                                   bool session_container, bool compressed, int workers)
+{
+    QDir(folder).removeRecursively();
+    QDir().mkpath(folder);
+#ifndef _WIN32
+    sync();
+#endif
+
+    int32_t number_of_points = frame.get()[0];
+    uint64_t frame_bytes = ((uint64_t)number_of_points * 5 + 1) * sizeof(int32_t);
+
+    //!the whole burst fits in the queue, a frame dropped would not be written
+    saveDataManager manager;
+    manager.setDataTypeToSave(pointcloud);
+    manager.setQueueBudget(frame_bytes * frames);
+    saveDataManager::setTotalQueueBudget(frame_bytes * frames);
+    manager.startController();
+
+    std::shared_ptr<sessionContainerWriter> session;
+    if(session_container){
+        session = std::make_shared<sessionContainerWriter>();
+        session->open(folder.toStdString());
+        session->addStream(1, session_format_pointcloud, "lidar");
+        manager.setSessionContainer(session, 1);
+        //!the frames queued keep it, the last one written closes it
+        session.reset();
+    }
+
+    pointCloudSaveDataExecutor *executor = new pointCloudSaveDataExecutor();
+    executor->setSaveDataManager(&manager);
+    executor->setPathToSavePcd(folder + "/");
+    executor->setCompression(compressed);
+    executor->setNumberOfWorkers(workers);
+
+    benchClock::time_point start = benchClock::now();
+    executor->startController();
+    for(int i = 0; i < frames; ++i){
+        manager.doSavePointCloudToBin(frame, number_of_points, 100000000 + i);
+    }
+    manager.setSessionContainer(NULL, 0);
+    manager.stopController();
+    executor->stopController();
+
+    saveBenchResult result;
+    result.written_seconds = secondsSince(start);
+#ifndef _WIN32
+    sync();
+#endif
+    result.on_disk_seconds = secondsSince(start);
+    result.dropped_frames = manager.getQueueStatistics().dropped_frames;
+
+    delete executor;
+    QDir(folder).removeRecursively();
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication application(argc, argv);
+
+    //!the folder should be on the disk the recordings are saved to
+    QString folder = (argc > 1) ? QString(argv[1]) : QString("save_queue_out");
+    int frames = (argc > 2) ? atoi(argv[2]) : 300;
+    const char *file_name = (argc > 3) ? argv[3] : "../../sample_data/115550076.bin";
+
+    //!the sample frame, as the receiver assembles it: the number of points and the points
+    std::vector<int32_t> sample;
+    FILE *file_handler = fopen(file_name, "rb");
+    int32_t number_of_points = 0;
+    if(file_handler != NULL){
+        if(fread(&number_of_points, sizeof(number_of_points), 1, file_handler) == 1 && number_of_points > 0){
+            sample.resize((size_t)number_of_points * 5 + 1);
+            sample[0] = number_of_points;
+            if(fread(&sample[1], sizeof(int32_t) * 5, number_of_points, file_handler) != (size_t)number_of_points){
+                sample.clear();
+            }
+        }
+        fclose(file_handler);
+    }
+    if(sample.empty() || frames <= 0){
+        printf("usage: save_queue [output folder] [frames] [point cloud .bin]\n");
+        return 1;
+    }
+
+    int32_t *frame_buffer = new int32_t[sample.size()];
+    std::copy(sample.begin(), sample.end(), frame_buffer);
+    std::shared_ptr<const int32_t> frame(frame_buffer, std::default_delete<int32_t[]>());
+    double frame_megabytes = sample.size() * sizeof(int32_t) / 1048576.0;
+
+    printf("%d frames of %d points (%.2f MB) to %s\n", frames, number_of_points, frame_megabytes, folder.toStdString().c_str());
+    printf("%-8s %-10s %7s %14s %14s %12s %8s\n", "target", "format", "workers", "written fps", "on disk fps", "on disk MB/s", "dropped");
+
+    const int worker_counts[] = {1, 2, 4};
+    for(int target = 0; target < 2; ++target){
+        for(int compressed = 0; compressed < 2; ++compressed){
+            for(int workers : worker_counts){
+                saveBenchResult result = measureSave(folder, frame, frames, target == 1, compressed == 1, workers);
+                printf("%-8s %-10s %7d %14.0f %14.0f %12.0f %8u\n", (target == 1) ? "session" : "files",
+                       compressed ? "compressed" : "raw", workers, frames / result.written_seconds, frames / result.on_disk_seconds,
+                       frames * frame_megabytes / result.on_disk_seconds, result.dropped_frames);
+            }
+        }
+    }
+    return 0;
+}
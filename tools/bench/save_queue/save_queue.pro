@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#
+# Benchmark of the point cloud save path, run it from this folder:
+#   qmake && make && ./save_queue [output folder] [frames] [point cloud .bin]
+#
+#-------------------------------------------------
+unix{
+QMAKE_CXXFLAGS += -std=gnu++14
+}
+
+CONFIG += c++14 console release
+CONFIG -= app_bundle
+QT = core
+
+TARGET = save_queue
+TEMPLATE = app
+
+SOURCES += \
+        ../../../BeamagineCore/saveDataManager/pointCloudSaveDataExecutor.cpp \
+        ../../../BeamagineCore/saveDataManager/saveDataManager.cpp \
+        ../../../BeamagineCore/saveDataManager/videoStreamWriter.cpp \
+        ../../../BeamagineCore/sessionContainer/batchedFileWriter.cpp \
+        ../../../BeamagineCore/sessionContainer/sessionContainerWriter.cpp \
+        ../../../BeamagineCore/pointCloudProcessing/pointCloudCodec.cpp \
+        ../../../BeamagineCore/codecs/streamCoder.cpp \
+        saveQueueBench.cpp
+
+HEADERS += \
+        ../../../BeamagineCore/saveDataManager/pointCloudSaveDataExecutor.h \
+        ../../../BeamagineCore/saveDataManager/saveDataManager.h \
+        ../../../BeamagineCore/saveDataManager/videoStreamWriter.h \
+        ../../../BeamagineCore/sessionContainer/batchedFileWriter.h \
+        ../../../BeamagineCore/sessionContainer/sessionContainerWriter.h \
+        ../../../BeamagineCore/pointCloudProcessing/pointCloudCodec.h \
+        ../../../BeamagineCore/codecs/streamCoder.h
+
+INCLUDEPATH += \
+        ../../../libs/libL3Cam/ \
+        ../../../BeamagineCore/saveDataManager/ \
+        ../../../BeamagineCore/sessionContainer/ \
+        ../../../BeamagineCore/pointCloudProcessing/ \
+        ../../../BeamagineCore/codecs/ \
+        ../../../BeamagineCore/
+
+#FFMPEG, saveDataManager also hands the camera frames to videoStreamWriter
+LIBS += -lavformat \
+    -lavcodec \
+    -lswscale \
+    -lavutil
@@ -0,0 +1,185 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//! Sustained write rate of the session container: records of the size of a compressed
+//! camera frame are appended to 1 GB segments with every backend of batchedFileWriter,
+//! through the page cache and with direct I/O. The time counts until the writer is closed
+//! and until the segments are on disk (sync), run it on the disk the recordings go to.
+//! The session is read back afterwards and every record is checked.
+
+#include <QCoreApplication>
+#include <QDir>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "sessionContainerReader.h"
+#include "sessionContainerWriter.h"
+
+typedef std::chrono::steady_clock benchClock;
+
+//! About a PNG of a 1920x1080 frame
+static const uint32_t record_bytes = 1200000;
+
+static const uint64_t segment_bytes = 1024ull * 1024 * 1024;
+
+static const uint16_t number_of_streams = 3;
+
+static double secondsSince(benchClock::time_point start)
+{
+    return std::chrono::duration<double>(benchClock::now() - start).count();
+}
+
+static void syncDisk()
+{
+#ifndef _WIN32
+    sync();
+#endif
+}
+
+//! @brief  Fills the payload of a record with its number, so a record read back from the
+//!         wrong place or a stale chunk is found
+static void fillRecord(std::vector<uint8_t> &payload, uint32_t record)
+{
+    for(size_t i = 0; i + sizeof(record) <= payload.size(); i += 4096){
+        uint32_t value = record + (uint32_t)i;
+        memcpy(&payload[i], &value, sizeof(value));
+    }
+}
+
+static bool checkRecord(const sessionRecordView &view, uint32_t record)
+{
+    if(view.payload_bytes != record_bytes || view.device_timestamp != record){
+        return false;
+    }
+    for(size_t i = 0; i + sizeof(record) <= view.payload_bytes; i += 4096){
+        uint32_t value;
+        memcpy(&value, &view.payload[i], sizeof(value));
+        if(value != record + (uint32_t)i){
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct writeBenchResult{
+    double written_seconds;         //!< until the writer is closed
+    double on_disk_seconds;         //!< until sync returns
+    sessionContainerStatistics statistics;
+    bool valid;                     //!< every record was read back as written
+}writeBenchResult;
+
+static writeBenchResult measureWrite(const QString &folder, uint64_t total_bytes, const batchedWriterSettings &settings)
+{
+    writeBenchResult result;
+    memset(&result, 0, sizeof(result));
+
+    QDir(folder).removeRecursively();
+    QDir().mkpath(folder);
+    syncDisk();
+
+    std::vector<uint8_t> payload(record_bytes, 0x5A);
+    uint32_t records = (uint32_t)((total_bytes + record_bytes - 1) / record_bytes);
+
+    benchClock::time_point start = benchClock::now();
+    sessionContainerWriter writer;
+    if(!writer.open(folder.toStdString(), segment_bytes, settings)){
+        return result;
+    }
+    for(uint16_t stream = 1; stream <= number_of_streams; ++stream){
+        writer.addStream(stream, session_format_pointcloud, "stream");
+    }
+    bool written = true;
+    for(uint32_t record = 0; record < records && written; ++record){
+        fillRecord(payload, record);
+        written = writer.writeRecord(1 + record % number_of_streams, session_format_pointcloud, record, payload.data(), record_bytes);
+    }
+    writer.close();
+    result.written_seconds = secondsSince(start);
+    syncDisk();
+    result.on_disk_seconds = secondsSince(start);
+    result.statistics = writer.getStatistics();
+
+    sessionContainerReader reader;
+    result.valid = written && reader.open(folder.toStdString());
+    for(uint16_t stream = 1; stream <= number_of_streams && result.valid; ++stream){
+        size_t count = reader.getNumberOfRecords(stream);
+        result.valid = count == (records + number_of_streams - stream) / number_of_streams;
+        for(size_t position = 0; position < count && result.valid; ++position){
+            sessionRecordView view;
+            result.valid = reader.getRecord(stream, position, view) &&
+                    checkRecord(view, (uint32_t)(position * number_of_streams + stream - 1));
+        }
+    }
+    reader.close();
+
+    QDir(folder).removeRecursively();
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication application(argc, argv);
+
+    //!the folder should be on the disk the recordings are saved to
+    QString folder = (argc > 1) ? QString(argv[1]) : QString("session_writer_out");
+    uint64_t megabytes = (argc > 2) ? strtoull(argv[2], NULL, 10) : 3072;
+    if(megabytes == 0){
+        printf("usage: session_writer [output folder] [MB]\n");
+        return 1;
+    }
+
+    printf("%llu MB in records of %u bytes, segments of %llu MB, to %s\n", (unsigned long long)megabytes, record_bytes,
+           (unsigned long long)(segment_bytes >> 20), folder.toStdString().c_str());
+    printf("%-20s %-9s %12s %14s %9s %6s\n", "settings", "backend", "written MB/s", "on disk MB/s", "waits", "check");
+
+    const char *backend_names[] = {"stdio", "pwritev", "io_uring"};
+    bool valid = true;
+    for(int direct_io = 0; direct_io < 2; ++direct_io){
+        for(int use_io_uring = 0; use_io_uring < 2; ++use_io_uring){
+            batchedWriterSettings settings = batchedFileWriter::defaultSettings();
+            settings.use_io_uring = use_io_uring == 1;
+            settings.direct_io = direct_io == 1;
+            settings.preallocate_bytes = segment_bytes;
+
+            writeBenchResult result = measureWrite(folder, megabytes << 20, settings);
+            QString name = QString(use_io_uring ? "io_uring" : "pwritev") + QString(direct_io ? " + O_DIRECT" : "");
+            printf("%-20s %-9s %12.0f %14.0f %9llu %6s\n", name.toStdString().c_str(), backend_names[result.statistics.backend],
+                   megabytes / result.written_seconds, megabytes / result.on_disk_seconds,
+                   (unsigned long long)result.statistics.waits, result.valid ? "ok" : "FAILED");
+            valid = valid && result.valid;
+        }
+    }
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# Benchmark of the session container writer, run it from this folder:
+#   qmake && make && ./session_writer [output folder] [MB]
+#
+#-------------------------------------------------
+unix{
+QMAKE_CXXFLAGS += -std=gnu++14
+}
+
+CONFIG += c++14 console release
+CONFIG -= app_bundle
+QT = core
+
+TARGET = session_writer
+TEMPLATE = app
+
+SOURCES += \
+        ../../../BeamagineCore/codecs/streamCoder.cpp \
+        ../../../BeamagineCore/pointCloudProcessing/pointCloudCodec.cpp \
+        ../../../BeamagineCore/sessionContainer/batchedFileWriter.cpp \
+        ../../../BeamagineCore/sessionContainer/sessionContainerReader.cpp \
+        ../../../BeamagineCore/sessionContainer/sessionContainerWriter.cpp \
+        sessionWriterBench.cpp
+
+HEADERS += \
+        ../../../BeamagineCore/codecs/streamCoder.h \
+        ../../../BeamagineCore/pointCloudProcessing/pointCloudCodec.h \
+        ../../../BeamagineCore/sessionContainer/batchedFileWriter.h \
+        ../../../BeamagineCore/sessionContainer/sessionContainerFormat.h \
+        ../../../BeamagineCore/sessionContainer/sessionContainerReader.h \
+        ../../../BeamagineCore/sessionContainer/sessionContainerWriter.h
+
+INCLUDEPATH += \
+        ../../../libs/libL3Cam/ \
+        ../../../BeamagineCore/codecs/ \
+        ../../../BeamagineCore/pointCloudProcessing/ \
+        ../../../BeamagineCore/sessionContainer/ \
+        ../../../BeamagineCore/
@@ -0,0 +1,37 @@
+#-------------------------------------------------
+#
+# Round trip check of the codecs of the recordings, run it from this folder:
+#   qmake && make && ./codec_check [thermal frame .bin] [point cloud .bin]
+#
+#-------------------------------------------------
+unix{
+QMAKE_CXXFLAGS += -std=gnu++14
+}
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+QT = core
+
+TARGET = codec_check
+TEMPLATE = app
+
+SOURCES += \
+        ../../BeamagineCore/codecs/streamCoder.cpp \
+        ../../BeamagineCore/pointCloudProcessing/pointCloudCodec.cpp \
+        ../../BeamagineCore/saveDataManager/temperatureCodec.cpp \
+        codecCheck.cpp \
+        pointCloudCodecCheck.cpp \
+        temperatureCodecCheck.cpp
+
+HEADERS += \
+        ../../BeamagineCore/codecs/streamCoder.h \
+        ../../BeamagineCore/pointCloudProcessing/pointCloudCodec.h \
+        ../../BeamagineCore/saveDataManager/temperatureCodec.h \
+        codecCheck.h
+
+INCLUDEPATH += \
+        ../../libs/libL3Cam/ \
+        ../../BeamagineCore/codecs/ \
+        ../../BeamagineCore/pointCloudProcessing/ \
+        ../../BeamagineCore/saveDataManager/ \
+        ../../BeamagineCore/
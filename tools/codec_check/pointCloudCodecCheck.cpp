@@ -0,0 +1,165 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//! Round trip of pointCloudCodec: every point has to come back bit exact, and the sample frame
+//! has to be coded at least 3 times smaller than its raw .bin file.
+
+#include "codecCheck.h"
+#include "pointCloudCodec.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+//! Smallest compression of the sample frame, the recordings are expected to take 3 to 4 times less
+static const double min_sample_ratio = 3.0;
+
+//! @brief  Codes and decodes a frame and compares every point with the original
+//! @param  min_ratio Smallest raw .bin size divided by the encoded size, 0 to not check it
+//! @return false if a point is not given back bit exact or the frame is coded too large
+static bool checkRoundTrip(pointCloudCodec &codec, const std::vector<tPointPcd> &points, double min_ratio, const char *name)
+{
+    std::vector<uint8_t> encoded;
+    codec.encode(points.data(), points.size(), encoded);
+
+    bool valid = pointCloudCodec::getNumberOfPoints(encoded.data(), encoded.size()) == (int32_t)points.size();
+    std::vector<tPointPcd> decoded(points.size());
+    valid = valid && codec.decode(encoded.data(), encoded.size(), decoded.data());
+
+    size_t wrong_points = 0;
+    for(size_t i = 0; valid && i < points.size(); ++i){
+        if(memcmp(&points[i], &decoded[i], sizeof(tPointPcd)) != 0){
+            ++wrong_points;
+        }
+    }
+
+    //!the raw .bin file is the number of points and the points
+    size_t raw_bytes = sizeof(int32_t) + points.size() * sizeof(tPointPcd);
+    double ratio = (double)raw_bytes / encoded.size();
+    bool small_enough = ratio >= min_ratio;
+
+    bool passed = valid && wrong_points == 0 && small_enough;
+    printf("%-28s %-8s %8zu points %9zu -> %8zu bytes, ratio %.2f %s\n", name, "bpc",
+           points.size(), raw_bytes, encoded.size(), ratio, passed ? "ok" : "FAILED");
+    if(!valid){
+        printf("    the frame could not be decoded\n");
+    }else if(wrong_points > 0){
+        printf("    %zu points are not the same\n", wrong_points);
+    }else if(!small_enough){
+        printf("    coded less than %.1f times smaller than the raw frame\n", min_ratio);
+    }
+    return passed;
+}
+
+//! @brief  Checks that a frame cut short is refused instead of decoded out of its bytes
+static bool checkTruncated(pointCloudCodec &codec, const std::vector<tPointPcd> &points, const char *name)
+{
+    std::vector<uint8_t> encoded;
+    codec.encode(points.data(), points.size(), encoded);
+
+    std::vector<tPointPcd> decoded(points.size());
+    bool refused = true;
+    const size_t cuts[] = {encoded.size() / 2, encoded.size() - 1, sizeof(pointCloudCodecHeader) - 1};
+    for(size_t bytes : cuts){
+        //!a copy of the exact size, so reading past it is caught by the sanitizers
+        std::vector<uint8_t> truncated(encoded.begin(), encoded.begin() + bytes);
+        if(codec.decode(truncated.data(), truncated.size(), decoded.data())){
+            refused = false;
+        }
+    }
+
+    printf("%-28s %-8s %8zu points, cut short %s\n", name, "bpc", points.size(), refused ? "ok" : "FAILED");
+    if(!refused){
+        printf("    a frame cut short was decoded\n");
+    }
+    return refused;
+}
+
+int checkPointCloudCodec(const char *file_name)
+{
+    std::vector<tPointPcd> sample;
+    FILE *file_handler = fopen(file_name, "rb");
+    int32_t number_of_points = 0;
+    if(file_handler != NULL){
+        if(fread(&number_of_points, sizeof(number_of_points), 1, file_handler) == 1 && number_of_points > 0){
+            sample.resize(number_of_points);
+            sample.resize(fread(sample.data(), sizeof(tPointPcd), number_of_points, file_handler));
+        }
+        fclose(file_handler);
+    }
+    if(sample.empty() || (int32_t)sample.size() != number_of_points){
+        printf("%s is not a point cloud frame\n", file_name);
+        return 1;
+    }
+
+    std::mt19937 generator(1);
+    std::vector<std::pair<const char*, std::vector<tPointPcd> > > frames;
+
+    frames.push_back(std::make_pair("empty", std::vector<tPointPcd>()));
+    frames.push_back(std::make_pair("one point", std::vector<tPointPcd>(sample.begin(), sample.begin() + 1)));
+
+    //!the deltas of the points out of scan order are larger
+    std::vector<tPointPcd> shuffled = sample;
+    std::shuffle(shuffled.begin(), shuffled.end(), generator);
+    frames.push_back(std::make_pair("sample shuffled", shuffled));
+
+    //!more colors than the palette takes, coded as byte deltas
+    std::vector<tPointPcd> random_colors = sample;
+    for(size_t i = 0; i < random_colors.size(); ++i){
+        random_colors[i].RGB = (int32_t)generator();
+    }
+    frames.push_back(std::make_pair("sample, random colors", random_colors));
+
+    //!the deltas of the extreme values wrap around the int32
+    std::vector<tPointPcd> random_bits(64 * 64);
+    for(size_t i = 0; i < random_bits.size(); ++i){
+        random_bits[i].x = (int32_t)generator();
+        random_bits[i].y = (int32_t)generator();
+        random_bits[i].z = (int32_t)generator();
+        random_bits[i].intensity = (int32_t)generator();
+        random_bits[i].RGB = (int32_t)generator();
+    }
+    frames.push_back(std::make_pair("random bits", random_bits));
+
+    pointCloudCodec codec;
+    int failed = 0;
+    if(!checkRoundTrip(codec, sample, min_sample_ratio, "sample")){
+        ++failed;
+    }
+    for(size_t i = 0; i < frames.size(); ++i){
+        if(!checkRoundTrip(codec, frames[i].second, 0.0, frames[i].first)){
+            ++failed;
+        }
+    }
+    if(!checkTruncated(codec, sample, "sample")){
+        ++failed;
+    }
+
+    return failed;
+}
@@ -0,0 +1,191 @@
+/*  Copyright (c) 2023, Beamagine
+ *
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without modification,
+    are permitted provided that the following conditions are met:
+
+        - Redistributions of source code must retain the above copyright notice,
+          this list of conditions and the following disclaimer.
+        - Redistributions in binary form must reproduce the above copyright notice,
+          this list of conditions and the following disclaimer in the documentation and/or
+          other materials provided with the distribution.
+        - Neither the name of copyright holders nor the names of its contributors may be
+          used to endorse or promote products derived from this software without specific
+          prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS “AS IS” AND ANY
+    EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+    MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+    COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+    EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+    HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+    TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+    EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+//! Round trip of temperatureCodec in its three encodings: lossless has to give back every bit,
+//! fixed16 and half every temperature within the error of their steps.
+
+#include "codecCheck.h"
+#include "temperatureCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+static const char *encoding_names[] = {"raw", "fixed16", "half", "lossless"};
+
+//! Largest half float, the values from the middle of the last step up round to infinity
+static const float half_max = 65504.0f;
+static const float half_overflow = 65520.0f;
+
+//! @brief  Returns the largest error of a temperature coded as a half float, half a step: 11
+//!         significant bits, fixed steps of 2^-24 below the smallest normal half
+static double halfMaxError(float value)
+{
+    return std::max(std::fabs((double)value) * std::ldexp(1.0, -11), std::ldexp(1.0, -25));
+}
+
+//! @brief  Returns the largest error of a fixed16 temperature, half a step, plus the rounding
+//!         of the float the offset and the steps are added to
+static double fixed16MaxError(float value, float scale)
+{
+    return scale / 2.0 + std::fabs((double)value) * std::numeric_limits<float>::epsilon();
+}
+
+//! @brief  Codes and decodes a buffer and checks every temperature decoded
+//! @return false if the round trip is not within the error of the encoding
+static bool checkRoundTrip(temperatureCodec &codec, const std::vector<float> &values, uint32_t width, uint8_t encoding, const char *name)
+{
+    std::vector<uint8_t> encoded;
+    codec.encode(values.data(), values.size(), width, encoding, encoded);
+
+    temperatureCodecHeader header;
+    memcpy(&header, encoded.data(), sizeof(header));
+
+    bool valid = temperatureCodec::getNumberOfValues(encoded.data(), encoded.size()) == (int64_t)values.size();
+    std::vector<float> decoded(values.size());
+    valid = valid && codec.decode(encoded.data(), encoded.size(), decoded.data());
+
+    double max_error = 0.0;
+    size_t wrong_values = 0;
+    for(size_t i = 0; valid && i < values.size(); ++i){
+        float value = values[i];
+        float result = decoded[i];
+        bool right = true;
+
+        if(encoding == temperature_encoding_lossless){
+            right = memcmp(&value, &result, sizeof(value)) == 0;
+        }else if(std::isnan(value)){
+            //!fixed16 takes the values that are not finite as the step 0
+            right = (encoding == temperature_encoding_fixed16) ? (result == header.offset) : std::isnan(result);
+        }else if(std::isinf(value)){
+            right = (encoding == temperature_encoding_fixed16) ? (result == header.offset) : (result == value);
+        }else if(encoding == temperature_encoding_half && std::fabs(value) >= half_overflow){
+            right = std::isinf(result) && std::signbit(result) == std::signbit(value);
+        }else{
+            double error = std::fabs((double)result - (double)value);
+            double allowed = (encoding == temperature_encoding_fixed16) ? fixed16MaxError(value, header.scale) :
+                                                                           halfMaxError(std::min(std::fabs(value), half_max));
+            right = error <= allowed;
+            max_error = std::max(max_error, error);
+        }
+
+        if(!right){
+            ++wrong_values;
+        }
+    }
+
+    bool passed = valid && wrong_values == 0;
+    printf("%-28s %-8s %8zu values %9zu -> %8zu bytes, max error %g %s\n", name, encoding_names[encoding],
+           values.size(), values.size() * sizeof(float), encoded.size(), max_error, passed ? "ok" : "FAILED");
+    if(!valid){
+        printf("    the frame could not be decoded\n");
+    }else if(wrong_values > 0){
+        printf("    %zu values out of the error of the encoding\n", wrong_values);
+    }
+    return passed;
+}
+
+int checkTemperatureCodec(const char *file_name)
+{
+    const uint32_t sample_width = 320;
+
+    std::vector<float> sample;
+    FILE *file_handler = fopen(file_name, "rb");
+    if(file_handler != NULL){
+        float value;
+        while(fread(&value, sizeof(value), 1, file_handler) == 1){
+            sample.push_back(value);
+        }
+        fclose(file_handler);
+    }
+    if(sample.empty() || sample.size() % sample_width != 0){
+        printf("%s is not a thermal frame of %u values per row\n", file_name, sample_width);
+        return 1;
+    }
+
+    std::mt19937 generator(1);
+    std::vector<std::pair<const char*, std::vector<float> > > buffers;
+    std::vector<uint32_t> widths;
+
+    buffers.push_back(std::make_pair("sample", sample));
+    widths.push_back(sample_width);
+
+    buffers.push_back(std::make_pair("empty", std::vector<float>()));
+    widths.push_back(sample_width);
+
+    //!coded as one row
+    buffers.push_back(std::make_pair("sample, not whole rows", std::vector<float>(sample.begin(), sample.begin() + 3 * sample_width + 17)));
+    widths.push_back(sample_width);
+
+    std::vector<float> below_zero = sample;
+    for(size_t i = 0; i < below_zero.size(); ++i){
+        below_zero[i] -= 30.0f;
+    }
+    buffers.push_back(std::make_pair("sample below 0", below_zero));
+    widths.push_back(sample_width);
+
+    //!wider than the 655 °C of the steps of 0.01 °C, and past the largest half float
+    std::vector<float> ramp(sample.size());
+    for(size_t i = 0; i < ramp.size(); ++i){
+        ramp[i] = -40.0f + 70000.0f * (i % sample_width) / (sample_width - 1);
+    }
+    buffers.push_back(std::make_pair("-40 to 70000 ramp", ramp));
+    widths.push_back(sample_width);
+
+    std::vector<float> special = sample;
+    special[5] = std::numeric_limits<float>::quiet_NaN();
+    special[6] = std::numeric_limits<float>::infinity();
+    special[7] = -std::numeric_limits<float>::infinity();
+    special[8] = -0.0f;
+    special[9] = 1e-7f;
+    buffers.push_back(std::make_pair("NaN, inf and tiny values", special));
+    widths.push_back(sample_width);
+
+    std::vector<float> random_bits(64 * 64);
+    for(size_t i = 0; i < random_bits.size(); ++i){
+        uint32_t bits = generator();
+        memcpy(&random_bits[i], &bits, sizeof(bits));
+    }
+    buffers.push_back(std::make_pair("random bits", random_bits));
+    widths.push_back(64);
+
+    temperatureCodec codec;
+    int failed = 0;
+    for(size_t i = 0; i < buffers.size(); ++i){
+        for(uint8_t encoding = temperature_encoding_fixed16; encoding <= temperature_encoding_lossless; ++encoding){
+            if(!checkRoundTrip(codec, buffers[i].second, widths[i], encoding, buffers[i].first)){
+                ++failed;
+            }
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,96 @@
+import struct
+import sys
+
+import numpy as np
+
+# Decoder of the compressed point clouds (.bpc files and session records),
+# see BeamagineCore/pointCloudProcessing/pointCloudCodec.h
+
+MAX_CODE_BITS = 12
+NUMBER_OF_SYMBOLS = 33
+STREAM_HEADER_BYTES = 4 + (NUMBER_OF_SYMBOLS + 1) // 2
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_stream(data, position, count):
+    stream_bytes = struct.unpack_from("<I", data, position)[0]
+    lengths = []
+    for i in range(NUMBER_OF_SYMBOLS):
+        packed = data[position + 4 + i // 2]
+        lengths.append(packed & 0x0F if i % 2 == 0 else packed >> 4)
+
+    # canonical codes, read lowest bit first
+    table = [None] * (1 << MAX_CODE_BITS)
+    code = 0
+    for length in range(1, MAX_CODE_BITS + 1):
+        for symbol in range(NUMBER_OF_SYMBOLS):
+            if lengths[symbol] == length:
+                reversed_code = int(format(code, "0" + str(length) + "b")[::-1], 2)
+                for high in range(1 << (MAX_CODE_BITS - length)):
+                    table[reversed_code | (high << length)] = (symbol, length)
+                code += 1
+        code <<= 1
+
+    # the bits are read from a copy padded with zeros
+    bits = bytes(data[position + STREAM_HEADER_BYTES:position + stream_bytes]) + bytes(8)
+    bit_position = 0
+    values = np.empty(count, dtype=np.int64)
+    for i in range(count):
+        window = int.from_bytes(bits[bit_position >> 3:(bit_position >> 3) + 8], "little") >> (bit_position & 7)
+        symbol, length = table[window & ((1 << MAX_CODE_BITS) - 1)]
+        window >>= length
+        bit_position += length
+        value = symbol
+        if symbol > 1:
+            value = (1 << (symbol - 1)) | (window & ((1 << (symbol - 1)) - 1))
+            bit_position += symbol - 1
+        values[i] = value
+    return values, position + stream_bytes
+
+
+def decode(data):
+    # returns the points as an array of number_of_points rows of x, y, z, intensity, rgb
+    magic, number_of_points, palette_size, streams = struct.unpack_from("<4siII", data, 0)
+    if magic != b"BPC1":
+        raise ValueError("not a compressed point cloud")
+    position = 16
+    palette = np.frombuffer(data, dtype=np.int32, count=palette_size, offset=position)
+    position += palette_size * 4
+
+    points = np.zeros((number_of_points, 5), dtype=np.int64)
+    for field in range(4):
+        values, position = decode_stream(data, position, number_of_points)
+        points[:, field] = np.cumsum(unzigzag(values))
+
+    if palette_size > 0:
+        values, position = decode_stream(data, position, number_of_points)
+        points[:, 4] = palette[values]
+    else:
+        for lane in range(4):
+            values, position = decode_stream(data, position, number_of_points)
+            points[:, 4] |= (np.cumsum(unzigzag(values)) & 0xFF) << (8 * lane)
+
+    # the values wrap around as the int32 of the frame
+    return points.astype(np.uint32).view(np.int32)
+
+
+def main():
+    # TODO: Change the file name
+    file_name = sys.argv[1] if len(sys.argv) > 1 else "../sample_data/115550076.bpc"
+
+    with open(file_name, "rb") as file:
+        points = decode(file.read())
+
+    print("num points " + str(len(points)))
+
+    # TODO: Uncomment this to convert the point cloud to the raw .bin layout
+    #with open(file_name[:-4] + ".bin", "wb") as file:
+    #    file.write(struct.pack("<i", len(points)))
+    #    file.write(points.tobytes())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+import bisect
+import glob
+import mmap
+import os
+import struct
+import sys
+
+import numpy as np
+
+import pointcloudCodec
+
+# Layout of the session container, see BeamagineCore/sessionContainer/sessionContainerFormat.h
+SEGMENT_HEADER = struct.Struct("<8sIIQ")
+RECORD_HEADER = struct.Struct("<IHHIIQ")
+INDEX_ENTRY = struct.Struct("<QQIIHHI")
+STREAM_ENTRY = struct.Struct("<HHI24s")
+FOOTER = struct.Struct("<QII8s")
+
+RECORD_MAGIC = 0x43455242
+FORMAT_EXTENSIONS = {0: "bin", 1: "png", 2: "bmp", 3: "bin", 4: "bpc", 5: "btc"}
+
+
+def timestamp_to_ms(timestamp):
+    # device timestamps are hhmmssmmm
+    return (((timestamp // 10000000) * 60 + (timestamp // 100000) % 100) * 60 + (timestamp // 1000) % 100) * 1000 + timestamp % 1000
+
+
+class Session:
+    def __init__(self, folder):
+        self.segments = []
+        self.streams = {}
+        # stream -> list of (device_timestamp, host_time_ns, segment, offset, payload_bytes, format)
+        self.records = {}
+
+        for path in sorted(glob.glob(os.path.join(folder, "session_*.bsc"))):
+            with open(path, "rb") as file:
+                data = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+            self.segments.append(data)
+            self._load_segment(len(self.segments) - 1, data)
+
+        # sorted device times of every stream, searched for the nearest record
+        self.keys = {}
+        for stream_id, records in self.records.items():
+            records.sort(key=lambda record: timestamp_to_ms(record[0]))
+            self.keys[stream_id] = [timestamp_to_ms(record[0]) for record in records]
+
+    def _load_segment(self, segment, data):
+        if len(data) < SEGMENT_HEADER.size or data[:8] != b"BEAMSES1":
+            print("not a session segment, skipped")
+            return
+
+        if len(data) >= SEGMENT_HEADER.size + FOOTER.size:
+            index_offset, index_entries, streams, magic = FOOTER.unpack_from(data, len(data) - FOOTER.size)
+            if magic == b"BEAMIDX1":
+                for i in range(index_entries):
+                    offset, host_time_ns, timestamp, payload_bytes, stream_id, fmt, _ = INDEX_ENTRY.unpack_from(data, index_offset + i * INDEX_ENTRY.size)
+                    self.records.setdefault(stream_id, []).append((timestamp, host_time_ns, segment, offset, payload_bytes, fmt))
+                table = index_offset + index_entries * INDEX_ENTRY.size
+                for i in range(streams):
+                    stream_id, fmt, _, name = STREAM_ENTRY.unpack_from(data, table + i * STREAM_ENTRY.size)
+                    self.streams[stream_id] = name.rstrip(b"\0").decode()
+                return
+
+        # segment of an interrupted recording, the record headers are walked instead
+        print("segment " + str(segment) + " without index, walking its records")
+        offset = SEGMENT_HEADER.size
+        while offset + RECORD_HEADER.size <= len(data):
+            magic, stream_id, fmt, timestamp, payload_bytes, host_time_ns = RECORD_HEADER.unpack_from(data, offset)
+            if magic != RECORD_MAGIC or offset + RECORD_HEADER.size + payload_bytes > len(data):
+                break
+            self.records.setdefault(stream_id, []).append((timestamp, host_time_ns, segment, offset, payload_bytes, fmt))
+            self.streams.setdefault(stream_id, "stream " + str(stream_id))
+            offset += RECORD_HEADER.size + ((payload_bytes + 7) & ~7)
+
+    def payload(self, record):
+        # view of the mapped segment, nothing is copied
+        timestamp, host_time_ns, segment, offset, payload_bytes, fmt = record
+        start = offset + RECORD_HEADER.size
+        return memoryview(self.segments[segment])[start:start + payload_bytes]
+
+    def points(self, record):
+        # points of a point cloud record as an array of x, y, z, intensity, rgb rows, decoded if it is compressed
+        fmt = record[5]
+        data = self.payload(record)
+        if fmt == 4:
+            return pointcloudCodec.decode(data)
+        if fmt != 0:
+            raise ValueError("not a point cloud record")
+        number_of_points = struct.unpack_from("<i", data, 0)[0]
+        return np.frombuffer(data, dtype=np.int32, count=number_of_points * 5, offset=4).reshape(number_of_points, 5)
+
+    def nearest(self, stream_id, timestamp):
+        records = self.records.get(stream_id, [])
+        if not records:
+            return None
+        keys = self.keys[stream_id]
+        time = timestamp_to_ms(timestamp)
+        position = bisect.bisect_left(keys, time)
+        if position == len(records) or (position > 0 and time - keys[position - 1] <= keys[position] - time):
+            position -= 1
+        return records[position]
+
+    def export(self, stream_id, folder):
+        # writes every record as the file of the frame would have been saved
+        os.makedirs(folder, exist_ok=True)
+        for record in self.records.get(stream_id, []):
+            file_name = os.path.join(folder, str(record[0]) + "." + FORMAT_EXTENSIONS.get(record[5], "bin"))
+            with open(file_name, "wb") as file:
+                file.write(self.payload(record))
+
+
+def main():
+    # TODO: Change the session folder
+    folder = sys.argv[1] if len(sys.argv) > 1 else "../sample_data/session"
+
+    session = Session(folder)
+    for stream_id, name in sorted(session.streams.items()):
+        print(str(stream_id) + " " + name + ": " + str(len(session.records.get(stream_id, []))) + " records")
+
+    # TODO: Uncomment this to look for the frame of a stream closest to a device timestamp
+    #record = session.nearest(1, 115550076)
+    #points = session.points(record)
+
+    # TODO: Uncomment this to convert a stream to one file per frame
+    #session.export(1, "pointcloud")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+import os
+import struct
+import sys
+
+import numpy as np
+
+from pointcloudCodec import decode_stream
+
+# Decoder of the compressed temperatures (.btc files and session records),
+# see BeamagineCore/saveDataManager/temperatureCodec.h
+
+HEADER = struct.Struct("<4sIIIff")
+ENCODINGS = {1: "fixed16", 2: "half", 3: "lossless"}
+
+
+def predict(samples, row, column, width):
+    # median predictor of LOCO-I, the left or upper value at the edges
+    i = row * width + column
+    if row == 0:
+        return 0 if column == 0 else samples[i - 1]
+    if column == 0:
+        return samples[i - width]
+    left, up, up_left = samples[i - 1], samples[i - width], samples[i - width - 1]
+    if up_left >= max(left, up):
+        return min(left, up)
+    if up_left <= min(left, up):
+        return max(left, up)
+    return left + up - up_left
+
+
+def decode(data):
+    # returns the temperatures as an array of rows of width values and the header
+    magic, number_of_values, width, encoding, offset, scale = HEADER.unpack_from(data, 0)
+    if magic != b"BTC1" or encoding not in ENCODINGS:
+        raise ValueError("not compressed temperatures")
+    residuals, _ = decode_stream(data, HEADER.size, number_of_values)
+    residuals = [(value >> 1) ^ -(value & 1) for value in residuals.tolist()]
+
+    # the samples wrap around as 32 bit values
+    samples = [0] * number_of_values
+    for i in range(number_of_values):
+        samples[i] = (predict(samples, i // width, i % width, width) + residuals[i]) & 0xFFFFFFFF
+    samples = np.array(samples, dtype=np.uint32)
+
+    if encoding == 1:
+        values = (offset + (samples & 0xFFFF).astype(np.float64) * scale).astype(np.float32)
+    elif encoding == 2:
+        # the samples sort as the half floats, the negative ones are inverted
+        bits = np.where(samples & 0x8000, samples & 0x7FFF, ~samples & 0xFFFF).astype(np.uint16)
+        values = bits.view(np.float16).astype(np.float32)
+    else:
+        bits = np.where(samples & 0x80000000, samples & 0x7FFFFFFF, ~samples).astype(np.uint32)
+        values = bits.view(np.float32)
+
+    rows = number_of_values // width if width else 0
+    return values.reshape((rows, width)), (encoding, offset, scale)
+
+
+def compare(values, reference, header):
+    # checks a decoded frame against the raw .bin of the same frame
+    encoding, offset, scale = header
+    values = values.ravel()
+    if values.tobytes() == reference.tobytes():
+        return "exact, every bit of the " + str(len(values)) + " values"
+    finite = np.isfinite(reference)
+    error = np.abs(values[finite].astype(np.float64) - reference[finite])
+    text = "max error " + str(error.max()) + " " + ENCODINGS[encoding]
+    if encoding == 1:
+        # rounded to the nearest step, the float of the result adds its own rounding
+        text += ", within half a step" if error.max() <= scale / 2 + 1e-5 * np.abs(reference[finite]).max() else ", TOO LARGE"
+    return text
+
+
+def main():
+    # TODO: Change the file name
+    file_name = sys.argv[1] if len(sys.argv) > 1 else "../sample_data/115616410.btc"
+
+    with open(file_name, "rb") as file:
+        values, header = decode(file.read())
+
+    print(ENCODINGS[header[0]] + " " + str(values.shape[1]) + "x" + str(values.shape[0]) +
+          " min value: " + str(values.min()) + " max value: " + str(values.max()))
+
+    # the raw frame, if it was saved too, must come back as it was
+    reference_name = file_name[:-4] + ".bin"
+    if os.path.exists(reference_name):
+        reference = np.fromfile(reference_name, dtype=np.float32)
+        if reference.size != values.size:
+            print("the frame has " + str(values.size) + " values, " + reference_name + " has " + str(reference.size))
+        else:
+            print(compare(values, reference, header))
+
+    # TODO: Uncomment this to convert the temperatures to the raw .bin layout
+    #values.tofile(file_name[:-4] + ".bin")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,68 @@
+import bisect
+import csv
+import sys
+
+import cv2
+
+# Reader of the camera streams recorded as video, every video has an index (.csv) with the
+# device timestamp and the host time of its frames, see BeamagineCore/saveDataManager/videoStreamWriter.h
+
+
+def timestamp_to_ms(timestamp):
+    # device timestamps are hhmmssmmm
+    return (((timestamp // 10000000) * 60 + (timestamp // 100000) % 100) * 60 + (timestamp // 1000) % 100) * 1000 + timestamp % 1000
+
+
+class Video:
+    def __init__(self, file_name):
+        self.capture = cv2.VideoCapture(file_name)
+        # frame number, device timestamp and host time of every frame, in the order of the video
+        with open(file_name[:file_name.rfind(".")] + ".csv", newline="") as index_file:
+            self.frames = [(int(row["frame"]), int(row["timestamp"]), int(row["host_time_ms"])) for row in csv.DictReader(index_file)]
+        self.keys = [timestamp_to_ms(frame[1]) for frame in self.frames]
+        self.next_frame = 0
+
+    def nearest(self, timestamp):
+        # frame number closest to a device timestamp
+        if not self.frames:
+            return None
+        time = timestamp_to_ms(timestamp)
+        position = bisect.bisect_left(self.keys, time)
+        if position == len(self.frames) or (position > 0 and time - self.keys[position - 1] <= self.keys[position] - time):
+            position -= 1
+        return self.frames[position][0]
+
+    def read(self, frame_number):
+        # the decoder seeks to the previous key frame, reading the frames in order does not seek
+        if frame_number != self.next_frame:
+            self.capture.set(cv2.CAP_PROP_POS_FRAMES, frame_number)
+        ok, image = self.capture.read()
+        self.next_frame = frame_number + 1
+        return image if ok else None
+
+    def export(self, folder, extension="png"):
+        # writes every frame as the image file it would have been saved to
+        for frame_number, timestamp, host_time_ms in self.frames:
+            image = self.read(frame_number)
+            if image is not None:
+                cv2.imwrite(folder + "/" + str(timestamp) + "." + extension, image)
+
+
+def main():
+    # TODO: Change the file name
+    file_name = sys.argv[1] if len(sys.argv) > 1 else "../sample_data/115550153_rgb.mp4"
+
+    video = Video(file_name)
+    print(str(len(video.frames)) + " frames")
+
+    # TODO: Uncomment this to show the frame closest to a device timestamp
+    #image = video.read(video.nearest(115550186))
+    #cv2.imshow("frame", image)
+    #cv2.waitKey(0)
+
+    # TODO: Uncomment this to convert the video to one image per frame
+    #video.export("rgb")
+
+
+if __name__ == "__main__":
+    main()